@@ -136,7 +136,10 @@ namespace canvas
     PropertyBasedElement(node),
     _event_manager(new EventManager),
     _status(node, "status"),
-    _status_msg(node, "status-msg")
+    _status_msg(node, "status-msg"),
+    _update_stats(new Element::UpdateStats),
+    _status_elements_visited(node, "status-elements-visited"),
+    _status_elements_updated(node, "status-elements-updated")
   {
     // Looks like we need to propogate value changes upwards.
     node->setAttribute(SGPropertyNode::VALUE_CHANGED_DOWN, true);
@@ -144,6 +147,7 @@ namespace canvas
     setStatusFlags(MISSING_SIZE_X | MISSING_SIZE_Y);
 
     _root_group.reset( new Group(this, _node) );
+    _root_group->setUpdateStats(_update_stats);
 
     // Remove automatically created property listener as we forward them on our
     // own
@@ -391,7 +395,14 @@ namespace canvas
     else
       _texture.setRender(false);
 
-    _root_group->update(delta_time_sec);
+    // Only descend into subtrees which have changed since the last frame
+    _update_stats->visited = 1;
+    _update_stats->updated = 0;
+    if( _root_group->isUpdatePending() )
+      _root_group->update(delta_time_sec);
+
+    _status_elements_visited = _update_stats->visited;
+    _status_elements_updated = _update_stats->updated;
 
     if( _sampling_dirty )
     {
@@ -237,6 +237,11 @@ namespace canvas
       PropertyObject<int>           _status;
       PropertyObject<std::string>   _status_msg;
 
+      /// Number of elements checked and updated during the last frame
+      Element::UpdateStatsPtr       _update_stats;
+      PropertyObject<int>           _status_elements_visited;
+      PropertyObject<int>           _status_elements_updated;
+
       bool _sampling_dirty {false},
            _anisotropy_dirty {false},
            _render_dirty {true},
@@ -23,6 +23,8 @@
 #include "Canvas.hxx"
 #include "CanvasEventManager.hxx"
 
+#include <vg/openvg.h>
+
 // Used by ShaderVG to find the shader source files in fgdata
 static std::string simgearShaderRootPath = "";
 extern "C" void *
@@ -62,7 +64,8 @@ namespace canvas
 
   //----------------------------------------------------------------------------
   CanvasMgr::CanvasMgr(SGPropertyNode_ptr node):
-    PropertyBasedMgr(node, "texture", &canvasFactory)
+    PropertyBasedMgr(node, "texture", &canvasFactory),
+    _tess_stats(node->getNode("tessellation-stats", true))
   {
 
   }
@@ -85,6 +88,26 @@ namespace canvas
     return static_cast<Canvas*>( getElement(name).get() );
   }
 
+  //----------------------------------------------------------------------------
+  void CanvasMgr::update(double delta_time_sec)
+  {
+    PropertyBasedMgr::update(delta_time_sec);
+
+    if( !vgHasContextSH() )
+      return;
+
+    // Counted while drawing, so these are the numbers of the last frame
+    VGint stats[VG_TESS_STATS_COUNT_SH] = {0};
+    vgGetTessellationStatsSH(stats, VG_TESS_STATS_COUNT_SH, VG_TRUE);
+
+    _tess_stats->setIntValue("fill-cache-hits", stats[VG_TESS_CACHE_HITS_SH]);
+    _tess_stats->setIntValue("fill-cache-misses", stats[VG_TESS_CACHE_MISSES_SH]);
+    _tess_stats->setIntValue("fill-vertices", stats[VG_TESS_VERTICES_SH]);
+    _tess_stats->setIntValue("stroke-cache-hits", stats[VG_STROKE_CACHE_HITS_SH]);
+    _tess_stats->setIntValue("stroke-cache-misses", stats[VG_STROKE_CACHE_MISSES_SH]);
+    _tess_stats->setIntValue("stroke-vertices", stats[VG_STROKE_VERTICES_SH]);
+  }
+
   //----------------------------------------------------------------------------
   void CanvasMgr::elementCreated(PropertyBasedElementPtr element)
   {
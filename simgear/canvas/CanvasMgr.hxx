@@ -68,8 +68,16 @@ public:
      */
     void setShaderRoot(const SGPath &path) const;
 
+    /**
+     * Update all canvasses, and publish the path tessellation cache
+     * counters of the frame below tessellation-stats/
+     */
+    void update(double delta_time_sec) override;
+
 protected:
     void elementCreated(PropertyBasedElementPtr element) override;
+
+    SGPropertyNode_ptr _tess_stats;
 };
 
 } // namespace canvas
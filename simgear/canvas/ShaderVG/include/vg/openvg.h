@@ -386,6 +386,16 @@ typedef enum {
     VG_BLEND_DST_ATOP_SH    = 0x200D
 } VGBlendMode;
 
+typedef enum {
+    VG_TESS_CACHE_HITS_SH                       = 0,
+    VG_TESS_CACHE_MISSES_SH                     = 1,
+    VG_STROKE_CACHE_HITS_SH                     = 2,
+    VG_STROKE_CACHE_MISSES_SH                   = 3,
+    VG_TESS_VERTICES_SH                         = 4,
+    VG_STROKE_VERTICES_SH                       = 5,
+    VG_TESS_STATS_COUNT_SH                      = 6
+} VGTessellationStatSH;
+
 typedef enum {
     VG_IMAGE_FORMAT_QUERY  = 0x2100,
     VG_PATH_DATATYPE_QUERY = 0x2101
@@ -631,6 +641,11 @@ VG_API_CALL void vgResizeSurfaceSH(VGint width, VGint height);
 VG_API_CALL void vgSetOrtho2DSH(VGint left, VGint right, VGint bottom, VGint top);
 VG_API_CALL void vgDestroyContextSH(void);
 
+/* Same interface as ShivaVG, which caches tessellated paths. ShaderVG has no
+   such cache, so all counters are zero. */
+VG_API_CALL void vgGetTessellationStatsSH(VGint *stats, VGint count,
+                                          VGboolean reset);
+
 /* Extensions for ShaderVG */
 #define VG_FRAGMENT_SHADER_SH 0
 #define VG_VERTEX_SHADER_SH 1
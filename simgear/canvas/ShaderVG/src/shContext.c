@@ -69,6 +69,14 @@ VG_API_CALL VGboolean vgHasContextSH()
     return g_context != NULL;
 }
 
+VG_API_CALL void vgGetTessellationStatsSH(VGint *stats, VGint count,
+                                          VGboolean reset)
+{
+    int i;
+    for (i = 0; i < count && i < VG_TESS_STATS_COUNT_SH; ++i)
+        stats[i] = 0;
+}
+
 VG_API_CALL void vgResizeSurfaceSH(VGint width, VGint height)
 {
     VG_GETCONTEXT(VG_NO_RETVAL);
@@ -387,6 +387,16 @@ typedef enum {
   VG_BLEND_DST_ATOP_SH                        = 0x200D
 } VGBlendMode;
 
+typedef enum {
+  VG_TESS_CACHE_HITS_SH                       = 0,
+  VG_TESS_CACHE_MISSES_SH                     = 1,
+  VG_STROKE_CACHE_HITS_SH                     = 2,
+  VG_STROKE_CACHE_MISSES_SH                   = 3,
+  VG_TESS_VERTICES_SH                         = 4,
+  VG_STROKE_VERTICES_SH                       = 5,
+  VG_TESS_STATS_COUNT_SH                      = 6
+} VGTessellationStatSH;
+
 typedef enum {
   VG_IMAGE_FORMAT_QUERY                       = 0x2100,
   VG_PATH_DATATYPE_QUERY                      = 0x2101
@@ -625,6 +635,7 @@ VG_API_CALL const VGubyte * vgGetString(VGStringID name);
 #define OVG_SH_blend_dst_out          1
 #define OVG_SH_blend_src_atop         1
 #define OVG_SH_blend_dst_atop         1
+#define OVG_SH_tessellation_stats     1
 
 VG_API_CALL VGboolean vgCreateContextSH(VGint width, VGint height);
 VG_API_CALL VGboolean vgHasContextSH();
@@ -632,6 +643,11 @@ VG_API_CALL void vgResizeSurfaceSH(VGint width, VGint height);
 VG_API_CALL void vgSetOrtho2DSH(VGint left, VGint right, VGint bottom, VGint top);
 VG_API_CALL void vgDestroyContextSH(void);
 
+/* Query tessellation cache counters accumulated since the last reset, eg. to
+   get per frame statistics by querying with reset once every frame. */
+VG_API_CALL void vgGetTessellationStatsSH(VGint *stats, VGint count,
+                                          VGboolean reset);
+
 
 #if defined (__cplusplus)
 } /* extern "C" */
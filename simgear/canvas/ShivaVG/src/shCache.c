@@ -0,0 +1,348 @@
+/*
+ * shCache.c - tessellation cache shared by all paths of a context
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#include <vg/openvg.h>
+#include "shCache.h"
+#include <string.h>
+#include <stdlib.h>
+
+struct SHTessCacheEntry
+{
+  SHuint32 hash;
+
+  /* Key: raw path data and linear part of the flattening transform */
+  VGPathDatatype datatype;
+  SHfloat scale;
+  SHfloat bias;
+  SHfloat linear[4];
+  SHint segCount;
+  SHint dataSize;
+  SHuint8 *segs;
+  SHuint8 *data;
+
+  /* Flattened geometry in path space */
+  SHVertexArray vertices;
+  SHVector2 min, max;
+
+  /* Stroke for the most recently used stroke parameters */
+  VGboolean strokeValid;
+  SHfloat strokeLineWidth;
+  VGCapStyle strokeCapStyle;
+  VGJoinStyle strokeJoinStyle;
+  SHfloat strokeMiterLimit;
+  SHfloat strokeDashPhase;
+  VGboolean strokeDashPhaseReset;
+  SHFloatArray strokeDashPattern;
+  SHVector2Array stroke;
+
+  SHTessCacheEntry *next;
+  SHTessCacheEntry *lruPrev;
+  SHTessCacheEntry *lruNext;
+};
+
+/*-----------------------------------------------------
+ * Key helpers
+ *-----------------------------------------------------*/
+
+static SHuint32 shHashBytes(SHuint32 h, const void *bytes, SHint size)
+{
+  /* FNV-1a */
+  const SHuint8 *b = (const SHuint8*)bytes;
+  SHint i;
+
+  for (i=0; i<size; ++i) {
+    h ^= b[i];
+    h *= 16777619u; }
+
+  return h;
+}
+
+static void shLinearPart(SHMatrix3x3 *m, SHfloat linear[4])
+{
+  linear[0] = m->m[0][0]; linear[1] = m->m[0][1];
+  linear[2] = m->m[1][0]; linear[3] = m->m[1][1];
+}
+
+static SHuint32 shHashPath(SHPath *p, const SHfloat linear[4])
+{
+  SHuint32 h = 2166136261u;
+  h = shHashBytes(h, &p->datatype, sizeof(p->datatype));
+  h = shHashBytes(h, &p->scale, sizeof(p->scale));
+  h = shHashBytes(h, &p->bias, sizeof(p->bias));
+  h = shHashBytes(h, linear, 4 * sizeof(SHfloat));
+  h = shHashBytes(h, p->segs, p->segCount);
+  h = shHashBytes(h, p->data, shPathDataSize(p));
+  return h;
+}
+
+static SHTessCacheEntry* shFindEntry(SHTessCache *c, SHPath *p,
+                                     SHMatrix3x3 *m, SHuint32 *hashOut)
+{
+  SHTessCacheEntry *e;
+  SHfloat linear[4];
+  SHint dataSize = shPathDataSize(p);
+  SHuint32 hash;
+
+  shLinearPart(m, linear);
+  hash = shHashPath(p, linear);
+  if (hashOut) *hashOut = hash;
+
+  for (e = c->buckets[hash % SH_TESS_CACHE_BUCKETS]; e; e = e->next) {
+    if (e->hash == hash &&
+        e->datatype == p->datatype &&
+        e->scale == p->scale &&
+        e->bias == p->bias &&
+        e->segCount == p->segCount &&
+        e->dataSize == dataSize &&
+        memcmp(e->linear, linear, sizeof(linear)) == 0 &&
+        memcmp(e->segs, p->segs, p->segCount) == 0 &&
+        memcmp(e->data, p->data, dataSize) == 0)
+      return e;
+  }
+
+  return NULL;
+}
+
+/*-----------------------------------------------------
+ * Entry management
+ *-----------------------------------------------------*/
+
+static SHint shEntryVertexCount(SHTessCacheEntry *e)
+{
+  return e->vertices.size + (e->strokeValid ? e->stroke.size : 0);
+}
+
+static void shLruUnlink(SHTessCache *c, SHTessCacheEntry *e)
+{
+  if (e->lruPrev) e->lruPrev->lruNext = e->lruNext;
+  else c->lruFirst = e->lruNext;
+  if (e->lruNext) e->lruNext->lruPrev = e->lruPrev;
+  else c->lruLast = e->lruPrev;
+  e->lruPrev = e->lruNext = NULL;
+}
+
+static void shLruPushFront(SHTessCache *c, SHTessCacheEntry *e)
+{
+  e->lruPrev = NULL;
+  e->lruNext = c->lruFirst;
+  if (c->lruFirst) c->lruFirst->lruPrev = e;
+  else c->lruLast = e;
+  c->lruFirst = e;
+}
+
+static void shDeleteEntry(SHTessCache *c, SHTessCacheEntry *e)
+{
+  SHTessCacheEntry **link = &c->buckets[e->hash % SH_TESS_CACHE_BUCKETS];
+  while (*link != e) link = &(*link)->next;
+  *link = e->next;
+
+  shLruUnlink(c, e);
+  c->entryCount--;
+  c->vertexCount -= shEntryVertexCount(e);
+
+  free(e->segs);
+  SH_DEINITOBJ(SHVertexArray, e->vertices);
+  SH_DEINITOBJ(SHFloatArray, e->strokeDashPattern);
+  SH_DEINITOBJ(SHVector2Array, e->stroke);
+  free(e);
+}
+
+static void shEvict(SHTessCache *c, SHint newEntries, SHint newVertices)
+{
+  while (c->lruLast &&
+         (c->entryCount + newEntries > SH_TESS_CACHE_MAX_ENTRIES ||
+          c->vertexCount + newVertices > SH_TESS_CACHE_MAX_VERTICES))
+    shDeleteEntry(c, c->lruLast);
+}
+
+static int shCopyVertices(SHVertexArray *dst, const SHVertexArray *src)
+{
+  if (!shVertexArrayReserve(dst, src->size)) return 0;
+  memcpy(dst->items, src->items, src->size * sizeof(SHVertex));
+  dst->size = src->size;
+  return 1;
+}
+
+static int shCopyVector2s(SHVector2Array *dst, const SHVector2Array *src)
+{
+  if (!shVector2ArrayReserve(dst, src->size)) return 0;
+  memcpy(dst->items, src->items, src->size * sizeof(SHVector2));
+  dst->size = src->size;
+  return 1;
+}
+
+static int shCopyFloats(SHFloatArray *dst, const SHFloatArray *src)
+{
+  if (!shFloatArrayReserve(dst, src->size)) return 0;
+  memcpy(dst->items, src->items, src->size * sizeof(SHfloat));
+  dst->size = src->size;
+  return 1;
+}
+
+/*-----------------------------------------------------
+ * SHTessCache constructor / destructor
+ *-----------------------------------------------------*/
+
+void SHTessCache_ctor(SHTessCache *c)
+{
+  memset(c->buckets, 0, sizeof(c->buckets));
+  c->lruFirst = NULL;
+  c->lruLast = NULL;
+  c->entryCount = 0;
+  c->vertexCount = 0;
+  memset(c->stats, 0, sizeof(c->stats));
+}
+
+void SHTessCache_dtor(SHTessCache *c)
+{
+  while (c->lruFirst)
+    shDeleteEntry(c, c->lruFirst);
+}
+
+/*-----------------------------------------------------
+ * Flattened geometry
+ *-----------------------------------------------------*/
+
+VGboolean shTessCacheFetch(SHTessCache *c, SHPath *p, SHMatrix3x3 *m)
+{
+  SHTessCacheEntry *e;
+  if (p->segCount == 0) return VG_FALSE;
+
+  e = shFindEntry(c, p, m, NULL);
+  if (!e) return VG_FALSE;
+  if (!shCopyVertices(&p->vertices, &e->vertices)) return VG_FALSE;
+
+  p->min = e->min;
+  p->max = e->max;
+
+  shLruUnlink(c, e);
+  shLruPushFront(c, e);
+  return VG_TRUE;
+}
+
+void shTessCacheStore(SHTessCache *c, SHPath *p, SHMatrix3x3 *m)
+{
+  SHTessCacheEntry *e;
+  SHuint32 hash;
+  SHint dataSize = shPathDataSize(p);
+
+  /* Empty or too large to be worth keeping */
+  if (p->segCount == 0 ||
+      p->vertices.size > SH_TESS_CACHE_MAX_VERTICES / 4)
+    return;
+
+  if (shFindEntry(c, p, m, &hash))
+    return;
+
+  shEvict(c, 1, p->vertices.size);
+
+  e = (SHTessCacheEntry*)malloc(sizeof(SHTessCacheEntry));
+  if (!e) return;
+
+  e->segs = (SHuint8*)malloc(p->segCount + dataSize + 1);
+  if (!e->segs) { free(e); return; }
+
+  e->hash = hash;
+  e->datatype = p->datatype;
+  e->scale = p->scale;
+  e->bias = p->bias;
+  shLinearPart(m, e->linear);
+  e->segCount = p->segCount;
+  e->dataSize = dataSize;
+  e->data = e->segs + p->segCount;
+  memcpy(e->segs, p->segs, p->segCount);
+  memcpy(e->data, p->data, dataSize);
+
+  SH_INITOBJ(SHVertexArray, e->vertices);
+  SH_INITOBJ(SHFloatArray, e->strokeDashPattern);
+  SH_INITOBJ(SHVector2Array, e->stroke);
+  e->strokeValid = VG_FALSE;
+
+  if (!shCopyVertices(&e->vertices, &p->vertices)) {
+    free(e->segs);
+    SH_DEINITOBJ(SHVertexArray, e->vertices);
+    SH_DEINITOBJ(SHFloatArray, e->strokeDashPattern);
+    SH_DEINITOBJ(SHVector2Array, e->stroke);
+    free(e);
+    return;
+  }
+  e->min = p->min;
+  e->max = p->max;
+
+  e->next = c->buckets[hash % SH_TESS_CACHE_BUCKETS];
+  c->buckets[hash % SH_TESS_CACHE_BUCKETS] = e;
+  shLruPushFront(c, e);
+  c->entryCount++;
+  c->vertexCount += e->vertices.size;
+}
+
+/*-----------------------------------------------------
+ * Stroke geometry
+ *-----------------------------------------------------*/
+
+static VGboolean shStrokeMatches(SHTessCacheEntry *e, const SHStrokeParams *s)
+{
+  return e->strokeValid &&
+         e->strokeLineWidth == s->lineWidth &&
+         e->strokeCapStyle == s->capStyle &&
+         e->strokeJoinStyle == s->joinStyle &&
+         e->strokeMiterLimit == s->miterLimit &&
+         e->strokeDashPhase == s->dashPhase &&
+         e->strokeDashPhaseReset == s->dashPhaseReset &&
+         e->strokeDashPattern.size == s->dashPattern->size &&
+         memcmp(e->strokeDashPattern.items, s->dashPattern->items,
+                s->dashPattern->size * sizeof(SHfloat)) == 0;
+}
+
+VGboolean shStrokeCacheFetch(SHTessCache *c, SHPath *p, SHMatrix3x3 *m,
+                             const SHStrokeParams *s)
+{
+  SHTessCacheEntry *e;
+  if (p->segCount == 0) return VG_FALSE;
+
+  e = shFindEntry(c, p, m, NULL);
+  if (!e || !shStrokeMatches(e, s)) return VG_FALSE;
+  if (!shCopyVector2s(&p->stroke, &e->stroke)) return VG_FALSE;
+
+  shLruUnlink(c, e);
+  shLruPushFront(c, e);
+  return VG_TRUE;
+}
+
+void shStrokeCacheStore(SHTessCache *c, SHPath *p, SHMatrix3x3 *m,
+                        const SHStrokeParams *s)
+{
+  SHTessCacheEntry *e;
+  if (p->segCount == 0) return;
+
+  e = shFindEntry(c, p, m, NULL);
+  if (!e) return;
+
+  if (p->stroke.size > SH_TESS_CACHE_MAX_VERTICES / 4)
+    return;
+
+  /* Replace any previous stroke of this geometry */
+  c->vertexCount -= shEntryVertexCount(e);
+  e->strokeValid = VG_FALSE;
+  c->vertexCount += shEntryVertexCount(e);
+
+  /* Keep the entry itself from being evicted */
+  shLruUnlink(c, e);
+  shEvict(c, 0, p->stroke.size);
+  shLruPushFront(c, e);
+
+  if (!shCopyVector2s(&e->stroke, &p->stroke) ||
+      !shCopyFloats(&e->strokeDashPattern, s->dashPattern))
+    return;
+
+  e->strokeValid = VG_TRUE;
+  e->strokeLineWidth = s->lineWidth;
+  e->strokeCapStyle = s->capStyle;
+  e->strokeJoinStyle = s->joinStyle;
+  e->strokeMiterLimit = s->miterLimit;
+  e->strokeDashPhase = s->dashPhase;
+  e->strokeDashPhaseReset = s->dashPhaseReset;
+  c->vertexCount += e->stroke.size;
+}
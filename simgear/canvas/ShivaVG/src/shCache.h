@@ -0,0 +1,71 @@
+/*
+ * shCache.h - tessellation cache shared by all paths of a context
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#ifndef __SHCACHE_H
+#define __SHCACHE_H
+
+#include "shDefs.h"
+#include "shVectors.h"
+#include "shArrays.h"
+#include "shPath.h"
+
+/*-----------------------------------------------------------
+ * Tessellation cache shared by all paths of a context.
+ *
+ * Entries are keyed on the raw path data and the linear part
+ * of the user-to-surface transform used for flattening, so
+ * identical paths (eg. repeated symbols) share their
+ * flattened and stroked geometry, which is stored in path
+ * space. Translations are applied at draw time only.
+ *-----------------------------------------------------------*/
+
+#define SH_TESS_CACHE_BUCKETS       1024
+#define SH_TESS_CACHE_MAX_ENTRIES   4096
+#define SH_TESS_CACHE_MAX_VERTICES  (1 << 20)
+
+typedef struct
+{
+  SHfloat lineWidth;
+  VGCapStyle capStyle;
+  VGJoinStyle joinStyle;
+  SHfloat miterLimit;
+  SHfloat dashPhase;
+  VGboolean dashPhaseReset;
+  const SHFloatArray *dashPattern;
+
+} SHStrokeParams;
+
+typedef struct SHTessCacheEntry SHTessCacheEntry;
+
+typedef struct
+{
+  SHTessCacheEntry *buckets[SH_TESS_CACHE_BUCKETS];
+
+  /* Least recently used list, most recent first */
+  SHTessCacheEntry *lruFirst;
+  SHTessCacheEntry *lruLast;
+
+  SHint entryCount;
+  SHint vertexCount;
+
+  /* Statistics since last query (see VGTessellationStatSH) */
+  VGint stats[VG_TESS_STATS_COUNT_SH];
+
+} SHTessCache;
+
+void SHTessCache_ctor(SHTessCache *c);
+void SHTessCache_dtor(SHTessCache *c);
+
+/* Copies cached flattened geometry into the path on success */
+VGboolean shTessCacheFetch(SHTessCache *c, SHPath *p, SHMatrix3x3 *m);
+void shTessCacheStore(SHTessCache *c, SHPath *p, SHMatrix3x3 *m);
+
+/* Copies cached stroke geometry into the path on success */
+VGboolean shStrokeCacheFetch(SHTessCache *c, SHPath *p, SHMatrix3x3 *m,
+                             const SHStrokeParams *s);
+void shStrokeCacheStore(SHTessCache *c, SHPath *p, SHMatrix3x3 *m,
+                        const SHStrokeParams *s);
+
+#endif /* __SHCACHE_H */
@@ -67,6 +67,19 @@ VG_API_CALL VGboolean vgHasContextSH()
   return g_context != NULL;
 }
 
+VG_API_CALL void vgGetTessellationStatsSH(VGint *stats, VGint count,
+                                          VGboolean reset)
+{
+  int i;
+  if (!g_context) return;
+
+  for (i=0; i<count && i<VG_TESS_STATS_COUNT_SH; ++i)
+    stats[i] = g_context->tessCache.stats[i];
+
+  if (reset == VG_TRUE)
+    memset(g_context->tessCache.stats, 0, sizeof(g_context->tessCache.stats));
+}
+
 VG_API_CALL void vgResizeSurfaceSH(VGint width, VGint height)
 {
   VG_GETCONTEXT(VG_NO_RETVAL);
@@ -180,6 +193,7 @@ void VGContext_ctor(VGContext *c)
   SH_INITOBJ(SHPathArray, c->paths);
   SH_INITOBJ(SHPaintArray, c->paints);
   SH_INITOBJ(SHImageArray, c->images);
+  SH_INITOBJ(SHTessCache, c->tessCache);
 
   shLoadExtensions(c);
 }
@@ -204,6 +218,8 @@ void VGContext_dtor(VGContext *c)
   
   for (i=0; i<c->images.size; ++i)
     SH_DELETEOBJ(SHImage, c->images.items[i]);
+
+  SH_DEINITOBJ(SHTessCache, c->tessCache);
 }
 
 /*--------------------------------------------------
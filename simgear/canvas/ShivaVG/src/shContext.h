@@ -27,6 +27,7 @@
 #include "shPath.h"
 #include "shPaint.h"
 #include "shImage.h"
+#include "shCache.h"
 
 /*------------------------------------------------
  * VGContext object
@@ -106,6 +107,9 @@ typedef struct
   SHPaintArray      paints;
   SHImageArray      images;
 
+  /* Flattened and stroked geometry shared between paths */
+  SHTessCache       tessCache;
+
   /* Pointers to extensions */
   SHint isGLAvailable_ClampToEdge;
   SHint isGLAvailable_MirroredRepeat;
@@ -851,6 +851,7 @@ VG_API_CALL void vgPathBounds(VGPath path,
                               VGfloat * width, VGfloat * height)
 {
   SHPath *p = NULL;
+  SHMatrix3x3 identity;
   VG_GETCONTEXT(VG_NO_RETVAL);
 
   VG_RETURN_ERR_IF(!shIsValidPath(context, path),
@@ -866,9 +867,14 @@ VG_API_CALL void vgPathBounds(VGPath path,
   VG_RETURN_ERR_IF(!(p->caps & VG_PATH_CAPABILITY_PATH_BOUNDS),
                    VG_PATH_CAPABILITY_ERROR, VG_NO_RETVAL);
 
-  /* Update path geometry */
-  shFlattenPath(p, 0);
-  shFindBoundbox(p);
+  /* Update path geometry (shared with rendering if the
+     path is drawn without any scale or rotation) */
+  IDMAT(identity);
+  if (!shTessCacheFetch(&context->tessCache, p, &identity)) {
+    shFlattenPath(p, 0);
+    shFindBoundbox(p);
+    shTessCacheStore(&context->tessCache, p, &identity);
+  }
 
   /* Output bounds */
   *minX = p->min.x;
@@ -86,6 +86,7 @@ void SHPath_ctor(SHPath *p)
   
   SH_INITOBJ(SHVertexArray, p->vertices);
   SH_INITOBJ(SHVector2Array, p->stroke);
+  SH_INITOBJ(SHFloatArray, p->cacheStrokeDashPattern);
 }
 
 /*-----------------------------------------------------
@@ -99,6 +100,16 @@ void SHPath_dtor(SHPath *p)
   
   SH_DEINITOBJ(SHVertexArray, p->vertices);
   SH_DEINITOBJ(SHVector2Array, p->stroke);
+  SH_DEINITOBJ(SHFloatArray, p->cacheStrokeDashPattern);
+}
+
+/*-----------------------------------------------------
+ * Returns the size of the raw coordinate data in bytes
+ *-----------------------------------------------------*/
+
+SHint shPathDataSize(SHPath *p)
+{
+  return p->dataCount * shBytesPerDatatype[p->datatype];
 }
 
 /*-----------------------------------------------------
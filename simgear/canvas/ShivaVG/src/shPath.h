@@ -108,12 +108,16 @@ typedef struct SHPath
   SHfloat        cacheStrokeMiterLimit;
   SHfloat        cacheStrokeDashPhase;
   VGboolean      cacheStrokeDashPhaseReset;
+  SHFloatArray   cacheStrokeDashPattern;
   
 } SHPath;
 
 void SHPath_ctor(SHPath *p);
 void SHPath_dtor(SHPath *p);
 
+/* Size of the raw coordinate data in bytes */
+SHint shPathDataSize(SHPath *p);
+
 
 /* Processing normalization flags */
 #define SH_PROCESS_SIMPLIFY_LINES    (1 << 0)
@@ -26,6 +26,7 @@
 #include "shImage.h"
 #include "shGeometry.h"
 #include "shPaint.h"
+#include <string.h>
 
 #define USE_MODELVIEW_MATRIX	0
 
@@ -251,15 +252,23 @@ VGboolean shIsStrokeCacheValid (VGContext *c, SHPath *p)
   else if (p->cacheStrokeTessValid == VG_FALSE) {
     valid = VG_FALSE;
   }
-  else if (c->strokeDashPattern.size > 0) {
-    valid = VG_FALSE;
-  }
   else if (p->cacheStrokeLineWidth  != c->strokeLineWidth  ||
            p->cacheStrokeCapStyle   != c->strokeCapStyle   ||
            p->cacheStrokeJoinStyle  != c->strokeJoinStyle  ||
            p->cacheStrokeMiterLimit != c->strokeMiterLimit) {
     valid = VG_FALSE;
   }
+  else if (p->cacheStrokeDashPattern.size != c->strokeDashPattern.size) {
+    valid = VG_FALSE;
+  }
+  else if (c->strokeDashPattern.size > 0 &&
+           (p->cacheStrokeDashPhase      != c->strokeDashPhase      ||
+            p->cacheStrokeDashPhaseReset != c->strokeDashPhaseReset ||
+            memcmp(p->cacheStrokeDashPattern.items,
+                   c->strokeDashPattern.items,
+                   c->strokeDashPattern.size * sizeof(SHfloat)) != 0)) {
+    valid = VG_FALSE;
+  }
 
   if (valid == VG_FALSE)
   {
@@ -270,6 +279,17 @@ VGboolean shIsStrokeCacheValid (VGContext *c, SHPath *p)
     p->cacheStrokeCapStyle   = c->strokeCapStyle;
     p->cacheStrokeJoinStyle  = c->strokeJoinStyle;
     p->cacheStrokeMiterLimit = c->strokeMiterLimit;
+    p->cacheStrokeDashPhase  = c->strokeDashPhase;
+    p->cacheStrokeDashPhaseReset = c->strokeDashPhaseReset;
+
+    shFloatArrayClear(&p->cacheStrokeDashPattern);
+    if (shFloatArrayReserve(&p->cacheStrokeDashPattern,
+                            c->strokeDashPattern.size)) {
+      memcpy(p->cacheStrokeDashPattern.items, c->strokeDashPattern.items,
+             c->strokeDashPattern.size * sizeof(SHfloat));
+      p->cacheStrokeDashPattern.size = c->strokeDashPattern.size;
+    }
+    else p->cacheStrokeTessValid = VG_FALSE;
   }
 
   return valid;
@@ -289,8 +309,11 @@ VG_API_CALL void vgDrawPath(VGPath path, VGbitfield paintModes)
 #endif
   SHPaint *fill, *stroke;
   SHRectangle *rect;
+  SHTessCache *cache;
+  SHStrokeParams strokeParams;
   
   VG_GETCONTEXT(VG_NO_RETVAL);
+  cache = &context->tessCache;
   
   VG_RETURN_ERR_IF(!shIsValidPath(context, path),
                    VG_BAD_HANDLE_ERROR, VG_NO_RETVAL);
@@ -311,14 +334,27 @@ VG_API_CALL void vgDrawPath(VGPath path, VGbitfield paintModes)
   p = (SHPath*)path;
   
   /* If user-to-surface matrix invertible tessellate in
-     surface space for better path resolution */
-  if (shIsTessCacheValid( context, p ) == VG_FALSE)
+     surface space for better path resolution. Identical
+     paths share their geometry through the context cache. */
+  if (shIsTessCacheValid( context, p ) == VG_TRUE)
+  {
+    cache->stats[VG_TESS_CACHE_HITS_SH]++;
+  }
+  else if (shTessCacheFetch(cache, p, &context->pathTransform))
+  {
+    cache->stats[VG_TESS_CACHE_HITS_SH]++;
+  }
+  else
   {
     if (shInvertMatrix(&context->pathTransform, &mi)) {
       shFlattenPath(p, 1);
       shTransformVertices(&mi, p);
     }else shFlattenPath(p, 0);
     shFindBoundbox(p);
+    shTessCacheStore(cache, p, &context->pathTransform);
+
+    cache->stats[VG_TESS_CACHE_MISSES_SH]++;
+    cache->stats[VG_TESS_VERTICES_SH] += p->vertices.size;
   }
   
   /* TODO: Turn antialiasing on/off */
@@ -395,11 +431,35 @@ VG_API_CALL void vgDrawPath(VGPath path, VGbitfield paintModes)
 #if 0
     if (1) {/*context->strokeLineWidth > 1.0f) {*/
 #endif
-      if (shIsStrokeCacheValid( context, p ) == VG_FALSE)
+      if (shIsStrokeCacheValid( context, p ) == VG_TRUE)
+      {
+        cache->stats[VG_STROKE_CACHE_HITS_SH]++;
+      }
+      else
       {
-        /* Generate stroke triangles in user space */
-        shVector2ArrayClear(&p->stroke);
-        shStrokePath(context, p);
+        strokeParams.lineWidth = context->strokeLineWidth;
+        strokeParams.capStyle = context->strokeCapStyle;
+        strokeParams.joinStyle = context->strokeJoinStyle;
+        strokeParams.miterLimit = context->strokeMiterLimit;
+        strokeParams.dashPhase = context->strokeDashPhase;
+        strokeParams.dashPhaseReset = context->strokeDashPhaseReset;
+        strokeParams.dashPattern = &context->strokeDashPattern;
+
+        /* Key on the transform the vertices have been flattened with */
+        if (shStrokeCacheFetch(cache, p, &p->cacheTransform, &strokeParams))
+        {
+          cache->stats[VG_STROKE_CACHE_HITS_SH]++;
+        }
+        else
+        {
+          /* Generate stroke triangles in user space */
+          shVector2ArrayClear(&p->stroke);
+          shStrokePath(context, p);
+          shStrokeCacheStore(cache, p, &p->cacheTransform, &strokeParams);
+
+          cache->stats[VG_STROKE_CACHE_MISSES_SH]++;
+          cache->stats[VG_STROKE_VERTICES_SH] += p->stroke.size;
+        }
       }
 
       /* Stroke into stencil */
@@ -41,6 +41,14 @@ namespace canvas
 {
   const std::string NAME_TRANSFORM = "tf";
 
+  /**
+   * data-* properties only store user data and never affect rendering.
+   */
+  static bool isDataProperty(const SGPropertyNode* node)
+  {
+    return strutils::starts_with(node->getNameString(), "data-");
+  }
+
   /**
    * glScissor with coordinates relative to different reference frames.
    */
@@ -243,8 +251,37 @@ namespace canvas
   //----------------------------------------------------------------------------
   void Element::update(double dt)
   {
-    if( isVisible() )
-      updateImpl(dt);
+    // Clear before updating, so changes made while updating (eg. by event
+    // listeners or elements which need to be polled) are picked up next frame.
+    _update_pending = false;
+
+    if( !isVisible() )
+      // Hidden elements are updated again once they become visible
+      return;
+
+    if( _update_stats )
+      ++_update_stats->updated;
+
+    updateImpl(dt);
+  }
+
+  //----------------------------------------------------------------------------
+  void Element::requestUpdate()
+  {
+    _update_pending = true;
+
+    // Stop at the first ancestor already waiting for an update, as it will
+    // descend into this subtree anyway.
+    for( ElementPtr parent = getParent();
+                    parent && !parent->_update_pending;
+                    parent = parent->getParent() )
+      parent->_update_pending = true;
+  }
+
+  //----------------------------------------------------------------------------
+  void Element::setUpdateStats(const UpdateStatsPtr& stats)
+  {
+    _update_stats = stats;
   }
 
   //----------------------------------------------------------------------------
@@ -379,6 +416,10 @@ namespace canvas
     if( _scene_group.valid() )
       // TODO check if we need another nodemask
       _scene_group->setNodeMask(visible ? 0xffffffff : 0);
+
+    // Changes while being hidden have not been applied yet
+    if( visible )
+      requestUpdate();
   }
 
   //----------------------------------------------------------------------------
@@ -459,6 +500,9 @@ namespace canvas
   //----------------------------------------------------------------------------
   void Element::childAdded(SGPropertyNode* parent, SGPropertyNode* child)
   {
+    if( !isDataProperty(child) )
+      requestUpdate();
+
     if(    parent == _node
         && child->getNameString() == NAME_TRANSFORM )
     {
@@ -497,6 +541,9 @@ namespace canvas
   //----------------------------------------------------------------------------
   void Element::childRemoved(SGPropertyNode* parent, SGPropertyNode* child)
   {
+    if( !isDataProperty(child) )
+      requestUpdate();
+
     if( parent == _node )
     {
       if( child->getNameString() == NAME_TRANSFORM )
@@ -533,6 +580,9 @@ namespace canvas
   //----------------------------------------------------------------------------
   void Element::valueChanged(SGPropertyNode* child)
   {
+    if( !isDataProperty(child) )
+      requestUpdate();
+
     SGPropertyNode *parent = child->getParent();
     if( parent == _node )
     {
@@ -757,6 +807,9 @@ namespace canvas
       );
 
     _scene_group->setUserData( new OSGUserData(this) );
+
+    if( ElementPtr parent_element = _parent.lock() )
+      _update_stats = parent_element->_update_stats;
   }
 
   //----------------------------------------------------------------------------
@@ -77,6 +77,18 @@ namespace canvas
                             ///  their parents
       };
 
+      /**
+       * Counters for the elements touched by an update traversal. Shared by
+       * all elements of a canvas and reset by the canvas every frame.
+       */
+      struct UpdateStats:
+        public SGReferenced
+      {
+        unsigned int visited = 0; ///< Elements checked for pending updates
+        unsigned int updated = 0; ///< Elements which have been updated
+      };
+      typedef SGSharedPtr<UpdateStats> UpdateStatsPtr;
+
       /**
        * Coordinate reference frame (eg. "clip" property)
        */
@@ -104,6 +116,25 @@ namespace canvas
        */
       void update(double dt) override;
 
+      /**
+       * Mark this element as requiring an update and propagate the request to
+       * all ancestors. Groups only descend into children with a pending update
+       * so unchanged subtrees are skipped entirely.
+       */
+      void requestUpdate();
+
+      /**
+       * Get whether this element or any of its descendants needs an update.
+       */
+      bool isUpdatePending() const { return _update_pending; }
+
+      /**
+       * Set the counters updated while traversing this element. Children
+       * created afterwards share the counters of their parent.
+       */
+      void setUpdateStats(const UpdateStatsPtr& stats);
+      const UpdateStatsPtr& getUpdateStats() const { return _update_stats; }
+
       bool addEventListener(const std::string& type, const EventListener& cb);
       virtual void clearEventListener();
 
@@ -272,6 +303,8 @@ namespace canvas
       ElementWeakPtr  _parent;
 
       mutable uint32_t _attributes_dirty = 0;
+      bool _update_pending = true;
+      UpdateStatsPtr _update_stats;
 
       SceneGroupWeakPtr             _scene_group;
       std::vector<TransformType>    _transform_types;
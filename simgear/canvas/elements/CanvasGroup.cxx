@@ -249,8 +249,21 @@ namespace canvas
   {
     Element::updateImpl(dt);
 
+    // Manual updates (zero dt) traverse the whole subtree
+    const bool force = (dt == 0);
+
     for(size_t i = 0; i < _scene_group->getNumChildren(); ++i)
-      getChildByIndex(i)->update(dt);
+    {
+      ElementPtr child = getChildByIndex(i);
+      if( !child )
+        continue;
+
+      if( _update_stats )
+        ++_update_stats->visited;
+
+      if( force || child->isUpdatePending() )
+        child->update(dt);
+    }
   }
 
   //----------------------------------------------------------------------------
@@ -202,6 +202,7 @@ namespace canvas
 
     _src_canvas = src_canvas = canvas;
     _attributes_dirty |= SRC_CANVAS;
+    requestUpdate();
     _geom->setCullCallback(canvas ? new CullCallback(canvas) : 0);
 
     if( src_canvas )
@@ -276,6 +277,7 @@ namespace canvas
   {
       _attributes_dirty |= SRC_RECT;
       _src_rect = sourceRect;
+      requestUpdate();
   }
 
   //----------------------------------------------------------------------------
@@ -364,6 +366,11 @@ namespace canvas
         _attributes_dirty &= ~SRC_CANVAS;
     }
 
+    // The texture of the source canvas can change without any property of this
+    // element changing, so keep checking every frame.
+    if( canvas )
+      requestUpdate();
+
     if( !_attributes_dirty )
       return;
 
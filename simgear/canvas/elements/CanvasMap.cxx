@@ -27,6 +27,8 @@
 #include <simgear/misc/strutils.hxx>
 
 #include <cmath>
+#include <unordered_set>
+#include <vector>
 
 #define LOG_GEO_RET(msg) \
   {\
@@ -56,6 +58,21 @@ namespace canvas
   const std::string RANGE = "range";
   const std::string PROJECTION = "projection";
 
+  //----------------------------------------------------------------------------
+  struct Map::GeoBatch
+  {
+    using GeoPosition = HorizontalProjection::GeoPosition;
+    using ScreenPosition = Projection::ScreenPosition;
+
+    std::vector<std::shared_ptr<GeoNodePair>> nodes;
+    std::vector<GeoPosition> geo;           ///<! Cached per position terms
+    std::vector<ScreenPosition> projected,  ///<! Relative to center (nm)
+                                screen;     ///<! Final screen positions
+    std::vector<char> valid;                ///<! Successfully parsed
+    std::vector<size_t> changed;            ///<! Updated this frame
+    bool rebuild = true;
+  };
+
   //----------------------------------------------------------------------------
   void Map::staticInit()
   {
@@ -72,7 +89,8 @@ namespace canvas
             const SGPropertyNode_ptr& node,
             const Style& parent_style,
             ElementWeakPtr parent ):
-    Group(canvas, node, parent_style, parent)
+    Group(canvas, node, parent_style, parent),
+    _geo_batch(new GeoBatch)
   {
     staticInit();
 
@@ -90,46 +108,129 @@ namespace canvas
   {
     Group::updateImpl(dt);
 
-    for(auto& it: _geo_nodes)
+    GeoBatch& batch = *_geo_batch;
+    const bool rebuild = batch.rebuild;
+    if( rebuild )
+      rebuildGeoBatch();
+
+    // Parse changed positions. Unchanged positions keep their cached
+    // projection terms (very common case for a moving vehicle, where only
+    // the projection center and heading change).
+    batch.changed.clear();
+    for(size_t i = 0; i < batch.nodes.size(); ++i)
     {
-      GeoNodePair* geo_node = it.second.get();
-      if(    !geo_node->isComplete()
-          || (!geo_node->isDirty() && !_projection_dirty) )
+      GeoNodePair* geo_node = batch.nodes[i].get();
+      if( !geo_node->isDirty() )
         continue;
 
-      double latD = -9999.0, lonD = -9999.0;
-      if (geo_node->isDirty()) {
-        GeoCoord lat = parseGeoCoord(geo_node->getLat());
-        if( lat.type != GeoCoord::LATITUDE )
-          continue;
-        
-        GeoCoord lon = parseGeoCoord(geo_node->getLon());
-        if( lon.type != GeoCoord::LONGITUDE )
+      geo_node->setDirty(false);
+      batch.changed.push_back(i);
+      batch.valid[i] = false;
+
+      GeoCoord lat = parseGeoCoord(geo_node->getLat());
+      if( lat.type != GeoCoord::LATITUDE )
+        continue;
+
+      GeoCoord lon = parseGeoCoord(geo_node->getLon());
+      if( lon.type != GeoCoord::LONGITUDE )
+        continue;
+
+      geo_node->setCachedLatLon(std::make_pair(lat.value, lon.value));
+      batch.geo[i].lat = SGMiscd::deg2rad(lat.value);
+      batch.geo[i].lon = SGMiscd::deg2rad(lon.value);
+      batch.valid[i] = true;
+    }
+
+    const size_t num_nodes = batch.nodes.size();
+    if( rebuild || _projection_dirty || _reference_dirty || _view_dirty )
+    {
+      if( rebuild || _projection_dirty )
+        _projection->prepare(batch.geo.data(), num_nodes);
+      else
+        for(size_t i: batch.changed)
+          _projection->prepare(&batch.geo[i], 1);
+
+      if( rebuild || _projection_dirty || _reference_dirty )
+        _projection->project(batch.geo.data(), batch.projected.data(), num_nodes);
+      else
+        for(size_t i: batch.changed)
+          _projection->project(&batch.geo[i], &batch.projected[i], 1);
+
+      // Range and heading are applied to all positions as one affine transform
+      batch.screen = batch.projected;
+      _projection->viewTransform(batch.screen.data(), num_nodes);
+
+      for(size_t i = 0; i < num_nodes; ++i)
+        if( batch.valid[i] )
+          batch.nodes[i]->setScreenPos(batch.screen[i].x, batch.screen[i].y);
+    }
+    else
+    {
+      for(size_t i: batch.changed)
+      {
+        if( !batch.valid[i] )
           continue;
-        
-        // save the parsed values so we can re-use them if only projection
-        // is changed (very common case for moving vehicle)
-        latD = lat.value;
-        lonD = lon.value;
-        geo_node->setCachedLatLon(std::make_pair(latD, lonD));
-      } else {
-        std::tie(latD, lonD) = geo_node->getCachedLatLon();
-      }
-      
-      Projection::ScreenPosition pos = _projection->worldToScreen(latD, lonD);
-      geo_node->setScreenPos(pos.x, pos.y);
 
-//      geo_node->print();
-      geo_node->setDirty(false);
+        _projection->prepare(&batch.geo[i], 1);
+        _projection->project(&batch.geo[i], &batch.projected[i], 1);
+        batch.screen[i] = batch.projected[i];
+        _projection->viewTransform(&batch.screen[i], 1);
+        batch.nodes[i]->setScreenPos(batch.screen[i].x, batch.screen[i].y);
+      }
     }
+
     _projection_dirty = false;
+    _reference_dirty = false;
+    _view_dirty = false;
+  }
+
+  //----------------------------------------------------------------------------
+  void Map::rebuildGeoBatch()
+  {
+    GeoBatch& batch = *_geo_batch;
+    batch.rebuild = false;
+    batch.nodes.clear();
+
+    // Lat and lon node of a position share the same GeoNodePair
+    std::unordered_set<GeoNodePair*> seen;
+    for(auto& it: _geo_nodes)
+    {
+      if( it.second->isComplete() && seen.insert(it.second.get()).second )
+        batch.nodes.push_back(it.second);
+    }
+
+    const size_t num_nodes = batch.nodes.size();
+    batch.geo.assign(num_nodes, GeoBatch::GeoPosition());
+    batch.projected.resize(num_nodes);
+    batch.screen.resize(num_nodes);
+    batch.valid.assign(num_nodes, false);
+
+    for(size_t i = 0; i < num_nodes; ++i)
+    {
+      GeoNodePair* geo_node = batch.nodes[i].get();
+      if( geo_node->isDirty() || !geo_node->hasCachedLatLon() )
+      {
+        // Parsed (again) during the update
+        geo_node->setDirty();
+        continue;
+      }
+
+      double lat, lon;
+      std::tie(lat, lon) = geo_node->getCachedLatLon();
+      batch.geo[i].lat = SGMiscd::deg2rad(lat);
+      batch.geo[i].lon = SGMiscd::deg2rad(lon);
+      batch.valid[i] = true;
+    }
   }
 
   //----------------------------------------------------------------------------
   void Map::childAdded(SGPropertyNode* parent, SGPropertyNode* child)
   {
     if( strutils::ends_with(child->getNameString(), GEO) )
+    {
       _geo_nodes[child].reset(new GeoNodePair());
+      _geo_batch->rebuild = true;
+    }
     else if( parent != _node && child->getNameString() == HDG )
       _hdg_nodes.insert(child);
     else
@@ -140,8 +241,11 @@ namespace canvas
   void Map::childRemoved(SGPropertyNode* parent, SGPropertyNode* child)
   {
     if( strutils::ends_with(child->getNameString(), GEO) )
+    {
       // TODO remove from other node
       _geo_nodes.erase(child);
+      _geo_batch->rebuild = true;
+    }
     else if( parent != _node && child->getNameString() == HDG )
     {
       _hdg_nodes.erase(child);
@@ -178,8 +282,11 @@ namespace canvas
 
     if(    child->getNameString() == REF_LAT
         || child->getNameString() == REF_LON )
+    {
       _projection->setWorldPosition( _node->getDoubleValue(REF_LAT),
                                      _node->getDoubleValue(REF_LON) );
+      _reference_dirty = true;
+    }
     else if( child->getNameString() == HDG )
     {
       _projection->setOrientation(child->getFloatValue());
@@ -187,17 +294,22 @@ namespace canvas
                              it != _hdg_nodes.end();
                            ++it )
         hdgNodeChanged(*it);
+      _view_dirty = true;
     }
     else if( child->getNameString() == RANGE )
+    {
       _projection->setRange(child->getDoubleValue());
+      _view_dirty = true;
+    }
     else if( child->getNameString() == SCREEN_RANGE )
+    {
       _projection->setScreenRange(child->getDoubleValue());
+      _view_dirty = true;
+    }
     else if( child->getNameString() == PROJECTION )
       projectionNodeChanged(child);
     else
       return Group::childChanged(child);
-
-    _projection_dirty = true;
   }
 
   //----------------------------------------------------------------------------
@@ -234,10 +346,14 @@ namespace canvas
     GeoNodePair* geo_node = it_geo_node->second.get();
 
     geo_node->setDirty();
+    requestUpdate();
 
     if( !(geo_node->getStatus() & GeoNodePair::INCOMPLETE) )
       return;
 
+    // Pairing changes, so does the set of complete positions
+    _geo_batch->rebuild = true;
+
     // Detect lat, lon tuples...
     GeoCoord coord = parseGeoCoord(child->getStringValue());
     int index_other = -1;
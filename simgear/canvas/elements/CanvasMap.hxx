@@ -60,10 +60,17 @@ namespace canvas
         std::unordered_map<SGPropertyNode*, std::shared_ptr<GeoNodePair>>;
       using NodeSet = std::unordered_set<SGPropertyNode*>;
 
+      /// Geo positions of all complete node pairs, kept in arrays to
+      /// project them in one pass.
+      struct GeoBatch;
+
       GeoNodes _geo_nodes;
       NodeSet  _hdg_nodes;
       std::shared_ptr<HorizontalProjection> _projection;
-      bool _projection_dirty = false;
+      std::unique_ptr<GeoBatch> _geo_batch;
+      bool _projection_dirty = false, ///<! Projection type changed
+           _reference_dirty = false,  ///<! Projection center changed
+           _view_dirty = false;       ///<! Range or orientation changed
 
       struct GeoCoord
       {
@@ -76,6 +83,7 @@ namespace canvas
         double value = 0;
       };
 
+      void rebuildGeoBatch();
       void projectionNodeChanged(SGPropertyNode* child);
       void geoNodeChanged(SGPropertyNode* child);
       void hdgNodeChanged(SGPropertyNode* child);
@@ -808,6 +808,7 @@ namespace canvas
     _rect = r;
     _hasRect = true;
     _attributes_dirty |= RECT;
+    requestUpdate();
   }
 
   //----------------------------------------------------------------------------
@@ -4,6 +4,10 @@
 
 #include "CanvasElement.hxx"
 #include "CanvasGroup.hxx"
+#include "map/projection.hxx"
+
+#include <cmath>
+#include <vector>
 
 namespace sc = simgear::canvas;
 
@@ -64,3 +68,129 @@ BOOST_AUTO_TEST_CASE( attr_data )
   BOOST_CHECK( !el->hasDataProp("myData") );
   BOOST_CHECK_EQUAL( el->getDataProp("myData", 5), 5 );
 }
+
+BOOST_AUTO_TEST_CASE( dirty_subtree_update )
+{
+  SGPropertyNode_ptr node = new SGPropertyNode;
+  node->setAttribute(SGPropertyNode::VALUE_CHANGED_DOWN, true);
+
+  sc::ElementPtr root =
+    sc::Element::create<sc::Group>(sc::CanvasWeakPtr(), node);
+  sc::Element::UpdateStatsPtr stats = new sc::Element::UpdateStats;
+  root->setUpdateStats(stats);
+
+  // root -> 2 groups -> 3 groups each
+  for(int i = 0; i < 2; ++i)
+  {
+    SGPropertyNode* group = node->addChild("group");
+    for(int j = 0; j < 3; ++j)
+      group->addChild("group");
+  }
+
+  auto updateFrame = [&]()
+  {
+    stats->visited = 1;
+    stats->updated = 0;
+    if( root->isUpdatePending() )
+      root->update(0.1);
+  };
+
+  // Everything is new
+  updateFrame();
+  BOOST_CHECK_EQUAL(stats->visited, 9u);
+  BOOST_CHECK_EQUAL(stats->updated, 9u);
+  BOOST_CHECK( !root->isUpdatePending() );
+
+  // Nothing changed
+  updateFrame();
+  BOOST_CHECK_EQUAL(stats->visited, 1u);
+  BOOST_CHECK_EQUAL(stats->updated, 0u);
+
+  // Only the path to the changed element is updated
+  SGPropertyNode* leaf = node->getChild("group", 0)->getChild("group", 1);
+  leaf->setDoubleValue("tf/t", 5);
+  BOOST_CHECK( root->isUpdatePending() );
+  updateFrame();
+  BOOST_CHECK_EQUAL(stats->visited, 6u);
+  BOOST_CHECK_EQUAL(stats->updated, 3u);
+
+  // data-* properties do not affect rendering
+  leaf->setIntValue("data-value", 1);
+  BOOST_CHECK( !root->isUpdatePending() );
+  updateFrame();
+  BOOST_CHECK_EQUAL(stats->updated, 0u);
+
+  // Hidden subtrees are not traversed...
+  node->getChild("group", 1)->setBoolValue("visible", false);
+  updateFrame();
+  BOOST_CHECK_EQUAL(stats->visited, 3u);
+  BOOST_CHECK_EQUAL(stats->updated, 1u);
+
+  SGPropertyNode* hidden_leaf = node->getChild("group", 1)->getChild("group", 2);
+  hidden_leaf->setDoubleValue("tf/t", 5);
+  updateFrame();
+  BOOST_CHECK_EQUAL(stats->visited, 3u);
+  BOOST_CHECK_EQUAL(stats->updated, 1u);
+
+  // ...until they are shown again
+  node->getChild("group", 1)->setBoolValue("visible", true);
+  updateFrame();
+  BOOST_CHECK_EQUAL(stats->visited, 6u);
+  BOOST_CHECK_EQUAL(stats->updated, 3u);
+}
+
+//------------------------------------------------------------------------------
+template<class ProjectionType>
+void checkBatchProjection()
+{
+  ProjectionType proj;
+  proj.setWorldPosition(47.5, 11.2);
+  proj.setOrientation(33);
+  proj.setRange(40);
+  proj.setScreenRange(512);
+
+  const size_t count = 300; // more than one internal block
+  std::vector<double> lat(count), lon(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    lat[i] = 47.5 + std::sin(i * 0.37);
+    lon[i] = 11.2 + std::cos(i * 0.91);
+  }
+
+  std::vector<sc::Projection::ScreenPosition> pos(count);
+  proj.worldToScreen(lat.data(), lon.data(), pos.data(), count);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    sc::Projection::ScreenPosition ref = proj.worldToScreen(lat[i], lon[i]);
+    BOOST_CHECK_EQUAL(pos[i].x, ref.x);
+    BOOST_CHECK_EQUAL(pos[i].y, ref.y);
+  }
+
+  // Cached terms stay valid if only the projection center changes
+  std::vector<sc::HorizontalProjection::GeoPosition> geo(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    geo[i].lat = SGMiscd::deg2rad(lat[i]);
+    geo[i].lon = SGMiscd::deg2rad(lon[i]);
+  }
+  proj.prepare(geo.data(), count);
+
+  proj.setWorldPosition(48, 12);
+  proj.setOrientation(-120);
+  proj.project(geo.data(), pos.data(), count);
+  proj.viewTransform(pos.data(), count);
+
+  for(size_t i = 0; i < count; ++i)
+  {
+    sc::Projection::ScreenPosition ref = proj.worldToScreen(lat[i], lon[i]);
+    BOOST_CHECK_EQUAL(pos[i].x, ref.x);
+    BOOST_CHECK_EQUAL(pos[i].y, ref.y);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( map_batch_projection )
+{
+  checkBatchProjection<sc::SansonFlamsteedProjection>();
+  checkBatchProjection<sc::WebMercatorProjection>();
+}
@@ -37,7 +37,8 @@ namespace canvas
       GeoNodePair():
         _status(INCOMPLETE),
         _node_lat(0),
-        _node_lon(0)
+        _node_lon(0),
+        _has_cached_lat_lon(false)
       {}
 
       uint8_t getStatus() const
@@ -100,7 +101,13 @@ namespace canvas
       }
 
       void setCachedLatLon(const std::pair<double, double>& latLon)
-      { _cachedLatLon = latLon; }
+      {
+        _cachedLatLon = latLon;
+        _has_cached_lat_lon = true;
+      }
+
+      bool hasCachedLatLon() const
+      { return _has_cached_lat_lon; }
       
       std::pair<double, double> getCachedLatLon()
       { return _cachedLatLon; }
@@ -145,6 +152,7 @@ namespace canvas
       SGPropertyNode_ptr _xNode,
           _yNode;
       std::pair<double, double> _cachedLatLon;
+      bool _has_cached_lat_lon;
 
   };
 
@@ -22,6 +22,8 @@
 
 #include <simgear/math/SGMisc.hxx>
 
+#include <cstddef>
+
 namespace simgear
 {
 namespace canvas
@@ -70,6 +72,19 @@ namespace canvas
   {
     public:
 
+      /**
+       * Per position terms of a projection which do not depend on the
+       * reference position or the view, cached by the map for positions
+       * which have not changed.
+       */
+      struct GeoPosition
+      {
+        double lat,   ///<! Latitude (radian)
+               lon,   ///<! Longitude (radian)
+               kx,    ///<! Projection specific x factor
+               ky;    ///<! Projection specific y factor
+      };
+
       HorizontalProjection():
         _ref_lat(0),
         _ref_lon(0),
@@ -136,6 +151,78 @@ namespace canvas
         );
       }
 
+      /**
+       * Transform arrays of world positions to screen positions. Gives the
+       * same results as calling worldToScreen() for each position.
+       *
+       * @param lat   Latitudes in degrees
+       * @param lon   Longitudes in degrees
+       * @param pos   Resulting screen positions
+       * @param count Number of positions
+       */
+      void worldToScreen( const double* lat,
+                          const double* lon,
+                          ScreenPosition* pos,
+                          size_t count )
+      {
+        const size_t block_size = 256;
+        GeoPosition geo[block_size];
+
+        for(size_t begin = 0; begin < count; begin += block_size)
+        {
+          size_t n = count - begin < block_size ? count - begin : block_size;
+          for(size_t i = 0; i < n; ++i)
+          {
+            geo[i].lat = SGMiscd::deg2rad(lat[begin + i]);
+            geo[i].lon = SGMiscd::deg2rad(lon[begin + i]);
+          }
+
+          prepare(geo, n);
+          project(geo, pos + begin, n);
+          viewTransform(pos + begin, n);
+        }
+      }
+
+      /**
+       * Compute the reference independent terms for the given positions.
+       * GeoPosition::lat and GeoPosition::lon need to be set (in radians).
+       */
+      virtual void prepare(GeoPosition* geo, size_t count) const
+      {
+        for(size_t i = 0; i < count; ++i)
+          geo[i].kx = geo[i].ky = 0;
+      }
+
+      /**
+       * Project prepared positions relative to the projection center, without
+       * applying range and orientation.
+       */
+      virtual void project( const GeoPosition* geo,
+                            ScreenPosition* pos,
+                            size_t count ) const
+      {
+        for(size_t i = 0; i < count; ++i)
+          pos[i] = project(geo[i].lat, geo[i].lon);
+      }
+
+      /**
+       * Apply range and orientation to projected positions. This is a single
+       * affine transform, so a change of only range, screen range or heading
+       * does not require projecting the positions again.
+       */
+      void viewTransform(ScreenPosition* pos, size_t count) const
+      {
+        const double scale = _screen_range / _range;
+
+        for(size_t i = 0; i < count; ++i)
+        {
+          const double x = pos[i].x * scale,
+                       y = pos[i].y * scale;
+          pos[i].x =  _cos_angle * x - _sin_angle * y;
+          pos[i].y = -_sin_angle * x - _cos_angle * y;
+        }
+      }
+
     protected:
 
       /**
@@ -160,6 +247,31 @@ namespace canvas
   class SansonFlamsteedProjection:
     public HorizontalProjection
   {
+    public:
+
+      virtual void prepare(GeoPosition* geo, size_t count) const
+      {
+        for(size_t i = 0; i < count; ++i)
+        {
+          double r = getEarthRadius(geo[i].lat);
+          geo[i].kx = r * cos(geo[i].lat);
+          geo[i].ky = r;
+        }
+      }
+
+      /// No trigonometry left once prepared, so moving the projection center
+      /// is cheap.
+      virtual void project( const GeoPosition* geo,
+                            ScreenPosition* pos,
+                            size_t count ) const
+      {
+        for(size_t i = 0; i < count; ++i)
+        {
+          pos[i].x = geo[i].kx * (geo[i].lon - _ref_lon);
+          pos[i].y = geo[i].ky * (geo[i].lat - _ref_lat);
+        }
+      }
+
     protected:
 
       virtual ScreenPosition project(double lat, double lon) const
@@ -198,6 +310,10 @@ namespace canvas
   class WebMercatorProjection:
     public HorizontalProjection
   {
+    public:
+
+      using HorizontalProjection::project;
+
     protected:
 
       virtual ScreenPosition project(double lat, double lon) const
@@ -1,4 +1,6 @@
 #include "debug_types.h"
+#include "logdelta.hxx"
+#include "logstream.hxx"
 
 #include <iostream>
 #include <map>
@@ -130,6 +132,12 @@ struct logDelta
         }
     }
     
+    bool active()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex);
+        return !m_items.empty();
+    }
+
     /* Returns delta logging level for (file,line,function), using m_items and
     caching results in m_cache. */
     int operator()(const char* file, int line, const char* function)
@@ -256,4 +264,10 @@ sgDebugPriority logDeltaAdd(sgDebugPriority priority,
 void logDeltaSet(const char* items)
 {
     s_log_delta.update(items);
+    sglog().updateMinPriority();
+}
+
+bool logDeltaActive()
+{
+    return s_log_delta.active();
 }
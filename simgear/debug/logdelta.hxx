@@ -47,3 +47,7 @@ sgDebugPriority logDeltaAdd(sgDebugPriority priority,
 /* Resets deltas. <items> should be a string in same format as $SG_LOG_DELTAS
 as described above. */
 void logDeltaSet(const char* items);
+
+/* Returns true if any deltas are set, in which case any priority may end up
+being logged. */
+bool logDeltaActive();
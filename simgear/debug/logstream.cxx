@@ -30,11 +30,13 @@
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
 
 #include <simgear/sg_inlines.h>
 #include <simgear/threads/SGThread.hxx>
-#include <simgear/threads/SGQueue.hxx>
 
 #include "LogCallback.hxx"
 #include <simgear/io/iostreams/sgstream.hxx>
@@ -164,6 +166,105 @@ public:
 
 #endif
 
+namespace {
+
+/**
+ * An entry on its way to the logging thread. Entries logged with
+ * logDeferred() carry a formatter instead of the message.
+ */
+struct QueuedEntry
+{
+    sgDebugClass debugClass = SG_NONE;
+    sgDebugPriority debugPriority = SG_BULK;
+    sgDebugPriority originalPriority = SG_BULK;
+    const char* file = nullptr;
+    int line = 0;
+    const char* function = nullptr;
+    std::string message;
+    std::function<std::string()> format;
+    bool freeFilename = false;
+    uint64_t sequence = 0;
+};
+
+/**
+ * Single producer, single consumer ring of entries. Each thread which logs
+ * gets its own, the logging thread is the only consumer.
+ */
+class LogRing
+{
+public:
+    static const size_t Capacity = 512;
+
+    // producer side, leaves the entry alone if the ring is full
+    bool push(QueuedEntry& entry)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_slots[tail % Capacity] = std::move(entry);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side
+    void drain(std::vector<QueuedEntry>& out)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        for (size_t i = head; i != tail; ++i) {
+            out.push_back(std::move(m_slots[i % Capacity]));
+        }
+        m_head.store(tail, std::memory_order_release);
+    }
+
+    bool empty() const
+    {
+        return m_head.load(std::memory_order_acquire) ==
+               m_tail.load(std::memory_order_acquire);
+    }
+
+    // only written by the producer, read for getQueueStats()
+    static void increment(std::atomic<uint64_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> queued{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> waits{0};
+
+    // set when the producing thread exits
+    std::atomic<bool> orphaned{false};
+
+private:
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    QueuedEntry m_slots[Capacity];
+};
+
+struct ThreadRing
+{
+    uint64_t owner = 0;
+    std::shared_ptr<LogRing> ring;
+
+    ~ThreadRing()
+    {
+        if (ring) {
+            ring->orphaned = true;
+        }
+        ring.reset();
+        owner = 0;
+    }
+};
+
+thread_local ThreadRing t_ring;
+thread_local bool t_isLogThread = false;
+std::atomic<uint64_t> s_nextInstance{1};
+
+} // of anonymous namespace
+
 class logstream::LogStreamPrivate : public SGThread
 {
 private:
@@ -318,7 +419,19 @@ public:
     }
 
     std::mutex m_lock;
-    SGBlockingQueue<simgear::LogEntry> m_entries;
+
+    // per-thread rings, the logging thread drains all of them
+    const uint64_t m_instance = s_nextInstance++;
+    mutable std::mutex m_ringsLock;
+    std::vector<std::shared_ptr<LogRing>> m_rings;
+    logstream::QueueStats m_retiredStats; ///< of rings of exited threads
+    std::atomic<uint64_t> m_sequence{0};
+
+    std::mutex m_wakeLock;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_consumerWaiting{false};
+    std::atomic<bool> m_stopRequested{false};
+    std::atomic<bool> m_closing{false};
 
     // log entries posted during startup
     std::vector<simgear::LogEntry> m_startupEntries;
@@ -332,7 +445,7 @@ public:
 
     sgDebugClass m_logClass;
     sgDebugPriority m_logPriority;
-    bool m_isRunning = false;
+    std::atomic<bool> m_isRunning{false};
 #if defined (SG_WINDOWS)
     // track whether the console was redirected on launch (in the constructor, which is called early on)
     bool m_stderr_isRedirectedAlready = false;
@@ -372,28 +485,157 @@ public:
         m_startupEntries.clear();
     }
 
-    void run() override
+    LogRing& threadRing()
     {
-        while (1) {
-            simgear::LogEntry entry(m_entries.pop());
-            // special marker entry detected, terminate the thread since we are
-            // making a configuration change or quitting the app
-            if ((entry.debugClass == SG_NONE) && entry.file && !strcmp(entry.file, "done")) {
+        if (t_ring.owner != m_instance) {
+            if (t_ring.ring) {
+                t_ring.ring->orphaned = true;
+            }
+            t_ring.ring = std::make_shared<LogRing>();
+            t_ring.owner = m_instance;
+            std::lock_guard<std::mutex> g(m_ringsLock);
+            m_rings.push_back(t_ring.ring);
+        }
+        return *t_ring.ring;
+    }
+
+    void wakeConsumer()
+    {
+        // pairs with the fence in run(), so either the logging thread sees
+        // the new entry or we see it waiting. Only the first thread to see
+        // it waiting needs to wake it up.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_consumerWaiting.load(std::memory_order_relaxed) &&
+            m_consumerWaiting.exchange(false)) {
+            std::lock_guard<std::mutex> g(m_wakeLock);
+            m_wake.notify_one();
+        }
+    }
+
+    void enqueue(QueuedEntry& entry)
+    {
+        LogRing& ring = threadRing();
+        while (!ring.push(entry)) {
+            // With a full ring debug output is dropped, anything more
+            // important waits for the logging thread to catch up unless
+            // that can never happen.
+            if (entry.debugPriority < SG_INFO || m_closing || t_isLogThread) {
+                LogRing::increment(ring.dropped);
+                if (entry.freeFilename) {
+                    free(const_cast<char*>(entry.file));
+                    free(const_cast<char*>(entry.function));
+                }
                 return;
             }
-            {
-                std::lock_guard<std::mutex> g(m_lock);
-                if (m_startupLogging) {
-                    // save to the startup list for not-yet-added callbacks to
-                    // pull down on startup
-                    m_startupEntries.push_back(entry);
+            LogRing::increment(ring.waits);
+            wakeConsumer();
+            std::this_thread::yield();
+        }
+        LogRing::increment(ring.queued);
+        wakeConsumer();
+    }
+
+    bool anyQueued() const
+    {
+        std::lock_guard<std::mutex> g(m_ringsLock);
+        for (const auto& ring : m_rings) {
+            if (!ring->empty()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void collect(std::vector<QueuedEntry>& pending)
+    {
+        {
+            std::lock_guard<std::mutex> g(m_ringsLock);
+            for (auto it = m_rings.begin(); it != m_rings.end(); ) {
+                LogRing& ring = **it;
+                // nothing can be added after the owner exited
+                const bool orphaned = ring.orphaned;
+                ring.drain(pending);
+                if (orphaned) {
+                    m_retiredStats.queued += ring.queued;
+                    m_retiredStats.dropped += ring.dropped;
+                    m_retiredStats.waits += ring.waits;
+                    it = m_rings.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        // restore the order of entries from different threads
+        std::sort(pending.begin(), pending.end(),
+                  [](const QueuedEntry& a, const QueuedEntry& b) {
+                      return a.sequence < b.sequence;
+                  });
+    }
+
+    void dispatch(QueuedEntry& queued)
+    {
+        std::string message;
+        if (queued.format) {
+            try {
+                message = queued.format();
+            } catch (const std::exception& e) {
+                message = std::string("exception formatting log message: ") + e.what();
+            }
+        } else {
+            message = std::move(queued.message);
+        }
+
+        simgear::LogEntry entry(queued.debugClass, queued.debugPriority,
+                                queued.originalPriority, queued.file,
+                                queued.line, queued.function, message,
+                                queued.freeFilename);
+        {
+            std::lock_guard<std::mutex> g(m_lock);
+            if (m_startupLogging) {
+                // save to the startup list for not-yet-added callbacks to
+                // pull down on startup
+                m_startupEntries.push_back(entry);
+            }
+        }
+        // submit to each installed callback in turn
+        for (simgear::LogCallback* cb : m_callbacks) {
+            cb->processEntry(entry);
+        }
+    }
+
+    void run() override
+    {
+        t_isLogThread = true;
+        std::vector<QueuedEntry> pending;
+        while (1) {
+            // read before draining, so everything logged before stop() was
+            // called gets written
+            const bool stopping = m_stopRequested.load(std::memory_order_acquire);
+            collect(pending);
+            if (!pending.empty()) {
+                for (auto& queued : pending) {
+                    dispatch(queued);
                 }
+                pending.clear();
+                continue;
             }
-            // submit to each installed callback in turn
-            for (simgear::LogCallback* cb : m_callbacks) {
-                cb->processEntry(entry);
+
+            // terminate the thread since we are making a configuration
+            // change or quitting the app
+            if (stopping) {
+                break;
+            }
+
+            std::unique_lock<std::mutex> g(m_wakeLock);
+            m_consumerWaiting = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!m_stopRequested && !anyQueued()) {
+                m_wake.wait_for(g, std::chrono::milliseconds(100));
             }
+            m_consumerWaiting = false;
         } // of main thread loop
+        t_isLogThread = false;
     }
 
     bool stop()
@@ -403,17 +645,32 @@ public:
             if (!m_isRunning) {
                 return false;
             }
+        }
 
-            // log a special marker value, which will cause the thread to wakeup,
-            // and then exit
-            log(SG_NONE, SG_ALERT, "done", -1, "", "", false);
+        {
+            std::lock_guard<std::mutex> g(m_wakeLock);
+            m_stopRequested = true;
+            m_wake.notify_one();
         }
         join();
 
+        m_stopRequested = false;
         m_isRunning = false;
         return true;
     }
 
+    logstream::QueueStats queueStats() const
+    {
+        std::lock_guard<std::mutex> g(m_ringsLock);
+        logstream::QueueStats stats = m_retiredStats;
+        for (const auto& ring : m_rings) {
+            stats.queued += ring->queued.load(std::memory_order_relaxed);
+            stats.dropped += ring->dropped.load(std::memory_order_relaxed);
+            stats.waits += ring->waits.load(std::memory_order_relaxed);
+        }
+        return stats;
+    }
+
     void addCallback(simgear::LogCallback* cb)
     {
         PauseThread pause(this);
@@ -455,34 +712,61 @@ public:
         }
     }
 
+    // translated receives the priority for log(), if given
     bool would_log( sgDebugClass c, sgDebugPriority p,
             const char* file, int line, const char* function,
-            bool freeFilename ) const
+            bool freeFilename, sgDebugPriority* translated = nullptr ) const
     {
         // Testing mode, so always log.
-        if (m_testMode) return true;
-
         // SG_OSG (OSG notify) - will always be displayed regardless of FG log settings as OSG log level is configured
         // separately and thus it makes more sense to allow these message through.
-        if (static_cast<unsigned>(p) == static_cast<unsigned>(SG_OSG)) return true;
+        if (m_testMode || static_cast<unsigned>(p) == static_cast<unsigned>(SG_OSG)) {
+            if (translated) {
+                *translated = translatePriority(p, file, line, function, freeFilename);
+            }
+            return true;
+        }
 
-        p = translatePriority(p, file, line, function, freeFilename);
-        if (p >= SG_INFO) return true;
-        return ((c & m_logClass) != 0 && p >= m_logPriority);
+        const auto tp = translatePriority(p, file, line, function, freeFilename);
+        if (translated) {
+            *translated = tp;
+        }
+        if (tp >= SG_INFO) return true;
+        return ((c & m_logClass) != 0 && tp >= m_logPriority);
     }
 
     void log( sgDebugClass c, sgDebugPriority p,
             const char* fileName, int line, const char* function,
-            const std::string& msg, bool freeFilename)
+            const std::string& msg, bool freeFilename,
+            std::function<std::string()> format = {})
     {
         auto tp = translatePriority(p, fileName, line, function, freeFilename);
+        log(c, p, tp, fileName, line, function, msg, freeFilename, std::move(format));
+    }
+
+    // tp is p after translatePriority()
+    void log( sgDebugClass c, sgDebugPriority p, sgDebugPriority tp,
+            const char* fileName, int line, const char* function,
+            const std::string& msg, bool freeFilename,
+            std::function<std::string()> format = {})
+    {
         if (!m_fileLine) {
             /* This prevents output of file:line in StderrLogCallback. */
             line = -line;
         }
 
-        simgear::LogEntry entry(c, tp, p, fileName, line, function, msg, freeFilename);
-        m_entries.push(entry);
+        QueuedEntry entry;
+        entry.debugClass = c;
+        entry.debugPriority = tp;
+        entry.originalPriority = p;
+        entry.file = fileName;
+        entry.line = line;
+        entry.function = function;
+        entry.message = msg;
+        entry.format = std::move(format);
+        entry.freeFilename = freeFilename;
+        entry.sequence = m_sequence.fetch_add(1, std::memory_order_relaxed);
+        enqueue(entry);
     }
 
     sgDebugPriority translatePriority(sgDebugPriority in,
@@ -507,22 +791,39 @@ public:
 static std::unique_ptr<logstream> global_logstream;
 static std::mutex global_logStreamLock;
 
+static std::atomic<logstream*> global_logstreamPtr{nullptr};
+
 logstream::logstream()
 {
     d.reset(new LogStreamPrivate);
+    updateMinPriority();
     d->startLog();
 }
 
 logstream::~logstream()
 {
+    d->m_closing = true;
     d->stop();
     d.reset();
 }
 
+void
+logstream::updateMinPriority()
+{
+    // Test mode and log deltas can let anything through, otherwise nothing
+    // below the configured priority or SG_INFO, whichever is lower, is logged.
+    int p = 0;
+    if (!d->m_testMode && !logDeltaActive()) {
+        p = std::min(static_cast<int>(d->m_logPriority), static_cast<int>(SG_INFO));
+    }
+    m_minPriority.store(p, std::memory_order_relaxed);
+}
+
 void
 logstream::setLogLevels( sgDebugClass c, sgDebugPriority p )
 {
     d->setLogLevels(c, p);
+    updateMinPriority();
 }
 
 void logstream::setDeveloperMode(bool devMode)
@@ -547,6 +848,12 @@ logstream::removeCallback(simgear::LogCallback* cb)
     d->removeCallback(cb);
 }
 
+void
+logstream::removeCallbacks()
+{
+    d->removeCallbacks();
+}
+
 void
 logstream::log( sgDebugClass c, sgDebugPriority p,
         const char* fileName, int line, const char* function,
@@ -555,6 +862,14 @@ logstream::log( sgDebugClass c, sgDebugPriority p,
     d->log(c, p, fileName, line, function, msg, false);
 }
 
+void
+logstream::log( sgDebugClass c, sgDebugPriority p, sgDebugPriority translated,
+        const char* fileName, int line, const char* function,
+        const std::string& msg)
+{
+    d->log(c, p, translated, fileName, line, function, msg, false);
+}
+
 void
 logstream::logCopyingFilename( sgDebugClass c, sgDebugPriority p,
          const char* fileName, int line, const char* function,
@@ -563,6 +878,28 @@ logstream::logCopyingFilename( sgDebugClass c, sgDebugPriority p,
     d->log(c, p, strdup(fileName), line, strdup(function), msg, true);
 }
 
+void
+logstream::logDeferred( sgDebugClass c, sgDebugPriority p,
+        const char* fileName, int line, const char* function,
+        std::function<std::string()> format)
+{
+    d->log(c, p, fileName, line, function, std::string(), false, std::move(format));
+}
+
+void
+logstream::logDeferred( sgDebugClass c, sgDebugPriority p, sgDebugPriority translated,
+        const char* fileName, int line, const char* function,
+        std::function<std::string()> format)
+{
+    d->log(c, p, translated, fileName, line, function, std::string(), false, std::move(format));
+}
+
+logstream::QueueStats
+logstream::getQueueStats() const
+{
+    return d->queueStats();
+}
+
 
 void logstream::hexdump(sgDebugClass c, sgDebugPriority p,
         const char* fileName, int line, const char* function,
@@ -647,11 +984,11 @@ logstream::has_popup()
 }
 
 bool
-logstream::would_log( sgDebugClass c, sgDebugPriority p,
+logstream::would_log_slow( sgDebugClass c, sgDebugPriority p,
         const char* file, int line, const char* function,
-        bool freeFilename ) const
+        bool freeFilename, sgDebugPriority* translated ) const
 {
-    return d->would_log(c, p, file, line, function, freeFilename);
+    return d->would_log(c, p, file, line, function, freeFilename, translated);
 }
 
 sgDebugClass
@@ -669,13 +1006,13 @@ logstream::get_log_priority() const
 void
 logstream::set_log_priority( sgDebugPriority p)
 {
-    d->setLogLevels(d->m_logClass, p);
+    setLogLevels(d->m_logClass, p);
 }
 
 void
 logstream::set_log_classes( sgDebugClass c)
 {
-    d->setLogLevels(c, d->m_logPriority);
+    setLogLevels(c, d->m_logPriority);
 }
 
 sgDebugPriority logstream::priorityFromString(const std::string& s)
@@ -696,12 +1033,17 @@ sglog()
     static std::ios_base::Init initializer;
 
     // http://www.aristeia.com/Papers/DDJ_Jul_Aug_2004_revised.pdf
-    // in the absence of portable memory barrier ops in Simgear,
-    // let's keep this correct & safe
-    std::lock_guard<std::mutex> g(global_logStreamLock);
+    // double-checked, every SG_LOG() comes through here
+    logstream* instance = global_logstreamPtr.load(std::memory_order_acquire);
+    if (instance) {
+        return *instance;
+    }
 
-    if( !global_logstream )
+    std::lock_guard<std::mutex> g(global_logStreamLock);
+    if( !global_logstream ) {
         global_logstream.reset(new logstream);
+        global_logstreamPtr.store(global_logstream.get(), std::memory_order_release);
+    }
     return *(global_logstream.get());
 }
 
@@ -766,6 +1108,7 @@ logstream::setTestingMode( bool testMode )
 {
     d->m_testMode = testMode;
     if (testMode) d->removeCallbacks();
+    updateMinPriority();
 }
 
 
@@ -781,6 +1124,7 @@ void requestConsole(bool ignoreErrors)
 void shutdownLogging()
 {
     std::lock_guard<std::mutex> g(global_logStreamLock);
+    global_logstreamPtr.store(nullptr, std::memory_order_release);
     global_logstream.reset();
 }
 
@@ -28,6 +28,9 @@
 #include <simgear/compiler.h>
 #include <simgear/debug/debug_types.h>
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <sstream>
 #include <vector>
 #include <memory>
@@ -50,6 +53,8 @@ void shutdownLogging();
 
 } // of namespace simgear
 
+void logDeltaSet(const char* items);
+
 /**
  * Class to manage the debug logging stream.
  */
@@ -74,9 +79,35 @@ public:
      */
     void setLogLevels( sgDebugClass c, sgDebugPriority p );
 
+    /**
+     * Messages below the lowest priority which could be logged with the
+     * current settings are rejected with a single relaxed load, everything
+     * else is checked against the class, log deltas and developer mode.
+     */
+    bool would_log(  sgDebugClass c, sgDebugPriority p,
+            const char* file, int line, const char* function,
+            bool freeFilename=false ) const
+    {
+        if (static_cast<int>(p) < m_minPriority.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return would_log_slow(c, p, file, line, function, freeFilename);
+    }
+
+    /**
+     * As above, also returning the priority after log deltas and developer
+     * mode have been applied, to pass on to log() or logDeferred() so they
+     * don't work it out again. Used by the SG_LOG macros.
+     */
     bool would_log(  sgDebugClass c, sgDebugPriority p,
             const char* file, int line, const char* function,
-            bool freeFilename=false ) const;
+            sgDebugPriority& translated ) const
+    {
+        if (static_cast<int>(p) < m_minPriority.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return would_log_slow(c, p, file, line, function, false, &translated);
+    }
 
     void logToFile( const SGPath& aPath, sgDebugClass c, sgDebugPriority p );
 
@@ -113,6 +144,11 @@ public:
             const char* fileName, int line, const char* function,
             const std::string& msg);
 
+    // overload of above, with the priority translated by would_log()
+    void log( sgDebugClass c, sgDebugPriority p, sgDebugPriority translated,
+            const char* fileName, int line, const char* function,
+            const std::string& msg);
+
     // overload of above, which can transfer ownership of the file-name.
     // this is unecesary overhead when logging from C++, since __FILE__ points
     // to constant data, but it's needed when the filename is Nasal data (for
@@ -121,6 +157,33 @@ public:
     void logCopyingFilename( sgDebugClass c, sgDebugPriority p,
              const char* fileName, int line, const char* function,
              const std::string& msg);
+
+    /**
+     * log a message which is only formatted on the logging thread. The
+     * formatter must not capture anything which may be gone or changed by the
+     * time the message is written, see SG_LOG_DEFERRED.
+     */
+    void logDeferred( sgDebugClass c, sgDebugPriority p,
+            const char* fileName, int line, const char* function,
+            std::function<std::string()> format);
+
+    // overload of above, with the priority translated by would_log()
+    void logDeferred( sgDebugClass c, sgDebugPriority p, sgDebugPriority translated,
+            const char* fileName, int line, const char* function,
+            std::function<std::string()> format);
+
+    struct QueueStats
+    {
+        uint64_t queued = 0;    ///< entries passed to the logging thread
+        uint64_t dropped = 0;   ///< debug entries dropped with a full queue
+        uint64_t waits = 0;     ///< times a thread waited for a full queue
+    };
+
+    /**
+     * counters of the per-thread queues feeding the logging thread, summed
+     * over all threads which logged so far.
+     */
+    QueueStats getQueueStats() const;
     
     /**
     * output formatted hex dump of memory block
@@ -185,9 +248,19 @@ private:
     // constructor
     logstream();
 
+    bool would_log_slow( sgDebugClass c, sgDebugPriority p,
+            const char* file, int line, const char* function,
+            bool freeFilename, sgDebugPriority* translated = nullptr ) const;
+
+    // recompute m_minPriority after the settings changed
+    void updateMinPriority();
+    friend void ::logDeltaSet(const char* items);
+
     class LogStreamPrivate;
 
     std::unique_ptr<LogStreamPrivate> d;
+
+    std::atomic<int> m_minPriority{0};
 };
 
 logstream& sglog();
@@ -195,23 +268,49 @@ logstream& sglog();
 
 
 /** \def SG_LOG(C,P,M)
- * Log a message.
+ * Log a message. The message is formatted by the caller, so M may refer
+ * to anything in scope.
  * @param C debug class
  * @param P priority
  * @param M message
  */
 # define SG_LOGX(C,P,M) \
-    do { if(sglog().would_log(C,P, __FILE__, __LINE__, __FUNCTION__)) { \
+    do { sgDebugPriority sg_log_translated_ = (P);                    \
+        if(sglog().would_log(C,P, __FILE__, __LINE__, __FUNCTION__, sg_log_translated_)) { \
         std::ostringstream os; os << M;                  \
-        sglog().log(C, P, __FILE__, __LINE__, __FUNCTION__, os.str()); \
+        sglog().log(C, P, sg_log_translated_, __FILE__, __LINE__, __FUNCTION__, os.str()); \
         if ((P) == SG_POPUP) sglog().popup(os.str());    \
     } } while(0)
+
+/** \def SG_LOG_DEFERRED(C,P,M)
+ * Log a message, formatting it on the logging thread instead of the caller.
+ * The stream expression is captured by value, so it must only refer to
+ * values (numbers, strings, SGVec and friends) and not to pointers or
+ * references to objects which may change or go away in the meantime.
+ *
+ * In a member function the capture by value also captures the this
+ * pointer, and members named in M are read through it when the message
+ * is formatted, not copied. Copy members to locals first and log those,
+ * or use SG_LOG.
+ * @param C debug class
+ * @param P priority
+ * @param M message
+ */
+# define SG_LOG_DEFERREDX(C,P,M) \
+    do { sgDebugPriority sg_log_translated_ = (P);                    \
+        if(sglog().would_log(C,P, __FILE__, __LINE__, __FUNCTION__, sg_log_translated_)) { \
+        if ((P) == SG_POPUP) { SG_LOGX(C,P,M); break; }                 \
+        sglog().logDeferred(C, P, sg_log_translated_, __FILE__, __LINE__, __FUNCTION__, \
+            [=]() { std::ostringstream os; os << M; return os.str(); }); \
+    } } while(0)
 #ifdef FG_NDEBUG
 # define SG_LOG(C,P,M)	do { if((P) == SG_POPUP) SG_LOGX(C,P,M) } while(0)
+# define SG_LOG_DEFERRED(C,P,M) SG_LOG(C,P,M)
 # define SG_LOG_NAN(C,P,M) SG_LOG(C,P,M)
 # define SG_HEXDUMP(C,P,MEM,LEN)
 #else
 # define SG_LOG(C,P,M)	SG_LOGX(C,P,M)
+# define SG_LOG_DEFERRED(C,P,M) SG_LOG_DEFERREDX(C,P,M)
 # define SG_LOG_NAN(C,P,M) do { SG_LOGX(C,P,M); throw std::overflow_error(M); } while(0)
 # define SG_LOG_HEXDUMP(C,P,MEM,LEN) if(sglog().would_log(C,P, __FILE__, __LINE__, __FUNCTION__)) \
         sglog().hexdump(C, P, __FILE__, __LINE__, __FUNCTION__, MEM, LEN)
@@ -1,50 +1,95 @@
+// logtest - throughput of SG_LOG from many threads
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include <simgear/debug/LogCallback.hxx>
+#include <simgear/debug/LogEntry.hxx>
 #include <simgear/debug/logstream.hxx>
 
-class Test {
+namespace {
+
+const int NumThreads = 8;
 
-	public:
-	Test() {
-	  //cout << "Cout seems to work" << endl;
-	  //cerr << "Cerr seems to work" << endl;
-	  
-	  sglog().setLogLevels( SG_ALL, SG_INFO );
-	  
-	  SG_LOG(SG_EVENT, SG_INFO, "Test::Test" << "foo");
-	}
+class CountingCallback : public simgear::LogCallback
+{
+public:
+    CountingCallback() : simgear::LogCallback(SG_ALL, SG_BULK) {}
+
+    bool doProcessEntry(const simgear::LogEntry& e) override
+    {
+        ++count;
+        bytes += e.message.size();
+        return true;
+    }
 
+    std::atomic<unsigned long> count{0};
+    std::atomic<unsigned long> bytes{0};
 };
 
-Test test;
+template <class F>
+void run(const char* name, int perThread, F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NumThreads; ++t) {
+        threads.emplace_back([=] {
+            for (int i = 0; i < perThread; ++i)
+                f(t, i);
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-int
-main( int argc, char* argv[] )
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10)
+              << dt * 1e9 / (NumThreads * perThread) << " ns/msg" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
 {
-    sglog().setLogLevels( SG_ALL, SG_INFO );
-
-    //SG_LOG( FG_TERRAIN, FG_BULK,  "terrain::bulk" ); // shouldnt appear
-    //SG_LOG( FG_TERRAIN, SG_DEBUG, "terrain::debug" ); // shouldnt appear
-    //SG_LOG( FG_TERRAIN, SG_INFO,  "terrain::info" );
-    //SG_LOG( FG_TERRAIN, FG_WARN,  "terrain::warn" );
-    //SG_LOG( FG_TERRAIN, SG_ALERT, "terrain::alert" );
-
-    int i = 12345;
-    long l = 54321L;
-    double d = 3.14159;
-    string s = "Hello world!";
-
-    SG_LOG( SG_EVENT, SG_INFO, "event::info "
-				 << "i=" << i
-				 << ", l=" << l
-				 << ", d=" << d
-	                         << ", d*l=" << d*l
-				 << ", s=\"" << s << "\"" );
-
-    // This shouldn't appear in log output:
-    SG_LOG( SG_EVENT, SG_DEBUG, "event::debug "
-	    << "- this should be seen - "
-	    << "d=" << d
-	    << ", s=\"" << s << "\"" );
-
-    return 0;
+    const int perThread = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    CountingCallback* counter = new CountingCallback;
+    sglog().removeCallbacks();
+    sglog().addCallback(counter);
+    sglog().setLogLevels(SG_ALL, SG_INFO);
+
+    const std::string s = "Hello world!";
+    std::cout << NumThreads << " threads, " << perThread << " messages each" << std::endl;
+
+    run("disabled", perThread, [&](int t, int i) {
+        SG_LOG(SG_EVENT, SG_DEBUG, "event::debug i=" << i << ", t=" << t << ", d=" << i * 0.5 << ", s=" << s);
+    });
+    run("constant", perThread, [&](int, int) {
+        SG_LOG(SG_EVENT, SG_INFO, "event::info constant message");
+    });
+    run("enabled", perThread, [&](int t, int i) {
+        SG_LOG(SG_EVENT, SG_INFO, "event::info i=" << i << ", t=" << t << ", d=" << i * 0.5 << ", s=" << s);
+    });
+    run("deferred", perThread, [&](int t, int i) {
+        SG_LOG_DEFERRED(SG_EVENT, SG_INFO, "event::info i=" << i << ", t=" << t << ", d=" << i * 0.5 << ", s=" << s);
+    });
+
+    // wait for the logging thread by restarting it
+    sglog().removeCallback(counter);
+    logstream::QueueStats stats = sglog().getQueueStats();
+    std::cout << "written " << counter->count << ", queued " << stats.queued
+              << ", dropped " << stats.dropped << ", waits " << stats.waits << std::endl;
+
+    const bool ok = counter->count == stats.queued && stats.dropped == 0;
+    delete counter;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -45,6 +45,7 @@
 #include <simgear/debug/logstream.hxx>
 #include <simgear/timing/timestamp.hxx>
 #include <simgear/structure/exception.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
 
 #include "HTTPClient_private.hxx"
 #include "HTTPTestApi_private.hxx"
@@ -148,6 +149,8 @@ void Client::reset()
 
 void Client::update(int waitTimeout)
 {
+    d->finishBackgroundJobs();
+
     if (d->requests.empty()) {
         // curl_multi_wait returns immediately if there's no requests active,
         // but that can cause high CPU usage for us.
@@ -449,9 +452,30 @@ void Client::setProxy( const std::string& proxy,
     d->proxyAuth = auth;
 }
 
+void Client::runInBackground(std::function<void()> work, std::function<void()> done)
+{
+    d->backgroundJobs.push_back({SGThreadPool::shared().submit(std::move(work)), std::move(done)});
+}
+
+void Client::ClientPrivate::finishBackgroundJobs()
+{
+    auto it = backgroundJobs.begin();
+    while (it != backgroundJobs.end()) {
+        if (it->work.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            ++it;
+            continue;
+        }
+
+        // jobs started by done are appended, leaving the iterator valid
+        std::function<void()> done = std::move(it->done);
+        it = backgroundJobs.erase(it);
+        done();
+    }
+}
+
 bool Client::hasActiveRequests() const
 {
-    return !d->requests.empty();
+    return !d->requests.empty() || !d->backgroundJobs.empty();
 }
 
 void Client::receivedBytes(unsigned int count)
@@ -93,9 +93,17 @@ public:
 
     const std::string& proxyAuth() const;
 
+    /**
+     * Run work on the shared thread pool, then done from the next update()
+     * after it finished, on the thread calling update(). Lets request
+     * callbacks hand off slow file work without blocking other transfers.
+     * Counts as an active request until done has run.
+     */
+    void runInBackground(std::function<void()> work, std::function<void()> done);
+
     /**
      * predicate, check if at least one connection is active, with at
-     * least one request active or queued.
+     * least one request active or queued, or background work is pending.
      */
     bool hasActiveRequests() const;
 
@@ -14,6 +14,8 @@
 
 #pragma once
 
+#include <functional>
+#include <future>
 #include <list>
 #include <map>
 
@@ -61,6 +63,14 @@ public:
 
   SGPath tlsCertificatePath;
 
+  struct BackgroundJob {
+    std::future<void> work;
+    std::function<void()> done;
+  };
+  std::list<BackgroundJob> backgroundJobs;
+
+  void finishBackgroundJobs();
+
   // only used by unit-tests / test-api, but
   // only costs us a pointe here to declare it.
   ResponseDoneCallback testsuiteResponseDoneCallback;
@@ -34,11 +34,20 @@
 
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
 
 #include <cassert>
 #include <cerrno>
 #include <cstring>
 
+#if defined(__linux__)
+#  define SG_NETCHANNEL_EPOLL 1
+#  include <sys/epoll.h>
+#  include <unistd.h>
+#elif !defined(_WIN32)
+#  include <sys/select.h>
+#endif
+
 #include <simgear/debug/logstream.hxx>
 
 
@@ -146,6 +155,10 @@ NetChannel::recv (void * buffer, int size, int flags)
 void
 NetChannel::close (void)
 {
+  if (poller) {
+    poller->channelClosing(this);
+  }
+
   if ( !closed )
   {
     this->handleClose();
@@ -244,6 +257,230 @@ void NetChannel::handleError (int error)
     }
 }
 
+class NetChannelPoller::Backend
+{
+public:
+    virtual ~Backend() {}
+
+    virtual Method method() const = 0;
+
+    // called for every channel on each poll, with the events it wants
+    virtual void update(NetChannel* channel, bool read, bool write) = 0;
+
+    // the channel leaves the poller or is about to close its socket
+    virtual void remove(NetChannel* channel) {}
+
+    virtual void wait(unsigned int timeout, ChannelList& reads, ChannelList& writes) = 0;
+};
+
+/**
+ * The portable version, rebuilding the descriptor sets on each poll.
+ */
+class NetChannelPoller::SelectBackend : public NetChannelPoller::Backend
+{
+public:
+    Method method() const override { return METHOD_SELECT; }
+
+    void update(NetChannel* channel, bool read, bool write) override
+    {
+        if (!read && !write) {
+            return;
+        }
+
+#if !defined(_WIN32)
+        if (channel->getHandle() >= FD_SETSIZE) {
+            if (!warnedSetSize) {
+                SG_LOG(SG_IO, SG_ALERT, "Network: handle " << channel->getHandle()
+                       << " exceeds FD_SETSIZE, channel will not be polled");
+                warnedSetSize = true;
+            }
+            return;
+        }
+#endif
+        if (read) {
+            reads.push_back(channel);
+        }
+        if (write) {
+            writes.push_back(channel);
+        }
+    }
+
+    void wait(unsigned int timeout, ChannelList& readyReads, ChannelList& readyWrites) override
+    {
+        reads.push_back(nullptr);
+        writes.push_back(nullptr);
+        Socket::select(reads.data(), writes.data(), timeout);
+
+        for (int i = 0; reads[i]; i++) {
+            readyReads.push_back(static_cast<NetChannel*>(reads[i]));
+        }
+        for (int i = 0; writes[i]; i++) {
+            readyWrites.push_back(static_cast<NetChannel*>(writes[i]));
+        }
+
+        reads.clear();
+        writes.clear();
+    }
+
+private:
+    std::vector<Socket*> reads, writes;
+    bool warnedSetSize = false;
+};
+
+#if defined(SG_NETCHANNEL_EPOLL)
+
+/**
+ * Channels stay registered between polls, level triggered, so the epoll
+ * set only changes when a channel's interest or socket changes.
+ */
+class NetChannelPoller::EpollBackend : public NetChannelPoller::Backend
+{
+public:
+    EpollBackend() :
+        epollHandle(epoll_create1(EPOLL_CLOEXEC))
+    {
+        if (epollHandle < 0) {
+            SG_LOG(SG_IO, SG_WARN, "Network: epoll_create1 failed: " << strerror(errno));
+        }
+    }
+
+    ~EpollBackend()
+    {
+        if (epollHandle >= 0) {
+            ::close(epollHandle);
+        }
+    }
+
+    bool isValid() const { return epollHandle >= 0; }
+
+    Method method() const override { return METHOD_EPOLL; }
+
+    void update(NetChannel* channel, bool read, bool write) override
+    {
+        const unsigned int wanted = (read ? EPOLLIN : 0) | (write ? EPOLLOUT : 0);
+        const int handle = channel->getHandle();
+
+        // Nothing wanted also means no more errors or hang ups, which are
+        // always reported for registered sockets
+        if (channel->pollHandle != -1 && (channel->pollHandle != handle || !wanted)) {
+            remove(channel);
+        }
+
+        if (!wanted || handle < 0) {
+            return;
+        }
+
+        epoll_event ev;
+        ev.events = wanted;
+        if (channel->pollHandle == -1) {
+            ev.data.u64 = nextKey;
+            if (epoll_ctl(epollHandle, EPOLL_CTL_ADD, handle, &ev) < 0) {
+                SG_LOG(SG_IO, SG_WARN, "Network:" << handle << ": epoll_ctl failed: "
+                       << strerror(errno));
+                return;
+            }
+            channel->pollHandle = handle;
+            channel->pollEvents = wanted;
+            channel->pollKey = nextKey++;
+            keys[channel->pollKey] = channel;
+        } else if (channel->pollEvents != wanted) {
+            ev.data.u64 = channel->pollKey;
+            if (epoll_ctl(epollHandle, EPOLL_CTL_MOD, handle, &ev) == 0) {
+                channel->pollEvents = wanted;
+            }
+        }
+    }
+
+    void remove(NetChannel* channel) override
+    {
+        if (channel->pollHandle == -1) {
+            return;
+        }
+
+        // a socket closed behind our back has already left the set, and its
+        // handle may belong to another channel by now
+        if (channel->getHandle() == channel->pollHandle) {
+            epoll_event ev = {};
+            epoll_ctl(epollHandle, EPOLL_CTL_DEL, channel->pollHandle, &ev);
+        }
+
+        keys.erase(channel->pollKey);
+        channel->pollHandle = -1;
+        channel->pollEvents = 0;
+        channel->pollKey = 0;
+    }
+
+    void wait(unsigned int timeout, ChannelList& reads, ChannelList& writes) override
+    {
+        // anything beyond is reported by the next wait
+        events.resize(std::max<size_t>(1, std::min<size_t>(keys.size(), 1024)));
+        int count = epoll_wait(epollHandle, events.data(), static_cast<int>(events.size()),
+                               static_cast<int>(timeout));
+
+        for (int i = 0; i < count; ++i) {
+            auto it = keys.find(events[i].data.u64);
+            if (it == keys.end()) {
+                continue;
+            }
+
+            // like select(), errors and hang ups make the socket ready for
+            // whatever the channel was waiting for
+            NetChannel* channel = it->second;
+            const unsigned int e = events[i].events;
+            if ((e & (EPOLLIN | EPOLLERR | EPOLLHUP)) && (channel->pollEvents & EPOLLIN)) {
+                reads.push_back(channel);
+            }
+            if ((e & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && (channel->pollEvents & EPOLLOUT)) {
+                writes.push_back(channel);
+            }
+        }
+    }
+
+private:
+    int epollHandle;
+    uint64_t nextKey = 1;
+    std::unordered_map<uint64_t, NetChannel*> keys;
+    std::vector<epoll_event> events;
+};
+
+#endif // of SG_NETCHANNEL_EPOLL
+
+NetChannelPoller::NetChannelPoller(Method m)
+{
+#if defined(SG_NETCHANNEL_EPOLL)
+    if (m != METHOD_SELECT) {
+        std::unique_ptr<EpollBackend> epoll(new EpollBackend);
+        if (epoll->isValid()) {
+            backend = std::move(epoll);
+        }
+    }
+#endif
+
+    if (!backend) {
+        backend.reset(new SelectBackend);
+    }
+}
+
+NetChannelPoller::~NetChannelPoller()
+{
+    for (NetChannel* ch : channels) {
+        backend->remove(ch);
+        ch->poller = NULL;
+    }
+}
+
+NetChannelPoller::Method
+NetChannelPoller::method() const
+{
+    return backend->method();
+}
+
+void
+NetChannelPoller::channelClosing(NetChannel* channel)
+{
+    backend->remove(channel);
+}
+
 void
 NetChannelPoller::addChannel(NetChannel* channel)
 {
@@ -259,12 +496,17 @@ NetChannelPoller::removeChannel(NetChannel* channel)
 {
     assert(channel);
     assert(channel->poller == this);
+    backend->remove(channel);
     channel->poller = NULL;
 
     auto it = std::find(channels.begin(), channels.end(), channel);
     if (it != channels.end()) {
         channels.erase(it);
     }
+
+    // removed while dispatching events
+    std::replace(readyReads.begin(), readyReads.end(), channel, static_cast<NetChannel*>(nullptr));
+    std::replace(readyWrites.begin(), readyWrites.end(), channel, static_cast<NetChannel*>(nullptr));
 }
 
 bool
@@ -274,9 +516,6 @@ NetChannelPoller::poll(unsigned int timeout)
         return false;
     }
     
-    enum { MAX_SOCKETS = 256 } ;
-    Socket* reads [ MAX_SOCKETS+1 ] ;
-    Socket* writes [ MAX_SOCKETS+1 ] ;
     int nreads = 0 ;
     int nwrites = 0 ;
     int nopen = 0 ;
@@ -289,6 +528,7 @@ NetChannelPoller::poll(unsigned int timeout)
         {
             // avoid the channel trying to remove itself from us, or we get
             // bug http://code.google.com/p/flightgear-bugs/issues/detail?id=1144
+            backend->remove(ch);
             ch->poller = NULL;
             delete ch;
             it = channels.erase(it);
@@ -297,50 +537,48 @@ NetChannelPoller::poll(unsigned int timeout)
 
         ++it; // we've copied the pointer into ch
         if ( ch->closed ) { 
+            backend->update(ch, false, false);
             continue;
         }
 
         if (ch -> resolving_host )
         {
+            backend->update(ch, false, false);
             ch -> handleResolve();
             continue;
         }
       
         nopen++ ;
-        if (ch -> readable()) {
-          assert(nreads<MAX_SOCKETS);
-          reads[nreads++] = ch ;
-        }
-        if (ch -> writable()) {
-          assert(nwrites<MAX_SOCKETS);
-          writes[nwrites++] = ch ;
-        }
-    } // of array-filling pass
-    
-    reads[nreads] = NULL ;
-    writes[nwrites] = NULL ;
+        const bool read = ch -> readable();
+        const bool write = ch -> writable();
+        nreads += read;
+        nwrites += write;
+        backend->update(ch, read, write);
+    } // of interest-updating pass
 
     if (!nopen)
       return false ;
     if (!nreads && !nwrites)
       return true ; //hmmm- should we shutdown?
 
-    Socket::select (reads, writes, timeout) ;
+    backend->wait(timeout, readyReads, readyWrites);
 
-    for ( int i=0; reads[i]; i++ )
+    for (size_t i = 0; i < readyReads.size(); i++)
     {
-      NetChannel* ch = (NetChannel*)reads[i];
-      if ( ! ch -> closed )
+      NetChannel* ch = readyReads[i];
+      if ( ch && ! ch -> closed )
         ch -> handleReadEvent();
     }
 
-    for ( int i=0; writes[i]; i++ )
+    for (size_t i = 0; i < readyWrites.size(); i++)
     {
-      NetChannel* ch = (NetChannel*)writes[i];
-      if ( ! ch -> closed )
+      NetChannel* ch = readyWrites[i];
+      if ( ch && ! ch -> closed )
         ch -> handleWriteEvent();
     }
 
+    readyReads.clear();
+    readyWrites.clear();
     return true ;
 }
 
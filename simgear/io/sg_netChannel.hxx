@@ -55,6 +55,8 @@
 
 #include <simgear/io/raw_socket.hxx>
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -71,6 +73,12 @@ class NetChannel : public Socket
   
     friend class NetChannelPoller;
     NetChannelPoller* poller;
+
+    // registration with an event based poller: the handle and events it
+    // was registered with, and the key identifying it in events
+    int pollHandle = -1;
+    unsigned int pollEvents = 0;
+    uint64_t pollKey = 0;
 public:
 
   NetChannel () ;
@@ -115,11 +123,36 @@ public:
 
 };
 
+/**
+ * Waits for events on a set of channels and dispatches them. On Linux
+ * this uses epoll by default, with each channel registered once and its
+ * interest updated when the result of readable() or writable() changes.
+ * Elsewhere, or on request, select() is used, which limits the handles to
+ * below FD_SETSIZE.
+ */
 class NetChannelPoller
 {
     typedef std::vector<NetChannel*> ChannelList;
     ChannelList channels;
 public:
+    enum Method {
+        METHOD_DEFAULT, ///< the best one available
+        METHOD_SELECT,
+        METHOD_EPOLL
+    };
+
+    NetChannelPoller(Method method = METHOD_DEFAULT);
+    ~NetChannelPoller();
+
+    NetChannelPoller(const NetChannelPoller&) = delete;
+    NetChannelPoller& operator=(const NetChannelPoller&) = delete;
+
+    /**
+     * the method in use, which is METHOD_SELECT if the requested one is
+     * not available
+     */
+    Method method() const;
+
     void addChannel(NetChannel* channel);
     void removeChannel(NetChannel* channel);
     
@@ -127,6 +160,19 @@ public:
     
     bool poll(unsigned int timeout = 0);
     void loop(unsigned int timeout = 0);
+
+private:
+    class Backend;
+    class SelectBackend;
+    class EpollBackend;
+
+    friend class NetChannel;
+    // the channel is about to close its socket
+    void channelClosing(NetChannel* channel);
+
+    std::unique_ptr<Backend> backend;
+    // channels with events from the last wait, removed ones are cleared
+    ChannelList readyReads, readyWrites;
 };
 
 } // of namespace simgear
@@ -34,12 +34,29 @@
 #include <cstdlib> // for atoi
 #include <algorithm>
 
+#if defined(__linux__)
+#  define SG_UDP_MMSG 1
+#  include <cerrno>
+#  include <sys/socket.h>
+#  include <sys/uio.h>
+#endif
+
 using std::string;
 
+namespace {
+
+#if defined(SG_UDP_MMSG)
+// datagrams per recvmmsg() / sendmmsg() call
+const int BatchSize = 64;
+#endif
+
+} // anonymous namespace
+
 SGSocketUDP::SGSocketUDP( const string& host, const string& port ) :
     hostname(host),
     port_str(port),
-    save_len(0)
+    save_len(0),
+    blocking(true)
 {
     set_valid( false );
 }
@@ -76,6 +93,12 @@ bool SGSocketUDP::open( const SGProtocolDir d ) {
       SG_LOG(SG_IO, SG_ALERT, "error binding to port" << port_str);
       return false;
     }
+
+#if defined(SG_UDP_MMSG) && defined(SO_RXQ_OVFL)
+    // have readBatch() report datagrams dropped by the kernel
+    int on = 1;
+    setsockopt(sock.getHandle(), SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+#endif
   } else if (get_dir() == SG_IO_OUT) {
     // this means client
 
@@ -113,6 +136,8 @@ int SGSocketUDP::read( char *buf, int length ) {
     if ( (result = sock.recv(buf, maxsize, 0)) >= 0 ) {
 	buf[result] = '\0';
 	// printf("msg received = %s\n", buf);
+	++stats.packetsRead;
+	stats.bytesRead += result;
     }
 
     return result;
@@ -177,13 +202,174 @@ int SGSocketUDP::write( const char *buf, const int length ) {
 
     if ( sock.send( buf, length, 0 ) < 0 ) {
 	SG_LOG( SG_IO, SG_WARN, "Error writing to socket: " << port );
+	++stats.writeErrors;
 	return 0;
     }
 
+    ++stats.packetsWritten;
+    stats.bytesWritten += length;
     return length;
 }
 
 
+// read as many datagrams as are pending, up to count
+int SGSocketUDP::readBatch( Datagram *datagrams, int count ) {
+    if ( ! isvalid() || count <= 0 ) {
+	return 0;
+    }
+
+    int total = 0;
+#if defined(SG_UDP_MMSG)
+    mmsghdr msgs[BatchSize];
+    iovec iov[BatchSize];
+#  if defined(SO_RXQ_OVFL)
+    union {
+        char buf[CMSG_SPACE(sizeof(uint32_t))];
+        cmsghdr align;
+    } control[BatchSize];
+#  endif
+
+    while ( total < count ) {
+        const int n = std::min(count - total, BatchSize);
+        Datagram *batch = datagrams + total;
+        for ( int i = 0; i < n; ++i ) {
+            iov[i].iov_base = batch[i].data;
+            iov[i].iov_len = batch[i].size;
+            memset( &msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr) );
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+#  if defined(SO_RXQ_OVFL)
+            msgs[i].msg_hdr.msg_control = control[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+#  endif
+        }
+
+        // only the first call may block, and only for the first datagram
+        int result = recvmmsg( sock.getHandle(), msgs, n,
+                               total ? MSG_DONTWAIT : MSG_WAITFORONE, nullptr );
+        if ( result < 0 ) {
+            if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) {
+                break;
+            }
+            return total ? total : -1;
+        }
+
+        for ( int i = 0; i < result; ++i ) {
+            batch[i].length = msgs[i].msg_len;
+            batch[i].truncated = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+            stats.bytesRead += msgs[i].msg_len;
+            stats.truncated += batch[i].truncated;
+#  if defined(SO_RXQ_OVFL)
+            for ( cmsghdr *c = CMSG_FIRSTHDR(&msgs[i].msg_hdr); c;
+                  c = CMSG_NXTHDR(&msgs[i].msg_hdr, c) ) {
+                if ( c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL ) {
+                    uint32_t drops;
+                    memcpy( &drops, CMSG_DATA(c), sizeof(drops) );
+                    stats.kernelDrops = drops; // running total of the socket
+                }
+            }
+#  endif
+        }
+        stats.packetsRead += result;
+        total += result;
+
+        if ( result < n ) {
+            break;
+        }
+    }
+#else
+    // a blocking socket can only wait for one datagram at a time
+    for ( ; total < count; ++total ) {
+        int result = sock.recv( datagrams[total].data, datagrams[total].size, 0 );
+        if ( result < 0 ) {
+            if ( total == 0 && !simgear::Socket::isNonBlockingError() ) {
+                return -1;
+            }
+            break;
+        }
+        datagrams[total].length = result;
+        datagrams[total].truncated = false;
+        ++stats.packetsRead;
+        stats.bytesRead += result;
+        if ( blocking ) {
+            ++total;
+            break;
+        }
+    }
+#endif
+
+    return total;
+}
+
+
+// send count datagrams
+int SGSocketUDP::writeBatch( Datagram *datagrams, int count ) {
+    if ( ! isvalid() || count <= 0 ) {
+	return 0;
+    }
+
+    int total = 0;
+    bool error = false;
+#if defined(SG_UDP_MMSG)
+    mmsghdr msgs[BatchSize];
+    iovec iov[BatchSize];
+
+    while ( total < count ) {
+        const int n = std::min(count - total, BatchSize);
+        Datagram *batch = datagrams + total;
+        for ( int i = 0; i < n; ++i ) {
+            iov[i].iov_base = batch[i].data;
+            iov[i].iov_len = batch[i].size;
+            memset( &msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr) );
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int result = sendmmsg( sock.getHandle(), msgs, n, MSG_NOSIGNAL );
+        if ( result < 0 ) {
+            if ( errno == EINTR ) {
+                continue;
+            }
+            if ( errno != EAGAIN && errno != EWOULDBLOCK ) {
+                SG_LOG( SG_IO, SG_WARN, "Error writing to socket: " << port );
+                error = true;
+            }
+            break;
+        }
+
+        for ( int i = 0; i < result; ++i ) {
+            batch[i].length = msgs[i].msg_len;
+            stats.bytesWritten += msgs[i].msg_len;
+        }
+        stats.packetsWritten += result;
+        total += result;
+
+        // the one after the last sent failed
+        if ( result < n ) {
+            break;
+        }
+    }
+#else
+    for ( ; total < count; ++total ) {
+        int result = sock.send( datagrams[total].data, datagrams[total].size, 0 );
+        if ( result < 0 ) {
+            if ( !simgear::Socket::isNonBlockingError() ) {
+                SG_LOG( SG_IO, SG_WARN, "Error writing to socket: " << port );
+                error = true;
+            }
+            break;
+        }
+        datagrams[total].length = result;
+        ++stats.packetsWritten;
+        stats.bytesWritten += result;
+    }
+#endif
+
+    stats.writeErrors += count - total;
+    return ( error && total == 0 ) ? -1 : total;
+}
+
+
 // write null terminated string to socket (server)
 int SGSocketUDP::writestring( const char *str ) {
     if ( !isvalid() ) {
@@ -210,6 +396,7 @@ bool SGSocketUDP::close() {
 // configure the socket as non-blocking
 bool SGSocketUDP::setBlocking( bool value ) {
     sock.setBlocking( value );
+    blocking = value;
 
     return true;
 }
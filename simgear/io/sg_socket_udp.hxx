@@ -30,6 +30,7 @@
 
 #include <simgear/compiler.h>
 
+#include <cstdint>
 #include <string>
 
 #include <simgear/math/sg_types.hxx>
@@ -41,6 +42,30 @@
  */
 class SGSocketUDP : public SGIOChannel {
 
+public:
+
+    /**
+     * A datagram for readBatch() and writeBatch() in a buffer owned by the
+     * caller. Data is not copied or null terminated.
+     */
+    struct Datagram {
+        char *data = nullptr;
+        int size = 0;            ///< buffer size for reads, length for writes
+        int length = 0;          ///< bytes received or sent
+        bool truncated = false;  ///< the datagram did not fit into the buffer
+    };
+
+    /** Counters of the datagrams through this socket */
+    struct Stats {
+        uint64_t packetsRead = 0;
+        uint64_t bytesRead = 0;
+        uint64_t packetsWritten = 0;
+        uint64_t bytesWritten = 0;
+        uint64_t truncated = 0;     ///< received datagrams cut to the buffer size
+        uint64_t writeErrors = 0;   ///< datagrams which could not be sent
+        uint64_t kernelDrops = 0;   ///< dropped with a full receive buffer (Linux)
+    };
+
 private:
 
     simgear::Socket sock;
@@ -53,6 +78,9 @@ private:
 
     short unsigned int port;
 
+    bool blocking;
+    Stats stats;
+
 public:
 
     /**
@@ -111,6 +139,26 @@ public:
     // write null terminated string to a socket
     int writestring( const char *str );
 
+    /**
+     * Receive up to count datagrams with as few system calls as possible
+     * (recvmmsg() on Linux). A blocking socket waits for the first one
+     * only.
+     * @return number of datagrams received, 0 if none were pending or -1
+     * on an error
+     */
+    int readBatch( Datagram *datagrams, int count );
+
+    /**
+     * Send count datagrams with as few system calls as possible
+     * (sendmmsg() on Linux).
+     * @return number of datagrams sent, -1 if an error prevented sending
+     * any
+     */
+    int writeBatch( Datagram *datagrams, int count );
+
+    /** @return counters of the single and batch reads and writes */
+    const Stats& getStats() const { return stats; }
+
     // close file
     bool close();
 
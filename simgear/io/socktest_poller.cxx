@@ -0,0 +1,191 @@
+// socktest_poller - NetChannelPoller throughput with many idle channels
+// SPDX-License-Identifier: LGPL-2.0-or-later
+//
+// Active channel pairs exchange messages over loopback while the poller
+// also watches a number of idle connections, as the telnet and HTTP props
+// servers do with their clients.
+
+#include <simgear_config.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#if !defined(_WIN32)
+#  include <sys/select.h>
+#endif
+
+#include <simgear/io/sg_netChannel.hxx>
+
+using namespace simgear;
+
+namespace {
+
+const int ActivePairs = 16;
+const int RoundTrips = 20000;
+
+class EchoChannel : public NetChannel
+{
+public:
+    void handleRead() override
+    {
+        char buf[512];
+        int n = recv(buf, sizeof(buf));
+        if (n > 0)
+            send(buf, n);
+    }
+};
+
+class PingChannel : public NetChannel
+{
+public:
+    bool writable() override { return !pinged || NetChannel::writable(); }
+
+    void handleWrite() override
+    {
+        if (!pinged)
+            ping();
+    }
+
+    void handleRead() override
+    {
+        char buf[512];
+        int n = recv(buf, sizeof(buf));
+        if (n <= 0)
+            return;
+        pending -= n;
+        if (pending <= 0) {
+            ++(*replies);
+            ping();
+        }
+    }
+
+    void ping()
+    {
+        static const char msg[64] = "/position/altitude-ft";
+        pinged = true;
+        pending = sizeof(msg);
+        send(msg, sizeof(msg));
+    }
+
+    bool pinged = false;
+    int pending = 0;
+    int* replies = nullptr;
+};
+
+class Listener
+{
+public:
+    Listener()
+    {
+        socket.open(true);
+        for (port = 5800; port < 5900; ++port) {
+            if (socket.bind("127.0.0.1", port) == 0)
+                break;
+        }
+        socket.listen(1024);
+    }
+
+    bool connect(NetChannel* client, NetChannel* server)
+    {
+        if (!client->open())
+            return false;
+        IPAddress addr("127.0.0.1", port);
+        client->Socket::connect(&addr);
+        int handle = socket.accept(nullptr);
+        if (handle < 0)
+            return false;
+        server->setHandle(handle);
+        server->setBlocking(false);
+        return true;
+    }
+
+    Socket socket;
+    int port;
+};
+
+const char* methodName(NetChannelPoller::Method method)
+{
+    return method == NetChannelPoller::METHOD_EPOLL ? "epoll" : "select";
+}
+
+void run(NetChannelPoller::Method method, int idleCount)
+{
+    std::cout << std::left << std::setw(8) << methodName(method) << std::right
+              << std::setw(8) << idleCount;
+
+#if !defined(_WIN32)
+    // two handles per connection
+    if (method == NetChannelPoller::METHOD_SELECT &&
+        2 * (idleCount + ActivePairs) + 16 >= FD_SETSIZE) {
+        std::cout << std::setw(12) << "n/a" << std::endl;
+        return;
+    }
+#endif
+
+    Listener listener;
+    NetChannelPoller poller(method);
+    if (poller.method() != method) {
+        std::cout << std::setw(12) << "n/a" << std::endl;
+        return;
+    }
+
+    std::vector<std::unique_ptr<NetChannel>> clients;
+    std::vector<std::unique_ptr<NetChannel>> servers;
+    for (int i = 0; i < idleCount; ++i) {
+        clients.emplace_back(new NetChannel);
+        servers.emplace_back(new EchoChannel);
+        if (!listener.connect(clients.back().get(), servers.back().get())) {
+            std::cout << std::setw(12) << "failed" << std::endl;
+            return;
+        }
+        poller.addChannel(servers.back().get());
+    }
+
+    int replies = 0;
+    for (int i = 0; i < ActivePairs; ++i) {
+        PingChannel* ping = new PingChannel;
+        ping->replies = &replies;
+        clients.emplace_back(ping);
+        servers.emplace_back(new EchoChannel);
+        listener.connect(ping, servers.back().get());
+        poller.addChannel(ping);
+        poller.addChannel(servers.back().get());
+    }
+
+    // the first polls connect and send the first messages
+    for (int i = 0; i < 10; ++i)
+        poller.poll(0);
+
+    int polls = 0;
+    const int start = replies;
+    auto startTime = std::chrono::steady_clock::now();
+    while (replies - start < RoundTrips) {
+        poller.poll(100);
+        ++polls;
+    }
+    double dt = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::cout << std::fixed << std::setprecision(1)
+              << std::setw(12) << (replies - start) / dt * 1e-3
+              << std::setw(12) << dt / polls * 1e6 << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::cout << ActivePairs << " active pairs, " << RoundTrips << " round trips" << std::endl;
+    std::cout << std::left << std::setw(8) << "method" << std::right << std::setw(8) << "idle"
+              << std::setw(12) << "k trips/s" << std::setw(12) << "us/poll" << std::endl;
+
+    for (int idle : {0, 250, 450, 2000, 5000}) {
+        run(NetChannelPoller::METHOD_SELECT, idle);
+        run(NetChannelPoller::METHOD_EPOLL, idle);
+    }
+
+    return EXIT_SUCCESS;
+}
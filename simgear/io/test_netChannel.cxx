@@ -0,0 +1,188 @@
+// test_netChannel - NetChannelPoller with the select and epoll methods
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <simgear/io/sg_netChannel.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+using namespace simgear;
+
+namespace {
+
+// echoes everything back
+class EchoChannel : public NetChannel
+{
+public:
+    explicit EchoChannel(bool* deleted = nullptr) : deleted(deleted) {}
+    ~EchoChannel() { if (deleted) *deleted = true; }
+
+    void handleRead() override
+    {
+        char buf[512];
+        int n = recv(buf, sizeof(buf));
+        if (n > 0)
+            send(buf, n);
+    }
+
+    void handleClose() override { ++closes; }
+
+    int closes = 0;
+    bool* deleted;
+};
+
+// sends a message and counts the replies, sending the next one for each
+class PingChannel : public NetChannel
+{
+public:
+    bool writable() override { return !pinged || NetChannel::writable(); }
+
+    void handleWrite() override
+    {
+        if (!pinged)
+            ping();
+    }
+
+    void handleRead() override
+    {
+        char buf[512];
+        int n = recv(buf, sizeof(buf));
+        if (n <= 0)
+            return;
+        received.append(buf, n);
+        if (received.size() >= sizeof(Message) - 1) {
+            SG_CHECK_EQUAL(received, std::string(Message));
+            received.clear();
+            ++replies;
+            ping();
+        }
+    }
+
+    void ping()
+    {
+        pinged = true;
+        send(Message, sizeof(Message) - 1);
+    }
+
+    static constexpr const char Message[] = "ping from the client";
+    bool pinged = false;
+    std::string received;
+    int replies = 0;
+};
+
+constexpr const char PingChannel::Message[];
+
+class Listener
+{
+public:
+    Listener()
+    {
+        socket.open(true);
+        for (port = 5700; port < 5800; ++port) {
+            if (socket.bind("127.0.0.1", port) == 0)
+                break;
+        }
+        SG_VERIFY(port < 5800);
+        SG_CHECK_EQUAL(socket.listen(64), 0);
+    }
+
+    // connects the client and hands the server side to the channel
+    void connect(NetChannel* client, NetChannel* server)
+    {
+        SG_VERIFY(client->open());
+        IPAddress addr("127.0.0.1", port);
+        client->Socket::connect(&addr);
+        int handle = socket.accept(nullptr);
+        SG_VERIFY(handle >= 0);
+        server->setHandle(handle);
+        server->setBlocking(false);
+    }
+
+    Socket socket;
+    int port;
+};
+
+void runUntil(NetChannelPoller& poller, const std::function<bool()>& done)
+{
+    for (int i = 0; i < 2000 && !done(); ++i)
+        poller.poll(10);
+    SG_VERIFY(done());
+}
+
+void testPoller(NetChannelPoller::Method method)
+{
+    Listener listener;
+    NetChannelPoller poller(method);
+#if defined(__linux__)
+    SG_CHECK_EQUAL(poller.method(), method);
+#endif
+
+    // more channels than the old limit of 256
+    std::vector<std::unique_ptr<NetChannel>> clients;
+    std::vector<std::unique_ptr<EchoChannel>> idle;
+    for (int i = 0; i < 300; ++i) {
+        clients.emplace_back(new NetChannel);
+        idle.emplace_back(new EchoChannel);
+        listener.connect(clients.back().get(), idle.back().get());
+        poller.addChannel(idle.back().get());
+    }
+
+    PingChannel ping;
+    EchoChannel echo;
+    listener.connect(&ping, &echo);
+    poller.addChannel(&ping);
+    poller.addChannel(&echo);
+    runUntil(poller, [&] { return ping.replies >= 100; });
+
+    // a closed peer closes the channel, and the next socket, which likely
+    // reuses the handle, is polled as well
+    clients[7]->close();
+    runUntil(poller, [&] { return idle[7]->isClosed(); });
+    SG_CHECK_EQUAL(idle[7]->closes, 1);
+
+    PingChannel ping2;
+    EchoChannel echo2;
+    listener.connect(&ping2, &echo2);
+    poller.addChannel(&ping2);
+    poller.addChannel(&echo2);
+    const int replies = ping.replies;
+    runUntil(poller, [&] { return ping2.replies >= 10 && ping.replies >= replies + 10; });
+
+    // channels can be removed and deleted by the poller
+    poller.removeChannel(&ping2);
+    poller.removeChannel(&echo2);
+
+    bool deleted = false;
+    NetChannel client;
+    EchoChannel* doomed = new EchoChannel(&deleted);
+    listener.connect(&client, doomed);
+    poller.addChannel(doomed);
+    doomed->shouldDelete();
+    poller.poll(0);
+    SG_VERIFY(deleted);
+
+    poller.removeChannel(&ping);
+    poller.removeChannel(&echo);
+    for (auto& channel : idle)
+        poller.removeChannel(channel.get());
+    SG_VERIFY(!poller.hasChannels());
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    testPoller(NetChannelPoller::METHOD_SELECT);
+    testPoller(NetChannelPoller::METHOD_EPOLL);
+
+    std::cout << "all tests passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+// test_socket_udp - batch reads and writes of SGSocketUDP
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <simgear/io/sg_socket_udp.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+namespace {
+
+// the server, bound to a free port on the loopback interface
+std::unique_ptr<SGSocketUDP> openServer(std::string& port)
+{
+    for (int p = 5900; p < 6000; ++p) {
+        port = std::to_string(p);
+        std::unique_ptr<SGSocketUDP> server(new SGSocketUDP("127.0.0.1", port));
+        if (server->open(SG_IO_IN)) {
+            server->setBlocking(false);
+            return server;
+        }
+    }
+    SG_VERIFY(false);
+    return nullptr;
+}
+
+void testBatch()
+{
+    std::string port;
+    std::unique_ptr<SGSocketUDP> server = openServer(port);
+    SGSocketUDP client("127.0.0.1", port);
+    SG_VERIFY(client.open(SG_IO_OUT));
+
+    const int count = 100;
+    std::vector<std::string> messages;
+    for (int i = 0; i < count; ++i)
+        messages.push_back("datagram " + std::to_string(i) + std::string(i % 7, 'x'));
+
+    std::vector<SGSocketUDP::Datagram> out(count);
+    for (int i = 0; i < count; ++i) {
+        out[i].data = &messages[i][0];
+        out[i].size = messages[i].size();
+    }
+    SG_CHECK_EQUAL(client.writeBatch(out.data(), count), count);
+    for (int i = 0; i < count; ++i)
+        SG_CHECK_EQUAL(out[i].length, static_cast<int>(messages[i].size()));
+
+    // more buffers than datagrams, and more than one recvmmsg() call
+    std::vector<char> storage(150 * 64);
+    std::vector<SGSocketUDP::Datagram> in(150);
+    for (int i = 0; i < 150; ++i) {
+        in[i].data = &storage[i * 64];
+        in[i].size = 64;
+    }
+    SG_CHECK_EQUAL(server->readBatch(in.data(), 150), count);
+    for (int i = 0; i < count; ++i) {
+        SG_CHECK_EQUAL(std::string(in[i].data, in[i].length), messages[i]);
+        SG_VERIFY(!in[i].truncated);
+    }
+
+    // nothing pending
+    SG_CHECK_EQUAL(server->readBatch(in.data(), 150), 0);
+
+    // the single datagram functions use the same counters
+    SG_CHECK_EQUAL(client.writestring("single"), 6);
+    char buf[64];
+    SG_CHECK_EQUAL(server->read(buf, sizeof(buf)), 6);
+    SG_CHECK_EQUAL(std::string(buf), std::string("single"));
+
+#if defined(__linux__)
+    std::string large(200, 'y');
+    SGSocketUDP::Datagram big;
+    big.data = &large[0];
+    big.size = large.size();
+    SG_CHECK_EQUAL(client.writeBatch(&big, 1), 1);
+    SG_CHECK_EQUAL(server->readBatch(in.data(), 1), 1);
+    SG_VERIFY(in[0].truncated);
+    SG_CHECK_EQUAL(in[0].length, 64);
+    SG_CHECK_EQUAL(server->getStats().truncated, 1u);
+#else
+    SG_CHECK_EQUAL(client.writestring("y"), 1);
+    SG_CHECK_EQUAL(server->readBatch(in.data(), 1), 1);
+#endif
+
+    SG_CHECK_EQUAL(client.getStats().packetsWritten, static_cast<uint64_t>(count + 2));
+    SG_CHECK_EQUAL(server->getStats().packetsRead, static_cast<uint64_t>(count + 2));
+    SG_CHECK_EQUAL(client.getStats().writeErrors, 0u);
+
+    server->close();
+    client.close();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    testBatch();
+
+    std::cout << "all tests passed" << std::endl;
+    return EXIT_SUCCESS;
+}
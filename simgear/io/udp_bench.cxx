@@ -0,0 +1,105 @@
+// udp_bench - single and batch SGSocketUDP throughput over loopback
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <simgear/io/sg_socket_udp.hxx>
+
+namespace {
+
+// datagrams written before reading them back, well within the default
+// receive buffer
+const int Burst = 64;
+const int PacketSize = 200;
+
+template <class F>
+double timeIt(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int bursts = argc > 1 ? std::atoi(argv[1]) : 5000;
+
+    std::string port;
+    std::unique_ptr<SGSocketUDP> server;
+    for (int p = 6000; p < 6100 && !server; ++p) {
+        port = std::to_string(p);
+        server.reset(new SGSocketUDP("127.0.0.1", port));
+        if (!server->open(SG_IO_IN))
+            server.reset();
+    }
+    if (!server)
+        return EXIT_FAILURE;
+    server->setBlocking(false);
+
+    SGSocketUDP client("127.0.0.1", port);
+    if (!client.open(SG_IO_OUT))
+        return EXIT_FAILURE;
+
+    std::vector<char> storage(Burst * (PacketSize + 1), 'x');
+    std::vector<SGSocketUDP::Datagram> datagrams(Burst);
+    for (int i = 0; i < Burst; ++i) {
+        datagrams[i].data = &storage[i * (PacketSize + 1)];
+        datagrams[i].size = PacketSize;
+    }
+
+    long received = 0;
+    double writeSingle = 0, readSingle = 0;
+    for (int b = 0; b < bursts; ++b) {
+        writeSingle += timeIt([&] {
+            for (int i = 0; i < Burst; ++i)
+                client.write(datagrams[i].data, PacketSize);
+        });
+        readSingle += timeIt([&] {
+            while (server->read(datagrams[0].data, PacketSize + 1) > 0)
+                ++received;
+        });
+    }
+    const long singleReceived = received;
+
+    received = 0;
+    double writeBatch = 0, readBatch = 0;
+    for (int b = 0; b < bursts; ++b) {
+        for (auto& d : datagrams)
+            d.size = PacketSize;
+        writeBatch += timeIt([&] { client.writeBatch(datagrams.data(), Burst); });
+        for (auto& d : datagrams)
+            d.size = PacketSize + 1;
+        readBatch += timeIt([&] {
+            int n;
+            while ((n = server->readBatch(datagrams.data(), Burst)) > 0)
+                received += n;
+        });
+    }
+
+    const double packets = double(bursts) * Burst;
+    std::cout << bursts * Burst << " datagrams of " << PacketSize << " bytes" << std::endl;
+    std::cout << std::left << std::setw(10) << "kpps" << std::right << std::setw(10) << "single"
+              << std::setw(10) << "batch" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << std::left << std::setw(10) << "write" << std::right
+              << std::setw(10) << packets / writeSingle * 1e-3
+              << std::setw(10) << packets / writeBatch * 1e-3 << std::endl;
+    std::cout << std::left << std::setw(10) << "read" << std::right
+              << std::setw(10) << singleReceived / readSingle * 1e-3
+              << std::setw(10) << received / readBatch * 1e-3 << std::endl;
+
+    const SGSocketUDP::Stats& stats = server->getStats();
+    std::cout << "received " << stats.packetsRead << ", truncated " << stats.truncated
+              << ", kernel drops " << stats.kernelDrops << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -189,15 +189,39 @@ static double htnm_wmm2020[13][13]=
 
 static const int nmax = 12;
 
-static double P[13][13];
-static double DP[13][13];
-static double gnm[13][13];
-static double hnm[13][13];
-static double sm[13];
-static double cm[13];
+namespace {
+
+// These values do not change between calls, computed once in a thread safe
+// way on first use
+struct Roots
+{
+    double root[13];
+    double roots[13][13][2];
 
-static double root[13];
-static double roots[13][13][2];
+    Roots()
+    {
+	int n, m;
+	for ( n = 2; n <= nmax; n++ ) {
+	    root[n] = sqrt((2.0*n-1) / (2.0*n));
+	}
+
+	for ( m = 0; m <= nmax; m++ ) {
+	    double mm = m*m;
+	    for ( n = SG_MAX2(m + 1, 2); n <= nmax; n++ ) {
+		roots[m][n][0] = sqrt((n-1)*(n-1) - mm);
+		roots[m][n][1] = 1.0 / sqrt( n*n - mm);
+	    }
+	}
+    }
+};
+
+const Roots& getRoots()
+{
+    static const Roots roots;
+    return roots;
+}
+
+}
 
 /* Convert date to Julian day    1950-2049 */
 unsigned long int yymmdd_to_julian_days( int yy, int mm, int dd )
@@ -214,6 +238,33 @@ unsigned long int yymmdd_to_julian_days( int yy, int mm, int dd )
 }
 
 
+/*
+ * compute Gauss coefficients gnm and hnm of degree n and order m for the
+ * (Julian) date, achieved by adjusting the coefficients at time t0 for
+ * linear secular variation
+ */
+void calc_magvar_model( long dat, magvar_model* model )
+{
+    int n,m;
+    /* reference date for current model is 1 januari 2015 */
+    long date0_wmm2020 = yymmdd_to_julian_days(15,1,1);
+
+    /* WMM2020 */
+    double yearfrac = (dat - date0_wmm2020) / 365.25;
+    for ( n = 0; n <= nmax; n++ ) {
+	for ( m = 0; m <= nmax; m++ ) {
+	    if ( n == 0 ) {
+		model->gnm[n][m] = 0.0;
+		model->hnm[n][m] = 0.0;
+		continue;
+	    }
+	    model->gnm[n][m] = gnm_wmm2020[n][m] + yearfrac * gtnm_wmm2020[n][m];
+	    model->hnm[n][m] = hnm_wmm2020[n][m] + yearfrac * htnm_wmm2020[n][m];
+	}
+    }
+}
+
+
 /*
  * return variation (in radians) given geodetic latitude (radians),
  * longitude(radians), height (km) and (Julian) date
@@ -221,16 +272,30 @@ unsigned long int yymmdd_to_julian_days( int yy, int mm, int dd )
 */
 
 double calc_magvar( double lat, double lon, double h, long dat, double* field )
+{
+    magvar_model model;
+    calc_magvar_model( dat, &model );
+    return calc_magvar_with_model( lat, lon, h, &model, field );
+}
+
+
+double calc_magvar_with_model( double lat, double lon, double h,
+                               const magvar_model* model, double* field )
 {
     /* output field B_r,B_th,B_phi,B_x,B_y,B_z */
     int n,m;
-    /* reference date for current model is 1 januari 2015 */
-    long date0_wmm2020 = yymmdd_to_julian_days(15,1,1);
 
-    double yearfrac,sr,r,theta,c,s,psi,fn,fn_0,B_r,B_theta,B_phi,X,Y,Z;
+    double sr,r,theta,c,s,psi,fn,fn_0,B_r,B_theta,B_phi,X,Y,Z;
     double sinpsi, cospsi, inv_s;
 
-    static int been_here = 0;
+    double P[13][13];
+    double DP[13][13];
+    double sm[13];
+    double cm[13];
+
+    const Roots& rt = getRoots();
+    const double (*gnm)[13] = model->gnm;
+    const double (*hnm)[13] = model->hnm;
 
     double sinlat = sin(lat);
     double coslat = cos(lat);
@@ -271,27 +336,11 @@ double calc_magvar( double lat, double lon, double h, long dat, double* field )
     P[1][0] = c ;
     DP[1][0] = -s;
 
-    // these values will not change for subsequent function calls
-    if( !been_here ) {
-	for ( n = 2; n <= nmax; n++ ) {
-	    root[n] = sqrt((2.0*n-1) / (2.0*n));
-	}
-
-	for ( m = 0; m <= nmax; m++ ) {
-	    double mm = m*m;
-	    for ( n = SG_MAX2(m + 1, 2); n <= nmax; n++ ) {
-		roots[m][n][0] = sqrt((n-1)*(n-1) - mm);
-		roots[m][n][1] = 1.0 / sqrt( n*n - mm);
-	    }
-	}
-	been_here = 1;
-    }
-
     for ( n=2; n <= nmax; n++ ) {
 	// double root = sqrt((2.0*n-1) / (2.0*n));
-	P[n][n] = P[n-1][n-1] * s * root[n];
+	P[n][n] = P[n-1][n-1] * s * rt.root[n];
 	DP[n][n] = (DP[n-1][n-1] * s + P[n-1][n-1] * c) *
-	    root[n];
+	    rt.root[n];
     }
 
     /* lower triangle */
@@ -301,23 +350,12 @@ double calc_magvar( double lat, double lon, double h, long dat, double* field )
 	    // double root1 = sqrt((n-1)*(n-1) - mm);
 	    // double root2 = 1.0 / sqrt( n*n - mm);
 	    P[n][m] = (P[n-1][m] * c * (2.0*n-1) -
-		       P[n-2][m] * roots[m][n][0]) *
-		roots[m][n][1];
+		       P[n-2][m] * rt.roots[m][n][0]) *
+		rt.roots[m][n][1];
 
 	    DP[n][m] = ((DP[n-1][m] * c - P[n-1][m] * s) *
-			(2.0*n-1) - DP[n-2][m] * roots[m][n][0]) *
-		roots[m][n][1];
-	}
-    }
-
-    /* compute Gauss coefficients gnm and hnm of degree n and order m for the desired time
-       achieved by adjusting the coefficients at time t0 for linear secular variation */
-    /* WMM2020 */
-    yearfrac = (dat - date0_wmm2020) / 365.25;
-    for ( n = 1; n <= nmax; n++ ) {
-	for ( m = 0; m <= nmax; m++ ) {
-	    gnm[n][m] = gnm_wmm2020[n][m] + yearfrac * gtnm_wmm2020[n][m];
-	    hnm[n][m] = hnm_wmm2020[n][m] + yearfrac * htnm_wmm2020[n][m];
+			(2.0*n-1) - DP[n-2][m] * rt.roots[m][n][0]) *
+		rt.roots[m][n][1];
 	}
     }
 
@@ -374,6 +412,13 @@ double calc_magvar( double lat, double lon, double h, long dat, double* field )
 
 
 #ifdef TEST_NHV_HACKS
+static double P[13][13];
+static double DP[13][13];
+static double gnm[13][13];
+static double hnm[13][13];
+static double sm[13];
+static double cm[13];
+
 double SGMagVarOrig( double lat, double lon, double h, long dat, double* field )
 {
     /* output field B_r,B_th,B_phi,B_x,B_y,B_z */
@@ -46,5 +46,21 @@ N and E lat and long are positive, S and W negative
 */
 double calc_magvar( double lat, double lon, double h, long dat, double* field );
 
+/* Gauss coefficients of the model at a given date */
+struct magvar_model {
+    double gnm[13][13];
+    double hnm[13][13];
+};
+
+/* compute the model coefficients for a (Julian) date */
+void calc_magvar_model( long dat, magvar_model* model );
+
+/* same as calc_magvar() with the coefficients for the date precomputed by
+calc_magvar_model(), for many positions at the same date. Unlike the
+original implementation this keeps no state between calls.
+*/
+double calc_magvar_with_model( double lat, double lon, double h,
+                               const magvar_model* model, double* field );
+
 
 #endif // SG_MAGVAR_HXX
@@ -74,3 +74,14 @@ double sgGetMagVar( const SGGeod& pos, double jd )
     pos.getElevationM(), jd);
 }
 
+void sgGetMagVar( const SGGeod* pos, double* magvar, size_t count, double jd )
+{
+  magvar_model model;
+  calc_magvar_model( (long)jd, &model );
+
+  double field[6];
+  for ( size_t i = 0; i < count; ++i ) {
+    magvar[i] = calc_magvar_with_model( pos[i].getLatitudeRad(),
+      pos[i].getLongitudeRad(), pos[i].getElevationM() / 1000.0, &model, field );
+  }
+}
@@ -33,6 +33,8 @@
 #endif
 
 
+#include <cstddef>
+
 // forward decls
 class SGGeod;
 
@@ -108,4 +110,13 @@ double sgGetMagVar( double lon, double lat, double alt_m, double jd );
  */
 double sgGetMagVar( const SGGeod& pos, double jd );
 
+/**
+ * \relates SGMagVar
+ * Lookup the magvar for many positions at the same date, computing the
+ * model coefficients for the date only once. See SGMagVarGrid for a
+ * faster approximation.
+ * @param magvar receives the magvar in radians for each position
+ */
+void sgGetMagVar( const SGGeod* pos, double* magvar, size_t count, double jd );
+
 #endif // _MAGVAR_HXX
@@ -0,0 +1,259 @@
+// magvargrid.cxx - interpolated magnetic variation for many positions
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include "magvargrid.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <future>
+#include <mutex>
+
+#include <simgear/math/SGMath.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
+
+#include "coremag.hxx"
+
+// Towards the geographic poles the north and east components turn quickly
+// with longitude and do not interpolate well.
+const double SGMagVarGrid::MaxLatitudeDeg = 80.0;
+
+namespace {
+
+// Grid cells per tile side
+const int CellsPerTile = 10;
+
+// North, east and down components in nT
+struct Field
+{
+    double x = 0, y = 0, z = 0;
+};
+
+void toAngles(const Field& f, double& magvar, double& magdip)
+{
+    // zero variation at the magnetic pole, as calc_magvar()
+    magvar = (f.x != 0. || f.y != 0.) ? atan2(f.y, f.x) : 0.;
+    magdip = atan(f.z / sqrt(f.x * f.x + f.y * f.y));
+}
+
+} // namespace
+
+struct SGMagVarGrid::Impl : public std::enable_shared_from_this<SGMagVarGrid::Impl>
+{
+    // Components at the nodes, indexed by latitude, longitude, level
+    typedef std::vector<float> Tile;
+
+    magvar_model model;
+    double spacing;
+    double altitudeSpacing;
+    int numLevels;
+    int latCells, lonCells;
+    int tileRows, tileCols;
+
+    std::unique_ptr<std::atomic<const Tile*>[]> tiles;
+    std::unique_ptr<std::atomic<bool>[]> requested;
+
+    std::mutex pendingMutex;
+    std::vector<std::future<void>> pending;
+
+    Impl(double jd, double spacingDeg, double altitudeSpacingM, double maxAltitudeM) :
+        spacing(std::max(spacingDeg, 0.01)),
+        altitudeSpacing(std::max(altitudeSpacingM, 1.0)),
+        numLevels(std::max(2, static_cast<int>(std::floor(maxAltitudeM / altitudeSpacing)) + 1)),
+        latCells(static_cast<int>(std::ceil(180.0 / spacing))),
+        lonCells(static_cast<int>(std::ceil(360.0 / spacing))),
+        tileRows((latCells + CellsPerTile - 1) / CellsPerTile),
+        tileCols((lonCells + CellsPerTile - 1) / CellsPerTile),
+        tiles(new std::atomic<const Tile*>[tileRows * tileCols]),
+        requested(new std::atomic<bool>[tileRows * tileCols])
+    {
+        calc_magvar_model(static_cast<long>(jd), &model);
+        for (int i = 0; i < tileRows * tileCols; ++i) {
+            tiles[i] = nullptr;
+            requested[i] = false;
+        }
+    }
+
+    ~Impl()
+    {
+        for (int i = 0; i < tileRows * tileCols; ++i)
+            delete tiles[i].load();
+    }
+
+    void exact(const SGGeod& pos, Field& f) const
+    {
+        double field[6];
+        calc_magvar_with_model(pos.getLatitudeRad(), pos.getLongitudeRad(),
+                               pos.getElevationM() / 1000.0, &model, field);
+        f.x = field[3];
+        f.y = field[4];
+        f.z = field[5];
+    }
+
+    void computeTile(int index)
+    {
+        const int row = index / tileCols, col = index % tileCols;
+        const int nodes = CellsPerTile + 1;
+
+        Tile* tile = new Tile(nodes * nodes * numLevels * 3);
+        float* node = tile->data();
+        for (int a = 0; a < nodes; ++a) {
+            double lat = -90.0 + (row * CellsPerTile + a) * spacing;
+            lat = SGMiscd::clip(lat, -90.0, 90.0);
+            for (int b = 0; b < nodes; ++b) {
+                const double lon = -180.0 + (col * CellsPerTile + b) * spacing;
+                for (int k = 0; k < numLevels; ++k, node += 3) {
+                    Field f;
+                    exact(SGGeod::fromDegM(lon, lat, k * altitudeSpacing), f);
+                    node[0] = static_cast<float>(f.x);
+                    node[1] = static_cast<float>(f.y);
+                    node[2] = static_cast<float>(f.z);
+                }
+            }
+        }
+
+        tiles[index].store(tile, std::memory_order_release);
+    }
+
+    void requestTile(int index)
+    {
+        if (requested[index].exchange(true))
+            return;
+
+        std::shared_ptr<Impl> self = shared_from_this();
+        std::future<void> done = simgear::SGThreadPool::shared().submit(
+            [self, index] { self->computeTile(index); });
+
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.push_back(std::move(done));
+    }
+
+    bool interpolate(const SGGeod& pos, Field& f, bool request)
+    {
+        const double lat = pos.getLatitudeDeg();
+        const double alt = pos.getElevationM();
+        if (std::fabs(lat) > MaxLatitudeDeg || alt < -altitudeSpacing ||
+            alt > (numLevels - 1) * altitudeSpacing)
+            return false;
+
+        const double lon = SGMiscd::normalizePeriodic(-180.0, 180.0, pos.getLongitudeDeg());
+        const double u = (lat + 90.0) / spacing;
+        const double v = (lon + 180.0) / spacing;
+        const int i = std::min(static_cast<int>(u), latCells - 1);
+        const int j = std::min(static_cast<int>(v), lonCells - 1);
+
+        const int row = i / CellsPerTile, col = j / CellsPerTile;
+        const int index = row * tileCols + col;
+        const Tile* tile = tiles[index].load(std::memory_order_acquire);
+        if (!tile) {
+            if (request)
+                requestTile(index);
+            return false;
+        }
+
+        // Below the lowest level the field is extrapolated
+        const double w = alt / altitudeSpacing;
+        const int k = SGMisc<int>::clip(static_cast<int>(std::floor(w)), 0, numLevels - 2);
+
+        const double fu = u - i, fv = v - j, fw = w - k;
+        const int a = i - row * CellsPerTile, b = j - col * CellsPerTile;
+        const int nodes = CellsPerTile + 1;
+
+        double sum[3] = { 0, 0, 0 };
+        for (int da = 0; da < 2; ++da) {
+            for (int db = 0; db < 2; ++db) {
+                for (int dk = 0; dk < 2; ++dk) {
+                    const double weight = (da ? fu : 1 - fu) * (db ? fv : 1 - fv) *
+                                          (dk ? fw : 1 - fw);
+                    const float* node = tile->data() +
+                        (((a + da) * nodes + (b + db)) * numLevels + (k + dk)) * 3;
+                    sum[0] += weight * node[0];
+                    sum[1] += weight * node[1];
+                    sum[2] += weight * node[2];
+                }
+            }
+        }
+
+        f.x = sum[0];
+        f.y = sum[1];
+        f.z = sum[2];
+        return true;
+    }
+
+    void field(const SGGeod& pos, Field& f)
+    {
+        if (!interpolate(pos, f, true))
+            exact(pos, f);
+    }
+};
+
+SGMagVarGrid::SGMagVarGrid(double jd, double spacingDeg, double altitudeSpacingM,
+                           double maxAltitudeM) :
+    _impl(std::make_shared<Impl>(jd, spacingDeg, altitudeSpacingM, maxAltitudeM))
+{
+}
+
+SGMagVarGrid::~SGMagVarGrid()
+{
+    // Pending tiles hold a reference to the implementation, no need to wait
+}
+
+double SGMagVarGrid::getMagVar(const SGGeod& pos) const
+{
+    double magvar, magdip;
+    get(pos, magvar, magdip);
+    return magvar;
+}
+
+void SGMagVarGrid::get(const SGGeod& pos, double& magvar, double& magdip) const
+{
+    Field f;
+    _impl->field(pos, f);
+    toAngles(f, magvar, magdip);
+}
+
+void SGMagVarGrid::getMagVar(const SGGeod* pos, double* magvar, size_t count) const
+{
+    for (size_t i = 0; i < count; ++i) {
+        Field f;
+        double magdip;
+        _impl->field(pos[i], f);
+        toAngles(f, magvar[i], magdip);
+    }
+}
+
+std::vector<double> SGMagVarGrid::getMagVar(const std::vector<SGGeod>& pos) const
+{
+    std::vector<double> magvar(pos.size());
+    getMagVar(pos.data(), magvar.data(), pos.size());
+    return magvar;
+}
+
+void SGMagVarGrid::getExact(const SGGeod& pos, double& magvar, double& magdip) const
+{
+    Field f;
+    _impl->exact(pos, f);
+    toAngles(f, magvar, magdip);
+}
+
+bool SGMagVarGrid::isInterpolated(const SGGeod& pos) const
+{
+    Field f;
+    return _impl->interpolate(pos, f, false);
+}
+
+void SGMagVarGrid::waitForPendingTiles() const
+{
+    std::vector<std::future<void>> pending;
+    {
+        std::lock_guard<std::mutex> lock(_impl->pendingMutex);
+        pending.swap(_impl->pending);
+    }
+
+    for (auto& done : pending)
+        done.wait();
+}
@@ -0,0 +1,76 @@
+// magvargrid.hxx - interpolated magnetic variation for many positions
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class SGGeod;
+
+/**
+ * Magnetic variation and dip for a fixed date, interpolated from the
+ * field components on a regular lat/lon/altitude grid.
+ *
+ * The grid is split into tiles which are computed on the shared thread
+ * pool the first time a position inside them is queried. Until a tile is
+ * ready, and outside of the grid (polar regions, high altitudes), queries
+ * are answered by the full model, so the results never depend on timing
+ * by more than the interpolation error.
+ *
+ * Interpolating the north, east and down components rather than the
+ * angles keeps the error small except close to the magnetic poles, where
+ * the variation itself is ill-defined. All methods are thread safe.
+ */
+class SGMagVarGrid
+{
+public:
+    /**
+     * @param jd              Julian date
+     * @param spacingDeg      Distance of the grid nodes in latitude and
+     *                        longitude
+     * @param altitudeSpacingM Distance of the grid levels in altitude
+     * @param maxAltitudeM    Highest grid level, positions above are
+     *                        computed exactly
+     */
+    explicit SGMagVarGrid(double jd, double spacingDeg = 1.0,
+                          double altitudeSpacingM = 5000.0,
+                          double maxAltitudeM = 20000.0);
+    ~SGMagVarGrid();
+
+    SGMagVarGrid(const SGMagVarGrid&) = delete;
+    SGMagVarGrid& operator=(const SGMagVarGrid&) = delete;
+
+    /** @return the magnetic variation in radians */
+    double getMagVar(const SGGeod& pos) const;
+
+    /** Magnetic variation and dip in radians */
+    void get(const SGGeod& pos, double& magvar, double& magdip) const;
+
+    /** Magnetic variation in radians for each of the positions */
+    void getMagVar(const SGGeod* pos, double* magvar, size_t count) const;
+    std::vector<double> getMagVar(const std::vector<SGGeod>& pos) const;
+
+    /**
+     * Variation and dip computed by the full model for the date of the
+     * grid, for comparison.
+     */
+    void getExact(const SGGeod& pos, double& magvar, double& magdip) const;
+
+    /**
+     * Whether the position is answered by interpolation, which means that
+     * it is inside the grid and its tile has been computed.
+     */
+    bool isInterpolated(const SGGeod& pos) const;
+
+    /** Wait until all tiles requested so far have been computed. */
+    void waitForPendingTiles() const;
+
+    /** Highest latitude covered by the grid, in degrees. */
+    static const double MaxLatitudeDeg;
+
+private:
+    struct Impl;
+    std::shared_ptr<Impl> _impl;
+};
@@ -2,11 +2,88 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cmath>
+#include <random>
+#include <vector>
 
 #include <simgear/constants.h>
+#include <simgear/math/SGMath.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include "coremag.hxx"
+#include "magvar.hxx"
+#include "magvargrid.hxx"
+
+/* Compare SGMagVarGrid with the full model at random positions. The
+   variation is only checked where the horizontal field is strong enough
+   for it to be well defined. */
+static int check_grid()
+{
+  const double jd = yymmdd_to_julian_days(24, 7, 1);
+  const double max_var_error_deg = 0.1;
+  const double max_dip_error_deg = 0.1;
+  const double min_horizontal_nT = 3000.0;
+
+  std::mt19937 gen(7);
+  std::uniform_real_distribution<double> lat(-SGMagVarGrid::MaxLatitudeDeg,
+                                             SGMagVarGrid::MaxLatitudeDeg);
+  std::uniform_real_distribution<double> lon(-180.0, 180.0);
+  std::uniform_real_distribution<double> alt(-500.0, 20000.0);
+
+  std::vector<SGGeod> pos;
+  for (int i = 0; i < 200000; ++i)
+    pos.push_back(SGGeod::fromDegM(lon(gen), lat(gen), alt(gen)));
+
+  SGMagVarGrid grid(jd);
+
+  /* The first query requests the tiles, answering exactly meanwhile */
+  std::vector<double> var = grid.getMagVar(pos);
+  grid.waitForPendingTiles();
+
+  SGTimeStamp start = SGTimeStamp::now();
+  var = grid.getMagVar(pos);
+  double grid_time = (SGTimeStamp::now() - start).toSecs();
+
+  std::vector<double> exact(pos.size());
+  start = SGTimeStamp::now();
+  sgGetMagVar(pos.data(), exact.data(), pos.size(), jd);
+  double exact_time = (SGTimeStamp::now() - start).toSecs();
+
+  double max_var_error = 0, max_dip_error = 0;
+  for (size_t i = 0; i < pos.size(); ++i) {
+    if (!grid.isInterpolated(pos[i])) {
+      fprintf(stderr, "position %zu not interpolated\n", i);
+      return 1;
+    }
+
+    double field[6], grid_var, grid_dip;
+    calc_magvar(pos[i].getLatitudeRad(), pos[i].getLongitudeRad(),
+                pos[i].getElevationM() / 1000.0, (long)jd, field);
+    double dip = atan(field[5]/sqrt(field[3]*field[3]+field[4]*field[4]));
+    grid.get(pos[i], grid_var, grid_dip);
+
+    max_dip_error = SGMiscd::max(max_dip_error, fabs(grid_dip - dip));
+    if (sqrt(field[3]*field[3]+field[4]*field[4]) >= min_horizontal_nT) {
+      double error = fabs(SGMiscd::normalizePeriodic(-SGD_PI, SGD_PI, var[i] - exact[i]));
+      max_var_error = SGMiscd::max(max_var_error, error);
+    }
+  }
+
+  max_var_error *= SGD_RADIANS_TO_DEGREES;
+  max_dip_error *= SGD_RADIANS_TO_DEGREES;
+  fprintf(stdout, "%zu positions, grid %.3fs, exact %.3fs\n",
+          pos.size(), grid_time, exact_time);
+  fprintf(stdout, "max variation error %.4f deg, max dip error %.4f deg\n",
+          max_var_error, max_dip_error);
+
+  if (max_var_error > max_var_error_deg || max_dip_error > max_dip_error_deg) {
+    fprintf(stderr, "interpolation error above %.2f/%.2f deg\n",
+            max_var_error_deg, max_dip_error_deg);
+    return 1;
+  }
+  return 0;
+}
 
 
 int main(int argc, char *argv[])
@@ -19,8 +96,13 @@ double lat_deg,lon_deg,h,var;
 int /* model,*/yy,mm,dd;
 double field[6];
 
+if ((argc == 2) && !strcmp(argv[1], "--grid")) {
+  return check_grid();
+}
+
 if ((argc != 8) && (argc !=7)) {
 fprintf(stdout,"Usage: mag lat_deg lon_deg h mm dd yy [model]\n");
+fprintf(stdout,"       mag --grid (check the interpolation error of SGMagVarGrid)\n");
 fprintf(stdout,"N latitudes, E longitudes positive degrees, h in km, mm dd yy is date\n");
 fprintf(stdout,"model 1,2,3,4,5,6,7 <=> IGRF90,WMM85,WMM90,WMM95,IGRF95,WMM2000,IGRF2000\n");
 fprintf(stdout,"Default model is IGRF2000, valid 1/1/00 - 12/31/05\n");
@@ -18,6 +18,8 @@
 #ifndef SGGeodesy_H
 #define SGGeodesy_H
 
+#include <cstddef>
+
 class SGGeodesy {
 public:
   // Hard numbers from the WGS84 standard.
@@ -35,6 +37,20 @@ public:
   /// coordinates.
   static void SGGeodToCart(const SGGeod& geod, SGVec3<double>& cart);
   
+  /// Batch versions of the two conversions above. Positions are given
+  /// either as arrays or as separate arrays of longitude and latitude in
+  /// degrees, elevation in meters and cartesian coordinates. Output arrays
+  /// must not overlap the input. The results agree with the single point
+  /// versions to rounding, SIMD instructions are used where available.
+  static void SGGeodToCart(const SGGeod* geod, SGVec3<double>* cart, size_t count);
+  static void SGCartToGeod(const SGVec3<double>* cart, SGGeod* geod, size_t count);
+  static void SGGeodToCart(const double* lonDeg, const double* latDeg,
+                           const double* elevM, double* x, double* y,
+                           double* z, size_t count);
+  static void SGCartToGeod(const double* x, const double* y, const double* z,
+                           double* lonDeg, double* latDeg, double* elevM,
+                           size_t count);
+
   /// Takes a geodetic coordinate data and returns the sea level radius.
   static double SGGeodToSeaLevelRadius(const SGGeod& geod);
 
@@ -58,9 +74,24 @@ public:
   static bool inverse(const SGGeod& p1, const SGGeod& p2, double& course1,
                       double& course2, double& distance);
 
+  /// Batch versions of direct() and inverse() for count points or pairs
+  /// of points, returning false if any of them failed.
+  static bool direct(const SGGeod* p1, const double* course1,
+                     const double* distance, SGGeod* p2, double* course2,
+                     size_t count);
+  static bool inverse(const SGGeod* p1, const SGGeod* p2, double* course1,
+                      double* course2, double* distance, size_t count);
+
   static double courseDeg(const SGGeod& from, const SGGeod& to);
   static double distanceM(const SGGeod& from, const SGGeod& to);
   static double distanceNm(const SGGeod& from, const SGGeod& to);
+
+  /// Batch version of distanceM(), throws an sg_exception on failure.
+  static void distanceM(const SGGeod* from, const SGGeod* to,
+                        double* distance, size_t count);
+
+  /// Name of the instruction set used by the batch functions.
+  static const char* batchInstructionSet();
     
   // Geocentric course/distance computation
   static void advanceRadM(const SGGeoc& geoc, double course, double distance,
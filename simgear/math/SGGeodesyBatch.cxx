@@ -0,0 +1,265 @@
+// SGGeodesyBatch.cxx - batch versions of the SGGeodesy functions
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include "SGGeodesyBatch.hxx"
+
+#include <algorithm>
+#include <cmath>
+
+#include "SGMath.hxx"
+
+using namespace simgear::geodesy_batch;
+
+namespace {
+
+// Positions of the array versions are converted in blocks of this size
+const size_t BlockSize = 256;
+
+size_t geodToCartScalar(const double* lon, const double* lat, const double* elev,
+                        double* x, double* y, double* z, size_t count)
+{ return geodToCart<Pack1>(lon, lat, elev, x, y, z, count); }
+
+size_t cartToGeodScalar(const double* x, const double* y, const double* z,
+                        double* lon, double* lat, double* elev, size_t count)
+{ return cartToGeod<Pack1>(x, y, z, lon, lat, elev, count); }
+
+size_t inverseScalar(const double* lat1, const double* lon1,
+                     const double* lat2, const double* lon2,
+                     double* az1, double* az2, double* s, size_t count)
+{ return inverse<Pack1>(lat1, lon1, lat2, lon2, az1, az2, s, count); }
+
+size_t directScalar(const double* lat1, const double* lon1,
+                    const double* az1, const double* s,
+                    double* lat2, double* lon2, double* az2, size_t count)
+{ return direct<Pack1>(lat1, lon1, az1, s, lat2, lon2, az2, count); }
+
+const Kernels kernelsScalar = {
+    "scalar", geodToCartScalar, cartToGeodScalar, inverseScalar, directScalar
+};
+
+#if defined(SG_GEODESY_SSE2) || defined(SG_GEODESY_NEON)
+
+size_t geodToCart2(const double* lon, const double* lat, const double* elev,
+                   double* x, double* y, double* z, size_t count)
+{ return geodToCart<Pack2>(lon, lat, elev, x, y, z, count); }
+
+size_t cartToGeod2(const double* x, const double* y, const double* z,
+                   double* lon, double* lat, double* elev, size_t count)
+{ return cartToGeod<Pack2>(x, y, z, lon, lat, elev, count); }
+
+size_t inverse2(const double* lat1, const double* lon1,
+                const double* lat2, const double* lon2,
+                double* az1, double* az2, double* s, size_t count)
+{ return inverse<Pack2>(lat1, lon1, lat2, lon2, az1, az2, s, count); }
+
+size_t direct2(const double* lat1, const double* lon1,
+               const double* az1, const double* s,
+               double* lat2, double* lon2, double* az2, size_t count)
+{ return direct<Pack2>(lat1, lon1, az1, s, lat2, lon2, az2, count); }
+
+const Kernels kernels2 = {
+#if defined(SG_GEODESY_SSE2)
+    "SSE2",
+#else
+    "NEON",
+#endif
+    geodToCart2, cartToGeod2, inverse2, direct2
+};
+
+#endif
+
+const Kernels& kernels()
+{
+    static const Kernels* k = [] {
+        if (const Kernels* avx2 = avx2Kernels())
+            return avx2;
+#if defined(SG_GEODESY_SSE2) || defined(SG_GEODESY_NEON)
+        return &kernels2;
+#else
+        return &kernelsScalar;
+#endif
+    }();
+    return *k;
+}
+
+// The SIMD kernel for whole packs, the scalar reference for the rest
+
+void geodToCartSoA(const double* lon, const double* lat, const double* elev,
+                   double* x, double* y, double* z, size_t count)
+{
+    size_t i = kernels().geodToCart(lon, lat, elev, x, y, z, count);
+    geodToCartScalar(lon + i, lat + i, elev + i, x + i, y + i, z + i, count - i);
+}
+
+void cartToGeodSoA(const double* x, const double* y, const double* z,
+                   double* lon, double* lat, double* elev, size_t count)
+{
+    size_t i = kernels().cartToGeod(x, y, z, lon, lat, elev, count);
+    cartToGeodScalar(x + i, y + i, z + i, lon + i, lat + i, elev + i, count - i);
+
+    for (i = 0; i < count; ++i) {
+        if (!std::isnan(lat[i]))
+            continue;
+        SGGeod geod;
+        SGGeodesy::SGCartToGeod(SGVec3d(x[i], y[i], z[i]), geod);
+        lon[i] = geod.getLongitudeDeg();
+        lat[i] = geod.getLatitudeDeg();
+        elev[i] = geod.getElevationM();
+    }
+}
+
+void inverseSoA(const double* lat1, const double* lon1,
+                const double* lat2, const double* lon2,
+                double* az1, double* az2, double* s, size_t count)
+{
+    size_t i = kernels().inverse(lat1, lon1, lat2, lon2, az1, az2, s, count);
+    inverseScalar(lat1 + i, lon1 + i, lat2 + i, lon2 + i, az1 + i, az2 + i, s + i, count - i);
+}
+
+} // anonymous namespace
+
+void
+SGGeodesy::SGGeodToCart(const double* lonDeg, const double* latDeg,
+                        const double* elevM, double* x, double* y,
+                        double* z, size_t count)
+{
+  geodToCartSoA(lonDeg, latDeg, elevM, x, y, z, count);
+}
+
+void
+SGGeodesy::SGCartToGeod(const double* x, const double* y, const double* z,
+                        double* lonDeg, double* latDeg, double* elevM,
+                        size_t count)
+{
+  cartToGeodSoA(x, y, z, lonDeg, latDeg, elevM, count);
+}
+
+void
+SGGeodesy::SGGeodToCart(const SGGeod* geod, SGVec3<double>* cart, size_t count)
+{
+  double lon[BlockSize], lat[BlockSize], elev[BlockSize];
+  double x[BlockSize], y[BlockSize], z[BlockSize];
+  for (size_t start = 0; start < count; start += BlockSize) {
+    const size_t n = std::min(BlockSize, count - start);
+    for (size_t i = 0; i < n; ++i) {
+      lon[i] = geod[start + i].getLongitudeDeg();
+      lat[i] = geod[start + i].getLatitudeDeg();
+      elev[i] = geod[start + i].getElevationM();
+    }
+    geodToCartSoA(lon, lat, elev, x, y, z, n);
+    for (size_t i = 0; i < n; ++i)
+      cart[start + i] = SGVec3<double>(x[i], y[i], z[i]);
+  }
+}
+
+void
+SGGeodesy::SGCartToGeod(const SGVec3<double>* cart, SGGeod* geod, size_t count)
+{
+  double lon[BlockSize], lat[BlockSize], elev[BlockSize];
+  double x[BlockSize], y[BlockSize], z[BlockSize];
+  for (size_t start = 0; start < count; start += BlockSize) {
+    const size_t n = std::min(BlockSize, count - start);
+    for (size_t i = 0; i < n; ++i) {
+      x[i] = cart[start + i](0);
+      y[i] = cart[start + i](1);
+      z[i] = cart[start + i](2);
+    }
+    cartToGeodSoA(x, y, z, lon, lat, elev, n);
+    for (size_t i = 0; i < n; ++i)
+      geod[start + i] = SGGeod::fromDegM(lon[i], lat[i], elev[i]);
+  }
+}
+
+bool
+SGGeodesy::direct(const SGGeod* p1, const double* course1,
+                  const double* distance, SGGeod* p2, double* course2,
+                  size_t count)
+{
+  bool ok = true;
+  double lat1[BlockSize], lon1[BlockSize], lat2[BlockSize], lon2[BlockSize];
+  for (size_t start = 0; start < count; start += BlockSize) {
+    const size_t n = std::min(BlockSize, count - start);
+    for (size_t i = 0; i < n; ++i) {
+      lat1[i] = p1[start + i].getLatitudeDeg();
+      lon1[i] = p1[start + i].getLongitudeDeg();
+    }
+
+    const double* az1 = course1 + start;
+    const double* s = distance + start;
+    double* az2 = course2 + start;
+    size_t i = kernels().direct(lat1, lon1, az1, s, lat2, lon2, az2, n);
+    directScalar(lat1 + i, lon1 + i, az1 + i, s + i, lat2 + i, lon2 + i, az2 + i, n - i);
+
+    for (i = 0; i < n; ++i) {
+      if (std::isnan(lat2[i]))
+        ok &= direct(p1[start + i], az1[i], s[i], p2[start + i], az2[i]);
+      else
+        p2[start + i] = SGGeod::fromDeg(lon2[i], lat2[i]);
+    }
+  }
+  return ok;
+}
+
+bool
+SGGeodesy::inverse(const SGGeod* p1, const SGGeod* p2, double* course1,
+                   double* course2, double* distance, size_t count)
+{
+  bool ok = true;
+  double lat1[BlockSize], lon1[BlockSize], lat2[BlockSize], lon2[BlockSize];
+  for (size_t start = 0; start < count; start += BlockSize) {
+    const size_t n = std::min(BlockSize, count - start);
+    for (size_t i = 0; i < n; ++i) {
+      lat1[i] = p1[start + i].getLatitudeDeg();
+      lon1[i] = p1[start + i].getLongitudeDeg();
+      lat2[i] = p2[start + i].getLatitudeDeg();
+      lon2[i] = p2[start + i].getLongitudeDeg();
+    }
+
+    double* az1 = course1 + start;
+    double* az2 = course2 + start;
+    double* s = distance + start;
+    inverseSoA(lat1, lon1, lat2, lon2, az1, az2, s, n);
+
+    for (size_t i = 0; i < n; ++i) {
+      if (std::isnan(s[i]))
+        ok &= inverse(p1[start + i], p2[start + i], az1[i], az2[i], s[i]);
+    }
+  }
+  return ok;
+}
+
+void
+SGGeodesy::distanceM(const SGGeod* from, const SGGeod* to, double* distance,
+                     size_t count)
+{
+  double lat1[BlockSize], lon1[BlockSize], lat2[BlockSize], lon2[BlockSize];
+  double az1[BlockSize], az2[BlockSize];
+  for (size_t start = 0; start < count; start += BlockSize) {
+    const size_t n = std::min(BlockSize, count - start);
+    for (size_t i = 0; i < n; ++i) {
+      lat1[i] = from[start + i].getLatitudeDeg();
+      lon1[i] = from[start + i].getLongitudeDeg();
+      lat2[i] = to[start + i].getLatitudeDeg();
+      lon2[i] = to[start + i].getLongitudeDeg();
+    }
+
+    double* s = distance + start;
+    inverseSoA(lat1, lon1, lat2, lon2, az1, az2, s, n);
+
+    // throws for the points the single point version fails on
+    for (size_t i = 0; i < n; ++i) {
+      if (std::isnan(s[i]))
+        s[i] = distanceM(from[start + i], to[start + i]);
+    }
+  }
+}
+
+const char*
+SGGeodesy::batchInstructionSet()
+{
+  return kernels().name;
+}
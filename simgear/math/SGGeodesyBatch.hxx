@@ -0,0 +1,590 @@
+// SGGeodesyBatch.hxx - SIMD kernels for the batch SGGeodesy functions
+// SPDX-License-Identifier: LGPL-2.0-or-later
+//
+// Internal header, not installed. The kernels are written once against a
+// small set of operations on packs of doubles and instantiated for plain
+// doubles (the scalar reference), SSE2, NEON and AVX2. The AVX2 version is
+// compiled in SGGeodesyBatchAVX2.cxx with SG_GEODESY_TARGET set to the
+// matching target attribute, so everything in here must stay in the
+// anonymous namespace and must not pull in code that could be shared
+// between the two translation units.
+//
+// All kernels work on structure of arrays input, process as many whole
+// packs as fit into count and return the number of elements done. Lanes
+// they cannot handle (special cases, no convergence) are returned as NaN
+// and must be redone by the single point SGGeodesy functions.
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  include <emmintrin.h>
+#  define SG_GEODESY_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#  include <arm_neon.h>
+#  define SG_GEODESY_NEON 1
+#endif
+
+#if defined(SG_GEODESY_AVX2)
+#  include <immintrin.h>
+#endif
+
+#ifndef SG_GEODESY_TARGET
+#  define SG_GEODESY_TARGET
+#endif
+
+namespace simgear {
+namespace geodesy_batch {
+
+typedef size_t (*ConvertFunc)(const double*, const double*, const double*,
+                              double*, double*, double*, size_t);
+typedef size_t (*InverseFunc)(const double* lat1, const double* lon1,
+                              const double* lat2, const double* lon2,
+                              double* az1, double* az2, double* s, size_t count);
+typedef size_t (*DirectFunc)(const double* lat1, const double* lon1,
+                             const double* az1, const double* s,
+                             double* lat2, double* lon2, double* az2, size_t count);
+
+struct Kernels
+{
+    const char* name;
+    ConvertFunc geodToCart;
+    ConvertFunc cartToGeod;
+    InverseFunc inverse;
+    DirectFunc direct;
+};
+
+/// The AVX2 kernels if they are compiled in and the CPU supports them.
+const Kernels* avx2Kernels();
+
+namespace {
+
+// WGS84 as in SGGeodesy.cxx, repeated here to keep this header free of
+// other SimGear code.
+const double EquRad = 6378137.0;
+const double iFlattening = 298.257223563;
+const double Squash = 0.9966471893352525192801545;
+const double Pi = 3.14159265358979323846;
+const double DegToRad = Pi / 180.0;
+const double RadToDeg = 180.0 / Pi;
+const double Nan = std::numeric_limits<double>::quiet_NaN();
+
+// Packs. Each provides Size, load/store, arithmetic, sqrt, abs, min, max,
+// comparisons returning a Mask, select() and any().
+
+struct Mask1
+{
+    bool v;
+    SG_GEODESY_TARGET Mask1(bool b) : v(b) {}
+};
+
+SG_GEODESY_TARGET inline Mask1 operator&(Mask1 a, Mask1 b) { return a.v && b.v; }
+SG_GEODESY_TARGET inline Mask1 operator|(Mask1 a, Mask1 b) { return a.v || b.v; }
+SG_GEODESY_TARGET inline Mask1 operator~(Mask1 a) { return !a.v; }
+SG_GEODESY_TARGET inline bool any(Mask1 m) { return m.v; }
+
+struct Pack1
+{
+    enum { Size = 1 };
+    typedef Mask1 Mask;
+    double v;
+    SG_GEODESY_TARGET Pack1() : v(0) {}
+    SG_GEODESY_TARGET Pack1(double d) : v(d) {}
+    SG_GEODESY_TARGET static Pack1 load(const double* p) { return *p; }
+    SG_GEODESY_TARGET void store(double* p) const { *p = v; }
+};
+
+SG_GEODESY_TARGET inline Pack1 operator+(Pack1 a, Pack1 b) { return a.v + b.v; }
+SG_GEODESY_TARGET inline Pack1 operator-(Pack1 a, Pack1 b) { return a.v - b.v; }
+SG_GEODESY_TARGET inline Pack1 operator*(Pack1 a, Pack1 b) { return a.v * b.v; }
+SG_GEODESY_TARGET inline Pack1 operator/(Pack1 a, Pack1 b) { return a.v / b.v; }
+SG_GEODESY_TARGET inline Pack1 operator-(Pack1 a) { return -a.v; }
+SG_GEODESY_TARGET inline Pack1 sqrt(Pack1 a) { return std::sqrt(a.v); }
+SG_GEODESY_TARGET inline Pack1 abs(Pack1 a) { return std::fabs(a.v); }
+SG_GEODESY_TARGET inline Pack1 min(Pack1 a, Pack1 b) { return a.v < b.v ? a.v : b.v; }
+SG_GEODESY_TARGET inline Pack1 max(Pack1 a, Pack1 b) { return a.v > b.v ? a.v : b.v; }
+SG_GEODESY_TARGET inline Mask1 operator<(Pack1 a, Pack1 b) { return a.v < b.v; }
+SG_GEODESY_TARGET inline Mask1 operator>(Pack1 a, Pack1 b) { return a.v > b.v; }
+SG_GEODESY_TARGET inline Mask1 operator<=(Pack1 a, Pack1 b) { return a.v <= b.v; }
+SG_GEODESY_TARGET inline Mask1 operator>=(Pack1 a, Pack1 b) { return a.v >= b.v; }
+SG_GEODESY_TARGET inline Mask1 operator==(Pack1 a, Pack1 b) { return a.v == b.v; }
+SG_GEODESY_TARGET inline Pack1 select(Mask1 m, Pack1 a, Pack1 b) { return m.v ? a : b; }
+
+#if defined(SG_GEODESY_SSE2)
+
+struct Mask2
+{
+    __m128d v;
+    SG_GEODESY_TARGET Mask2(__m128d m) : v(m) {}
+};
+
+SG_GEODESY_TARGET inline Mask2 operator&(Mask2 a, Mask2 b) { return _mm_and_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator|(Mask2 a, Mask2 b) { return _mm_or_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator~(Mask2 a)
+{ return _mm_xor_pd(a.v, _mm_castsi128_pd(_mm_set1_epi32(-1))); }
+SG_GEODESY_TARGET inline bool any(Mask2 m) { return _mm_movemask_pd(m.v) != 0; }
+
+struct Pack2
+{
+    enum { Size = 2 };
+    typedef Mask2 Mask;
+    __m128d v;
+    SG_GEODESY_TARGET Pack2() : v(_mm_setzero_pd()) {}
+    SG_GEODESY_TARGET Pack2(__m128d x) : v(x) {}
+    SG_GEODESY_TARGET Pack2(double d) : v(_mm_set1_pd(d)) {}
+    SG_GEODESY_TARGET static Pack2 load(const double* p) { return _mm_loadu_pd(p); }
+    SG_GEODESY_TARGET void store(double* p) const { _mm_storeu_pd(p, v); }
+};
+
+SG_GEODESY_TARGET inline Pack2 operator+(Pack2 a, Pack2 b) { return _mm_add_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator-(Pack2 a, Pack2 b) { return _mm_sub_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator*(Pack2 a, Pack2 b) { return _mm_mul_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator/(Pack2 a, Pack2 b) { return _mm_div_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator-(Pack2 a) { return _mm_xor_pd(a.v, _mm_set1_pd(-0.0)); }
+SG_GEODESY_TARGET inline Pack2 sqrt(Pack2 a) { return _mm_sqrt_pd(a.v); }
+SG_GEODESY_TARGET inline Pack2 abs(Pack2 a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a.v); }
+SG_GEODESY_TARGET inline Pack2 min(Pack2 a, Pack2 b) { return _mm_min_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 max(Pack2 a, Pack2 b) { return _mm_max_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator<(Pack2 a, Pack2 b) { return _mm_cmplt_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator>(Pack2 a, Pack2 b) { return _mm_cmpgt_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator<=(Pack2 a, Pack2 b) { return _mm_cmple_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator>=(Pack2 a, Pack2 b) { return _mm_cmpge_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator==(Pack2 a, Pack2 b) { return _mm_cmpeq_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 select(Mask2 m, Pack2 a, Pack2 b)
+{ return _mm_or_pd(_mm_and_pd(m.v, a.v), _mm_andnot_pd(m.v, b.v)); }
+
+#elif defined(SG_GEODESY_NEON)
+
+struct Mask2
+{
+    uint64x2_t v;
+    SG_GEODESY_TARGET Mask2(uint64x2_t m) : v(m) {}
+};
+
+SG_GEODESY_TARGET inline Mask2 operator&(Mask2 a, Mask2 b) { return vandq_u64(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator|(Mask2 a, Mask2 b) { return vorrq_u64(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator~(Mask2 a)
+{ return vreinterpretq_u64_u32(vmvnq_u32(vreinterpretq_u32_u64(a.v))); }
+SG_GEODESY_TARGET inline bool any(Mask2 m)
+{ return (vgetq_lane_u64(m.v, 0) | vgetq_lane_u64(m.v, 1)) != 0; }
+
+struct Pack2
+{
+    enum { Size = 2 };
+    typedef Mask2 Mask;
+    float64x2_t v;
+    SG_GEODESY_TARGET Pack2() : v(vdupq_n_f64(0)) {}
+    SG_GEODESY_TARGET Pack2(float64x2_t x) : v(x) {}
+    SG_GEODESY_TARGET Pack2(double d) : v(vdupq_n_f64(d)) {}
+    SG_GEODESY_TARGET static Pack2 load(const double* p) { return vld1q_f64(p); }
+    SG_GEODESY_TARGET void store(double* p) const { vst1q_f64(p, v); }
+};
+
+SG_GEODESY_TARGET inline Pack2 operator+(Pack2 a, Pack2 b) { return vaddq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator-(Pack2 a, Pack2 b) { return vsubq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator*(Pack2 a, Pack2 b) { return vmulq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator/(Pack2 a, Pack2 b) { return vdivq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 operator-(Pack2 a) { return vnegq_f64(a.v); }
+SG_GEODESY_TARGET inline Pack2 sqrt(Pack2 a) { return vsqrtq_f64(a.v); }
+SG_GEODESY_TARGET inline Pack2 abs(Pack2 a) { return vabsq_f64(a.v); }
+SG_GEODESY_TARGET inline Pack2 min(Pack2 a, Pack2 b) { return vminq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 max(Pack2 a, Pack2 b) { return vmaxq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator<(Pack2 a, Pack2 b) { return vcltq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator>(Pack2 a, Pack2 b) { return vcgtq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator<=(Pack2 a, Pack2 b) { return vcleq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator>=(Pack2 a, Pack2 b) { return vcgeq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask2 operator==(Pack2 a, Pack2 b) { return vceqq_f64(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack2 select(Mask2 m, Pack2 a, Pack2 b) { return vbslq_f64(m.v, a.v, b.v); }
+
+#endif
+
+#if defined(SG_GEODESY_AVX2)
+
+struct Mask4
+{
+    __m256d v;
+    SG_GEODESY_TARGET Mask4(__m256d m) : v(m) {}
+};
+
+SG_GEODESY_TARGET inline Mask4 operator&(Mask4 a, Mask4 b) { return _mm256_and_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask4 operator|(Mask4 a, Mask4 b) { return _mm256_or_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask4 operator~(Mask4 a)
+{ return _mm256_xor_pd(a.v, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))); }
+SG_GEODESY_TARGET inline bool any(Mask4 m) { return _mm256_movemask_pd(m.v) != 0; }
+
+struct Pack4
+{
+    enum { Size = 4 };
+    typedef Mask4 Mask;
+    __m256d v;
+    SG_GEODESY_TARGET Pack4() : v(_mm256_setzero_pd()) {}
+    SG_GEODESY_TARGET Pack4(__m256d x) : v(x) {}
+    SG_GEODESY_TARGET Pack4(double d) : v(_mm256_set1_pd(d)) {}
+    SG_GEODESY_TARGET static Pack4 load(const double* p) { return _mm256_loadu_pd(p); }
+    SG_GEODESY_TARGET void store(double* p) const { _mm256_storeu_pd(p, v); }
+};
+
+SG_GEODESY_TARGET inline Pack4 operator+(Pack4 a, Pack4 b) { return _mm256_add_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack4 operator-(Pack4 a, Pack4 b) { return _mm256_sub_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack4 operator*(Pack4 a, Pack4 b) { return _mm256_mul_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack4 operator/(Pack4 a, Pack4 b) { return _mm256_div_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack4 operator-(Pack4 a) { return _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)); }
+SG_GEODESY_TARGET inline Pack4 sqrt(Pack4 a) { return _mm256_sqrt_pd(a.v); }
+SG_GEODESY_TARGET inline Pack4 abs(Pack4 a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v); }
+SG_GEODESY_TARGET inline Pack4 min(Pack4 a, Pack4 b) { return _mm256_min_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Pack4 max(Pack4 a, Pack4 b) { return _mm256_max_pd(a.v, b.v); }
+SG_GEODESY_TARGET inline Mask4 operator<(Pack4 a, Pack4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ); }
+SG_GEODESY_TARGET inline Mask4 operator>(Pack4 a, Pack4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ); }
+SG_GEODESY_TARGET inline Mask4 operator<=(Pack4 a, Pack4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ); }
+SG_GEODESY_TARGET inline Mask4 operator>=(Pack4 a, Pack4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ); }
+SG_GEODESY_TARGET inline Mask4 operator==(Pack4 a, Pack4 b) { return _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ); }
+SG_GEODESY_TARGET inline Pack4 select(Mask4 m, Pack4 a, Pack4 b) { return _mm256_blendv_pd(b.v, a.v, m.v); }
+
+#endif
+
+// Elementary functions, accurate to a few ulp in the ranges used here.
+
+// Rounds to the nearest integer for |x| < 2^51
+template<class P>
+SG_GEODESY_TARGET inline P roundNearest(P x)
+{
+    const P magic(6755399441055744.0);
+    return (x + magic) - magic;
+}
+
+// Cody-Waite reduction by pi/2 and the Cephes polynomials on [-pi/4, pi/4].
+// Intended for |x| well below 1e6.
+template<class P>
+SG_GEODESY_TARGET inline void sincos(P x, P& s, P& c)
+{
+    const P q = roundNearest(x * P(2 / Pi));
+    const P r = ((x - q * P(1.57079632673412561417e+00))
+                   - q * P(6.07710050630396597660e-11))
+                   - q * P(2.02226624871116645580e-21);
+    const P z = r * r;
+
+    P ps = P(1.58962301576546568060e-10) * z + P(-2.50507477628578072866e-8);
+    ps = ps * z + P(2.75573136213857245213e-6);
+    ps = ps * z + P(-1.98412698295895385996e-4);
+    ps = ps * z + P(8.33333333332211858878e-3);
+    ps = ps * z + P(-1.66666666666666307295e-1);
+    const P sr = r + r * z * ps;
+
+    P pc = P(-1.13585365213876817300e-11) * z + P(2.08757008419747316778e-9);
+    pc = pc * z + P(-2.75573141792967388112e-7);
+    pc = pc * z + P(2.48015872888517045348e-5);
+    pc = pc * z + P(-1.38888888888730564116e-3);
+    pc = pc * z + P(4.16666666666665929218e-2);
+    const P cr = (P(1) - P(0.5) * z) + z * z * pc;
+
+    // quadrant 0..3
+    const P m = q - P(4) * roundNearest(q * P(0.25) - P(0.375));
+    const typename P::Mask odd = (m == P(1)) | (m == P(3));
+    const P sq = select(odd, cr, sr);
+    const P cq = select(odd, sr, cr);
+    s = select(m >= P(2), -sq, sq);
+    c = select((m == P(1)) | (m == P(2)), -cq, cq);
+}
+
+template<class P>
+SG_GEODESY_TARGET inline P cos(P x)
+{
+    P s, c;
+    sincos(x, s, c);
+    return c;
+}
+
+// Cephes atan for 0 <= t <= 1
+template<class P>
+SG_GEODESY_TARGET inline P atan01(P t)
+{
+    const typename P::Mask big = t > P(0.66);
+    const P x = select(big, (t - P(1)) / (t + P(1)), t);
+    const P z = x * x;
+
+    P p = P(-8.750608600031904122785e-1) * z + P(-1.615753718733365076637e1);
+    p = p * z + P(-7.500855792314704667340e1);
+    p = p * z + P(-1.228866684490136173410e2);
+    p = p * z + P(-6.485021904942025371773e1);
+    P q = z + P(2.485846490142306297962e1);
+    q = q * z + P(1.650270098316988542046e2);
+    q = q * z + P(4.328810604912902668951e2);
+    q = q * z + P(4.853903996359136964868e2);
+    q = q * z + P(1.945506571482613964425e2);
+
+    const P r = x * (z * p / q) + x;
+    return select(big, P(Pi / 4) + (r + P(0.5 * 6.123233995736765886130e-17)), r);
+}
+
+template<class P>
+SG_GEODESY_TARGET inline P atan2(P y, P x)
+{
+    const P ax = abs(x), ay = abs(y);
+    const P mx = max(ax, ay), mn = min(ax, ay);
+    P a = atan01(select(mx > P(0), mn / mx, P(0)));
+    a = select(ay > ax, (P(Pi / 2) - a) + P(6.123233995736765886e-17), a);
+    a = select(x < P(0), (P(Pi) - a) + P(1.224646799147353177e-16), a);
+    return select(y < P(0), -a, a);
+}
+
+// Cube root for 1 <= t <= 2 by Halley's method from the tangent at 1
+template<class P>
+SG_GEODESY_TARGET inline P cbrt12(P t)
+{
+    P y = P(2.0 / 3.0) + t * P(1.0 / 3.0);
+    for (int i = 0; i < 3; ++i) {
+        const P y3 = y * y * y;
+        y = y * (y3 + P(2) * t) / (P(2) * y3 + t);
+    }
+    return y;
+}
+
+// Kernels, following the single point versions in SGGeodesy.cxx
+
+template<class P>
+SG_GEODESY_TARGET size_t geodToCart(const double* lonDeg, const double* latDeg,
+                                    const double* elevM, double* x, double* y,
+                                    double* z, size_t count)
+{
+    const double e2 = std::fabs(1 - Squash * Squash);
+
+    size_t i = 0;
+    for (; i + P::Size <= count; i += P::Size) {
+        const P lambda = P::load(lonDeg + i) * P(DegToRad);
+        const P phi = P::load(latDeg + i) * P(DegToRad);
+        const P h = P::load(elevM + i);
+
+        P sphi, cphi, slambda, clambda;
+        sincos(phi, sphi, cphi);
+        sincos(lambda, slambda, clambda);
+        const P n = P(EquRad) / sqrt(P(1) - P(e2) * sphi * sphi);
+        ((h + n) * cphi * clambda).store(x + i);
+        ((h + n) * cphi * slambda).store(y + i);
+        ((h + n - P(e2) * n) * sphi).store(z + i);
+    }
+    return i;
+}
+
+template<class P>
+SG_GEODESY_TARGET size_t cartToGeod(const double* x, const double* y, const double* z,
+                                    double* lonDeg, double* latDeg, double* elevM,
+                                    size_t count)
+{
+    const double e2 = std::fabs(1 - Squash * Squash);
+    const double e4 = e2 * e2;
+    const double ra2 = 1 / (EquRad * EquRad);
+
+    size_t i = 0;
+    for (; i + P::Size <= count; i += P::Size) {
+        const P X = P::load(x + i), Y = P::load(y + i), Z = P::load(z + i);
+        const P XXpYY = X * X + Y * Y;
+        const P sqrtXXpYY = sqrt(XXpYY);
+        const P p = XXpYY * P(ra2);
+        const P q = Z * Z * P((1 - e2) * ra2);
+        const P r = P(1 / 6.0) * (p + q - P(e4));
+        P s = P(e4) * p * q / (P(4) * r * r * r);
+        s = select((s >= P(-2)) & (s <= P(0)), P(0), s);
+        const P t0 = P(1) + s + sqrt(s * (P(2) + s));
+        // the geocenter region and points far below the surface
+        const typename P::Mask ok = (XXpYY + Z * Z >= P(25)) & (t0 >= P(1)) & (t0 <= P(2));
+
+        const P t = cbrt12(select(ok, t0, P(1)));
+        const P u = r * (P(1) + t + P(1) / t);
+        const P v = sqrt(u * u + P(e4) * q);
+        const P w = P(e2) * (u + v - q) / (P(2) * v);
+        const P k = sqrt(u + v + w * w) - w;
+        const P D = k * sqrtXXpYY / (k + P(e2));
+        const P sqrtDDpZZ = sqrt(D * D + Z * Z);
+
+        select(ok, P(2) * atan2(Y, X + sqrtXXpYY) * P(RadToDeg), P(Nan)).store(lonDeg + i);
+        select(ok, P(2) * atan2(Z, D + sqrtDDpZZ) * P(RadToDeg), P(Nan)).store(latDeg + i);
+        select(ok, (k + P(e2 - 1)) * sqrtDDpZZ / k, P(Nan)).store(elevM + i);
+    }
+    return i;
+}
+
+template<class P>
+SG_GEODESY_TARGET inline P toDegrees360(P rad, P testv)
+{
+    P deg = rad * P(180) / P(Pi);
+    deg = select(abs(deg) < testv, P(0), deg);
+    return select(deg < P(0), deg + P(360), deg);
+}
+
+template<class P>
+SG_GEODESY_TARGET size_t inverse(const double* lat1, const double* lon1,
+                                 const double* lat2, const double* lon2,
+                                 double* az1, double* az2, double* s, size_t count)
+{
+    typedef typename P::Mask Mask;
+    const double a = EquRad;
+    const double f = 1.0 / iFlattening;
+    const double b = a * (1.0 - f);
+    const P testv(1.0E-10);
+
+    size_t i = 0;
+    for (; i + P::Size <= count; i += P::Size) {
+        const P la1 = P::load(lat1 + i), lo1 = P::load(lon1 + i);
+        const P la2 = P::load(lat2 + i), lo2 = P::load(lon2 + i);
+        const P phi1 = la1 * P(Pi) / P(180), lam1 = lo1 * P(Pi) / P(180);
+        const P phi2 = la2 * P(Pi) / P(180), lam2 = lo2 * P(Pi) / P(180);
+        P sinphi1, cosphi1, sinphi2, cosphi2;
+        sincos(phi1, sinphi1, cosphi1);
+        sincos(phi2, sinphi2, cosphi2);
+
+        // identical, polar and antipodal points
+        Mask bad = ((abs(la1 - la2) < testv) & (abs(lo1 - lo2) < testv)) |
+                   (abs(la1 - P(90)) < testv) |
+                   (abs(cosphi1) < testv) | (abs(cosphi2) < testv) |
+                   ((abs(abs(lo1 - lo2) - P(180)) < testv) & (abs(la1 + la2) < testv));
+
+        const P dlam = lam2 - lam1;
+        P temp = P(1.0 - f) * sinphi1 / cosphi1;
+        const P cosu1 = P(1) / sqrt(P(1) + temp * temp);
+        const P sinu1 = temp * cosu1;
+        temp = P(1.0 - f) * sinphi2 / cosphi2;
+        const P cosu2 = P(1) / sqrt(P(1) + temp * temp);
+        const P sinu2 = temp * cosu2;
+        const Mask equatorial = (sinu1 == P(0)) | (sinu2 == P(0));
+
+        // The single point version may give up after 50 iterations, leave
+        // these lanes to it.
+        P dlams = dlam, sdlams, cdlams, sig, sinsig, cossig, sinaz, cos2saz, c2sigm;
+        Mask active = ~bad;
+        for (int iter = 0; any(active); ++iter) {
+            if (iter == 50) {
+                bad = bad | active;
+                break;
+            }
+
+            P sd, cd;
+            sincos(dlams, sd, cd);
+            const P w = cosu1 * sinu2 - sinu1 * cosu2 * cd;
+            const P nsinsig = sqrt(cosu2 * cosu2 * sd * sd + w * w);
+            const P ncossig = sinu1 * sinu2 + cosu1 * cosu2 * cd;
+            const P nsig = atan2(nsinsig, ncossig);
+            const P nsinaz = cosu1 * cosu2 * sd / nsinsig;
+            const P ncos2saz = P(1) - nsinaz * nsinaz;
+            const P nc2sigm = select(equatorial, ncossig,
+                                     ncossig - P(2) * sinu1 * sinu2 / ncos2saz);
+            const P tc = P(f) * ncos2saz * (P(4) + P(f) * (P(4) - P(3) * ncos2saz)) / P(16);
+            const P ndlams = dlam + (P(1) - tc) * P(f) * nsinaz *
+                (nsig + tc * nsinsig * (nc2sigm + tc * ncossig * (P(-1) + P(2) * nc2sigm * nc2sigm)));
+
+            sdlams = select(active, sd, sdlams);
+            cdlams = select(active, cd, cdlams);
+            sig = select(active, nsig, sig);
+            sinsig = select(active, nsinsig, sinsig);
+            cossig = select(active, ncossig, cossig);
+            sinaz = select(active, nsinaz, sinaz);
+            cos2saz = select(active, ncos2saz, cos2saz);
+            c2sigm = select(active, nc2sigm, c2sigm);
+
+            const Mask next = active & (abs(dlams - ndlams) > testv);
+            dlams = select(active, ndlams, dlams);
+            active = next;
+        }
+
+        const P us = cos2saz * P((a * a - b * b) / (b * b));
+        const P raz2 = atan2(-(cosu1 * sdlams), sinu1 * cosu2 - cosu1 * sinu2 * cdlams);
+        const P raz1 = atan2(cosu2 * sdlams, cosu1 * sinu2 - sinu1 * cosu2 * cdlams);
+
+        const P ta = P(1) + us * (P(4096) + us * (P(-768) + us * (P(320) - P(175) * us))) / P(16384);
+        const P tb = us * (P(256) + us * (P(-128) + us * (P(74) - P(47) * us))) / P(1024);
+        const P dist = P(b) * ta * (sig - tb * sinsig *
+            (c2sigm + tb * (cossig * (P(-1) + P(2) * c2sigm * c2sigm) - tb *
+                            c2sigm * (P(-3) + P(4) * sinsig * sinsig) *
+                            (P(-3) + P(4) * c2sigm * c2sigm) / P(6)) / P(4)));
+
+        select(bad, P(Nan), toDegrees360(raz1, testv)).store(az1 + i);
+        select(bad, P(Nan), toDegrees360(raz2, testv)).store(az2 + i);
+        select(bad, P(Nan), dist).store(s + i);
+    }
+    return i;
+}
+
+template<class P>
+SG_GEODESY_TARGET size_t direct(const double* lat1, const double* lon1,
+                                const double* az1, const double* s,
+                                double* lat2, double* lon2, double* az2, size_t count)
+{
+    typedef typename P::Mask Mask;
+    const double a = EquRad;
+    const double f = 1.0 / iFlattening;
+    const double b = a * (1.0 - f);
+    const double e2 = f * (2.0 - f);
+    const P testv(1.0E-10);
+
+    size_t i = 0;
+    for (; i + P::Size <= count; i += P::Size) {
+        const P dist = P::load(s + i);
+        const P phi1 = P::load(lat1 + i) * P(Pi) / P(180);
+        const P lam1 = P::load(lon1 + i) * P(Pi) / P(180);
+        const P azm1 = P::load(az1 + i) * P(Pi) / P(180);
+        P sinphi1, cosphi1, sinaz1, cosaz1;
+        sincos(phi1, sinphi1, cosphi1);
+        sincos(azm1, sinaz1, cosaz1);
+
+        // congruent points and polar origins
+        Mask bad = (abs(dist) < P(0.01)) |
+                   (abs(cosphi1) <= P(std::numeric_limits<double>::min()));
+
+        const P tanu1 = P(std::sqrt(1.0 - e2)) * sinphi1 / cosphi1;
+        const P sig1 = atan2(tanu1, cosaz1);
+        const P cosu1 = P(1) / sqrt(P(1) + tanu1 * tanu1), sinu1 = tanu1 * cosu1;
+        const P sinaz = cosu1 * sinaz1, cos2saz = P(1) - sinaz * sinaz;
+        const P us = cos2saz * P(e2 / (1.0 - e2));
+
+        const P ta = P(1) + us * (P(4096) + us * (P(-768) + us * (P(320) - P(175) * us))) / P(16384);
+        const P tb = us * (P(256) + us * (P(-128) + us * (P(74) - P(47) * us))) / P(1024);
+
+        const P first = dist / (P(b) * ta);
+        P sig = first, c2sigm, sinsig, cossig;
+        Mask active = ~bad;
+        for (int iter = 0; any(active); ++iter) {
+            if (iter == 100) {
+                bad = bad | active;
+                break;
+            }
+
+            P ns, nc;
+            sincos(sig, ns, nc);
+            const P nc2sigm = cos(P(2) * sig1 + sig);
+            const P nsig = first + tb * ns * (nc2sigm + tb * (nc * (P(-1) + P(2) * nc2sigm * nc2sigm) -
+                tb * nc2sigm * (P(-3) + P(4) * ns * ns) * (P(-3) + P(4) * nc2sigm * nc2sigm) / P(6)) / P(4));
+
+            c2sigm = select(active, nc2sigm, c2sigm);
+            sinsig = select(active, ns, sinsig);
+            cossig = select(active, nc, cossig);
+            const Mask next = active & (abs(nsig - sig) > testv);
+            sig = select(active, nsig, sig);
+            active = next;
+        }
+
+        const P temp = sinu1 * sinsig - cosu1 * cossig * cosaz1;
+        const P denom = P(1.0 - f) * sqrt(sinaz * sinaz + temp * temp);
+        const P rnumer = sinu1 * cossig + cosu1 * sinsig * cosaz1;
+        const P rlat2 = atan2(rnumer, denom);
+
+        const P dlams = atan2(sinsig * sinaz1, cosu1 * cossig - sinu1 * sinsig * cosaz1);
+        const P tc = P(f) * cos2saz * (P(4) + P(f) * (P(4) - P(3) * cos2saz)) / P(16);
+        const P dlam = dlams - (P(1) - tc) * P(f) * sinaz *
+            (sig + tc * sinsig * (c2sigm + tc * cossig * (P(-1) + P(2) * c2sigm * c2sigm)));
+
+        P dlon2 = (lam1 + dlam) * P(180) / P(Pi);
+        dlon2 = select(dlon2 > P(180), dlon2 - P(360), dlon2);
+        dlon2 = select(dlon2 < P(-180), dlon2 + P(360), dlon2);
+
+        select(bad, P(Nan), rlat2 * P(180) / P(Pi)).store(lat2 + i);
+        select(bad, P(Nan), dlon2).store(lon2 + i);
+        select(bad, P(Nan), toDegrees360(atan2(-sinaz, temp), testv)).store(az2 + i);
+    }
+    return i;
+}
+
+} // anonymous namespace
+} // namespace geodesy_batch
+} // namespace simgear
@@ -0,0 +1,68 @@
+// SGGeodesyBatchAVX2.cxx - AVX2 instances of the batch SGGeodesy kernels
+// SPDX-License-Identifier: LGPL-2.0-or-later
+//
+// Only the kernel functions are compiled for AVX2 (and FMA) through the
+// target attribute, the rest of the library keeps the baseline instruction
+// set. The kernels are used when the CPU reports support at runtime.
+
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define SG_GEODESY_AVX2 1
+#  define SG_GEODESY_TARGET __attribute__((target("avx2,fma")))
+#endif
+
+#include "SGGeodesyBatch.hxx"
+
+namespace simgear {
+namespace geodesy_batch {
+
+#if defined(SG_GEODESY_AVX2)
+
+namespace {
+
+SG_GEODESY_TARGET size_t geodToCartAVX2(const double* lon, const double* lat, const double* elev,
+                                        double* x, double* y, double* z, size_t count)
+{ return geodToCart<Pack4>(lon, lat, elev, x, y, z, count); }
+
+SG_GEODESY_TARGET size_t cartToGeodAVX2(const double* x, const double* y, const double* z,
+                                        double* lon, double* lat, double* elev, size_t count)
+{ return cartToGeod<Pack4>(x, y, z, lon, lat, elev, count); }
+
+SG_GEODESY_TARGET size_t inverseAVX2(const double* lat1, const double* lon1,
+                                     const double* lat2, const double* lon2,
+                                     double* az1, double* az2, double* s, size_t count)
+{ return inverse<Pack4>(lat1, lon1, lat2, lon2, az1, az2, s, count); }
+
+SG_GEODESY_TARGET size_t directAVX2(const double* lat1, const double* lon1,
+                                    const double* az1, const double* s,
+                                    double* lat2, double* lon2, double* az2, size_t count)
+{ return direct<Pack4>(lat1, lon1, az1, s, lat2, lon2, az2, count); }
+
+const Kernels kernelsAVX2 = {
+    "AVX2", geodToCartAVX2, cartToGeodAVX2, inverseAVX2, directAVX2
+};
+
+} // anonymous namespace
+
+const Kernels* avx2Kernels()
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return &kernelsAVX2;
+    return nullptr;
+}
+
+#else
+
+const Kernels* avx2Kernels()
+{
+    return nullptr;
+}
+
+#endif
+
+} // namespace geodesy_batch
+} // namespace simgear
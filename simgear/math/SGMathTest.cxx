@@ -23,6 +23,7 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <vector>
 
 #include "SGMath.hxx"
 #include "SGRect.hxx"
@@ -357,6 +358,106 @@ GeodesyTest(void)
   return true;
 }
 
+bool
+GeodesyBatchTest(void)
+{
+  // An odd number of points, so the scalar tail is used as well
+  const size_t n = 1001;
+  std::vector<SGGeod> geod(n), geod2(n);
+  for (size_t i = 0; i < n; ++i) {
+    geod[i] = SGGeod::fromDegM(360*sg_random() - 180, 180*sg_random() - 90,
+                               20000*sg_random() - 1000);
+    geod2[i] = SGGeod::fromDegM(360*sg_random() - 180, 180*sg_random() - 90, 0);
+  }
+  // special cases the kernels leave to the single point versions
+  geod[0] = SGGeod::fromDegM(0, 90, 0);
+  geod[1] = SGGeod::fromDegM(10, -90, 100);
+  geod[2] = SGGeod::fromDegM(0, 0, -SGGeodesy::EQURAD);
+  geod[3] = SGGeod::fromDegM(20, 30, -6e6);
+  geod2[4] = geod[4];
+  geod2[5] = SGGeod::fromDeg(geod[5].getLongitudeDeg() + 180, -geod[5].getLatitudeDeg());
+  geod[6] = SGGeod::fromDeg(0, 0);
+  geod2[6] = SGGeod::fromDeg(90, 0);
+
+  // Geodetic to cartesian and back, array of structures
+  std::vector<SGVec3<double> > cart(n);
+  SGGeodesy::SGGeodToCart(geod.data(), cart.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    if (1e-6 < norm(cart[i] - SGVec3<double>::fromGeod(geod[i])))
+      { lineno = __LINE__; return false; }
+  }
+
+  std::vector<SGGeod> geodBack(n);
+  SGGeodesy::SGCartToGeod(cart.data(), geodBack.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    SGGeod ref = SGGeod::fromCart(cart[i]);
+    if (1e-9 < fabs(geodBack[i].getLatitudeDeg() - ref.getLatitudeDeg()) ||
+        1e-9 < fabs(geodBack[i].getLongitudeDeg() - ref.getLongitudeDeg()) ||
+        1e-6 < fabs(geodBack[i].getElevationM() - ref.getElevationM()))
+      { lineno = __LINE__; return false; }
+  }
+
+  // Structure of arrays
+  std::vector<double> lon(n), lat(n), elev(n), x(n), y(n), z(n);
+  for (size_t i = 0; i < n; ++i) {
+    lon[i] = geod[i].getLongitudeDeg();
+    lat[i] = geod[i].getLatitudeDeg();
+    elev[i] = geod[i].getElevationM();
+  }
+  SGGeodesy::SGGeodToCart(lon.data(), lat.data(), elev.data(),
+                          x.data(), y.data(), z.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    if (!equivalent(SGVec3<double>(x[i], y[i], z[i]), cart[i], 0.0, 1e-6))
+      { lineno = __LINE__; return false; }
+  }
+  SGGeodesy::SGCartToGeod(x.data(), y.data(), z.data(),
+                          lon.data(), lat.data(), elev.data(), n);
+  for (size_t i = 0; i < n; ++i) {
+    if (1e-9 < fabs(lat[i] - geodBack[i].getLatitudeDeg()) ||
+        1e-9 < fabs(lon[i] - geodBack[i].getLongitudeDeg()) ||
+        1e-6 < fabs(elev[i] - geodBack[i].getElevationM()))
+      { lineno = __LINE__; return false; }
+  }
+
+  // Inverse, direct and distances. Near antipodal points are ill
+  // conditioned, so allow for more than rounding there.
+  std::vector<double> course1(n), course2(n), distance(n);
+  if (!SGGeodesy::inverse(geod.data(), geod2.data(), course1.data(),
+                          course2.data(), distance.data(), n))
+    { lineno = __LINE__; return false; }
+  for (size_t i = 0; i < n; ++i) {
+    double c1, c2, d;
+    SGGeodesy::inverse(geod[i], geod2[i], c1, c2, d);
+    if (1e-3 < fabs(distance[i] - d) ||
+        1e-8 < fabs(SGMiscd::normalizePeriodic(-180, 180, course1[i] - c1)) ||
+        1e-8 < fabs(SGMiscd::normalizePeriodic(-180, 180, course2[i] - c2)))
+      { lineno = __LINE__; return false; }
+  }
+
+  std::vector<double> distanceOnly(n);
+  SGGeodesy::distanceM(geod.data(), geod2.data(), distanceOnly.data(), n);
+  if (distanceOnly != distance)
+    { lineno = __LINE__; return false; }
+
+  std::vector<SGGeod> dest(n);
+  if (!SGGeodesy::direct(geod.data(), course1.data(), distance.data(),
+                         dest.data(), course2.data(), n))
+    { lineno = __LINE__; return false; }
+  for (size_t i = 0; i < n; ++i) {
+    SGGeod p2;
+    double c2;
+    SGGeodesy::direct(geod[i], course1[i], distance[i], p2, c2);
+    if (1e-8 < fabs(dest[i].getLatitudeDeg() - p2.getLatitudeDeg()) ||
+        1e-8 < fabs(SGMiscd::normalizePeriodic(-180, 180, dest[i].getLongitudeDeg() - p2.getLongitudeDeg())) ||
+        1e-8 < fabs(SGMiscd::normalizePeriodic(-180, 180, course2[i] - c2)) ||
+        dest[i].getElevationM() != 0)
+      { lineno = __LINE__; return false; }
+  }
+
+  std::cout << "batch geodesy uses " << SGGeodesy::batchInstructionSet() << std::endl;
+  return true;
+}
+
 int
 main(void)
 {
@@ -391,6 +492,8 @@ main(void)
   // Check geodetic/geocentric/cartesian conversions
   if (!GeodesyTest())
     { fprintf(stderr, "Error at line: %i called from line: %i\n", lineno, __LINE__); return EXIT_FAILURE; }
+  if (!GeodesyBatchTest())
+    { fprintf(stderr, "Error at line: %i called from line: %i\n", lineno, __LINE__); return EXIT_FAILURE; }
 
   std::cout << "Successfully passed all tests!" << std::endl;
   return EXIT_SUCCESS;
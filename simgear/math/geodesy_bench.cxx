@@ -0,0 +1,118 @@
+// geodesy_bench - compare single point and batch SGGeodesy throughput
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <simgear/math/SGMath.hxx>
+
+namespace {
+
+template <class F>
+double timeIt(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char* name, size_t n, double single, double batch)
+{
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(10) << n / single * 1e-6
+              << std::setw(10) << n / batch * 1e-6
+              << std::setprecision(2) << std::setw(9) << single / batch << "x"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> lon(-180, 180), lat(-85, 85), elev(-100, 12000);
+    std::vector<SGGeod> geod(n), geod2(n);
+    for (size_t i = 0; i < n; ++i) {
+        geod[i] = SGGeod::fromDegM(lon(rng), lat(rng), elev(rng));
+        // AI traffic and map style distances of up to a few hundred km
+        geod2[i] = SGGeod::fromDeg(geod[i].getLongitudeDeg() + 4 * (lat(rng) / 85),
+                                   SGMiscd::clip(geod[i].getLatitudeDeg() + 3 * (lat(rng) / 85), -89, 89));
+    }
+
+    std::vector<SGVec3d> cart(n), cart2(n);
+    std::vector<SGGeod> result(n);
+    std::vector<double> lonDeg(n), latDeg(n), elevM(n), x(n), y(n), z(n);
+    std::vector<double> course1(n), course2(n), distance(n);
+    for (size_t i = 0; i < n; ++i) {
+        lonDeg[i] = geod[i].getLongitudeDeg();
+        latDeg[i] = geod[i].getLatitudeDeg();
+        elevM[i] = geod[i].getElevationM();
+    }
+
+    std::cout << n << " points, batch kernels: "
+              << SGGeodesy::batchInstructionSet() << std::endl;
+    std::cout << std::left << std::setw(24) << "Mpoints/s" << std::right
+              << std::setw(10) << "single" << std::setw(10) << "batch"
+              << std::setw(10) << "speedup" << std::endl;
+
+    double single = timeIt([&] {
+        for (size_t i = 0; i < n; ++i)
+            SGGeodesy::SGGeodToCart(geod[i], cart[i]);
+    });
+    double batch = timeIt([&] { SGGeodesy::SGGeodToCart(geod.data(), cart2.data(), n); });
+    report("SGGeodToCart", n, single, batch);
+    batch = timeIt([&] {
+        SGGeodesy::SGGeodToCart(lonDeg.data(), latDeg.data(), elevM.data(),
+                                x.data(), y.data(), z.data(), n);
+    });
+    report("SGGeodToCart (SoA)", n, single, batch);
+
+    single = timeIt([&] {
+        for (size_t i = 0; i < n; ++i)
+            SGGeodesy::SGCartToGeod(cart[i], result[i]);
+    });
+    batch = timeIt([&] { SGGeodesy::SGCartToGeod(cart.data(), result.data(), n); });
+    report("SGCartToGeod", n, single, batch);
+    batch = timeIt([&] {
+        SGGeodesy::SGCartToGeod(x.data(), y.data(), z.data(),
+                                lonDeg.data(), latDeg.data(), elevM.data(), n);
+    });
+    report("SGCartToGeod (SoA)", n, single, batch);
+
+    single = timeIt([&] {
+        for (size_t i = 0; i < n; ++i)
+            SGGeodesy::inverse(geod[i], geod2[i], course1[i], course2[i], distance[i]);
+    });
+    batch = timeIt([&] {
+        SGGeodesy::inverse(geod.data(), geod2.data(), course1.data(),
+                           course2.data(), distance.data(), n);
+    });
+    report("inverse", n, single, batch);
+
+    single = timeIt([&] {
+        for (size_t i = 0; i < n; ++i)
+            distance[i] = SGGeodesy::distanceM(geod[i], geod2[i]);
+    });
+    batch = timeIt([&] { SGGeodesy::distanceM(geod.data(), geod2.data(), distance.data(), n); });
+    report("distanceM", n, single, batch);
+
+    single = timeIt([&] {
+        for (size_t i = 0; i < n; ++i)
+            SGGeodesy::direct(geod[i], course1[i], distance[i], result[i], course2[i]);
+    });
+    batch = timeIt([&] {
+        SGGeodesy::direct(geod.data(), course1.data(), distance.data(),
+                          result.data(), course2.data(), n);
+    });
+    report("direct", n, single, batch);
+
+    return EXIT_SUCCESS;
+}
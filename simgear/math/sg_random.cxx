@@ -44,6 +44,8 @@
 #include <stdlib.h>         // for random(), srandom()
 #include <time.h>           // for time() to seed srandom()        
 
+#include <mutex>
+
 #include "sg_random.hxx"
 
 // Structure for the random number functions.
@@ -119,7 +121,7 @@ const int PC_MAP_X  =     251; /* = modulo for noise map in x direction */
 const int PC_MAP_Y  =     257; /* = modulo for noise map in y direction */
 const int PC_MAP_I  =      16; /* = number of indices for each [x;y] location */
 
-static bool   pc_initialised = false;
+static std::once_flag pc_initialised;
 static int    pc_int32[PC_SIZE];
 static double pc_uniform[PC_SIZE];
 static double pc_normal[PC_SIZE];
@@ -143,8 +145,6 @@ static void pc_precompute_numbers() {
         }
 
     }
-
-    pc_initialised = true;
 }
 
 /**
@@ -152,9 +152,9 @@ static void pc_precompute_numbers() {
  */
 void pc_init(unsigned int seed) {
 
-    if (!pc_initialised) {
-        pc_precompute_numbers();
-    }
+    // pc_init() is called from several threads loading scenery at once,
+    // the tables are filled by the first one and shared
+    std::call_once(pc_initialised, pc_precompute_numbers);
 
     // https://stackoverflow.com/questions/664014/what-integer-hash-function-are-good-that-accepts-an-integer-hash-key
 
@@ -0,0 +1,342 @@
+// DiskCache.cxx - size limited cache of generated data on disk
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include "DiskCache.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/sg_hash.hxx>
+#include <simgear/misc/strutils.hxx>
+
+namespace simgear
+{
+
+namespace
+{
+
+const char* EntryExtension = "cache";
+
+std::string entryName(const std::string& key)
+{
+    sha1nfo info;
+    sha1_init(&info);
+    sha1_write(&info, key.data(), key.size());
+    return strutils::encodeHex(sha1_result(&info), HASH_LENGTH);
+}
+
+bool readFile(const SGPath& path, std::string& data)
+{
+    sg_ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return !file.bad();
+}
+
+} // anonymous namespace
+
+class DiskCache::Index
+{
+public:
+    Index(const SGPath& dir, size_t maxSize) :
+        _dir(dir),
+        _maxSize(maxSize)
+    {
+        scan();
+    }
+
+    // entries are kept in a sub-directory named after the first two
+    // characters of their name, like the texture cache
+    SGPath entryPath(const std::string& name) const
+    {
+        return _dir / name.substr(0, 2) / (name + "." + EntryExtension);
+    }
+
+    bool read(const std::string& key, std::string& data)
+    {
+        const std::string name = entryName(key);
+        SGPath path;
+        size_t size = 0;
+        unsigned generation = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto it = _entries.find(name);
+            if (it == _entries.end()) {
+                ++_stats.misses;
+                return false;
+            }
+            path = entryPath(name);
+            size = it->second->size;
+            generation = it->second->generation;
+        }
+
+        if (!readFile(path, data) || (data.size() != size)) {
+            SG_LOG(SG_IO, SG_WARN, "DiskCache: unable to read " << path);
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_stats.errors;
+            ++_stats.misses;
+            // unless it was replaced meanwhile
+            auto it = _entries.find(name);
+            if ((it != _entries.end()) && (it->second->generation == generation)) {
+                erase(name);
+            }
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_stats.hits;
+            auto it = _entries.find(name);
+            if (it != _entries.end()) {
+                _lru.splice(_lru.begin(), _lru, it->second);
+            }
+        }
+
+        // keep the order of use for the next session
+        path.touch();
+        return true;
+    }
+
+    bool write(const std::string& key, const std::string& data)
+    {
+        if (data.size() > maxSize()) {
+            return false;
+        }
+
+        const std::string name = entryName(key);
+        const SGPath path = entryPath(name);
+        const SGPath tempPath = path.dirPath() /
+            (name + "." + std::to_string(++_tempCounter) + ".tmp");
+
+        Dir dir(path.dirPath());
+        if (!dir.exists()) {
+            dir.create(0755);
+        }
+
+        bool ok = false;
+        {
+            sg_ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (file.is_open()) {
+                file.write(data.data(), data.size());
+                file.close();
+                ok = !file.fail();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (ok) {
+            erase(name);
+            ok = SGPath(tempPath).rename(path);
+        }
+
+        if (!ok) {
+            SG_LOG(SG_IO, SG_WARN, "DiskCache: unable to write " << path);
+            SGPath(tempPath).remove();
+            ++_stats.errors;
+            return false;
+        }
+
+        insert(name, data.size());
+        ++_stats.writes;
+        evict();
+        return true;
+    }
+
+    bool remove(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return erase(entryName(key));
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        while (!_lru.empty()) {
+            erase(_lru.back().name);
+        }
+    }
+
+    void setMaxSize(size_t maxSize)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _maxSize = maxSize;
+        evict();
+    }
+
+    size_t maxSize() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _maxSize;
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _size;
+    }
+
+    unsigned count() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return static_cast<unsigned>(_entries.size());
+    }
+
+    Stats stats() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _stats;
+    }
+
+    const SGPath _dir;
+
+private:
+    struct Entry
+    {
+        std::string name;
+        size_t size;
+        unsigned generation;
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    // pick up the entries of a previous session, most recently used first
+    void scan()
+    {
+        std::vector<std::tuple<time_t, std::string, size_t>> found;
+        for (const auto& sub : Dir(_dir).children(Dir::TYPE_DIR | Dir::NO_DOT_OR_DOTDOT)) {
+            for (auto file : Dir(sub).children(Dir::TYPE_FILE)) {
+                if (file.extension() == "tmp") {
+                    // left behind by an interrupted write
+                    file.remove();
+                } else if (file.extension() == EntryExtension) {
+                    found.emplace_back(file.modTime(), file.file_base(), file.sizeInBytes());
+                }
+            }
+        }
+
+        std::sort(found.begin(), found.end(), [](const auto& a, const auto& b) {
+            return std::get<0>(a) > std::get<0>(b);
+        });
+
+        for (const auto& f : found) {
+            _lru.push_back({std::get<1>(f), std::get<2>(f), ++_generation});
+            _entries[std::get<1>(f)] = std::prev(_lru.end());
+            _size += std::get<2>(f);
+        }
+
+        evict();
+    }
+
+    void insert(const std::string& name, size_t size)
+    {
+        _lru.push_front({name, size, ++_generation});
+        _entries[name] = _lru.begin();
+        _size += size;
+    }
+
+    bool erase(const std::string& name)
+    {
+        auto it = _entries.find(name);
+        if (it == _entries.end()) {
+            return false;
+        }
+
+        SGPath path = entryPath(name);
+        path.remove();
+        _size -= it->second->size;
+        _lru.erase(it->second);
+        _entries.erase(it);
+        return true;
+    }
+
+    void evict()
+    {
+        while ((_size > _maxSize) && !_lru.empty()) {
+            erase(_lru.back().name);
+            ++_stats.evictions;
+        }
+    }
+
+    mutable std::mutex _mutex;
+    size_t _maxSize;
+    size_t _size = 0;
+    EntryList _lru; ///< most recently used first
+    std::unordered_map<std::string, EntryList::iterator> _entries;
+    unsigned _generation = 0;
+    std::atomic<unsigned> _tempCounter{0};
+    Stats _stats;
+};
+
+DiskCache::DiskCache(const SGPath& dir, size_t maxSize) :
+    _index(new Index(dir, maxSize))
+{
+}
+
+DiskCache::~DiskCache() = default;
+
+const SGPath& DiskCache::path() const
+{
+    return _index->_dir;
+}
+
+void DiskCache::setMaxSize(size_t maxSize)
+{
+    _index->setMaxSize(maxSize);
+}
+
+size_t DiskCache::maxSize() const
+{
+    return _index->maxSize();
+}
+
+size_t DiskCache::size() const
+{
+    return _index->size();
+}
+
+unsigned DiskCache::count() const
+{
+    return _index->count();
+}
+
+bool DiskCache::read(const std::string& key, std::string& data)
+{
+    return _index->read(key, data);
+}
+
+bool DiskCache::write(const std::string& key, const std::string& data)
+{
+    return _index->write(key, data);
+}
+
+bool DiskCache::remove(const std::string& key)
+{
+    return _index->remove(key);
+}
+
+void DiskCache::clear()
+{
+    _index->clear();
+}
+
+DiskCache::Stats DiskCache::stats() const
+{
+    return _index->stats();
+}
+
+} // of simgear namespace
@@ -0,0 +1,83 @@
+// DiskCache.hxx - size limited cache of generated data on disk
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifndef SG_DISK_CACHE_HXX
+#define SG_DISK_CACHE_HXX
+
+#include <memory>
+#include <string>
+
+#include <simgear/misc/sg_path.hxx>
+
+namespace simgear
+{
+
+/**
+ * Keeps blobs of data in a directory, one file per key, for data which is
+ * expensive to generate and worth keeping between sessions. When the total
+ * size exceeds the limit, the least recently used entries are removed.
+ *
+ * Files are named after the SHA-1 hash of their key, so keys may be of any
+ * length: callers put everything the data depends on into the key, and
+ * changed inputs simply miss the cache. The order of use is kept in the
+ * modification times of the files, so it survives a restart.
+ *
+ * All methods may be called from any thread.
+ */
+class DiskCache
+{
+public:
+    /**
+     * @param dir directory holding the cache, created on first write
+     * @param maxSize limit on the total size of the entries, in bytes
+     */
+    DiskCache(const SGPath& dir, size_t maxSize);
+    ~DiskCache();
+
+    const SGPath& path() const;
+
+    /**
+     * Change the size limit, removing entries if it is exceeded.
+     */
+    void setMaxSize(size_t maxSize);
+    size_t maxSize() const;
+
+    /// total size of all entries, in bytes
+    size_t size() const;
+    unsigned count() const;
+
+    /**
+     * Read the data stored for key, returning false if there is none.
+     */
+    bool read(const std::string& key, std::string& data);
+
+    /**
+     * Store data for key, replacing any previous data. Data larger than
+     * the size limit is not stored.
+     */
+    bool write(const std::string& key, const std::string& data);
+
+    bool remove(const std::string& key);
+
+    /// remove all entries
+    void clear();
+
+    struct Stats
+    {
+        unsigned hits = 0;      ///< successful reads
+        unsigned misses = 0;    ///< reads of keys without an entry
+        unsigned writes = 0;    ///< entries stored
+        unsigned evictions = 0; ///< entries removed for the size limit
+        unsigned errors = 0;    ///< files which could not be read or written
+    };
+
+    Stats stats() const;
+
+private:
+    class Index;
+    std::unique_ptr<Index> _index;
+};
+
+} // of simgear namespace
+
+#endif // of header guard
@@ -0,0 +1,97 @@
+#include <simgear_config.h>
+
+#include <cstdlib>
+#include <string>
+
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+#include "DiskCache.hxx"
+
+using simgear::Dir;
+using simgear::DiskCache;
+
+void test_readWrite()
+{
+    Dir d = Dir::tempDir("DiskCache");
+    d.setRemoveOnDestroy();
+
+    DiskCache cache(d.file("cache"), 1000);
+    std::string data;
+    SG_VERIFY(!cache.read("tile 1", data));
+
+    SG_VERIFY(cache.write("tile 1", std::string(100, 'a')));
+    SG_VERIFY(cache.write("tile 2", std::string("b\0c", 3)));
+    SG_CHECK_EQUAL(cache.count(), 2);
+    SG_CHECK_EQUAL(cache.size(), 103);
+
+    SG_VERIFY(cache.read("tile 1", data));
+    SG_CHECK_EQUAL(data, std::string(100, 'a'));
+    SG_VERIFY(cache.read("tile 2", data));
+    SG_CHECK_EQUAL(data, std::string("b\0c", 3));
+
+    // replace an entry
+    SG_VERIFY(cache.write("tile 1", "x"));
+    SG_VERIFY(cache.read("tile 1", data));
+    SG_CHECK_EQUAL(data, "x");
+    SG_CHECK_EQUAL(cache.size(), 4);
+
+    SG_VERIFY(cache.remove("tile 2"));
+    SG_VERIFY(!cache.read("tile 2", data));
+
+    // larger than the whole cache
+    SG_VERIFY(!cache.write("tile 3", std::string(1001, 'c')));
+
+    DiskCache::Stats stats = cache.stats();
+    SG_CHECK_EQUAL(stats.hits, 3);
+    SG_CHECK_EQUAL(stats.misses, 2);
+    SG_CHECK_EQUAL(stats.writes, 3);
+    SG_CHECK_EQUAL(stats.evictions, 0);
+
+    // entries survive a restart
+    DiskCache reopened(d.file("cache"), 1000);
+    SG_CHECK_EQUAL(reopened.count(), 1);
+    SG_VERIFY(reopened.read("tile 1", data));
+    SG_CHECK_EQUAL(data, "x");
+}
+
+void test_evict()
+{
+    Dir d = Dir::tempDir("DiskCache");
+    d.setRemoveOnDestroy();
+
+    DiskCache cache(d.path(), 300);
+    std::string data;
+    SG_VERIFY(cache.write("a", std::string(100, 'a')));
+    SG_VERIFY(cache.write("b", std::string(100, 'b')));
+    SG_VERIFY(cache.write("c", std::string(100, 'c')));
+
+    // a is used again, so b is the least recently used
+    SG_VERIFY(cache.read("a", data));
+    SG_VERIFY(cache.write("d", std::string(100, 'd')));
+    SG_CHECK_EQUAL(cache.count(), 3);
+    SG_VERIFY(!cache.read("b", data));
+    SG_VERIFY(cache.read("a", data));
+    SG_VERIFY(cache.read("c", data));
+    SG_VERIFY(cache.read("d", data));
+    SG_CHECK_EQUAL(cache.stats().evictions, 1);
+
+    // lowering the limit evicts in order of use: a, then c
+    cache.setMaxSize(150);
+    SG_CHECK_EQUAL(cache.count(), 1);
+    SG_CHECK_EQUAL(cache.size(), 100);
+    SG_VERIFY(cache.read("d", data));
+    SG_CHECK_EQUAL(cache.stats().evictions, 3);
+
+    cache.clear();
+    SG_CHECK_EQUAL(cache.count(), 0);
+    SG_VERIFY(!cache.read("d", data));
+    SG_VERIFY(DiskCache(d.path(), 300).count() == 0);
+}
+
+int main(int argc, char* argv[])
+{
+    test_readWrite();
+    test_evict();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+// IndexedPathProvider.cxx - resolve resources against indexed directories
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include "IndexedPathProvider.hxx"
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <unordered_map>
+
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/strutils.hxx>
+
+namespace simgear
+{
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+// Directories changed this recently may change again within the resolution
+// of their modification time, so their listings are always read again.
+const time_t RecentChangeSeconds = 2;
+
+std::string entryKey(const std::string& name)
+{
+#if defined(SG_WINDOWS) || defined(SG_MAC)
+    // case insensitive file systems
+    return strutils::lowercase(name);
+#else
+    return name;
+#endif
+}
+
+} // anonymous namespace
+
+class IndexedPathProvider::Index
+{
+public:
+    explicit Index(const SGPath& base) :
+        _base(base)
+    {
+    }
+
+    bool exists(const std::string& resource)
+    {
+        if (resource.find('\\') != std::string::npos || hasParentReference(resource)) {
+            ++_uncached;
+            return SGPath(_base, resource).exists();
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::string dir;
+        const Listing* listing = getListing(dir);
+        size_t begin = 0;
+        while (listing && begin <= resource.size()) {
+            size_t end = resource.find('/', begin);
+            if (end == std::string::npos)
+                end = resource.size();
+            const size_t length = end - begin;
+            if (length == 0 || (length == 1 && resource[begin] == '.')) {
+                begin = end + 1;
+                continue;
+            }
+
+            _name.assign(resource, begin, length);
+            auto it = listing->entries.find(entryKey(_name));
+            if (it == listing->entries.end()) {
+                listing = nullptr;
+                break;
+            }
+
+            begin = end + 1;
+            if (begin > resource.size())
+                break; // the last name, a file or a directory
+            if (!it->second) {
+                listing = nullptr;
+                break;
+            }
+
+            if (!dir.empty())
+                dir += '/';
+            dir += _name;
+            listing = getListing(dir);
+        }
+
+        if (!listing) {
+            ++_notFound;
+            return false;
+        }
+
+        ++_found;
+        return true;
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _listings.clear();
+    }
+
+    const SGPath _base;
+    std::atomic<double> _recheckInterval{2.0};
+
+    std::atomic<unsigned> _found{0};
+    std::atomic<unsigned> _notFound{0};
+    std::atomic<unsigned> _uncached{0};
+    std::atomic<unsigned> _listingsRead{0};
+    std::atomic<unsigned> _rechecks{0};
+
+private:
+    struct Listing
+    {
+        // entry name to whether it is a directory
+        std::unordered_map<std::string, bool> entries;
+        time_t modTime = 0;
+        bool recent = false;
+        Clock::time_point checked;
+    };
+
+    static bool hasParentReference(const std::string& resource)
+    {
+        for (size_t pos = resource.find(".."); pos != std::string::npos;
+             pos = resource.find("..", pos + 1)) {
+            if ((pos == 0 || resource[pos - 1] == '/') &&
+                (pos + 2 == resource.size() || resource[pos + 2] == '/'))
+                return true;
+        }
+        return false;
+    }
+
+    SGPath dirPath(const std::string& dir) const
+    {
+        return dir.empty() ? _base : SGPath(_base, dir);
+    }
+
+    const Listing* getListing(const std::string& dir)
+    {
+        auto it = _listings.find(dir);
+        if (it == _listings.end())
+            return readListing(dir);
+
+        Listing& listing = it->second;
+        const Clock::time_point now = Clock::now();
+        if (std::chrono::duration<double>(now - listing.checked).count() < _recheckInterval)
+            return &listing;
+
+        ++_rechecks;
+        listing.checked = now;
+        if (!listing.recent && dirPath(dir).modTime() == listing.modTime)
+            return &listing;
+
+        _listings.erase(it);
+        return readListing(dir);
+    }
+
+    const Listing* readListing(const std::string& dir)
+    {
+        Dir d(dirPath(dir));
+        if (!d.exists())
+            return nullptr;
+
+        ++_listingsRead;
+        Listing& listing = _listings[dir];
+        listing.modTime = d.path().modTime();
+        listing.recent = time(nullptr) - listing.modTime <= RecentChangeSeconds;
+        listing.checked = Clock::now();
+
+        for (const SGPath& p : d.children(Dir::TYPE_FILE | Dir::INCLUDE_HIDDEN))
+            listing.entries[entryKey(p.file())] = false;
+        for (const SGPath& p : d.children(Dir::TYPE_DIR | Dir::NO_DOT_OR_DOTDOT |
+                                          Dir::INCLUDE_HIDDEN))
+            listing.entries[entryKey(p.file())] = true;
+        return &listing;
+    }
+
+    std::mutex _mutex;
+    std::string _name;
+    // listings by path relative to the base, "" for the base itself
+    std::unordered_map<std::string, Listing> _listings;
+};
+
+IndexedPathProvider::IndexedPathProvider(const SGPath& aBase,
+                                         ResourceManager::Priority aPriority) :
+    ResourceProvider(aPriority),
+    _index(new Index(aBase))
+{
+}
+
+IndexedPathProvider::~IndexedPathProvider()
+{
+}
+
+SGPath IndexedPathProvider::resolve(const std::string& aResource, SGPath&) const
+{
+    return _index->exists(aResource) ? SGPath(_index->_base, aResource) : SGPath();
+}
+
+void IndexedPathProvider::refresh()
+{
+    _index->clear();
+}
+
+void IndexedPathProvider::setRecheckInterval(double seconds)
+{
+    _index->_recheckInterval = seconds;
+}
+
+IndexedPathProvider::Stats IndexedPathProvider::stats() const
+{
+    Stats s;
+    s.found = _index->_found;
+    s.notFound = _index->_notFound;
+    s.uncached = _index->_uncached;
+    s.lookups = s.found + s.notFound + s.uncached;
+    s.listings = _index->_listingsRead;
+    s.rechecks = _index->_rechecks;
+    return s;
+}
+
+} // of namespace simgear
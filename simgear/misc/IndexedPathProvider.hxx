@@ -0,0 +1,66 @@
+// IndexedPathProvider.hxx - resolve resources against indexed directories
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifndef SG_INDEXED_PATH_PROVIDER_HXX
+#define SG_INDEXED_PATH_PROVIDER_HXX
+
+#include <memory>
+#include <string>
+
+#include <simgear/misc/ResourceManager.hxx>
+
+namespace simgear
+{
+
+/**
+ * Resource provider for a fixed base path, like addBasePath(), which keeps
+ * the listings of the directories it has looked into. Lookups are answered
+ * from memory instead of calling stat() for every candidate, which matters
+ * when many base paths are searched in turn.
+ *
+ * Directories are listed on first use. A listing is read again after
+ * refresh(), or when the modification time of the directory changed; the
+ * latter is only checked once per recheck interval.
+ *
+ * Resource names containing '..' are resolved through the file system.
+ */
+class IndexedPathProvider : public ResourceProvider
+{
+public:
+    IndexedPathProvider(const SGPath& aBase,
+                        ResourceManager::Priority aPriority = ResourceManager::PRIORITY_DEFAULT);
+    ~IndexedPathProvider();
+
+    SGPath resolve(const std::string& aResource, SGPath& aContext) const override;
+
+    /**
+     * Drop all directory listings.
+     */
+    void refresh();
+
+    /**
+     * Minimum time between checks of the modification time of a listed
+     * directory, in seconds. With 0 every lookup checks. Default is 2.
+     */
+    void setRecheckInterval(double seconds);
+
+    struct Stats
+    {
+        unsigned lookups = 0;   ///< calls to resolve()
+        unsigned found = 0;     ///< resolved from the index
+        unsigned notFound = 0;  ///< rejected from the index
+        unsigned uncached = 0;  ///< resolved through the file system
+        unsigned listings = 0;  ///< directories read
+        unsigned rechecks = 0;  ///< modification time checks
+    };
+
+    Stats stats() const;
+
+private:
+    class Index;
+    std::unique_ptr<Index> _index;
+};
+
+} // of simgear namespace
+
+#endif // of header guard
@@ -0,0 +1,88 @@
+#include <simgear_config.h>
+
+#include <cstdlib>
+
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/test_macros.hxx>
+
+#include "IndexedPathProvider.hxx"
+
+using simgear::Dir;
+using simgear::IndexedPathProvider;
+
+static void touch(const SGPath& path)
+{
+    sg_ofstream file(path);
+}
+
+void test_resolve()
+{
+    Dir d = Dir::tempDir("IndexedPathProvider");
+    d.setRemoveOnDestroy();
+    Dir(d.file("Models/Textures")).create(0755);
+    touch(d.file("Models/Textures/a.png"));
+    touch(d.file("Models/b.ac"));
+
+    IndexedPathProvider provider(d.path());
+    SGPath context;
+    SG_CHECK_EQUAL(provider.resolve("Models/Textures/a.png", context),
+                   SGPath(d.path(), "Models/Textures/a.png"));
+    SG_CHECK_EQUAL(provider.resolve("Models/b.ac", context), SGPath(d.path(), "Models/b.ac"));
+    SG_CHECK_EQUAL(provider.resolve("Models//./b.ac", context),
+                   SGPath(d.path(), "Models//./b.ac"));
+    SG_CHECK_EQUAL(provider.resolve("Models/Textures", context),
+                   SGPath(d.path(), "Models/Textures"));
+    SG_VERIFY(provider.resolve("Models/c.ac", context).isNull());
+    SG_VERIFY(provider.resolve("Models/b.ac/x", context).isNull());
+    SG_VERIFY(provider.resolve("Other/b.ac", context).isNull());
+
+    IndexedPathProvider::Stats stats = provider.stats();
+    SG_CHECK_EQUAL(stats.lookups, 7);
+    SG_CHECK_EQUAL(stats.found, 4);
+    SG_CHECK_EQUAL(stats.notFound, 3);
+    SG_CHECK_EQUAL(stats.listings, 3);
+
+    // through the file system
+    SG_CHECK_EQUAL(provider.resolve("Models/Textures/../b.ac", context),
+                   SGPath(d.path(), "Models/Textures/../b.ac"));
+    SG_CHECK_EQUAL(provider.stats().uncached, 1);
+
+    // no base directory
+    IndexedPathProvider missing(d.file("missing"));
+    SG_VERIFY(missing.resolve("Models/b.ac", context).isNull());
+}
+
+void test_invalidate()
+{
+    Dir d = Dir::tempDir("IndexedPathProvider");
+    d.setRemoveOnDestroy();
+    touch(d.file("a.xml"));
+
+    IndexedPathProvider provider(d.path());
+    provider.setRecheckInterval(1000);
+    SGPath context;
+    SG_VERIFY(provider.resolve("b.xml", context).isNull());
+
+    // the listing is kept until the next check
+    touch(d.file("b.xml"));
+    SG_VERIFY(provider.resolve("b.xml", context).isNull());
+
+    provider.refresh();
+    SG_VERIFY(!provider.resolve("b.xml", context).isNull());
+
+    // checks on every lookup
+    provider.setRecheckInterval(0);
+    touch(d.file("c.xml"));
+    SG_VERIFY(!provider.resolve("c.xml", context).isNull());
+    d.file("c.xml").remove();
+    SG_VERIFY(provider.resolve("c.xml", context).isNull());
+    SG_VERIFY(provider.stats().rechecks >= 2);
+}
+
+int main(int argc, char* argv[])
+{
+    test_resolve();
+    test_invalidate();
+    return EXIT_SUCCESS;
+}
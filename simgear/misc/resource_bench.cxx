@@ -0,0 +1,109 @@
+// resource_bench - compare ResourceManager lookups with and without an index
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/misc/IndexedPathProvider.hxx>
+#include <simgear/misc/ResourceManager.hxx>
+#include <simgear/misc/sg_dir.hxx>
+
+using namespace simgear;
+
+namespace {
+
+// Base paths, like the aircraft, scenery and data directories
+const int NumBases = 20;
+const int DirsPerBase = 20;
+const int FilesPerDir = 50;
+
+std::string textureName(int dir, int file)
+{
+    return "Models/Dir" + std::to_string(dir) + "/Textures/t" + std::to_string(file) + ".png";
+}
+
+double lookupAll(const std::vector<std::string>& names, int rounds, int& found)
+{
+    auto start = std::chrono::steady_clock::now();
+    found = 0;
+    for (int r = 0; r < rounds; ++r) {
+        for (const std::string& name : names) {
+            if (!ResourceManager::instance()->findPath(name).isNull())
+                ++found;
+        }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int rounds = argc > 1 ? std::atoi(argv[1]) : 5;
+
+    Dir root = Dir::tempDir("resource_bench");
+    root.setRemoveOnDestroy();
+
+    // every base has the directory layout, only the last one the textures
+    std::vector<SGPath> bases;
+    for (int b = 0; b < NumBases; ++b) {
+        SGPath base = root.file("base" + std::to_string(b));
+        for (int d = 0; d < DirsPerBase; ++d) {
+            Dir(SGPath(base, "Models/Dir" + std::to_string(d) + "/Textures")).create(0755);
+            if (b + 1 == NumBases) {
+                for (int f = 0; f < FilesPerDir; ++f)
+                    sg_ofstream file(SGPath(base, textureName(d, f)));
+            }
+        }
+        bases.push_back(base);
+    }
+
+    std::vector<std::string> names;
+    for (int d = 0; d < DirsPerBase; ++d) {
+        for (int f = 0; f < FilesPerDir; ++f)
+            names.push_back(textureName(d, f));
+        names.push_back(textureName(d, FilesPerDir)); // missing
+    }
+
+    std::cout << NumBases << " base paths, " << names.size() << " names, "
+              << rounds << " rounds" << std::endl;
+
+    int found;
+    for (const SGPath& base : bases)
+        ResourceManager::instance()->addBasePath(base);
+    double t = lookupAll(names, rounds, found);
+    std::cout << "base paths:    " << t * 1e3 << " ms, " << found << " found" << std::endl;
+    ResourceManager::reset();
+
+    std::vector<IndexedPathProvider*> providers;
+    for (const SGPath& base : bases) {
+        providers.push_back(new IndexedPathProvider(base));
+        ResourceManager::instance()->addProvider(providers.back());
+    }
+    t = lookupAll(names, 1, found);
+    std::cout << "indexed, cold: " << t * 1e3 << " ms, " << found << " found" << std::endl;
+    t = lookupAll(names, rounds, found);
+    std::cout << "indexed, warm: " << t * 1e3 << " ms, " << found << " found" << std::endl;
+
+    IndexedPathProvider::Stats total;
+    for (IndexedPathProvider* p : providers) {
+        IndexedPathProvider::Stats s = p->stats();
+        total.lookups += s.lookups;
+        total.found += s.found;
+        total.notFound += s.notFound;
+        total.listings += s.listings;
+        total.rechecks += s.rechecks;
+    }
+    std::cout << "lookups " << total.lookups << ", found " << total.found
+              << ", not found " << total.notFound << ", listings " << total.listings
+              << ", rechecks " << total.rechecks << std::endl;
+
+    ResourceManager::reset();
+    return EXIT_SUCCESS;
+}
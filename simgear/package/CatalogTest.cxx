@@ -19,14 +19,17 @@
 
 #include <simgear/misc/test_macros.hxx>
 
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
 #include <fstream>
+#include <map>
 
 #include <simgear/package/Catalog.hxx>
 #include <simgear/package/Root.hxx>
 #include <simgear/package/Package.hxx>
 #include <simgear/package/Install.hxx>
+#include <simgear/package/DeltaManifest.hxx>
 
 #include <simgear/misc/test_macros.hxx>
 #include <simgear/misc/sg_dir.hxx>
@@ -35,6 +38,7 @@
 #include <simgear/io/test_HTTP.hxx>
 #include <simgear/io/HTTPClient.hxx>
 #include <simgear/io/sg_file.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
 #include <simgear/structure/exception.hxx>
 
 using namespace simgear;
@@ -58,6 +62,9 @@ std::string readFileIntoString(const SGPath& path)
 }
 
 SGPath global_serverFilesRoot;
+SGPath global_deltaFilesRoot;
+std::string global_deltaManifestHash;
+int global_rangeRequestCount = 0;
 unsigned int global_catalogVersion = 0;
 bool global_failRequests = false;
 bool global_fail747Request = true;
@@ -117,6 +124,12 @@ public:
             path = "/catalogTest1/b737.tar.gz";
         }
         
+        // delta manifests and chunk stores are generated by the test
+        if (path.find("/catalogTest1/delta/") == 0) {
+            localPath = global_deltaFilesRoot;
+            path = path.substr(19);
+        }
+
         localPath.append(path);
 
       //  SG_LOG(SG_IO, SG_INFO, "local path is:" << localPath.str());
@@ -124,7 +137,29 @@ public:
         if (localPath.exists()) {
             std::string content = readFileIntoString(localPath);
             std::stringstream d;
-            d << "HTTP/1.1 " << 200 << " " << reasonForCode(200) << "\r\n";
+
+            const std::string hashPlaceholder = "@DELTA_MANIFEST_SHA1@";
+            const size_t hashPos = content.find(hashPlaceholder);
+            if (hashPos != std::string::npos) {
+                content.replace(hashPos, hashPlaceholder.size(), global_deltaManifestHash);
+            }
+
+            // only the single 'bytes=first-last' form used by the installer
+            auto range = requestHeaders.find("Range");
+            size_t first = 0, last = 0;
+            if ((range != requestHeaders.end()) &&
+                (sscanf(range->second.c_str(), "bytes=%zu-%zu", &first, &last) == 2) &&
+                (first <= last) && (last < content.size()))
+            {
+                ++global_rangeRequestCount;
+                std::string total = std::to_string(content.size());
+                content = content.substr(first, last - first + 1);
+                d << "HTTP/1.1 206 Partial Content\r\n";
+                d << "Content-Range: bytes " << first << "-" << last << "/" << total << "\r\n";
+            } else {
+                d << "HTTP/1.1 " << 200 << " " << reasonForCode(200) << "\r\n";
+            }
+
             d << "Content-Length:" << content.size() << "\r\n";
             d << "\r\n"; // final CRLF to terminate the headers
             d << content;
@@ -1337,6 +1372,183 @@ void testProvides(HTTP::Client* cl)
     SG_CHECK_EQUAL(packages.front()->qualifiedId(), "org.flightgear.test.catalog1.movies");
 }
 
+// deterministic content for the files only the delta update knows about
+std::string makeDeltaTestData(size_t size, bool modified)
+{
+    std::string data(size, '\0');
+    uint32_t x = 12345;
+    for (auto& c : data) {
+        x = x * 1664525 + 1013904223;
+        c = static_cast<char>(x >> 24);
+    }
+
+    if (modified) {
+        data.replace(100000, 10, "0123456789");
+    }
+    return data;
+}
+
+void writeDeltaTestFile(const SGPath& path, const std::string& data)
+{
+    simgear::Dir d(path.dir());
+    if (!d.exists()) {
+        d.create(0755);
+    }
+
+    sg_ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    f << data;
+}
+
+// installs revision 42 of the c172p, then updates it from the catalog with
+// the delta manifest, expecting the archive to be downloaded instead
+pkg::InstallRef updateWithoutDelta(HTTP::Client* cl, const std::string& dir)
+{
+    SGPath rootPath(simgear::Dir::current().path());
+    rootPath.append(dir);
+    simgear::Dir(rootPath).removeChildren();
+
+    global_catalogVersion = 0;
+    pkg::RootRef root(new pkg::Root(rootPath, "8.1.2"));
+    root->setHTTPClient(cl);
+    pkg::Catalog::createFromUrl(root.ptr(), "http://localhost:2000/catalogTest1/catalog.xml");
+    waitForUpdateComplete(cl, root);
+
+    pkg::InstallRef ins = root->getPackageById("c172p")->install();
+    waitForUpdateComplete(cl, root);
+
+    global_catalogVersion = 3;
+    root->refresh(true);
+    waitForUpdateComplete(cl, root);
+    root->scheduleToUpdate(ins);
+    waitForUpdateComplete(cl, root);
+
+    SG_CHECK_EQUAL(ins->status(), pkg::Delegate::STATUS_SUCCESS);
+    SG_CHECK_EQUAL(ins->revsion(), 43u);
+    SG_VERIFY(!ins->transferStats().delta);
+    SG_VERIFY((ins->path() / "c172p-set.xml").exists());
+    return ins;
+}
+
+void testDeltaInstall(HTTP::Client* cl)
+{
+    global_catalogVersion = 0;
+
+    SGPath rootPath(simgear::Dir::current().path());
+    rootPath.append("pkg_delta_install");
+    simgear::Dir pd(rootPath);
+    pd.removeChildren();
+
+    pkg::RootRef root(new pkg::Root(rootPath, "8.1.2"));
+    root->setHTTPClient(cl);
+
+    pkg::CatalogRef c = pkg::Catalog::createFromUrl(root.ptr(), "http://localhost:2000/catalogTest1/catalog.xml");
+    waitForUpdateComplete(cl, root);
+
+    pkg::PackageRef p1 = root->getPackageById("org.flightgear.test.catalog1.c172p");
+    pkg::InstallRef ins = p1->install();
+    waitForUpdateComplete(cl, root);
+    SG_CHECK_EQUAL(ins->status(), pkg::Delegate::STATUS_SUCCESS);
+    SG_VERIFY(!ins->transferStats().delta);
+
+    // a large local file, which the new revision contains with a small change
+    const std::string bigOld = makeDeltaTestData(256 * 1024, false);
+    writeDeltaTestFile(ins->path() / "Models/big.bin", bigOld);
+
+    // the new revision: one file edited, one added, one changed slightly
+    SGPath sourcePath(simgear::Dir::current().path());
+    sourcePath.append("pkg_delta_source");
+    simgear::Dir(sourcePath).removeChildren();
+
+    const SGPath c172pFiles = global_serverFilesRoot / "catalogTest1/c172p";
+    std::map<std::string, std::string> newFiles;
+    newFiles["c172p-set.xml"] = readFileIntoString(c172pFiles / "c172p-set.xml") + "<!-- edited -->\n";
+    newFiles["c172p-floats-set.xml"] = readFileIntoString(c172pFiles / "c172p-floats-set.xml");
+    newFiles["c172p-2d-panel-set.xml"] = readFileIntoString(c172pFiles / "c172p-2d-panel-set.xml");
+    newFiles["Docs/readme.txt"] = "new in revision 43\n";
+    newFiles["Models/big.bin"] = makeDeltaTestData(256 * 1024, true);
+    for (const auto& f : newFiles) {
+        writeDeltaTestFile(sourcePath / f.first, f.second);
+    }
+
+    global_deltaFilesRoot = SGPath(simgear::Dir::current().path()) / "pkg_delta_store";
+    simgear::Dir(global_deltaFilesRoot).removeChildren();
+    simgear::Dir(global_deltaFilesRoot).create(0755);
+
+    // small chunks, since the test server sends at most 16k per response
+    pkg::DeltaManifest::Chunking chunking;
+    chunking.minSize = 1024;
+    chunking.averageSize = 2048;
+    chunking.maxSize = 4096;
+
+    pkg::DeltaManifest manifest;
+    manifest.setChunking(chunking);
+    SG_VERIFY(manifest.build(sourcePath, global_deltaFilesRoot / "c172p.store"));
+    SG_CHECK_EQUAL(manifest.files().size(), newFiles.size());
+    for (const auto& f : manifest.files()) {
+        SG_VERIFY((f.path != "Models/big.bin") || (f.chunks.size() > 40));
+    }
+    const std::string manifestText = manifest.toString();
+    {
+        sg_ofstream f(global_deltaFilesRoot / "c172p.manifest", std::ios::out | std::ios::trunc);
+        f << manifestText;
+    }
+    global_deltaManifestHash = pkg::DeltaManifest::hashData(manifestText.data(), manifestText.size());
+
+    pkg::DeltaManifest parsed;
+    SG_VERIFY(parsed.parse(manifest.toString()));
+    SG_CHECK_EQUAL(parsed.toString(), manifest.toString());
+    SG_CHECK_EQUAL(parsed.chunking().averageSize, 2048u);
+    SG_VERIFY(!parsed.parse("version:1\nstore:x.store\nf:../evil:" + std::string(40, '0') + ":0\n"));
+
+    // catalog with revision 43 and the delta manifest
+    global_catalogVersion = 3;
+    root->refresh(true);
+    waitForUpdateComplete(cl, root);
+    SG_VERIFY(ins->hasUpdate());
+
+    global_rangeRequestCount = 0;
+    root->scheduleToUpdate(ins);
+    waitForUpdateComplete(cl, root);
+
+    SG_CHECK_EQUAL(ins->status(), pkg::Delegate::STATUS_SUCCESS);
+    SG_VERIFY(!ins->hasUpdate());
+    SG_CHECK_EQUAL(ins->revsion(), 43u);
+
+    const pkg::Install::TransferStats& stats = ins->transferStats();
+    SG_VERIFY(stats.delta);
+    SG_CHECK_EQUAL(stats.packageBytes, manifest.totalSize());
+    SG_CHECK_EQUAL(stats.requests, 1u + global_rangeRequestCount);
+    SG_VERIFY(global_rangeRequestCount > 0);
+    SG_VERIFY(stats.reusedBytes > 3 * stats.packageBytes / 4);
+    SG_VERIFY(stats.downloadedBytes < stats.packageBytes / 4);
+    SG_CHECK_EQUAL(ins->downloadedBytes(), static_cast<size_t>(-1)); // finished
+
+    for (const auto& f : newFiles) {
+        SG_CHECK_EQUAL(readFileIntoString(ins->path() / f.first), f.second);
+    }
+
+    // a manifest that doesn't match the catalog's hash is not used
+    {
+        sg_ofstream f(global_deltaFilesRoot / "c172p.manifest", std::ios::out | std::ios::trunc);
+        f << manifestText << "f:Models/extra.bin:" << std::string(40, '0') << ":0\n";
+    }
+    pkg::InstallRef mismatched = updateWithoutDelta(cl, "pkg_delta_mismatch");
+    SG_CHECK_EQUAL(mismatched->transferStats().requests, 2u);
+
+    // without the hash, the manifest isn't even fetched
+    global_deltaManifestHash.clear();
+    pkg::InstallRef unhashed = updateWithoutDelta(cl, "pkg_delta_unhashed");
+    SG_CHECK_EQUAL(unhashed->transferStats().requests, 1u);
+
+    // without the manifest, the update falls back to the archive
+    global_deltaManifestHash = pkg::DeltaManifest::hashData(manifestText.data(), manifestText.size());
+    simgear::Dir(global_deltaFilesRoot).removeChildren();
+    pkg::InstallRef missing = updateWithoutDelta(cl, "pkg_delta_fallback");
+    SG_CHECK_EQUAL(missing->transferStats().requests, 2u);
+
+    global_catalogVersion = 0;
+}
+
 int main(int argc, char* argv[])
 {
     sglog().setLogLevels( SG_ALL, SG_WARN );
@@ -1388,6 +1600,8 @@ int main(int argc, char* argv[])
 
     testProvides(&cl);
 
+    testDeltaInstall(&cl);
+
     cerr << "Successfully passed all tests!" << endl;
     return EXIT_SUCCESS;
 }
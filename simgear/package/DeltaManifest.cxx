@@ -0,0 +1,349 @@
+// DeltaManifest.cxx - chunk manifests for delta package updates
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <simgear/package/DeltaManifest.hxx>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/sg_hash.hxx>
+#include <simgear/misc/strutils.hxx>
+
+namespace simgear {
+
+namespace pkg {
+
+namespace {
+
+// gear hash table: fixed pseudo-random values, since the manifest builder
+// and every installer must cut files at the same places
+struct GearTable
+{
+    GearTable()
+    {
+        uint64_t x = 0x5347504b47444c54ULL;
+        for (int i = 0; i < 256; ++i) {
+            // splitmix64
+            x += 0x9e3779b97f4a7c15ULL;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            values[i] = z ^ (z >> 31);
+        }
+    }
+
+    uint64_t values[256];
+};
+
+const uint64_t* gearTable()
+{
+    static const GearTable table;
+    return table.values;
+}
+
+// length of the chunk starting at data; len is either at least the
+// maximum chunk size or the remainder of the file
+size_t findBoundary(const uint8_t* data, size_t len, const DeltaManifest::Chunking& chunking,
+                    uint64_t mask)
+{
+    if (len <= chunking.minSize) {
+        return len;
+    }
+
+    const uint64_t* gear = gearTable();
+    const size_t end = std::min(len, chunking.maxSize);
+    uint64_t hash = 0;
+    for (size_t i = chunking.minSize - 64; i < end; ++i) {
+        hash = (hash << 1) + gear[data[i]];
+        if ((i >= chunking.minSize) && ((hash & mask) == 0)) {
+            return i + 1;
+        }
+    }
+    return end;
+}
+
+// the top bits of the rolling hash depend on all of the last 64 bytes:
+// testing n of them gives an average chunk of 2^n past the minimum size
+uint64_t boundaryMask(size_t averageSize)
+{
+    int bits = 0;
+    while ((size_t(1) << bits) < averageSize) {
+        ++bits;
+    }
+    return ~uint64_t(0) << (64 - bits);
+}
+
+bool parseSize(const std::string& s, size_t& result)
+{
+    if (s.empty() || (s.find_first_not_of("0123456789") != std::string::npos)) {
+        return false;
+    }
+
+    result = std::strtoull(s.c_str(), nullptr, 10);
+    return true;
+}
+
+bool isValidHash(const std::string& s)
+{
+    return (s.size() == HASH_LENGTH * 2) &&
+        (s.find_first_not_of("0123456789abcdef") == std::string::npos);
+}
+
+// manifests come from the network: never accept a path which could
+// escape the package directory
+bool isSafePath(const std::string& path)
+{
+    if (path.empty() || (path.front() == '/') || (path.find('\\') != std::string::npos) ||
+        (path.find(':') != std::string::npos))
+    {
+        return false;
+    }
+
+    for (const auto& part : strutils::split(path, "/")) {
+        if (part.empty() || (part == ".") || (part == "..")) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void listFiles(const SGPath& dir, const std::string& prefix, string_list& result)
+{
+    const int types = Dir::TYPE_FILE | Dir::TYPE_DIR | Dir::NO_DOT_OR_DOTDOT | Dir::INCLUDE_HIDDEN;
+    for (const auto& p : Dir(dir).children(types)) {
+        const std::string name = prefix + p.file();
+        if (p.isDir()) {
+            listFiles(p, name + "/", result);
+        } else if (name != ".revision") {
+            result.push_back(name);
+        }
+    }
+}
+
+} // of anonymous namespace
+
+bool DeltaManifest::Chunking::isValid() const
+{
+    return (minSize >= 64) && (averageSize >= 64) && (averageSize <= (1 << 30)) &&
+        ((averageSize & (averageSize - 1)) == 0) &&
+        (maxSize >= minSize) && (maxSize <= 64 * 1024 * 1024);
+}
+
+bool DeltaManifest::forEachChunk(const SGPath& file, const Chunking& chunking,
+                                 const ChunkCallback& cb)
+{
+    if (!chunking.isValid()) {
+        return false;
+    }
+
+    sg_ifstream f(file, std::ios::in | std::ios::binary);
+    if (!f.is_open()) {
+        return false;
+    }
+
+    const uint64_t mask = boundaryMask(chunking.averageSize);
+    std::vector<char> buf(chunking.maxSize * 2);
+    size_t have = 0;
+    size_t offset = 0;
+    bool atEnd = false;
+    for (;;) {
+        while (!atEnd && (have < chunking.maxSize)) {
+            f.read(buf.data() + have, buf.size() - have);
+            have += f.gcount();
+            atEnd = !f;
+        }
+
+        if (have == 0) {
+            break;
+        }
+
+        const size_t len = findBoundary(reinterpret_cast<const uint8_t*>(buf.data()), have,
+                                        chunking, mask);
+        cb(buf.data(), offset, len);
+        offset += len;
+        have -= len;
+        memmove(buf.data(), buf.data() + len, have);
+    }
+
+    return !f.bad();
+}
+
+std::string DeltaManifest::hashData(const char* data, size_t size)
+{
+    sha1nfo info;
+    sha1_init(&info);
+    sha1_write(&info, data, size);
+    return strutils::encodeHex(sha1_result(&info), HASH_LENGTH);
+}
+
+bool DeltaManifest::parse(const std::string& text)
+{
+    m_chunking = Chunking();
+    m_storeName.clear();
+    m_files.clear();
+
+    std::istringstream is(text);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(is, line)) {
+        ++lineNumber;
+        line = strutils::strip(line);
+        if (line.empty() || (line[0] == '#')) {
+            continue;
+        }
+
+        bool ok = false;
+        if (lineNumber == 1) {
+            ok = (line == "version:1");
+        } else if (strutils::starts_with(line, "chunking:")) {
+            const string_list parts = strutils::split(line, ":");
+            ok = (parts.size() == 4) && parseSize(parts[1], m_chunking.minSize) &&
+                parseSize(parts[2], m_chunking.averageSize) &&
+                parseSize(parts[3], m_chunking.maxSize) && m_chunking.isValid();
+        } else if (strutils::starts_with(line, "store:")) {
+            m_storeName = line.substr(6);
+            ok = !m_storeName.empty();
+        } else if (strutils::starts_with(line, "f:")) {
+            // paths may not contain ':', but parse from the end anyway
+            const auto sizePos = line.rfind(':');
+            const auto hashPos = line.rfind(':', sizePos - 1);
+            File f;
+            f.path = line.substr(2, hashPos - 2);
+            f.hash = line.substr(hashPos + 1, sizePos - hashPos - 1);
+            ok = (hashPos != std::string::npos) && (hashPos > 2) &&
+                isSafePath(f.path) && isValidHash(f.hash) &&
+                parseSize(line.substr(sizePos + 1), f.size);
+            m_files.push_back(f);
+        } else if (strutils::starts_with(line, "c:") && !m_files.empty()) {
+            const string_list parts = strutils::split(line, ":");
+            Chunk c;
+            ok = (parts.size() == 4) && isValidHash(parts[1]) &&
+                parseSize(parts[2], c.size) && parseSize(parts[3], c.storeOffset);
+            c.hash = parts.size() > 1 ? parts[1] : std::string();
+            m_files.back().chunks.push_back(c);
+        }
+
+        if (!ok) {
+            SG_LOG(SG_GENERAL, SG_WARN, "malformed delta manifest at line " << lineNumber
+                   << ": '" << line << "'");
+            return false;
+        }
+    }
+
+    if (m_storeName.empty()) {
+        SG_LOG(SG_GENERAL, SG_WARN, "delta manifest has no chunk store");
+        return false;
+    }
+
+    for (const auto& f : m_files) {
+        size_t total = 0;
+        for (const auto& c : f.chunks) {
+            total += c.size;
+        }
+
+        if (total != f.size) {
+            SG_LOG(SG_GENERAL, SG_WARN, "delta manifest chunks don't add up for " << f.path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::string DeltaManifest::toString() const
+{
+    std::ostringstream os;
+    os << "version:1\n";
+    os << "chunking:" << m_chunking.minSize << ":" << m_chunking.averageSize
+       << ":" << m_chunking.maxSize << "\n";
+    os << "store:" << m_storeName << "\n";
+    for (const auto& f : m_files) {
+        os << "f:" << f.path << ":" << f.hash << ":" << f.size << "\n";
+        for (const auto& c : f.chunks) {
+            os << "c:" << c.hash << ":" << c.size << ":" << c.storeOffset << "\n";
+        }
+    }
+    return os.str();
+}
+
+bool DeltaManifest::build(const SGPath& dir, const SGPath& storePath)
+{
+    m_storeName = storePath.file();
+    m_files.clear();
+    if (!m_chunking.isValid()) {
+        SG_LOG(SG_GENERAL, SG_WARN, "invalid chunk sizes for delta manifest");
+        return false;
+    }
+
+    string_list paths;
+    listFiles(dir, std::string(), paths);
+    std::sort(paths.begin(), paths.end());
+
+    sg_ofstream store(storePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!store.is_open()) {
+        SG_LOG(SG_GENERAL, SG_WARN, "unable to create chunk store " << storePath);
+        return false;
+    }
+
+    std::map<std::string, size_t> storeOffsets;
+    size_t storeSize = 0;
+    for (const auto& path : paths) {
+        if (!isSafePath(path)) {
+            SG_LOG(SG_GENERAL, SG_WARN, "can't add to delta manifest: " << path);
+            return false;
+        }
+
+        File f;
+        f.path = path;
+        sha1nfo fileHash;
+        sha1_init(&fileHash);
+        bool ok = forEachChunk(dir / path, m_chunking, [&](const char* data, size_t, size_t size) {
+            sha1_write(&fileHash, data, size);
+            Chunk c;
+            c.hash = hashData(data, size);
+            c.size = size;
+
+            auto it = storeOffsets.find(c.hash);
+            if (it == storeOffsets.end()) {
+                store.write(data, size);
+                it = storeOffsets.insert({c.hash, storeSize}).first;
+                storeSize += size;
+            }
+            c.storeOffset = it->second;
+            f.size += size;
+            f.chunks.push_back(c);
+        });
+
+        if (!ok) {
+            SG_LOG(SG_GENERAL, SG_WARN, "unable to read " << (dir / path));
+            return false;
+        }
+
+        f.hash = strutils::encodeHex(sha1_result(&fileHash), HASH_LENGTH);
+        m_files.push_back(f);
+    }
+
+    return !store.fail();
+}
+
+size_t DeltaManifest::totalSize() const
+{
+    size_t total = 0;
+    for (const auto& f : m_files) {
+        total += f.size;
+    }
+    return total;
+}
+
+} // of namespace pkg
+
+} // of namespace simgear
@@ -0,0 +1,121 @@
+// DeltaManifest.hxx - chunk manifests for delta package updates
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifndef SG_PACKAGE_DELTA_MANIFEST_HXX
+#define SG_PACKAGE_DELTA_MANIFEST_HXX
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <simgear/misc/sg_path.hxx>
+
+namespace simgear
+{
+
+namespace pkg
+{
+
+/**
+ * Describes the files of one package revision as content-defined chunks,
+ * so an install of an older revision can fetch only the chunks it does not
+ * already have, using range requests into a chunk store: a single file
+ * holding each distinct chunk once.
+ *
+ * The text form follows the .dirindex files used by HTTPRepository:
+ *
+ *     version:1
+ *     chunking:16384:65536:262144
+ *     store:c172p-43.store
+ *     f:Models/c172p.ac:<sha1>:<size>
+ *     c:<sha1>:<size>:<offset in store>
+ *
+ * with one c: line per chunk, in file order, after each f: line. The store
+ * name is resolved relative to the manifest URL, and the chunking line gives
+ * the minimum, average and maximum chunk sizes.
+ */
+class DeltaManifest
+{
+public:
+    struct Chunk
+    {
+        std::string hash; ///< hex SHA-1 of the chunk data
+        size_t size = 0;
+        size_t storeOffset = 0;
+    };
+
+    struct File
+    {
+        std::string path; ///< relative to the package directory
+        std::string hash; ///< hex SHA-1 of the whole file
+        size_t size = 0;
+        std::vector<Chunk> chunks;
+    };
+
+    /**
+     * Chunk boundaries are placed where a rolling hash of the preceding 64
+     * bytes matches, so editing part of a file only changes the chunks
+     * around the edit. The sizes are recorded in the manifest, since the
+     * installer must split its files in the same way.
+     */
+    struct Chunking
+    {
+        size_t minSize = 16 * 1024;
+        size_t averageSize = 64 * 1024; ///< past the minimum, a power of two
+        size_t maxSize = 256 * 1024;
+
+        bool isValid() const;
+    };
+
+    typedef std::function<void(const char* data, size_t offset, size_t size)> ChunkCallback;
+
+    /**
+     * split a file into content-defined chunks, calling cb for each of them
+     * in order. Returns false if the file could not be read.
+     */
+    static bool forEachChunk(const SGPath& file, const Chunking& chunking,
+                             const ChunkCallback& cb);
+
+    static std::string hashData(const char* data, size_t size);
+
+    /**
+     * parse the text form, rejecting unknown versions and any file paths
+     * which would leave the package directory
+     */
+    bool parse(const std::string& text);
+
+    std::string toString() const;
+
+    /**
+     * chunk every file below dir, writing the distinct chunks to storePath.
+     * The manifest refers to the store by its file name.
+     */
+    bool build(const SGPath& dir, const SGPath& storePath);
+
+    const std::string& storeName() const
+        { return m_storeName; }
+
+    const Chunking& chunking() const
+        { return m_chunking; }
+
+    /// chunk sizes for build(), defaults otherwise
+    void setChunking(const Chunking& chunking)
+        { m_chunking = chunking; }
+
+    const std::vector<File>& files() const
+        { return m_files; }
+
+    /// size of all files, which is what a full download would extract
+    size_t totalSize() const;
+
+private:
+    Chunking m_chunking;
+    std::string m_storeName;
+    std::vector<File> m_files;
+};
+
+} // of namespace pkg
+
+} // of namespace simgear
+
+#endif // of SG_PACKAGE_DELTA_MANIFEST_HXX
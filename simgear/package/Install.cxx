@@ -18,9 +18,13 @@
 #include <simgear_config.h>
 #include <simgear/package/Install.hxx>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <set>
 
 #include <simgear/package/unzip.h>
 #include <simgear/package/md5.h>
@@ -29,11 +33,13 @@
 #include <simgear/structure/exception.hxx>
 #include <simgear/props/props_io.hxx>
 #include <simgear/package/Catalog.hxx>
+#include <simgear/package/DeltaManifest.hxx>
 #include <simgear/package/Package.hxx>
 #include <simgear/package/Root.hxx>
 #include <simgear/io/HTTPRequest.hxx>
 #include <simgear/io/HTTPClient.hxx>
 #include <simgear/misc/sg_dir.hxx>
+#include <simgear/misc/sg_hash.hxx>
 #include <simgear/misc/strutils.hxx>
 #include <simgear/io/iostreams/sgstream.hxx>
 
@@ -112,6 +118,7 @@ protected:
         }
 
 		m_extractor.reset(new ArchiveExtractor(m_extractPath));
+        m_owner->m_transferStats.packageBytes = responseLength();
         memset(&m_md5, 0, sizeof(SG_MD5_CTX));
         SG_MD5Init(&m_md5);
         
@@ -129,6 +136,7 @@ protected:
 		const uint8_t* ubytes = (uint8_t*) s;
         SG_MD5Update(&m_md5, ubytes, n);
         m_downloaded += n;
+        m_owner->m_transferStats.downloadedBytes += n;
         m_owner->installProgress(m_downloaded, responseLength());
 		m_extractor->extractBytes(ubytes, n);
         if (m_extractor->hasError()) {
@@ -171,15 +179,8 @@ protected:
             return;
         }
 
-		// disable caching on the owner's path, otherwise the upcoming
-		// delete & rename confuse everything
-		m_owner->m_path.set_cached(false);
-		m_extractPath.set_cached(false);
-
-        if (m_owner->path().exists()) {
-            Dir destDir(m_owner->path());
-            destDir.remove(true /* recursive */);
-        }
+        // disable caching, the upcoming rename and delete confuse everything
+        m_extractPath.set_cached(false);
 
         // build a path like /path/to/packages/org.some.catalog/Aircraft/extract_xxxx/MyAircraftDir
         SGPath extractedPath = m_extractPath;
@@ -189,10 +190,8 @@ protected:
             extractedPath.append(m_owner->package()->dirName());
         }
 
-
         // rename it to path/to/packages/org.some.catalog/Aircraft/MyAircraftDir
-        bool ok = extractedPath.rename(m_owner->path());
-        if (!ok) {
+        if (!m_owner->replaceFiles(extractedPath)) {
             doFailure(Delegate::FAIL_FILESYSTEM);
             return;
         }
@@ -238,6 +237,7 @@ private:
             // this new request will select one of the other mirrors
             auto retryDownload = new PackageArchiveDownloader(m_owner, m_urls);
             m_owner->m_download.reset(retryDownload);
+            m_owner->m_transferStats.requests++;
             m_owner->package()->catalog()->root()->makeHTTPRequest(retryDownload);
             return;
         }
@@ -256,6 +256,497 @@ private:
 	std::unique_ptr<ArchiveExtractor> m_extractor;
 };
 
+////////////////////////////////////////////////////////////////////
+// Updates an existing install from the package's delta manifest: chunks
+// already present in the installed files are copied, and the missing ones
+// are fetched from the chunk store with range requests. Any problem with
+// the manifest or the store falls back to downloading the archive.
+class Install::DeltaUpdate : public SGReferenced
+{
+public:
+    DeltaUpdate(InstallRef aOwner, const std::string& aManifestUrl,
+                const std::string& aManifestHash) :
+        m_owner(aOwner),
+        m_manifestUrl(aManifestUrl),
+        m_manifestHash(aManifestHash)
+    {
+        m_extractPath = aOwner->path().dir();
+        m_extractPath.append("_delta_" + aOwner->package()->md5());
+        removeExtractDir();
+    }
+
+    ~DeltaUpdate()
+    {
+        m_part.reset();
+        removeExtractDir();
+    }
+
+    void start()
+    {
+        makeRequest(new ManifestRequest(this, m_manifestUrl));
+    }
+
+    size_t downloadedBytes() const
+    {
+        return m_downloaded;
+    }
+
+    int percentDownloaded() const
+    {
+        if (m_fetchTotal == 0) {
+            return 0;
+        }
+
+        return (m_downloaded * 100) / m_fetchTotal;
+    }
+
+private:
+    // neighbouring missing chunks closer than this are fetched with one
+    // request, including the unused bytes between them
+    static const size_t MergeGap = 4096;
+
+    class ManifestRequest : public HTTP::Request
+    {
+    public:
+        ManifestRequest(DeltaUpdate* aUpdate, const std::string& aUrl) :
+            HTTP::Request(aUrl),
+            m_update(aUpdate)
+        {
+        }
+
+    protected:
+        void responseHeadersComplete() override
+        {
+            Request::responseHeadersComplete();
+            m_update->manifestStarted();
+        }
+
+        void gotBodyData(const char* s, int n) override
+        {
+            m_body.append(s, n);
+            m_update->addDownloaded(n);
+        }
+
+        void onDone() override
+        {
+            m_update->manifestDone(responseCode(), m_body);
+        }
+
+        void onFail() override
+        {
+            m_update->requestFailed(responseCode());
+        }
+
+    private:
+        SGSharedPtr<DeltaUpdate> m_update;
+        std::string m_body;
+    };
+
+    class RangeRequest : public HTTP::Request
+    {
+    public:
+        RangeRequest(DeltaUpdate* aUpdate, const std::string& aUrl,
+                     size_t aOffset, size_t aSize) :
+            HTTP::Request(aUrl),
+            m_update(aUpdate)
+        {
+            setRange(std::to_string(aOffset) + "-" + std::to_string(aOffset + aSize - 1));
+        }
+
+    protected:
+        void gotBodyData(const char* s, int n) override
+        {
+            // a server which ignores the range sends the whole store
+            if (responseCode() == 206) {
+                m_update->rangeData(s, n);
+            }
+        }
+
+        void onDone() override
+        {
+            m_update->rangeDone(responseCode());
+        }
+
+        void onFail() override
+        {
+            m_update->requestFailed(responseCode());
+        }
+
+    private:
+        SGSharedPtr<DeltaUpdate> m_update;
+    };
+
+    struct LocalChunk
+    {
+        SGPath file;
+        size_t offset;
+        size_t size;
+    };
+
+    struct Range
+    {
+        size_t storeOffset;
+        size_t size;
+        size_t partOffset; ///< where the range starts in the part file
+    };
+
+    void makeRequest(HTTP::Request* req)
+    {
+        m_owner->m_download.reset(req);
+        m_owner->m_transferStats.requests++;
+        m_owner->package()->catalog()->root()->makeHTTPRequest(req);
+    }
+
+    void manifestStarted()
+    {
+        m_owner->startDownload();
+    }
+
+    void addDownloaded(size_t n)
+    {
+        m_downloaded += n;
+        m_owner->m_transferStats.downloadedBytes += n;
+    }
+
+    void manifestDone(int code, const std::string& body)
+    {
+        if (code != 200) {
+            fallback("manifest download failed: " + std::to_string(code));
+            return;
+        }
+
+        // the manifest decides which local files are trusted, so it must be
+        // the one the catalog names
+        if (DeltaManifest::hashData(body.data(), body.size()) != m_manifestHash) {
+            fallback("manifest hash mismatch");
+            return;
+        }
+
+        if (!m_manifest.parse(body)) {
+            fallback("invalid manifest");
+            return;
+        }
+
+        // chunking the installed files reads all of them, so it runs on the
+        // thread pool instead of blocking other transfers
+        SGSharedPtr<DeltaUpdate> self(this);
+        const SGPath installed = m_owner->path();
+        runInBackground([self, installed] { self->indexLocalFiles(installed); },
+                        [self] { self->localFilesIndexed(); });
+    }
+
+    void localFilesIndexed()
+    {
+        if (cancelled()) {
+            return;
+        }
+
+        planRanges();
+        m_owner->m_transferStats.packageBytes = m_manifest.totalSize();
+
+        if (m_ranges.empty()) {
+            finish();
+            return;
+        }
+
+        Dir d(m_extractPath);
+        if (!d.create(0755)) {
+            fallback("failed to create " + m_extractPath.utf8Str());
+            return;
+        }
+
+        m_partPath = m_extractPath / "_chunks";
+        m_part.reset(new sg_ofstream(m_partPath, std::ios::out | std::ios::binary | std::ios::trunc));
+        m_nextRange = 0;
+        requestNextRange();
+    }
+
+    // chunk the installed files, remembering where to find each chunk the
+    // new revision needs. Runs on the thread pool.
+    void indexLocalFiles(const SGPath& installed)
+    {
+        std::set<std::string> wanted;
+        for (const auto& f : m_manifest.files()) {
+            for (const auto& c : f.chunks) {
+                wanted.insert(c.hash);
+            }
+        }
+
+        std::vector<SGPath> dirs = {installed};
+        while (!dirs.empty()) {
+            Dir d(dirs.back());
+            dirs.pop_back();
+            for (const auto& p : d.children(Dir::TYPE_FILE | Dir::TYPE_DIR | Dir::NO_DOT_OR_DOTDOT)) {
+                if (p.isDir()) {
+                    dirs.push_back(p);
+                    continue;
+                }
+
+                DeltaManifest::forEachChunk(p, m_manifest.chunking(), [&](const char* data, size_t offset, size_t size) {
+                    const std::string hash = DeltaManifest::hashData(data, size);
+                    if (wanted.count(hash) && !m_local.count(hash)) {
+                        m_local[hash] = LocalChunk{p, offset, size};
+                    }
+                });
+            }
+        }
+    }
+
+    void planRanges()
+    {
+        std::map<size_t, size_t> missing; // store offset -> size
+        for (const auto& f : m_manifest.files()) {
+            for (const auto& c : f.chunks) {
+                if (!m_local.count(c.hash)) {
+                    missing[c.storeOffset] = c.size;
+                }
+            }
+        }
+
+        size_t partOffset = 0;
+        for (const auto& m : missing) {
+            if (!m_ranges.empty()) {
+                Range& last = m_ranges.back();
+                const size_t lastEnd = last.storeOffset + last.size;
+                if (m.first <= lastEnd + MergeGap) {
+                    const size_t end = std::max(lastEnd, m.first + m.second);
+                    partOffset += end - lastEnd;
+                    last.size = end - last.storeOffset;
+                    continue;
+                }
+            }
+
+            m_ranges.push_back(Range{m.first, m.second, partOffset});
+            partOffset += m.second;
+        }
+
+        // progress includes the manifest, which has been read already
+        m_fetchTotal = m_downloaded + partOffset;
+    }
+
+    std::string storeUrl() const
+    {
+        const std::string& store = m_manifest.storeName();
+        if (store.find("://") != std::string::npos) {
+            return store;
+        }
+
+        return m_manifestUrl.substr(0, m_manifestUrl.rfind('/') + 1) + store;
+    }
+
+    void requestNextRange()
+    {
+        const Range& r = m_ranges.at(m_nextRange);
+        m_rangeReceived = 0;
+        makeRequest(new RangeRequest(this, storeUrl(), r.storeOffset, r.size));
+    }
+
+    void rangeData(const char* s, int n)
+    {
+        addDownloaded(n);
+        m_rangeReceived += n;
+        m_part->write(s, n);
+        m_owner->installProgress(m_downloaded, m_fetchTotal);
+    }
+
+    void rangeDone(int code)
+    {
+        const Range& r = m_ranges.at(m_nextRange);
+        if ((code != 206) || (m_rangeReceived != r.size)) {
+            fallback("chunk store range request failed: " + std::to_string(code));
+            return;
+        }
+
+        if (++m_nextRange < m_ranges.size()) {
+            requestNextRange();
+            return;
+        }
+
+        m_part->close();
+        if (m_part->fail()) {
+            fallback("failed to write " + m_partPath.utf8Str());
+            return;
+        }
+
+        finish();
+    }
+
+    // read the chunk's data from the previous install or the fetched ranges
+    bool readChunk(const DeltaManifest::Chunk& c, std::vector<char>& data)
+    {
+        SGPath file;
+        size_t offset = 0;
+        auto it = m_local.find(c.hash);
+        if (it != m_local.end()) {
+            file = it->second.file;
+            offset = it->second.offset;
+        } else {
+            // the last range starting at or before the chunk contains it
+            auto r = std::upper_bound(m_ranges.begin(), m_ranges.end(), c.storeOffset,
+                                      [](size_t o, const Range& range) { return o < range.storeOffset; });
+            if (r == m_ranges.begin()) {
+                return false;
+            }
+            --r;
+            file = m_partPath;
+            offset = r->partOffset + (c.storeOffset - r->storeOffset);
+        }
+
+        sg_ifstream f(file, std::ios::in | std::ios::binary);
+        f.seekg(offset);
+        data.resize(c.size);
+        f.read(data.data(), c.size);
+        return f.good() && (DeltaManifest::hashData(data.data(), c.size) == c.hash);
+    }
+
+    // write the new revision's files to dest. Runs on the thread pool.
+    Delegate::StatusCode assemble(const SGPath& dest)
+    {
+        Dir d(dest);
+        d.create(0755);
+
+        std::vector<char> data;
+        for (const auto& f : m_manifest.files()) {
+            const SGPath path = dest / f.path;
+            Dir parent(path.dir());
+            if (!parent.exists()) {
+                parent.create(0755);
+            }
+
+            sg_ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+            sha1nfo fileHash;
+            sha1_init(&fileHash);
+            for (const auto& c : f.chunks) {
+                if (!readChunk(c, data)) {
+                    SG_LOG(SG_GENERAL, SG_WARN, "delta update: bad chunk " << c.hash << " in " << f.path);
+                    return Delegate::FAIL_CHECKSUM;
+                }
+
+                if (m_local.count(c.hash)) {
+                    m_reusedBytes += c.size;
+                }
+
+                sha1_write(&fileHash, data.data(), c.size);
+                out.write(data.data(), c.size);
+            }
+
+            out.close();
+            if (out.fail()) {
+                return Delegate::FAIL_FILESYSTEM;
+            }
+
+            if (strutils::encodeHex(sha1_result(&fileHash), HASH_LENGTH) != f.hash) {
+                SG_LOG(SG_GENERAL, SG_WARN, "delta update: checksum mismatch for " << f.path);
+                return Delegate::FAIL_CHECKSUM;
+            }
+        }
+
+        return Delegate::STATUS_SUCCESS;
+    }
+
+    void finish()
+    {
+        m_extractedPath = m_extractPath / m_owner->package()->dirName();
+
+        SGSharedPtr<DeltaUpdate> self(this);
+        runInBackground([self] { self->m_assembleResult = self->assemble(self->m_extractedPath); },
+                        [self] { self->assembled(); });
+    }
+
+    void assembled()
+    {
+        if (cancelled()) {
+            return;
+        }
+
+        m_owner->m_transferStats.reusedBytes += m_reusedBytes;
+        if (m_assembleResult != Delegate::STATUS_SUCCESS) {
+            fallback("assembling files failed");
+            return;
+        }
+
+        if (!m_owner->replaceFiles(m_extractedPath)) {
+            done(Delegate::FAIL_FILESYSTEM);
+            return;
+        }
+
+        m_owner->m_transferStats.delta = true;
+        m_owner->m_revision = m_owner->package()->revision();
+        m_owner->writeRevisionFile();
+        done(Delegate::STATUS_SUCCESS);
+    }
+
+    // work is run on the thread pool, then done on the thread which runs
+    // the HTTP client, like the request callbacks
+    void runInBackground(std::function<void()> work, std::function<void()> done)
+    {
+        m_owner->package()->catalog()->root()->runInBackground(std::move(work), std::move(done));
+    }
+
+    // the install was cancelled while work was running in the background
+    bool cancelled() const
+    {
+        return m_owner->m_delta.get() != this;
+    }
+
+    void requestFailed(int code)
+    {
+        if (code == -1) {
+            done(Delegate::USER_CANCELLED);
+        } else {
+            fallback("request failed: " + std::to_string(code));
+        }
+    }
+
+    void fallback(const std::string& reason)
+    {
+        SG_LOG(SG_GENERAL, SG_WARN, "delta update of " << m_owner->package()->id()
+               << " failed (" << reason << "), downloading the archive instead");
+        m_part.reset();
+        removeExtractDir();
+
+        InstallRef owner = m_owner;
+        owner->m_delta.reset();
+        owner->startArchiveDownload();
+    }
+
+    void done(Delegate::StatusCode aReason)
+    {
+        InstallRef owner = m_owner;
+        owner->m_delta.reset();
+        owner->m_download.reset(); // so isDownloading reports false
+        owner->installResult(aReason);
+    }
+
+    void removeExtractDir()
+    {
+        m_extractPath.set_cached(false);
+        Dir d(m_extractPath);
+        if (d.exists()) {
+            d.remove(true /* recursive */);
+        }
+    }
+
+    InstallRef m_owner;
+    std::string m_manifestUrl;
+    std::string m_manifestHash;
+    DeltaManifest m_manifest;
+    std::map<std::string, LocalChunk> m_local;
+    std::vector<Range> m_ranges;
+    size_t m_nextRange = 0;
+    size_t m_rangeReceived = 0;
+    size_t m_downloaded = 0;
+    size_t m_fetchTotal = 0;
+    SGPath m_extractPath;
+    SGPath m_extractedPath;
+    SGPath m_partPath;
+    std::unique_ptr<sg_ofstream> m_part;
+
+    // results of the background work
+    size_t m_reusedBytes = 0;
+    Delegate::StatusCode m_assembleResult = Delegate::FAIL_UNKNOWN;
+};
+
 ////////////////////////////////////////////////////////////////////
 Install::Install(PackageRef aPkg, const SGPath& aPath) :
     m_package(aPkg),
@@ -312,9 +803,61 @@ void Install::startUpdate()
         return; // already active
     }
 
+    m_transferStats = TransferStats();
+
+    // a delta needs something to start from, and a manifest hash to check
+    // the manifest against
+    const std::string manifestUrl = deltaManifestUrl();
+    const std::string manifestHash = deltaManifestHash();
+    if (!manifestUrl.empty() && !manifestHash.empty() && (m_revision > 0) && m_path.exists()) {
+        m_delta = new DeltaUpdate(this, manifestUrl, manifestHash);
+        m_delta->start();
+    } else {
+        startArchiveDownload();
+    }
+
+    m_package->catalog()->root()->startInstall(this);
+}
+
+void Install::startArchiveDownload()
+{
     m_download = new PackageArchiveDownloader(this, {});
+    m_transferStats.requests++;
     m_package->catalog()->root()->makeHTTPRequest(m_download);
-    m_package->catalog()->root()->startInstall(this);
+}
+
+std::string Install::deltaManifestUrl() const
+{
+    const std::string url = m_package->properties()->getStringValue("delta-manifest");
+    if (url.empty() || (url.find("://") != std::string::npos)) {
+        return url;
+    }
+
+    const string_list urls = m_package->downloadUrls();
+    if (urls.empty()) {
+        return {};
+    }
+
+    return urls.front().substr(0, urls.front().rfind('/') + 1) + url;
+}
+
+std::string Install::deltaManifestHash() const
+{
+    return strutils::lowercase(m_package->properties()->getStringValue("delta-manifest-sha1"));
+}
+
+bool Install::replaceFiles(const SGPath& extractedPath)
+{
+    // disable caching on our path, otherwise the upcoming
+    // delete & rename confuse everything
+    m_path.set_cached(false);
+
+    if (m_path.exists()) {
+        Dir destDir(m_path);
+        destDir.remove(true /* recursive */);
+    }
+
+    return SGPath(extractedPath).rename(m_path);
 }
 
 bool Install::uninstall()
@@ -345,6 +888,10 @@ int Install::downloadedPercent() const
         return -1;
     }
 
+    if (m_delta) {
+        return m_delta->percentDownloaded();
+    }
+
     PackageArchiveDownloader* dl = static_cast<PackageArchiveDownloader*>(m_download.get());
     return dl->percentDownloaded();
 }
@@ -355,6 +902,10 @@ size_t Install::downloadedBytes() const
         return -1;
     }
 
+    if (m_delta) {
+        return m_delta->downloadedBytes();
+    }
+
     PackageArchiveDownloader* dl = static_cast<PackageArchiveDownloader*>(m_download.get());
     return dl->downloadedBytes();
 
@@ -373,6 +924,7 @@ void Install::cancelDownload()
 
     m_package->catalog()->root()->cancelDownload(this);
     m_download.clear();
+    m_delta.clear();
 }
 
 SGPath Install::primarySetPath() const
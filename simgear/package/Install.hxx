@@ -47,6 +47,19 @@ public:
     typedef std::function<void(Install*)> Callback;
     typedef std::function<void(Install*, unsigned int, unsigned int)> ProgressCallback;
 
+    /**
+     * bytes moved by the most recent update. A delta update copies whatever
+     * it can from the previous install and only downloads the rest.
+     */
+    struct TransferStats
+    {
+        size_t downloadedBytes = 0; ///< response bodies, including any manifest
+        size_t reusedBytes = 0;     ///< copied from the previous install
+        size_t packageBytes = 0;    ///< archive size, or unpacked size for a delta
+        unsigned int requests = 0;
+        bool delta = false;         ///< installed from the delta manifest
+    };
+
     /**
      * create from a directory on disk, or fail.
      */
@@ -76,6 +89,9 @@ public:
     size_t downloadedBytes() const;
     
     Delegate::StatusCode status() const;
+
+    const TransferStats& transferStats() const
+        { return m_transferStats; }
     
     /**
      * full path to the primary -set.xml file for this install
@@ -156,6 +172,9 @@ private:
     
     class PackageArchiveDownloader;
     friend class PackageArchiveDownloader;
+
+    class DeltaUpdate;
+    friend class DeltaUpdate;
     
     Install(PackageRef aPkg, const SGPath& aPath);
     
@@ -165,12 +184,32 @@ private:
     void installResult(Delegate::StatusCode aReason);
     void installProgress(unsigned int aBytes, unsigned int aTotal);
     void startDownload();
+    void startArchiveDownload();
+
+    /**
+     * URL of the package's delta manifest, if the catalog provides one.
+     * Relative URLs are resolved against the first download URL.
+     */
+    std::string deltaManifestUrl() const;
+
+    /**
+     * SHA-1 of the delta manifest, in lower case hex. Without it the
+     * archive is downloaded instead.
+     */
+    std::string deltaManifestHash() const;
+
+    /**
+     * replace the installed files with a freshly extracted copy
+     */
+    bool replaceFiles(const SGPath& extractedPath);
     
     PackageRef m_package;
     unsigned int m_revision; ///< revision on disk
     SGPath m_path; ///< installation point on disk
     
     HTTP::Request_ptr m_download;
+    SGSharedPtr<DeltaUpdate> m_delta;
+    TransferStats m_transferStats;
 
     Delegate::StatusCode m_status;
 
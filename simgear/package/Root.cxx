@@ -412,6 +412,17 @@ void Root::cancelHTTPRequest(HTTP::Request *req, const std::string &reason)
     }
 }
 
+void Root::runInBackground(std::function<void()> work, std::function<void()> done)
+{
+    if (d->http) {
+        d->http->runInBackground(std::move(work), std::move(done));
+        return;
+    }
+
+    work();
+    done();
+}
+
 Root::Root(const SGPath& aPath, const std::string& aVersion) :
     d(new RootPrivate)
 {
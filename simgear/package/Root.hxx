@@ -18,6 +18,7 @@
 #ifndef SG_PACKAGE_ROOT_HXX
 #define SG_PACKAGE_ROOT_HXX
 
+#include <functional>
 #include <vector>
 #include <memory> // for unique_ptr
 
@@ -189,6 +190,10 @@ private:
     void installProgress(InstallRef aInstall, unsigned int aBytes, unsigned int aTotal);
     void finishInstall(InstallRef aInstall, Delegate::StatusCode aReason);
     void cancelDownload(InstallRef aInstall);
+
+    /// slow work of an install, done is run on the thread updating the
+    /// HTTP client
+    void runInBackground(std::function<void()> work, std::function<void()> done);
     
     void registerInstall(InstallRef ins);
     void unregisterInstall(InstallRef ins);
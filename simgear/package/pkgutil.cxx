@@ -19,10 +19,12 @@
 
 #include <simgear/io/HTTPClient.hxx>
 #include <simgear/package/Catalog.hxx>
+#include <simgear/package/DeltaManifest.hxx>
 #include <simgear/package/Package.hxx>
 #include <simgear/package/Install.hxx>
 #include <simgear/package/Root.hxx>
 #include <simgear/misc/sg_dir.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
 
 #include <iostream>
 #include <cstring>
@@ -195,6 +197,29 @@ int main(int argc, char** argv)
         }
 
         printPackageInfo(pkg);
+    } else if (!strcmp(argv[1], "delta")) {
+        // writes <name>.manifest and <name>.store for a package directory;
+        // the manifest URL goes in the package's <delta-manifest>, and its
+        // SHA-1 in <delta-manifest-sha1>
+        if (argc < 4) {
+            cerr << "usage: delta <package dir> <output name>" << endl;
+            return EXIT_FAILURE;
+        }
+
+        const std::string name(argv[3]);
+        pkg::DeltaManifest manifest;
+        if (!manifest.build(SGPath::fromUtf8(argv[2]), SGPath::fromUtf8(name + ".store"))) {
+            cerr << "failed to build delta manifest" << endl;
+            return EXIT_FAILURE;
+        }
+
+        const std::string text = manifest.toString();
+        sg_ofstream f(SGPath::fromUtf8(name + ".manifest"), std::ios::out | std::ios::trunc);
+        f << text;
+        cout << "wrote " << name << ".manifest for " << manifest.files().size()
+             << " files, " << manifest.totalSize() << " bytes" << endl;
+        cout << "delta-manifest-sha1: "
+             << pkg::DeltaManifest::hashData(text.data(), text.size()) << endl;
     } else {
         cerr << "unknown command:" << argv[1] << endl;
         return EXIT_FAILURE;
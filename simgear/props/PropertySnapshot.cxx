@@ -0,0 +1,461 @@
+// PropertySnapshot.cxx - read-only copies of property subtrees
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include "PropertySnapshot.hxx"
+
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <sstream>
+
+#include <simgear/props/vectorPropTemplates.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
+
+namespace simgear
+{
+
+namespace
+{
+
+// nodes near the root with this many children have them handled on the
+// thread pool
+const int ParallelDepth = 2;
+const size_t ParallelChildren = 8;
+
+bool parallel(int depth, size_t children)
+{
+    return (depth < ParallelDepth) && (children >= ParallelChildren) &&
+        (SGThreadPool::shared().size() > 0);
+}
+
+template <typename Fn>
+void forEachChild(int depth, size_t count, const Fn& fn)
+{
+    if (parallel(depth, count)) {
+        SGThreadPool::shared().parallelFor(0, static_cast<int>(count), 1, [&fn](int begin, int end) {
+            for (int i = begin; i < end; ++i) {
+                fn(i);
+            }
+        });
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            fn(static_cast<int>(i));
+        }
+    }
+}
+
+bool sameDouble(double a, double b)
+{
+    return (a == b) || (std::isnan(a) && std::isnan(b));
+}
+
+std::string childPath(const std::string& path, const PropertySnapshot::Node& node)
+{
+    std::string result = path;
+    if (!result.empty()) {
+        result += '/';
+    }
+    result += node.getNameString();
+    if (node.getIndex() > 0) {
+        result += '[' + std::to_string(node.getIndex()) + ']';
+    }
+    return result;
+}
+
+} // of anonymous namespace
+
+const PropertySnapshot::Node* PropertySnapshot::Node::getChild(int position) const
+{
+    if ((position < 0) || (position >= nChildren())) {
+        return nullptr;
+    }
+    return _children[position];
+}
+
+const PropertySnapshot::Node* PropertySnapshot::Node::getChild(const std::string& name, int index) const
+{
+    for (const auto& child : _children) {
+        if ((child->_index == index) && (*child->_name == name)) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+// names are interned, so they are compared by address; children usually
+// keep their position, which is tried first
+const PropertySnapshot::Node* PropertySnapshot::Node::findChild(const std::string* name, int index,
+                                                                int hint) const
+{
+    if ((hint < nChildren()) && (_children[hint]->_name == name) && (_children[hint]->_index == index)) {
+        return _children[hint];
+    }
+
+    for (const auto& child : _children) {
+        if ((child->_name == name) && (child->_index == index)) {
+            return child;
+        }
+    }
+    return nullptr;
+}
+
+bool PropertySnapshot::Node::getBoolValue() const
+{
+    switch (_type) {
+    case props::BOOL:
+        return _value.bool_val;
+    case props::STRING:
+    case props::UNSPECIFIED:
+        return (_string == "true") || (getDoubleValue() != 0.0);
+    default:
+        return getDoubleValue() != 0.0;
+    }
+}
+
+int PropertySnapshot::Node::getIntValue() const
+{
+    return (_type == props::INT) ? _value.int_val : static_cast<int>(getLongValue());
+}
+
+long PropertySnapshot::Node::getLongValue() const
+{
+    switch (_type) {
+    case props::INT:
+        return _value.int_val;
+    case props::LONG:
+        return _value.long_val;
+    case props::STRING:
+    case props::UNSPECIFIED:
+        return std::strtol(_string.c_str(), nullptr, 0);
+    default:
+        return static_cast<long>(getDoubleValue());
+    }
+}
+
+double PropertySnapshot::Node::getDoubleValue() const
+{
+    switch (_type) {
+    case props::BOOL:
+        return _value.bool_val ? 1.0 : 0.0;
+    case props::INT:
+        return _value.int_val;
+    case props::LONG:
+        return static_cast<double>(_value.long_val);
+    case props::FLOAT:
+        return _value.float_val;
+    case props::DOUBLE:
+        return _value.double_val;
+    case props::STRING:
+    case props::UNSPECIFIED:
+        return std::strtod(_string.c_str(), nullptr);
+    default:
+        return 0.0;
+    }
+}
+
+std::string PropertySnapshot::Node::getStringValue() const
+{
+    std::ostringstream os;
+    os.precision(std::numeric_limits<double>::digits10);
+    switch (_type) {
+    case props::BOOL:
+        return _value.bool_val ? "true" : "false";
+    case props::INT:
+        return std::to_string(_value.int_val);
+    case props::LONG:
+        return std::to_string(_value.long_val);
+    case props::FLOAT:
+        os << _value.float_val;
+        return os.str();
+    case props::DOUBLE:
+        os << _value.double_val;
+        return os.str();
+    case props::STRING:
+    case props::UNSPECIFIED:
+        return _string;
+    case props::VEC3D:
+    case props::VEC4D:
+        for (int i = 0; i < ((_type == props::VEC3D) ? 3 : 4); ++i) {
+            os << (i ? "," : "") << _value.vec_val[i];
+        }
+        return os.str();
+    default:
+        return std::string();
+    }
+}
+
+bool PropertySnapshot::Node::sameValue(const Node& other) const
+{
+    if (_type != other._type) {
+        return false;
+    }
+
+    switch (_type) {
+    case props::BOOL:
+        return _value.bool_val == other._value.bool_val;
+    case props::INT:
+        return _value.int_val == other._value.int_val;
+    case props::LONG:
+        return _value.long_val == other._value.long_val;
+    case props::FLOAT:
+        return sameDouble(_value.float_val, other._value.float_val);
+    case props::DOUBLE:
+        return sameDouble(_value.double_val, other._value.double_val);
+    case props::STRING:
+    case props::UNSPECIFIED:
+        return _string == other._string;
+    case props::VEC3D:
+    case props::VEC4D:
+        for (int i = 0; i < 4; ++i) {
+            if (!sameDouble(_value.vec_val[i], other._value.vec_val[i])) {
+                return false;
+            }
+        }
+        return true;
+    default:
+        return true;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+// PropertySnapshot::Node is only constructed here
+class PropertySnapshotBuilder
+{
+public:
+    static PropertySnapshot::Node_ptr take(const SGPropertyNode* live,
+                                           const PropertySnapshot::Node* previous, int depth)
+    {
+        SGSharedPtr<PropertySnapshot::Node> node = new PropertySnapshot::Node;
+        node->_name = &live->getNameString();
+        node->_index = live->getIndex();
+        readValue(live, *node);
+
+        // keep the children alive while they are read, in case they are
+        // removed meanwhile
+        std::vector<SGConstPropertyNode_ptr> children;
+        children.reserve(live->nChildren());
+        for (int i = 0; i < live->nChildren(); ++i) {
+            const SGPropertyNode* child = live->getChild(i);
+            if (child) {
+                children.push_back(child);
+            }
+        }
+
+        node->_children.resize(children.size());
+        forEachChild(depth, children.size(), [&](int i) {
+            const SGPropertyNode* child = children[i];
+            const PropertySnapshot::Node* previousChild = previous
+                ? previous->findChild(&child->getNameString(), child->getIndex(), i)
+                : nullptr;
+            node->_children[i] = take(child, previousChild, depth + 1);
+        });
+
+        // nothing changed: share the previous subtree, as long as it is the
+        // same node and not just an equal one, like /b taken against /a
+        if (previous && (previous->_index == node->_index) &&
+            (previous->getNameString() == node->getNameString()) &&
+            previous->sameValue(*node) && (previous->_children == node->_children)) {
+            return previous;
+        }
+        return node;
+    }
+
+    static void readValue(const SGPropertyNode* live, PropertySnapshot::Node& node)
+    {
+        if (live->isAlias() || !live->hasValue()) {
+            return;
+        }
+
+        node._type = live->getType();
+        switch (node._type) {
+        case props::BOOL:
+            node._value.bool_val = live->getBoolValue();
+            break;
+        case props::INT:
+            node._value.int_val = live->getIntValue();
+            break;
+        case props::LONG:
+            node._value.long_val = live->getLongValue();
+            break;
+        case props::FLOAT:
+            node._value.float_val = live->getFloatValue();
+            break;
+        case props::DOUBLE:
+            node._value.double_val = live->getDoubleValue();
+            break;
+        case props::STRING:
+        case props::UNSPECIFIED:
+            node._string = live->getStringValue();
+            break;
+        case props::VEC3D: {
+            const SGVec3d v = live->getValue<SGVec3d>();
+            for (int i = 0; i < 3; ++i) {
+                node._value.vec_val[i] = v[i];
+            }
+            node._value.vec_val[3] = 0.0;
+            break;
+        }
+        case props::VEC4D: {
+            const SGVec4d v = live->getValue<SGVec4d>();
+            for (int i = 0; i < 4; ++i) {
+                node._value.vec_val[i] = v[i];
+            }
+            break;
+        }
+        default:
+            node._type = props::NONE;
+            break;
+        }
+    }
+
+    static void copyTo(const PropertySnapshot::Node& node, SGPropertyNode* out)
+    {
+        switch (node._type) {
+        case props::BOOL:
+            out->setBoolValue(node._value.bool_val);
+            break;
+        case props::INT:
+            out->setIntValue(node._value.int_val);
+            break;
+        case props::LONG:
+            out->setLongValue(node._value.long_val);
+            break;
+        case props::FLOAT:
+            out->setFloatValue(node._value.float_val);
+            break;
+        case props::DOUBLE:
+            out->setDoubleValue(node._value.double_val);
+            break;
+        case props::STRING:
+            out->setStringValue(node._string);
+            break;
+        case props::UNSPECIFIED:
+            out->setUnspecifiedValue(node._string.c_str());
+            break;
+        case props::VEC3D:
+            out->setValue(SGVec3d(node._value.vec_val[0], node._value.vec_val[1],
+                                  node._value.vec_val[2]));
+            break;
+        case props::VEC4D:
+            out->setValue(SGVec4d(node._value.vec_val[0], node._value.vec_val[1],
+                                  node._value.vec_val[2], node._value.vec_val[3]));
+            break;
+        default:
+            break;
+        }
+
+        for (const auto& child : node._children) {
+            copyTo(*child, out->getChild(*child->_name, child->_index, true));
+        }
+    }
+
+    static void diff(const PropertySnapshot::Node* previous, const PropertySnapshot::Node* current,
+                     const std::string& path, int depth, std::vector<PropertySnapshot::Change>& changes)
+    {
+        if (previous == current) {
+            return;
+        }
+
+        const PropertySnapshot::Node* node = current ? current : previous;
+        const bool changed = (previous && current)
+            ? !previous->sameValue(*current)
+            : (node->hasValue() || node->_children.empty());
+        if (changed) {
+            changes.push_back({path, previous, current});
+        }
+
+        // the children of current, then those only in previous
+        std::vector<std::pair<const PropertySnapshot::Node*, const PropertySnapshot::Node*>> pairs;
+        if (current) {
+            for (size_t i = 0; i < current->_children.size(); ++i) {
+                const PropertySnapshot::Node* child = current->_children[i];
+                pairs.emplace_back(previous
+                    ? previous->findChild(child->_name, child->_index, static_cast<int>(i))
+                    : nullptr, child);
+            }
+        }
+        if (previous) {
+            for (size_t i = 0; i < previous->_children.size(); ++i) {
+                const PropertySnapshot::Node* child = previous->_children[i];
+                if (!current || !current->findChild(child->_name, child->_index, static_cast<int>(i))) {
+                    pairs.emplace_back(child, nullptr);
+                }
+            }
+        }
+
+        if (!parallel(depth, pairs.size())) {
+            for (const auto& p : pairs) {
+                const PropertySnapshot::Node* child = p.second ? p.second : p.first;
+                diff(p.first, p.second, childPath(path, *child), depth + 1, changes);
+            }
+            return;
+        }
+
+        std::vector<std::vector<PropertySnapshot::Change>> childChanges(pairs.size());
+        forEachChild(depth, pairs.size(), [&](int i) {
+            const PropertySnapshot::Node* child = pairs[i].second ? pairs[i].second : pairs[i].first;
+            diff(pairs[i].first, pairs[i].second, childPath(path, *child), depth + 1, childChanges[i]);
+        });
+
+        for (auto& c : childChanges) {
+            changes.insert(changes.end(), std::make_move_iterator(c.begin()),
+                           std::make_move_iterator(c.end()));
+        }
+    }
+};
+
+PropertySnapshot PropertySnapshot::take(const SGPropertyNode* root, const PropertySnapshot* previous)
+{
+    if (!root) {
+        return PropertySnapshot();
+    }
+
+    const Node* previousRoot = previous ? previous->root() : nullptr;
+    return PropertySnapshot(PropertySnapshotBuilder::take(root, previousRoot, 0));
+}
+
+const PropertySnapshot::Node* PropertySnapshot::getNode(const std::string& path) const
+{
+    const Node* node = _root;
+    size_t pos = 0;
+    while (node && (pos < path.size())) {
+        size_t end = path.find('/', pos);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+
+        std::string name = path.substr(pos, end - pos);
+        int index = 0;
+        const size_t bracket = name.find('[');
+        if (bracket != std::string::npos) {
+            index = std::atoi(name.c_str() + bracket + 1);
+            name.resize(bracket);
+        }
+
+        if (!name.empty()) {
+            node = node->getChild(name, index);
+        }
+        pos = end + 1;
+    }
+    return node;
+}
+
+void PropertySnapshot::copyTo(SGPropertyNode* out) const
+{
+    if (_root && out) {
+        PropertySnapshotBuilder::copyTo(*_root, out);
+    }
+}
+
+std::vector<PropertySnapshot::Change> PropertySnapshot::diff(const PropertySnapshot& previous,
+                                                             const PropertySnapshot& current)
+{
+    std::vector<Change> changes;
+    PropertySnapshotBuilder::diff(previous._root, current._root, std::string(), 0, changes);
+    return changes;
+}
+
+} // of namespace simgear
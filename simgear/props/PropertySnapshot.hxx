@@ -0,0 +1,139 @@
+// PropertySnapshot.hxx - read-only copies of property subtrees
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifndef SG_PROPERTY_SNAPSHOT_HXX
+#define SG_PROPERTY_SNAPSHOT_HXX
+
+#include <string>
+#include <vector>
+
+#include <simgear/props/props.hxx>
+#include <simgear/structure/SGReferenced.hxx>
+#include <simgear/structure/SGSharedPtr.hxx>
+
+namespace simgear
+{
+
+class PropertySnapshotBuilder;
+
+/**
+ * An immutable copy of a property subtree, for use by other threads (flight
+ * recorders, telemetry, network replication) without locking the live tree.
+ *
+ * Snapshots share structure: taking a snapshot with the previous one of the
+ * same subtree reuses every subtree of the previous snapshot which did not
+ * change, so a series of snapshots only takes memory for what changed, and
+ * diff() skips shared subtrees without looking at them. Copying a snapshot is
+ * O(1), and snapshots may be read from any number of threads.
+ *
+ * Taking a snapshot is still O(n) in the size of the subtree, with or without
+ * a previous snapshot: the live tree has no record of what changed, so every
+ * node is read and compared. Sharing saves memory and makes diff() cheap, not
+ * take() itself.
+ *
+ * Taking a snapshot reads each live node under its own lock, like
+ * copyProperties(): values changed by other threads while the snapshot is
+ * taken may or may not be included. Wide subtrees are read on the shared
+ * thread pool.
+ */
+class PropertySnapshot
+{
+public:
+    class Node;
+    typedef SGSharedPtr<const Node> Node_ptr;
+
+    class Node : public SGReferenced
+    {
+    public:
+        const std::string& getNameString() const { return *_name; }
+        int getIndex() const { return _index; }
+
+        /// NONE for nodes without a value, including aliases
+        props::Type getType() const { return _type; }
+        bool hasValue() const { return _type != props::NONE; }
+
+        int nChildren() const { return static_cast<int>(_children.size()); }
+        const Node* getChild(int position) const;
+        const Node* getChild(const std::string& name, int index = 0) const;
+
+        bool getBoolValue() const;
+        int getIntValue() const;
+        long getLongValue() const;
+        double getDoubleValue() const;
+        std::string getStringValue() const;
+
+        /// type and value are the same, ignoring children
+        bool sameValue(const Node& other) const;
+
+    private:
+        friend class PropertySnapshot;
+        friend class PropertySnapshotBuilder;
+
+        const Node* findChild(const std::string* name, int index, int hint) const;
+
+        const std::string* _name = nullptr; ///< interned
+        int _index = 0;
+        props::Type _type = props::NONE;
+        union {
+            bool bool_val;
+            int int_val;
+            long long_val;
+            float float_val;
+            double double_val;
+            double vec_val[4];
+        } _value;
+        std::string _string;
+        std::vector<Node_ptr> _children;
+    };
+
+    /// an empty snapshot
+    PropertySnapshot() = default;
+
+    /**
+     * Take a snapshot of the subtree at root. If previous is a snapshot of
+     * the same subtree, its unchanged parts are shared with the result.
+     * Reads every node under root either way.
+     */
+    static PropertySnapshot take(const SGPropertyNode* root,
+                                 const PropertySnapshot* previous = nullptr);
+
+    bool isEmpty() const { return !_root; }
+    const Node* root() const { return _root; }
+
+    /**
+     * Find a node by a path relative to the root, like "a/b[1]/c".
+     * Returns nullptr if there is no such node.
+     */
+    const Node* getNode(const std::string& path) const;
+
+    /**
+     * Write the values of the snapshot to a live tree, creating nodes as
+     * needed. Nodes of out which are not in the snapshot are kept.
+     */
+    void copyTo(SGPropertyNode* out) const;
+
+    struct Change
+    {
+        std::string path;  ///< relative to the root, like "a/b[1]/c"
+        Node_ptr previous; ///< nullptr if added
+        Node_ptr current;  ///< nullptr if removed
+    };
+
+    /**
+     * The nodes whose values differ between two snapshots of a subtree,
+     * in tree order: nodes with a changed value, and added or removed nodes
+     * which have a value or no children. Shared subtrees are skipped, and
+     * wide subtrees are compared on the shared thread pool.
+     */
+    static std::vector<Change> diff(const PropertySnapshot& previous,
+                                    const PropertySnapshot& current);
+
+private:
+    explicit PropertySnapshot(const Node_ptr& root) : _root(root) {}
+
+    Node_ptr _root;
+};
+
+} // of namespace simgear
+
+#endif // of SG_PROPERTY_SNAPSHOT_HXX
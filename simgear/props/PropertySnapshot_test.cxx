@@ -0,0 +1,180 @@
+// PropertySnapshot_test.cxx - tests for property tree snapshots
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <iostream>
+#include <string>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/props/PropertySnapshot.hxx>
+#include <simgear/props/props.hxx>
+#include <simgear/props/props_io.hxx>
+
+using namespace simgear;
+
+void testTake()
+{
+    SGPropertyNode_ptr root = new SGPropertyNode;
+    root->setDoubleValue("position/altitude-ft", 1200.5);
+    root->setBoolValue("gear/down", true);
+    root->setStringValue("sim/aircraft", "c172p");
+    root->setIntValue("engines/engine[1]/rpm", 2300);
+    root->getNode("orphan", true);
+    root->getNode("alias", true)->alias(root->getNode("gear/down"), false);
+
+    PropertySnapshot snapshot = PropertySnapshot::take(root);
+    SG_VERIFY(!snapshot.isEmpty());
+    SG_CHECK_EQUAL(snapshot.getNode("position/altitude-ft")->getDoubleValue(), 1200.5);
+    SG_CHECK_EQUAL(snapshot.getNode("gear/down")->getBoolValue(), true);
+    SG_CHECK_EQUAL(snapshot.getNode("sim/aircraft")->getStringValue(), "c172p");
+    SG_CHECK_EQUAL(snapshot.getNode("engines/engine[1]/rpm")->getIntValue(), 2300);
+    SG_CHECK_EQUAL(snapshot.getNode("engines/engine[1]/rpm")->getType(), props::INT);
+    SG_VERIFY(!snapshot.getNode("orphan")->hasValue());
+    SG_VERIFY(!snapshot.getNode("alias")->hasValue());
+    SG_VERIFY(snapshot.getNode("engines/engine[0]") == nullptr);
+
+    // the snapshot doesn't change with the live tree
+    root->setDoubleValue("position/altitude-ft", 1500.0);
+    root->removeChild("sim");
+    PropertySnapshot copy = snapshot;
+    SG_CHECK_EQUAL(copy.getNode("position/altitude-ft")->getDoubleValue(), 1200.5);
+    SG_CHECK_EQUAL(copy.getNode("sim/aircraft")->getStringValue(), "c172p");
+    SG_VERIFY(copy.root() == snapshot.root());
+
+    SGPropertyNode_ptr restored = new SGPropertyNode;
+    snapshot.copyTo(restored);
+    SG_CHECK_EQUAL(restored->getDoubleValue("position/altitude-ft"), 1200.5);
+    SG_CHECK_EQUAL(restored->getStringValue("sim/aircraft"), "c172p");
+    SG_CHECK_EQUAL(restored->getIntValue("engines/engine[1]/rpm"), 2300);
+    SG_CHECK_EQUAL(restored->getNode("engines/engine[1]/rpm")->getType(), props::INT);
+}
+
+void testSharingAndDiff()
+{
+    SGPropertyNode_ptr root = new SGPropertyNode;
+    for (int i = 0; i < 20; ++i) {
+        SGPropertyNode* model = root->getNode("ai/models/aircraft", i, true);
+        model->setDoubleValue("position/latitude-deg", 47.0 + i);
+        model->setDoubleValue("position/longitude-deg", 8.0 + i);
+        model->setStringValue("callsign", "SG" + std::to_string(i));
+    }
+    root->setBoolValue("sim/freeze", false);
+
+    PropertySnapshot first = PropertySnapshot::take(root);
+    PropertySnapshot same = PropertySnapshot::take(root, &first);
+    SG_VERIFY(same.root() == first.root());
+    SG_CHECK_EQUAL(PropertySnapshot::diff(first, same).size(), 0);
+
+    root->setDoubleValue("ai/models/aircraft[3]/position/latitude-deg", 50.5);
+    root->getNode("ai/models")->removeChild("aircraft", 7);
+    root->setIntValue("ai/models/aircraft[20]/id", 20);
+    root->setBoolValue("sim/freeze", false); // unchanged value
+
+    PropertySnapshot second = PropertySnapshot::take(root, &first);
+    SG_VERIFY(second.root() != first.root());
+    SG_VERIFY(second.getNode("sim") == first.getNode("sim"));
+    SG_VERIFY(second.getNode("ai/models/aircraft[4]") == first.getNode("ai/models/aircraft[4]"));
+    SG_VERIFY(second.getNode("ai/models/aircraft[3]/callsign") ==
+              first.getNode("ai/models/aircraft[3]/callsign"));
+    SG_VERIFY(second.getNode("ai/models/aircraft[3]") != first.getNode("ai/models/aircraft[3]"));
+
+    const auto changes = PropertySnapshot::diff(first, second);
+    SG_CHECK_EQUAL(changes.size(), 5);
+
+    SG_CHECK_EQUAL(changes[0].path, "ai/models/aircraft[3]/position/latitude-deg");
+    SG_CHECK_EQUAL(changes[0].previous->getDoubleValue(), 50.0);
+    SG_CHECK_EQUAL(changes[0].current->getDoubleValue(), 50.5);
+
+    SG_CHECK_EQUAL(changes[1].path, "ai/models/aircraft[20]/id");
+    SG_VERIFY(!changes[1].previous);
+    SG_CHECK_EQUAL(changes[1].current->getIntValue(), 20);
+
+    SG_CHECK_EQUAL(changes[2].path, "ai/models/aircraft[7]/position/latitude-deg");
+    SG_CHECK_EQUAL(changes[3].path, "ai/models/aircraft[7]/position/longitude-deg");
+    SG_CHECK_EQUAL(changes[4].path, "ai/models/aircraft[7]/callsign");
+    SG_VERIFY(!changes[4].current);
+    SG_CHECK_EQUAL(changes[4].previous->getStringValue(), "SG7");
+
+    // applying the changes gives the same tree
+    SGPropertyNode_ptr replica = new SGPropertyNode;
+    first.copyTo(replica);
+    for (const auto& c : changes) {
+        if (c.current) {
+            replica->setStringValue(c.path, c.current->getStringValue());
+        } else {
+            SGPropertyNode* node = replica->getNode(c.path);
+            node->getParent()->removeChild(node);
+        }
+    }
+    SG_CHECK_EQUAL(replica->getDoubleValue("ai/models/aircraft[3]/position/latitude-deg"), 50.5);
+    SG_CHECK_EQUAL(replica->getIntValue("ai/models/aircraft[20]/id"), 20);
+    SG_VERIFY(!replica->getNode("ai/models/aircraft[7]/callsign"));
+}
+
+// wide trees are taken and compared on the thread pool
+void testWideTree()
+{
+    SGPropertyNode_ptr root = new SGPropertyNode;
+    for (int i = 0; i < 50; ++i) {
+        for (int j = 0; j < 50; ++j) {
+            root->getNode("tile", i, true)->getNode("object", j, true)->setIntValue(i * 100 + j);
+        }
+    }
+
+    PropertySnapshot first = PropertySnapshot::take(root);
+    for (int i = 0; i < 50; i += 10) {
+        root->getNode("tile", i)->getNode("object", 5)->setIntValue(-i);
+    }
+    PropertySnapshot second = PropertySnapshot::take(root, &first);
+
+    for (int i = 0; i < 50; ++i) {
+        const bool changed = (i % 10) == 0;
+        const std::string path = "tile[" + std::to_string(i) + "]";
+        SG_CHECK_EQUAL(second.getNode(path) == first.getNode(path), !changed);
+        SG_CHECK_EQUAL(second.getNode(path + "/object[5]")->getIntValue(), changed ? -i : i * 100 + 5);
+    }
+
+    const auto changes = PropertySnapshot::diff(first, second);
+    SG_CHECK_EQUAL(changes.size(), 5);
+    for (int i = 0; i < 5; ++i) {
+        const std::string tile = (i == 0) ? "tile" : "tile[" + std::to_string(i * 10) + "]";
+        SG_CHECK_EQUAL(changes[i].path, tile + "/object[5]");
+    }
+}
+
+void testOtherRoot()
+{
+    SGPropertyNode_ptr root = new SGPropertyNode;
+    SGPropertyNode* a = root->getNode("a", true);
+    SGPropertyNode* b = root->getNode("b", true);
+    SGPropertyNode* a1 = root->getNode("a", 1, true);
+    a->setIntValue("x", 1);
+    b->setIntValue("x", 1);
+    a1->setIntValue("x", 1);
+
+    // equal subtrees of other nodes share their children, not the root
+    const PropertySnapshot snapshotA = PropertySnapshot::take(a);
+    const PropertySnapshot snapshotB = PropertySnapshot::take(b, &snapshotA);
+    SG_VERIFY(snapshotB.root() != snapshotA.root());
+    SG_CHECK_EQUAL(snapshotB.root()->getNameString(), "b");
+    SG_VERIFY(snapshotB.getNode("x") == snapshotA.getNode("x"));
+
+    const PropertySnapshot snapshotA1 = PropertySnapshot::take(a1, &snapshotA);
+    SG_VERIFY(snapshotA1.root() != snapshotA.root());
+    SG_CHECK_EQUAL(snapshotA1.root()->getIndex(), 1);
+
+    // the same node is shared
+    SG_VERIFY(PropertySnapshot::take(a, &snapshotA).root() == snapshotA.root());
+}
+
+int main(int argc, char* argv[])
+{
+    testTake();
+    testSharingAndDiff();
+    testWideTree();
+    testOtherRoot();
+
+    std::cout << __FILE__ << ": All tests passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -16,7 +16,9 @@
 #include "props.hxx"
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
+#include <memory>
 
 #include <set>
 #include <sstream>
@@ -41,6 +43,7 @@ using std::cerr;
 # include <simgear/compiler.h>
 # include <simgear/debug/logstream.hxx>
 # include <simgear/sg_inlines.h>
+# include <simgear/structure/intern.hxx>
 
 # include "PropertyInterpolationMgr.hxx"
 # include "vectorPropTemplates.hxx"
@@ -340,7 +343,7 @@ struct SGPropertyLock
             std::cerr << __FILE__ << ":" << __LINE__ << ":"
                     << (shared ? "    shared" : " exclusive") << " try-lock failed."
                     << " &node=" << &node
-                    << " _name=" << node._name
+                    << " _name=" << *node._name
                     << ": " << e.what()
                     << "\n";
             throw;
@@ -350,7 +353,7 @@ struct SGPropertyLock
         std::cerr << __FILE__ << ":" << __LINE__ << ":"
                 << (shared ? "    shared" : " exclusive") << " lock contention"
                 << " &node=" << &node
-                << " _name=" << node._name
+                << " _name=" << *node._name
                 << "\n";
         try {
             if (shared) node._mutex.lock_shared();
@@ -360,7 +363,7 @@ struct SGPropertyLock
             std::cerr << __FILE__ << ":" << __LINE__ << ":"
                     << (shared ? "    shared" : " exclusive") << " lock failed:"
                     << " &node=" << &node
-                    << " _name=" << node._name
+                    << " _name=" << *node._name
                     << ": " << e.what()
                     << "\n";
             throw;
@@ -632,7 +635,7 @@ parse_name (const SGPropertyNode *node, const Range &path)
 }
 
 // Validate the name of a single node
-inline bool validateName(const std::string& name)
+inline bool validateName(std::string_view name)
 {
   if (name.empty())
     return false;
@@ -654,6 +657,15 @@ inline bool validateName(const std::string& name)
 #endif
 }
 
+// Names are interned, so that the nodes share a single copy of common names
+// like "value" and can be compared by address
+static const std::string* internName(std::string_view name)
+{
+  if (!validateName(name))
+    throw std::invalid_argument(string{"plain name expected instead of '"} + string{name} + '\'');
+  return intern(name);
+}
+
 #if PROPS_STANDALONE
 /**
  * Parse the name for a path component.
@@ -825,13 +837,14 @@ find_child(SGPropertyLock& lock, Itr begin, Itr end, int index, const PropertyLi
       return i;
   }
 #else
-  boost::iterator_range<Itr> name(begin, end);
+  // a name which was never interned can't be that of any node
+  const std::string* name = findInterned(std::string_view(begin, end - begin));
+  if (!name)
+    return -1;
+
   for (size_t i = 0; i < nNodes; i++) {
     SGPropertyNode * node = nodes[i];
-
-    // searching for a matching index is a lot less time consuming than
-    // comparing two strings so do that first.
-    if (node->getIndex() == index && boost::equals(node->getNameString(), name))
+    if (node->getIndex() == index && &node->getNameString() == name)
       return static_cast<int>(i);
   }
 #endif
@@ -846,10 +859,13 @@ find_last_child (SGPropertyLockExclusive& exclusive, const char * name, const Pr
 {
   size_t nNodes = nodes.size();
   int index = -1;
+  const std::string* interned = findInterned(name);
+  if (!interned)
+    return index;
 
   for (size_t i = 0; i < nNodes; i++) {
     SGPropertyNode * node = nodes[i];
-    if (node->getNameString() == string(name))
+    if (&node->getNameString() == interned)
     {
       int idx = node->getIndex();
       if (idx > index) index = idx;
@@ -2188,23 +2204,236 @@ typedef std::map<const SGPropertyNode*, SGSourceLocation> NodeOriginMap;
  */
 static NodeOriginMap* nodeOrigins;
 
+/**
+ * Slabs of memory for nodes. Deleted nodes are kept in a free list and
+ * reused; slabs are never released, as nodes may be deleted during static
+ * destruction.
+ *
+ * Each thread keeps a small free list of its own, refilled from and
+ * returned to the shared one in batches, so threads building or deleting
+ * trees at the same time rarely take the mutex.
+ */
+class SGPropertyNodePool
+{
+public:
+    static SGPropertyNodePool& instance()
+    {
+        static SGPropertyNodePool* pool = new SGPropertyNodePool;
+        return *pool;
+    }
+
+    void* allocate()
+    {
+        ThreadCache* cache = threadCache();
+        if (!cache) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_exitedLive;
+            return take();
+        }
+
+        if (!cache->free) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (size_t i = 0; i < Batch; ++i) {
+                Slot* slot = take();
+                slot->next = cache->free;
+                cache->free = slot;
+            }
+            cache->count += Batch;
+        }
+
+        Slot* slot = cache->free;
+        cache->free = slot->next;
+        --cache->count;
+        cache->live.store(cache->live.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return slot;
+    }
+
+    void release(void* p)
+    {
+        Slot* slot = static_cast<Slot*>(p);
+        ThreadCache* cache = threadCache();
+        if (!cache) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_exitedLive;
+            put(slot);
+            return;
+        }
+
+        slot->next = cache->free;
+        cache->free = slot;
+        ++cache->count;
+        cache->live.store(cache->live.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+        if (cache->count >= 2 * Batch) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (size_t i = 0; i < Batch; ++i) {
+                Slot* s = cache->free;
+                cache->free = s->next;
+                put(s);
+            }
+            cache->count -= Batch;
+        }
+    }
+
+    SGPropertyNode::PoolStats stats()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        SGPropertyNode::PoolStats result;
+        result.nodeSize = sizeof(Slot);
+        long live = _exitedLive;
+        for (const ThreadCache* cache : _caches) {
+            live += cache->live.load(std::memory_order_relaxed);
+        }
+        result.liveNodes = static_cast<size_t>(live);
+        result.poolBytes = _slabs.size() * sizeof(Slot) * NodesPerSlab;
+        return result;
+    }
+
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(SGPropertyNode) unsigned char storage[sizeof(SGPropertyNode)];
+    };
+
+    static const size_t NodesPerSlab = 512;
+    // slots moved between a thread's free list and the shared one at a time
+    static const size_t Batch = 64;
+
+    struct ThreadCache
+    {
+        Slot* free = nullptr;
+        size_t count = 0;
+        // nodes allocated minus nodes released by the thread, which may
+        // be negative; only written by the thread, read by stats()
+        std::atomic<long> live{0};
+        bool exited = false;
+    };
+
+    // registers the thread's cache, and returns it to the pool when the
+    // thread exits
+    class CacheOwner
+    {
+    public:
+        CacheOwner(SGPropertyNodePool* pool, ThreadCache* cache) :
+            _pool(pool), _cache(cache)
+        {
+            std::lock_guard<std::mutex> lock(_pool->_mutex);
+            _pool->_caches.push_back(_cache);
+        }
+
+        ~CacheOwner()
+        {
+            std::lock_guard<std::mutex> lock(_pool->_mutex);
+            while (_cache->free) {
+                Slot* slot = _cache->free;
+                _cache->free = slot->next;
+                _pool->put(slot);
+            }
+            _cache->count = 0;
+            _pool->_exitedLive += _cache->live.load(std::memory_order_relaxed);
+            _pool->_caches.erase(std::find(_pool->_caches.begin(), _pool->_caches.end(), _cache));
+            // nodes deleted later by the exiting thread, during static
+            // destruction for the main thread, use the shared list
+            _cache->exited = true;
+        }
+
+    private:
+        SGPropertyNodePool* _pool;
+        ThreadCache* _cache;
+    };
+
+    ThreadCache* threadCache()
+    {
+        thread_local ThreadCache cache;
+        if (cache.exited) {
+            return nullptr;
+        }
+        thread_local CacheOwner owner(this, &cache);
+        return &cache;
+    }
+
+    // with _mutex locked
+    Slot* take()
+    {
+        if (!_free) {
+            addSlab();
+        }
+
+        Slot* slot = _free;
+        _free = slot->next;
+        return slot;
+    }
+
+    // with _mutex locked
+    void put(Slot* slot)
+    {
+        slot->next = _free;
+        _free = slot;
+    }
+
+    void addSlab()
+    {
+        _slabs.emplace_back(new Slot[NodesPerSlab]);
+        Slot* slab = _slabs.back().get();
+        // hand out the slots in address order
+        for (size_t i = NodesPerSlab; i > 0; --i) {
+            slab[i - 1].next = _free;
+            _free = &slab[i - 1];
+        }
+    }
+
+    std::mutex _mutex;
+    Slot* _free = nullptr;
+    std::vector<std::unique_ptr<Slot[]>> _slabs;
+    std::vector<ThreadCache*> _caches;
+    long _exitedLive = 0; ///< live count of threads which exited
+};
+
+// classes derived from SGPropertyNode may be larger, and then use the heap
+void* SGPropertyNode::operator new(size_t size)
+{
+    if (size != sizeof(SGPropertyNode)) {
+        return ::operator new(size);
+    }
+    return SGPropertyNodePool::instance().allocate();
+}
+
+void SGPropertyNode::operator delete(void* p, size_t size)
+{
+    if (!p) {
+        return;
+    }
+    if (size != sizeof(SGPropertyNode)) {
+        ::operator delete(p);
+        return;
+    }
+    SGPropertyNodePool::instance().release(p);
+}
+
+SGPropertyNode::PoolStats SGPropertyNode::getPoolStats()
+{
+    return SGPropertyNodePool::instance().stats();
+}
+
 /**
  * Default constructor: always creates a root node.
  */
 SGPropertyNode::SGPropertyNode ()
   : _index(0),
+    _name(intern("")),
     _parent(nullptr),
-    _type(props::NONE),
-    _tied(false),
+    _listeners(0),
     _attr(READ|WRITE),
-    _listeners(0)
+    _type(props::NONE),
+    _tied(false)
 {
   _local_val.string_val = 0;
   _value.val = 0;
   if (0) std::cerr << __FILE__ << ":" << __LINE__ << ":"
         << " SGPropertyNode()"
         << " this=" << this
-        << " _name=" << _name
+        << " _name=" << *_name
         << " SGReferenced::count(this)=" << SGReferenced::count(this)
         << " SGReferenced::shared(this)=" << SGReferenced::shared(this)
         << "\n";
@@ -2224,10 +2453,10 @@ SGPropertyNode::SGPropertyNode (const SGPropertyNode &node)
     _index(node._index),
     _name(node._name),
     _parent(nullptr),			// don't copy the parent
-    _type(node._type),
-    _tied(node._tied),
+    _listeners(0),		// CHECK!!
     _attr(node._attr),
-    _listeners(0)		// CHECK!!
+    _type(node._type),
+    _tied(node._tied)
 {
     setLocation(node.getLocation());
 
@@ -2293,21 +2522,19 @@ SGPropertyNode::SGPropertyNode (Itr begin, Itr end,
 				int index,
 				SGPropertyNode* parent)
   : _index(index),
-    _name(begin, end),
+    _name(internName(std::string_view(begin, end - begin))),
     _parent(parent),
-    _type(props::NONE),
-    _tied(false),
+    _listeners(0),
     _attr(READ|WRITE),
-    _listeners(0)
+    _type(props::NONE),
+    _tied(false)
 {
   _local_val.string_val = 0;
   _value.val = 0;
-  if (!validateName(_name))
-      throw std::invalid_argument(string{"plain name expected instead of '"} + _name + '\'');
   if (0) std::cerr << __FILE__ << ":" << __LINE__ << ":"
         << " SGPropertyNode()"
         << " this=" << this
-        << " _name=" << _name
+        << " _name=" << *_name
         << " SGReferenced::count(this)=" << SGReferenced::count(this)
         << " SGReferenced::shared(this)=" << SGReferenced::shared(this)
         << "\n";
@@ -2317,18 +2544,16 @@ SGPropertyNode::SGPropertyNode( const std::string& name,
                                 int index,
                                 SGPropertyNode* parent)
   : _index(index),
-    _name(name),
+    _name(internName(name)),
     _parent(parent),
-    _type(props::NONE),
-    _tied(false),
-    _attr(READ|WRITE),
     // REVIEW: Memory Leak - 662 bytes in 32 blocks are indirectly lost
-    _listeners(0)
+    _listeners(0),
+    _attr(READ|WRITE),
+    _type(props::NONE),
+    _tied(false)
 {
   _local_val.string_val = 0;
   _value.val = 0;
-  if (!validateName(name))
-    throw std::invalid_argument(string{"plain name expected instead of '"} + _name + '\'');
 }
 
 /**
@@ -2491,7 +2716,7 @@ SGPropertyNode_ptr SGPropertyNode::addChild(SGPropertyNode_ptr node, const std::
   int pos = append
           ? std::max(find_last_child(exclusive, name.c_str(), _children) + 1, min_index)
           : first_unused_index(exclusive, name.c_str(), _children, min_index);
-  node->_name = name;
+  node->_name = internName(name);
   node->_parent = this;
   node->_index = pos;
   SGPropertyNodeImpl::appendNode(exclusive, *this, node);
@@ -2583,7 +2808,7 @@ bool SGPropertyNode::hasValue() const
 const std::string& SGPropertyNode::getNameString () const
 {
     SGPropertyLockShared shared(*this);
-    return _name;
+    return *_name;
 }
 int SGPropertyNode::getIndex () const
 {
@@ -2836,7 +3061,7 @@ SGPropertyNode::getDisplayName (bool simplify) const
   std::string display_name;
   {
     SGPropertyLockShared shared(*this);
-    display_name = _name;
+    display_name = *_name;
   }
   if (_index != 0 || !simplify) {
     stringstream sstr;
@@ -4153,7 +4378,7 @@ bool SGPropertyNode::compare(const SGPropertyNode& lhs,
         // I'm guessing that the nodes will usually be in the same
         // order.
         if (lchild->getIndex() != rchild->getIndex()
-                || lchild->getNameString() != rchild->getNameString()
+                || &lchild->getNameString() != &rchild->getNameString()
                 )
         {
             /* Search for matching child in rhs. */
@@ -4163,7 +4388,7 @@ bool SGPropertyNode::compare(const SGPropertyNode& lhs,
                     ++itr)
             {
                 if (lchild->getIndex() == (*itr)->getIndex()
-                        && lchild->getNameString() == (*itr)->getNameString()
+                        && &lchild->getNameString() == &(*itr)->getNameString()
                         )
                 {
                     rchild = *itr;
@@ -4179,6 +4404,41 @@ bool SGPropertyNode::compare(const SGPropertyNode& lhs,
     return true;
 }
 
+// memory taken by a std::string holding s
+static size_t stringBytes(const std::string& s)
+{
+    static const size_t localCapacity = std::string().capacity();
+    return sizeof(std::string) + ((s.size() > localCapacity) ? s.size() + 1 : 0);
+}
+
+static void collectNameStats(const SGPropertyNode& node, SGPropertyNode::NameStats& stats,
+                             std::set<const std::string*>& names)
+{
+    const std::string& name = node.getNameString();
+    ++stats.nodes;
+    stats.perNodeBytes += stringBytes(name);
+    stats.internedBytes += sizeof(const std::string*);
+    if (names.insert(&name).second) {
+        stats.internedBytes += stringBytes(name);
+    }
+
+    for (int i = 0; i < node.nChildren(); ++i) {
+        const SGPropertyNode* child = node.getChild(i);
+        if (child) {
+            collectNameStats(*child, stats, names);
+        }
+    }
+}
+
+SGPropertyNode::NameStats SGPropertyNode::getNameStats(const SGPropertyNode& root)
+{
+    NameStats stats;
+    std::set<const std::string*> names;
+    collectNameStats(root, stats, names);
+    stats.distinctNames = names.size();
+    return stats;
+}
+
 struct PropertyPlaceLess {
     typedef bool result_type;
     bool operator()(SGPropertyNode_ptr lhs, SGPropertyNode_ptr rhs) const
@@ -4496,7 +4756,7 @@ size_t hash_value(const SGPropertyNode& node)
                  end = children.end();
              itr != end;
              ++itr) {
-            hash_combine(seed, (*itr)->_name);
+            hash_combine(seed, *(*itr)->_name);
             hash_combine(seed, (*itr)->_index);
             hash_combine(seed, hash_value(**itr));
         }
@@ -1350,6 +1350,40 @@ public:
      */
     static bool compare(const SGPropertyNode& lhs, const SGPropertyNode& rhs);
 
+    /**
+     * Memory used by the names of the nodes in a tree. Node names are
+     * interned, so a node only holds a pointer to a single copy shared by
+     * all nodes of that name.
+     */
+    struct NameStats
+    {
+        size_t nodes = 0;
+        size_t distinctNames = 0;
+        size_t internedBytes = 0; ///< the pointers and the shared copies
+        size_t perNodeBytes = 0;  ///< a string per node would take this much
+        size_t bytesSaved() const { return perNodeBytes - internedBytes; }
+    };
+
+    static NameStats getNameStats(const SGPropertyNode& root);
+
+    /**
+     * Nodes are allocated from slabs of memory holding many nodes each,
+     * rather than one by one, so that nodes created together are close in
+     * memory and don't pay the allocator's overhead for every node. Memory
+     * of deleted nodes is reused for new nodes, and not released.
+     */
+    struct PoolStats
+    {
+        size_t nodeSize = 0;  ///< bytes taken by a node in the pool
+        size_t liveNodes = 0; ///< nodes currently allocated from the pool
+        size_t poolBytes = 0; ///< memory held by the pool
+    };
+
+    static PoolStats getPoolStats();
+
+    static void* operator new(size_t size);
+    static void operator delete(void* p, size_t size);
+
 protected:
 
     /* fire*() generally need to temporarily modify _listeners->_num_iterators
@@ -1398,20 +1432,20 @@ private:
     // Class data.
     //
     
+    // Members are ordered by size to avoid padding: with millions of nodes,
+    // every word counts. _index is first so it can share the word of the
+    // reference count.
+    int _index;
+
     // Support for thread-safety.
     //
     mutable std::shared_mutex _mutex;
     
     // Core data.
     //
-    int _index;
-    std::string _name;
+    const std::string* _name; ///< interned, see simgear::intern()
     SGPropertyNode* _parent;
     simgear::PropertyList _children;
-    mutable std::string _buffer;
-    simgear::props::Type _type;
-    bool _tied;
-    int _attr = NO_ATTR;
 
     /**
      * @brief when a property is an alias, we record information about it in
@@ -1440,7 +1474,12 @@ private:
         char* string_val;
     } _local_val;
 
+    // only allocated once a listener is added
     SGPropertyNodeListeners*  _listeners;
+
+    int _attr = NO_ATTR;
+    simgear::props::Type _type;
+    bool _tied;
 };
 
 // Convenience functions for use in templates
@@ -0,0 +1,198 @@
+// props_bench - memory footprint and full-tree operations of property trees
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "PropertySnapshot.hxx"
+#include "props.hxx"
+#include "props_io.hxx"
+
+namespace {
+
+// resident set size in bytes, or 0 where unknown
+size_t residentBytes()
+{
+#if defined(__linux__)
+    long pages = 0, resident = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (f) {
+        if (fscanf(f, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(f);
+    }
+    return static_cast<size_t>(resident) * sysconf(_SC_PAGESIZE);
+#else
+    return 0;
+#endif
+}
+
+double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// children are found by a linear search, so keep the lists short
+const int PerGroup = 100;
+
+// Something like the AI traffic and scenery objects of a session: many
+// small subtrees with the same few names.
+void buildTree(SGPropertyNode* root, int models, int objects)
+{
+    for (int i = 0; i < models; ++i) {
+        SGPropertyNode* m = root->getNode("ai/models/group", i / PerGroup, true)
+                                ->getNode("aircraft", i % PerGroup, true);
+        m->setStringValue("callsign", "SG" + std::to_string(i));
+        m->setIntValue("id", i);
+        m->setBoolValue("valid", true);
+        for (auto name : {"latitude-deg", "longitude-deg", "altitude-ft"}) {
+            m->getNode("position", true)->setDoubleValue(name, i * 0.001);
+        }
+        for (auto name : {"true-heading-deg", "pitch-deg", "roll-deg"}) {
+            m->getNode("orientation", true)->setDoubleValue(name, i * 0.01);
+        }
+        for (auto name : {"true-airspeed-kt", "vertical-speed-fps"}) {
+            m->getNode("velocities", true)->setDoubleValue(name, 100.0);
+        }
+        for (int e = 0; e < 2; ++e) {
+            SGPropertyNode* engine = m->getNode("engines/engine", e, true);
+            engine->setDoubleValue("rpm", 2400.0);
+            engine->setBoolValue("running", true);
+        }
+    }
+
+    for (int i = 0; i < objects; ++i) {
+        SGPropertyNode* o = root->getNode("scenery/tile", i / PerGroup, true)
+                                ->getNode("object", i % PerGroup, true);
+        o->setStringValue("path", "Models/Airport/hangar.xml");
+        o->setDoubleValue("lon", 8.5);
+        o->setDoubleValue("lat", 47.4);
+        o->setDoubleValue("elev-m", 420.0);
+        o->setDoubleValue("heading", 90.0);
+    }
+}
+
+// the same trees built and destroyed by several threads at once, each with
+// its own root, as by the loaders of models and scenery
+void threadedBuild(int threads, int models, int objects)
+{
+    std::vector<SGPropertyNode_ptr> roots(threads);
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&roots, t, models, objects] {
+            roots[t] = new SGPropertyNode;
+            buildTree(roots[t], models, objects);
+        });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    const double buildTime = secondsSince(start);
+    workers.clear();
+
+    start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&roots, t] { roots[t].clear(); });
+    }
+    for (auto& w : workers) {
+        w.join();
+    }
+    std::cout << threads << " threads build: " << buildTime << " s, destroy: "
+              << secondsSince(start) << " s" << std::endl;
+}
+
+int countNodes(const SGPropertyNode* node)
+{
+    int n = 1;
+    for (int i = 0; i < node->nChildren(); ++i) {
+        n += countNodes(node->getChild(i));
+    }
+    return n;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const int models = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int objects = argc > 2 ? std::atoi(argv[2]) : 50000;
+
+    std::cout << "sizeof(SGPropertyNode): " << sizeof(SGPropertyNode) << " bytes" << std::endl;
+
+    const size_t before = residentBytes();
+    auto start = std::chrono::steady_clock::now();
+    SGPropertyNode_ptr root = new SGPropertyNode;
+    buildTree(root, models, objects);
+    const double buildTime = secondsSince(start);
+    const size_t after = residentBytes();
+    const int nodes = countNodes(root);
+
+    const SGPropertyNode::PoolStats pool = SGPropertyNode::getPoolStats();
+    std::cout << "nodes: " << nodes << ", " << pool.nodeSize << " bytes each in the pool, "
+              << pool.poolBytes / (1024 * 1024) << " MiB pool" << std::endl;
+    std::cout << "build: " << buildTime << " s" << std::endl;
+    if (after > before) {
+        std::cout << "resident: " << (after - before) / (1024 * 1024) << " MiB, "
+                  << double(after - before) / nodes << " bytes per node" << std::endl;
+    }
+
+    start = std::chrono::steady_clock::now();
+    SGPropertyNode_ptr copy = new SGPropertyNode;
+    copyProperties(root, copy);
+    std::cout << "copyProperties: " << secondsSince(start) << " s" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    simgear::PropertySnapshot first = simgear::PropertySnapshot::take(root);
+    std::cout << "snapshot: " << secondsSince(start) << " s" << std::endl;
+
+    for (int i = 0; i < models; i += 100) {
+        root->getNode("ai/models/group", i / PerGroup)->setDoubleValue("aircraft/position/altitude-ft", i);
+    }
+    start = std::chrono::steady_clock::now();
+    simgear::PropertySnapshot second = simgear::PropertySnapshot::take(root, &first);
+    std::cout << "snapshot with previous: " << secondsSince(start) << " s" << std::endl;
+    start = std::chrono::steady_clock::now();
+    const size_t changes = simgear::PropertySnapshot::diff(first, second).size();
+    std::cout << "diff: " << secondsSince(start) << " s, " << changes << " changes" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    std::ostringstream os;
+    writeProperties(os, root, true);
+    std::cout << "writeProperties: " << secondsSince(start) << " s, "
+              << os.str().size() / 1024 << " KiB" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    double sum = 0.0;
+    for (int i = 0; i < models; ++i) {
+        sum += root->getDoubleValue("ai/models/group[" + std::to_string(i / PerGroup) + "]/aircraft[" +
+                                    std::to_string(i % PerGroup) + "]/engines/engine[1]/rpm");
+    }
+    std::cout << "lookups: " << secondsSince(start) << " s (" << sum << ")" << std::endl;
+
+    start = std::chrono::steady_clock::now();
+    copy.clear();
+    root.clear();
+    std::cout << "destroy: " << secondsSince(start) << " s" << std::endl;
+
+    // the whole tree again, split over the threads
+    for (int threads : {1, 2, 4, 8}) {
+        threadedBuild(threads, models / threads, objects / threads);
+    }
+
+    return 0;
+}
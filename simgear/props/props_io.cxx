@@ -22,6 +22,9 @@
 #include <simgear/xml/easyxml.hxx>
 #include <simgear/misc/ResourceManager.hxx>
 #include <simgear/io/iostreams/sgstream.hxx>
+#include <simgear/io/sg_mmap.hxx>
+#include <simgear/misc/sg_hash.hxx>
+#include <simgear/misc/strutils.hxx>
 
 #include "props.hxx"
 #include "props_io.hxx"
@@ -29,10 +32,17 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <cstring>      // strcmp()
+#include <cstdint>
+#include <ctime>
 #include <vector>
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 
 using std::istream;
 using std::ifstream;
@@ -49,6 +59,58 @@ using std::endl;
 // Name of special node containing unused attributes
 const std::string ATTR = "_attr_";
 
+namespace {
+
+// Set while a file is parsed for the snapshot cache: collects the files
+// read (including the included ones) and the aliases, which are only
+// resolved once the snapshot is applied to the real tree.
+struct SnapshotRecorder
+{
+  vector<SGPath> files;
+  map<const SGPropertyNode*, string> aliases;
+  // keeps the nodes alive, so their addresses stay unique
+  vector<SGConstPropertyNode_ptr> aliasNodes;
+
+  bool isAlias(const SGPropertyNode* node) const
+  {
+    return aliases.find(node) != aliases.end();
+  }
+};
+
+thread_local SnapshotRecorder* snapshotRecorder = nullptr;
+
+// Installs a recorder for the current thread, and restores the previous one
+// however the parse ends
+class SnapshotRecorderScope
+{
+public:
+  explicit SnapshotRecorderScope(SnapshotRecorder* recorder) :
+    _outer(snapshotRecorder)
+  {
+    snapshotRecorder = recorder;
+  }
+
+  ~SnapshotRecorderScope()
+  {
+    snapshotRecorder = _outer;
+  }
+
+  SnapshotRecorderScope(const SnapshotRecorderScope&) = delete;
+  SnapshotRecorderScope& operator=(const SnapshotRecorderScope&) = delete;
+
+private:
+  SnapshotRecorder* _outer;
+};
+
+bool
+readPropertiesCached(const SGPath& file, SGPropertyNode* start_node,
+                     int default_mode, bool extended);
+
+void
+readIncludedProperties(const SGPath& file, SGPropertyNode* node, bool extended);
+
+} // anonymous namespace
+
 
 ////////////////////////////////////////////////////////////////////////
 // Property list visitor, for XML parsing.
@@ -191,7 +253,7 @@ PropsVisitor::startElement (const char * name, const XMLAttributes &atts)
               message += attval;
               throw sg_io_exception(message, location, SG_ORIGIN, false);
           }
-          readProperties(path, _root, 0, _extended);
+          readIncludedProperties(path, _root, _extended);
       } catch (sg_io_exception &e) {
           setException(e);
       }
@@ -259,7 +321,11 @@ PropsVisitor::startElement (const char * name, const XMLAttributes &atts)
       // Check for an alias.
       else if( att_name == "alias" )
       {
-        if (!node->alias(val, false))
+        if (snapshotRecorder) {
+          snapshotRecorder->aliases[node] = val;
+          snapshotRecorder->aliasNodes.push_back(node);
+        }
+        else if (!node->alias(val, false))
               SG_LOG(
                   SG_INPUT,
                   SG_ALERT,
@@ -279,7 +345,7 @@ PropsVisitor::startElement (const char * name, const XMLAttributes &atts)
             message += val;
             throw sg_io_exception(message, location, SG_ORIGIN, false);
           }
-          readProperties(path, node, 0, _extended);
+          readIncludedProperties(path, node, _extended);
         }
         catch (sg_io_exception &e)
         {
@@ -321,7 +387,8 @@ PropsVisitor::endElement (const char * name)
 
   // If there are no children and it's
   // not an alias, then it's a leaf value.
-  if( !st.hasChildren() && !st.node->isAlias() )
+  if( !st.hasChildren() && !st.node->isAlias() &&
+      !(snapshotRecorder && snapshotRecorder->isAlias(st.node)) )
   {
     if (st.type == "bool") {
       if (_data == "true" || atoi(_data.c_str()) != 0)
@@ -440,6 +507,11 @@ void
 readProperties (const SGPath &file, SGPropertyNode * start_node,
                 int default_mode, bool extended)
 {
+  if (snapshotRecorder)
+    snapshotRecorder->files.push_back(file);
+  else if (readPropertiesCached(file, start_node, default_mode, extended))
+    return;
+
   PropsVisitor visitor(start_node, file.utf8Str(), default_mode, extended);
   readXML(file, visitor);
   if (visitor.hasException())
@@ -733,6 +805,900 @@ writeProperties (const char* file, const SGPropertyNode * start_node)
 }
 
 
+////////////////////////////////////////////////////////////////////////
+// Binary snapshots.
+//
+// A snapshot is a string table followed by the nodes in preorder, all
+// numbers little endian:
+//
+//   "SGPB" version stringCount nodeCount
+//   stringCount x (length bytes '\0')
+//   nodeCount x (name index type attributes childCount file line value)
+//
+// Names, string values, alias targets and location paths are indices into
+// the string table, which is used in place when the snapshot is mapped.
+////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const char SnapshotMagic[4] = { 'S', 'G', 'P', 'B' };
+const uint32_t SnapshotVersion = 1;
+const uint32_t NoLocation = 0xffffffff;
+
+// Attributes kept in a snapshot, the others are runtime state
+const int SnapshotAttributes =
+  SGPropertyNode::READ | SGPropertyNode::WRITE | SGPropertyNode::ARCHIVE |
+  SGPropertyNode::TRACE_READ | SGPropertyNode::TRACE_WRITE |
+  SGPropertyNode::USERARCHIVE | SGPropertyNode::PRESERVE;
+
+// Stable type codes, independent of simgear::props::Type
+enum SnapshotType : uint8_t {
+  SNAP_NONE,
+  SNAP_ALIAS,
+  SNAP_BOOL,
+  SNAP_INT,
+  SNAP_LONG,
+  SNAP_FLOAT,
+  SNAP_DOUBLE,
+  SNAP_STRING,
+  SNAP_UNSPECIFIED,
+  SNAP_VEC3D,
+  SNAP_VEC4D
+};
+
+class SnapshotWriter
+{
+public:
+  explicit SnapshotWriter(const SnapshotRecorder* recorder = nullptr) :
+    _recorder(recorder)
+  {
+  }
+
+  std::string write(const SGPropertyNode* root)
+  {
+    _nodeCount = 0;
+    writeNode(root);
+
+    string out(SnapshotMagic, sizeof(SnapshotMagic));
+    put32(out, SnapshotVersion);
+    put32(out, static_cast<uint32_t>(_strings.size()));
+    put32(out, _nodeCount);
+    for (const string* str : _stringOrder) {
+      put32(out, static_cast<uint32_t>(str->size()));
+      out.append(str->c_str(), str->size() + 1);
+    }
+    out += _nodes;
+    return out;
+  }
+
+  static void put32(string& out, uint32_t value)
+  {
+    for (int i = 0; i < 4; ++i)
+      out += static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+
+  static void put64(string& out, uint64_t value)
+  {
+    for (int i = 0; i < 8; ++i)
+      out += static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+
+  static void putDouble(string& out, double value)
+  {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put64(out, bits);
+  }
+
+private:
+  uint32_t stringIndex(const string& str)
+  {
+    auto it = _strings.emplace(str, static_cast<uint32_t>(_strings.size()));
+    if (it.second)
+      _stringOrder.push_back(&it.first->first);
+    return it.first->second;
+  }
+
+  void writeNode(const SGPropertyNode* node)
+  {
+    using namespace simgear;
+    ++_nodeCount;
+
+    const SGSourceLocation location = node->getLocation();
+    const int nChildren = node->nChildren();
+
+    SnapshotType type = SNAP_NONE;
+    string alias;
+    if (_recorder) {
+      auto it = _recorder->aliases.find(node);
+      if (it != _recorder->aliases.end()) {
+        type = SNAP_ALIAS;
+        alias = it->second;
+      }
+    }
+
+    if (type == SNAP_ALIAS) {
+    } else if (node->isAlias()) {
+      type = SNAP_ALIAS;
+      alias = node->getAliasTarget()->getPath();
+    } else if (node->hasValue()) {
+      switch (node->getType()) {
+      case props::BOOL: type = SNAP_BOOL; break;
+      case props::INT: type = SNAP_INT; break;
+      case props::LONG: type = SNAP_LONG; break;
+      case props::FLOAT: type = SNAP_FLOAT; break;
+      case props::DOUBLE: type = SNAP_DOUBLE; break;
+      case props::STRING: type = SNAP_STRING; break;
+      case props::VEC3D: type = SNAP_VEC3D; break;
+      case props::VEC4D: type = SNAP_VEC4D; break;
+      // other extended types only survive as their string form
+      default: type = SNAP_UNSPECIFIED; break;
+      }
+    }
+
+    put32(_nodes, stringIndex(node->getNameString()));
+    put32(_nodes, static_cast<uint32_t>(node->getIndex()));
+    _nodes += static_cast<char>(type);
+    put32(_nodes, static_cast<uint32_t>(node->getAttributes() & SnapshotAttributes));
+    put32(_nodes, static_cast<uint32_t>(nChildren));
+    put32(_nodes, location.isValid() ? stringIndex(location.getPath()) : NoLocation);
+    put32(_nodes, static_cast<uint32_t>(location.getLine()));
+
+    switch (type) {
+    case SNAP_NONE:
+      break;
+    case SNAP_ALIAS:
+      put32(_nodes, stringIndex(alias));
+      break;
+    case SNAP_BOOL:
+      _nodes += static_cast<char>(node->getBoolValue() ? 1 : 0);
+      break;
+    case SNAP_INT:
+      put32(_nodes, static_cast<uint32_t>(node->getIntValue()));
+      break;
+    case SNAP_LONG:
+      put64(_nodes, static_cast<uint64_t>(node->getLongValue()));
+      break;
+    case SNAP_FLOAT: {
+      const float value = node->getFloatValue();
+      uint32_t bits;
+      memcpy(&bits, &value, sizeof(bits));
+      put32(_nodes, bits);
+      break;
+    }
+    case SNAP_DOUBLE:
+      putDouble(_nodes, node->getDoubleValue());
+      break;
+    case SNAP_STRING:
+    case SNAP_UNSPECIFIED:
+      put32(_nodes, stringIndex(node->getStringValue()));
+      break;
+    case SNAP_VEC3D: {
+      const SGVec3d value = node->getValue<SGVec3d>();
+      for (int i = 0; i < 3; ++i)
+        putDouble(_nodes, value[i]);
+      break;
+    }
+    case SNAP_VEC4D: {
+      const SGVec4d value = node->getValue<SGVec4d>();
+      for (int i = 0; i < 4; ++i)
+        putDouble(_nodes, value[i]);
+      break;
+    }
+    }
+
+    for (int i = 0; i < nChildren; ++i)
+      writeNode(node->getChild(i));
+  }
+
+  const SnapshotRecorder* _recorder;
+  std::unordered_map<string, uint32_t> _strings;
+  vector<const string*> _stringOrder;
+  string _nodes;
+  uint32_t _nodeCount = 0;
+};
+
+class SnapshotReader
+{
+public:
+  SnapshotReader(const char* buf, size_t size) :
+    _pos(buf), _end(buf + size)
+  {
+  }
+
+  void read(SGPropertyNode* root)
+  {
+    if (size_t(_end - _pos) < sizeof(SnapshotMagic) ||
+        memcmp(_pos, SnapshotMagic, sizeof(SnapshotMagic)))
+      fail("not a property snapshot");
+    _pos += sizeof(SnapshotMagic);
+    if (get32() != SnapshotVersion)
+      fail("unsupported property snapshot version");
+
+    const uint32_t stringCount = get32();
+    _nodesLeft = get32();
+    if (stringCount > size_t(_end - _pos) / 5)
+      fail("bad string count");
+    _strings.resize(stringCount);
+    for (uint32_t i = 0; i < stringCount; ++i) {
+      const uint32_t length = get32();
+      if (length >= size_t(_end - _pos) || _pos[length] != '\0')
+        fail("bad string table");
+      _strings[i] = _pos;
+      _pos += length + 1;
+    }
+
+    readNode(root, true);
+    if (_nodesLeft != 0 || _pos != _end)
+      fail("trailing data");
+  }
+
+private:
+  [[noreturn]] void fail(const char* message)
+  {
+    throw sg_io_exception(string("Invalid property snapshot: ") + message,
+                          SG_ORIGIN, false);
+  }
+
+  void need(size_t n)
+  {
+    if (size_t(_end - _pos) < n)
+      fail("truncated");
+  }
+
+  uint8_t get8()
+  {
+    need(1);
+    return static_cast<uint8_t>(*_pos++);
+  }
+
+  uint32_t get32()
+  {
+    need(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i)
+      value |= uint32_t(static_cast<uint8_t>(_pos[i])) << (8 * i);
+    _pos += 4;
+    return value;
+  }
+
+  uint64_t get64()
+  {
+    need(8);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i)
+      value |= uint64_t(static_cast<uint8_t>(_pos[i])) << (8 * i);
+    _pos += 8;
+    return value;
+  }
+
+  double getDouble()
+  {
+    const uint64_t bits = get64();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  const char* getString()
+  {
+    const uint32_t i = get32();
+    if (i >= _strings.size())
+      fail("bad string index");
+    return _strings[i];
+  }
+
+  // A null node reads and discards a subtree
+  void readNode(SGPropertyNode* node, bool isRoot)
+  {
+    if (_nodesLeft-- == 0)
+      fail("bad node count");
+
+    const char* name = getString();
+    const int index = static_cast<int>(get32());
+    const uint8_t type = get8();
+    const int attributes = static_cast<int>(get32()) & SnapshotAttributes;
+    const uint32_t nChildren = get32();
+    const uint32_t file = get32();
+    const int line = static_cast<int>(get32());
+    if (file != NoLocation && file >= _strings.size())
+      fail("bad location");
+
+    if (!isRoot && node) {
+      node = node->getChild(name, index, true);
+      if (!node->getAttribute(SGPropertyNode::WRITE)) {
+        SG_LOG(SG_INPUT, SG_ALERT, "Not overwriting write-protected property "
+               << node->getPath(true));
+        node = nullptr;
+      }
+    }
+
+    readValue(node, type);
+
+    // like the XML reader, this includes the start node, which takes the
+    // mode and location of the <PropertyList> element
+    if (node) {
+      if (file != NoLocation)
+        node->setLocation(SGSourceLocation(_strings[file], line));
+      node->setAttributes(attributes);
+    }
+
+    for (uint32_t i = 0; i < nChildren; ++i)
+      readNode(node, false);
+  }
+
+  void readValue(SGPropertyNode* node, uint8_t type)
+  {
+    // as for XML, an explicit type replaces the current value
+    if (node && type > SNAP_ALIAS && type != SNAP_UNSPECIFIED && !node->isTied())
+      node->clearValue();
+
+    bool ret = true;
+    switch (type) {
+    case SNAP_NONE:
+      break;
+    case SNAP_ALIAS: {
+      const char* target = getString();
+      if (!node) {
+      } else if (snapshotRecorder) {
+        snapshotRecorder->aliases[node] = target;
+        snapshotRecorder->aliasNodes.push_back(node);
+      } else if (!node->alias(target, false)) {
+        SG_LOG(SG_INPUT, SG_ALERT, "Failed to set alias of "
+               << node->getPath() << " to " << target);
+      }
+      return;
+    }
+    case SNAP_BOOL: {
+      const bool value = get8() != 0;
+      if (node)
+        ret = node->setBoolValue(value);
+      break;
+    }
+    case SNAP_INT: {
+      const int value = static_cast<int>(get32());
+      if (node)
+        ret = node->setIntValue(value);
+      break;
+    }
+    case SNAP_LONG: {
+      const long value = static_cast<long>(static_cast<int64_t>(get64()));
+      if (node)
+        ret = node->setLongValue(value);
+      break;
+    }
+    case SNAP_FLOAT: {
+      const uint32_t bits = get32();
+      float value;
+      memcpy(&value, &bits, sizeof(value));
+      if (node)
+        ret = node->setFloatValue(value);
+      break;
+    }
+    case SNAP_DOUBLE: {
+      const double value = getDouble();
+      if (node)
+        ret = node->setDoubleValue(value);
+      break;
+    }
+    case SNAP_STRING: {
+      const char* value = getString();
+      if (node)
+        ret = node->setStringValue(value);
+      break;
+    }
+    case SNAP_UNSPECIFIED: {
+      const char* value = getString();
+      // an existing alias is kept, as for an untyped XML leaf
+      if (node && !node->isAlias())
+        ret = node->setUnspecifiedValue(value);
+      break;
+    }
+    case SNAP_VEC3D: {
+      SGVec3d value;
+      for (int i = 0; i < 3; ++i)
+        value[i] = getDouble();
+      if (node)
+        ret = node->setValue(value);
+      break;
+    }
+    case SNAP_VEC4D: {
+      SGVec4d value;
+      for (int i = 0; i < 4; ++i)
+        value[i] = getDouble();
+      if (node)
+        ret = node->setValue(value);
+      break;
+    }
+    default:
+      fail("unknown node type");
+    }
+
+    if (!ret)
+      SG_LOG(SG_INPUT, SG_ALERT, "readBinaryProperties: Failed to set "
+             << node->getPath());
+  }
+
+  const char* _pos;
+  const char* _end;
+  vector<const char*> _strings;
+  uint32_t _nodesLeft = 0;
+};
+
+} // anonymous namespace
+
+
+/**
+ * Write properties as a binary snapshot to a stream.
+ *
+ * @param output The output stream.
+ * @param start_node The root node to write.
+ */
+void
+writeBinaryProperties (ostream &output, const SGPropertyNode * start_node)
+{
+  const string data = SnapshotWriter().write(start_node);
+  output.write(data.data(), data.size());
+}
+
+
+/**
+ * Write properties as a binary snapshot to a file.
+ *
+ * @param file The file to create.
+ * @param start_node The root node to write.
+ */
+void
+writeBinaryProperties (const SGPath &file, const SGPropertyNode * start_node)
+{
+  SGPath dpath(file);
+  dpath.create_dir(0755);
+
+  sg_ofstream output(file, std::ios::out | std::ios::binary);
+  if (!output.good()) {
+    throw sg_io_exception("Cannot open file", sg_location(file.utf8Str()), "", false);
+  }
+  writeBinaryProperties(output, start_node);
+}
+
+
+/**
+ * Read properties from a binary snapshot in memory.
+ *
+ * @param buf The snapshot data.
+ * @param size The size of the data in bytes.
+ * @param start_node The root node for reading properties.
+ */
+void
+readBinaryProperties (const char *buf, size_t size, SGPropertyNode * start_node)
+{
+  SnapshotReader(buf, size).read(start_node);
+}
+
+
+/**
+ * Read properties from a binary snapshot file.
+ *
+ * @param file The snapshot file.
+ * @param start_node The root node for reading properties.
+ */
+void
+readBinaryProperties (const SGPath &file, SGPropertyNode * start_node)
+{
+  SGMMapFile mmap(file);
+  if (!mmap.open(SG_IO_IN)) {
+    throw sg_io_exception("Cannot open file", sg_location(file.utf8Str()), "", false);
+  }
+  readBinaryProperties(mmap.get(), mmap.get_size(), start_node);
+  mmap.close();
+}
+
+
+////////////////////////////////////////////////////////////////////////
+// Snapshot cache for XML property files.
+//
+// Each entry holds the snapshot of one file, read with one mode, together
+// with the size, modification time and SHA-1 of every file the XML read
+// including itself:
+//
+//   "SGPC" version source created depCount
+//   depCount x (path mtime size sha1)
+//   snapshotSize snapshot
+////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const char CacheMagic[4] = { 'S', 'G', 'P', 'C' };
+const uint32_t CacheVersion = 1;
+
+// Files changed this close to the creation of an entry may have been
+// changed again within the resolution of the modification time.
+const time_t CacheMTimeSlack = 2;
+
+std::mutex cacheDirMutex;
+SGPath cacheDir;
+std::atomic<unsigned> cacheHits(0);
+std::atomic<unsigned> cacheMisses(0);
+
+string
+hashFile(const SGPath& file)
+{
+  simgear::sha1nfo info;
+  simgear::sha1_init(&info);
+  if (file.sizeInBytes() > 0) {
+    SGMMapFile mmap(file);
+    if (!mmap.open(SG_IO_IN))
+      return string();
+    simgear::sha1_write(&info, mmap.get(), mmap.get_size());
+    mmap.close();
+  }
+  return string(reinterpret_cast<char*>(simgear::sha1_result(&info)), HASH_LENGTH);
+}
+
+string
+cacheEntryName(const SGPath& file, int default_mode, bool extended)
+{
+  const string key = file.utf8Str() + "|" + std::to_string(default_mode) +
+                     "|" + (extended ? "1" : "0");
+  simgear::sha1nfo info;
+  simgear::sha1_init(&info);
+  simgear::sha1_write(&info, key.data(), key.size());
+  return simgear::strutils::encodeHex(simgear::sha1_result(&info), HASH_LENGTH) +
+         ".sgpb";
+}
+
+class CacheEntryReader
+{
+public:
+  CacheEntryReader(const char* buf, size_t size) :
+    _pos(buf), _end(buf + size)
+  {
+  }
+
+  // Find the snapshot, if the entry is for the source file and all
+  // dependencies are unchanged.
+  bool validate(const SGPath& source, const char*& snapshot, size_t& size)
+  {
+    if (!need(sizeof(CacheMagic)) || memcmp(_pos, CacheMagic, sizeof(CacheMagic)))
+      return false;
+    _pos += sizeof(CacheMagic);
+
+    uint32_t version, depCount;
+    uint64_t created;
+    string path;
+    if (!get32(version) || version != CacheVersion ||
+        !getString(path) || path != source.utf8Str() ||
+        !get64(created) || !get32(depCount))
+      return false;
+
+    for (uint32_t i = 0; i < depCount; ++i) {
+      uint64_t mtime, fileSize;
+      if (!getString(path) || !get64(mtime) || !get64(fileSize) ||
+          !need(HASH_LENGTH))
+        return false;
+      const char* hash = _pos;
+      _pos += HASH_LENGTH;
+
+      SGPath dep = SGPath::fromUtf8(path);
+      if (!dep.exists() || dep.sizeInBytes() != fileSize)
+        return false;
+
+      const time_t modTime = dep.modTime();
+      if (static_cast<uint64_t>(modTime) != mtime ||
+          modTime + CacheMTimeSlack >= static_cast<time_t>(created)) {
+        if (hashFile(dep) != string(hash, HASH_LENGTH))
+          return false;
+      }
+    }
+
+    uint64_t snapshotSize;
+    if (!get64(snapshotSize) || snapshotSize != uint64_t(_end - _pos))
+      return false;
+    snapshot = _pos;
+    size = snapshotSize;
+    return true;
+  }
+
+private:
+  bool need(size_t n) const
+  {
+    return size_t(_end - _pos) >= n;
+  }
+
+  bool get32(uint32_t& value)
+  {
+    if (!need(4))
+      return false;
+    value = 0;
+    for (int i = 0; i < 4; ++i)
+      value |= uint32_t(static_cast<uint8_t>(_pos[i])) << (8 * i);
+    _pos += 4;
+    return true;
+  }
+
+  bool get64(uint64_t& value)
+  {
+    if (!need(8))
+      return false;
+    value = 0;
+    for (int i = 0; i < 8; ++i)
+      value |= uint64_t(static_cast<uint8_t>(_pos[i])) << (8 * i);
+    _pos += 8;
+    return true;
+  }
+
+  bool getString(string& str)
+  {
+    uint32_t length;
+    if (!get32(length) || !need(length))
+      return false;
+    str.assign(_pos, length);
+    _pos += length;
+    return true;
+  }
+
+  const char* _pos;
+  const char* _end;
+};
+
+void
+putString(string& out, const string& str)
+{
+  SnapshotWriter::put32(out, static_cast<uint32_t>(str.size()));
+  out += str;
+}
+
+void
+writeCacheEntry(const SGPath& dir, const string& name, const SGPath& source,
+                const vector<SGPath>& files, time_t created,
+                const string& snapshot)
+{
+  string out(CacheMagic, sizeof(CacheMagic));
+  SnapshotWriter::put32(out, CacheVersion);
+  putString(out, source.utf8Str());
+  SnapshotWriter::put64(out, static_cast<uint64_t>(created));
+  SnapshotWriter::put32(out, static_cast<uint32_t>(files.size()));
+  for (const SGPath& file : files) {
+    putString(out, file.utf8Str());
+    SnapshotWriter::put64(out, static_cast<uint64_t>(file.modTime()));
+    SnapshotWriter::put64(out, static_cast<uint64_t>(file.sizeInBytes()));
+    const string hash = hashFile(file);
+    if (hash.empty())
+      return;
+    out += hash;
+  }
+  SnapshotWriter::put64(out, snapshot.size());
+  out += snapshot;
+
+  // write and rename, so readers never see a partial entry
+  const SGPath entry = dir / name;
+  SGPath(entry).create_dir(0755);
+  std::ostringstream suffix;
+  suffix << ".tmp" << std::this_thread::get_id();
+  SGPath temp(entry.utf8Str() + suffix.str());
+  {
+    sg_ofstream output(temp, std::ios::out | std::ios::binary);
+    if (!output.good())
+      return;
+    output.write(out.data(), out.size());
+    if (!output.good()) {
+      output.close();
+      temp.remove();
+      return;
+    }
+  }
+  if (!temp.rename(entry))
+    temp.remove();
+}
+
+bool
+readPropertiesCached(const SGPath& file, SGPropertyNode* start_node,
+                     int default_mode, bool extended)
+{
+  const SGPath dir = getPropertiesCacheDir();
+  if (dir.isNull())
+    return false;
+
+  const SGPath source = file.realpath();
+  const string name = cacheEntryName(source, default_mode, extended);
+  const SGPath entry = dir / name;
+
+  if (entry.exists()) {
+    SGMMapFile mmap(entry);
+    if (mmap.open(SG_IO_IN)) {
+      const char* snapshot;
+      size_t size;
+      if (CacheEntryReader(mmap.get(), mmap.get_size()).validate(source, snapshot, size)) {
+        readBinaryProperties(snapshot, size, start_node);
+        mmap.close();
+        ++cacheHits;
+        return true;
+      }
+      mmap.close();
+    }
+  }
+
+  // Parse into a scratch tree, recording the files read. Parse errors are
+  // left to the uncached path, which reports them the usual way.
+  const time_t created = time(nullptr);
+  SGPropertyNode_ptr scratch = new SGPropertyNode;
+  SnapshotRecorder recorder;
+  try {
+    SnapshotRecorderScope scope(&recorder);
+    readProperties(source, scratch, default_mode, extended);
+  } catch (sg_exception&) {
+    return false;
+  }
+
+  const string snapshot = SnapshotWriter(&recorder).write(scratch);
+  writeCacheEntry(dir, name, source, recorder.files, created, snapshot);
+
+  readBinaryProperties(snapshot.data(), snapshot.size(), start_node);
+  ++cacheMisses;
+  return true;
+}
+
+// Parsed include files, shared by all threads. Entries are immutable
+// snapshots, which are applied to each node including the file.
+struct IncludeCacheEntry
+{
+  struct Dependency
+  {
+    string path;
+    time_t modTime;
+    size_t size;
+    // only for files changed just before parsing, see CacheMTimeSlack
+    string hash;
+  };
+
+  vector<Dependency> files;
+  string snapshot;
+
+  bool isCurrent() const
+  {
+    for (const Dependency& dep : files) {
+      const SGPath path = SGPath::fromUtf8(dep.path);
+      if (!path.exists() || path.modTime() != dep.modTime ||
+          path.sizeInBytes() != dep.size)
+        return false;
+      if (!dep.hash.empty() && hashFile(path) != dep.hash)
+        return false;
+    }
+    return true;
+  }
+};
+
+// Files included by many others are small, this only guards against
+// unusual use.
+const size_t IncludeCacheMaxBytes = 64 * 1024 * 1024;
+
+std::mutex includeCacheMutex;
+std::unordered_map<string, std::shared_ptr<const IncludeCacheEntry>> includeCache;
+size_t includeCacheBytes = 0;
+std::atomic<bool> includeCacheEnabled(true);
+std::atomic<unsigned> includeCacheHits(0);
+std::atomic<unsigned> includeCacheMisses(0);
+
+std::shared_ptr<const IncludeCacheEntry>
+parseIncludedProperties(const SGPath& file, bool extended)
+{
+  auto entry = std::make_shared<IncludeCacheEntry>();
+  const time_t parsed = time(nullptr);
+  SGPropertyNode_ptr scratch = new SGPropertyNode;
+  SnapshotRecorder recorder;
+  try {
+    SnapshotRecorderScope scope(&recorder);
+    readProperties(file, scratch, 0, extended);
+  } catch (sg_exception&) {
+    return nullptr;
+  }
+
+  for (const SGPath& path : recorder.files) {
+    const SGPath dep = SGPath::fromUtf8(path.utf8Str());
+    const time_t modTime = dep.modTime();
+    entry->files.push_back({ dep.utf8Str(), modTime, dep.sizeInBytes(),
+                             modTime + CacheMTimeSlack >= parsed ? hashFile(dep) : string() });
+  }
+  entry->snapshot = SnapshotWriter(&recorder).write(scratch);
+  return entry;
+}
+
+void
+readIncludedProperties(const SGPath& file, SGPropertyNode* node, bool extended)
+{
+  if (!includeCacheEnabled) {
+    readProperties(file, node, 0, extended);
+    return;
+  }
+
+  const string key = file.utf8Str() + (extended ? "|1" : "|0");
+  std::shared_ptr<const IncludeCacheEntry> entry;
+  {
+    std::lock_guard<std::mutex> lock(includeCacheMutex);
+    auto it = includeCache.find(key);
+    if (it != includeCache.end())
+      entry = it->second;
+  }
+
+  if (entry && entry->isCurrent()) {
+    ++includeCacheHits;
+  } else {
+    entry = parseIncludedProperties(file, extended);
+    if (!entry) {
+      // let the uncached path report the error the usual way
+      readProperties(file, node, 0, extended);
+      return;
+    }
+    ++includeCacheMisses;
+
+    std::lock_guard<std::mutex> lock(includeCacheMutex);
+    auto& cached = includeCache[key];
+    const size_t oldSize = cached ? cached->snapshot.size() : 0;
+    if (includeCacheBytes - oldSize + entry->snapshot.size() <= IncludeCacheMaxBytes) {
+      includeCacheBytes += entry->snapshot.size() - oldSize;
+      cached = entry;
+    } else if (!cached) {
+      includeCache.erase(key);
+    }
+  }
+
+  // a snapshot being recorded depends on the included files too
+  if (snapshotRecorder) {
+    for (const auto& dep : entry->files)
+      snapshotRecorder->files.push_back(SGPath::fromUtf8(dep.path));
+  }
+  readBinaryProperties(entry->snapshot.data(), entry->snapshot.size(), node);
+}
+
+} // anonymous namespace
+
+
+void
+setPropertiesIncludeCacheEnabled (bool enabled)
+{
+  includeCacheEnabled = enabled;
+  if (!enabled)
+    clearPropertiesIncludeCache();
+}
+
+
+void
+clearPropertiesIncludeCache ()
+{
+  std::lock_guard<std::mutex> lock(includeCacheMutex);
+  includeCache.clear();
+  includeCacheBytes = 0;
+}
+
+
+void
+setPropertiesCacheDir (const SGPath &dir)
+{
+  std::lock_guard<std::mutex> lock(cacheDirMutex);
+  cacheDir = dir;
+}
+
+
+SGPath
+getPropertiesCacheDir ()
+{
+  std::lock_guard<std::mutex> lock(cacheDirMutex);
+  return cacheDir;
+}
+
+
+SGPropertiesCacheStats
+getPropertiesCacheStats ()
+{
+  SGPropertiesCacheStats stats;
+  stats.hits = cacheHits;
+  stats.misses = cacheMisses;
+  stats.includeHits = includeCacheHits;
+  stats.includeMisses = includeCacheMisses;
+  return stats;
+}
+
+
 ////////////////////////////////////////////////////////////////////////
 // Copy properties from one tree to another.
 ////////////////////////////////////////////////////////////////////////
@@ -18,6 +18,7 @@
 #include <string>
 #include <iosfwd>
 #include <functional>
+#include <cstddef>
 
 /**
  * Read properties from an XML input stream.
@@ -76,6 +77,77 @@ void writeProperties (const SGPath &file,
 		      SGPropertyNode::Attribute archive_flag = SGPropertyNode::ARCHIVE);
 
 
+/**
+ * Write properties to an output stream as a binary snapshot.
+ *
+ * A snapshot keeps the types, attributes, aliases and source locations
+ * of the nodes and loads much faster than the equivalent XML.
+ */
+void writeBinaryProperties (std::ostream &output,
+                            const SGPropertyNode * start_node);
+
+
+/**
+ * Write properties to a file as a binary snapshot.
+ */
+void writeBinaryProperties (const SGPath &file,
+                            const SGPropertyNode * start_node);
+
+
+/**
+ * Read properties from a binary snapshot in memory.
+ *
+ * Throws sg_io_exception if the data is not a valid snapshot.
+ */
+void readBinaryProperties (const char *buf, size_t size,
+                           SGPropertyNode * start_node);
+
+
+/**
+ * Read properties from a binary snapshot file, which is mapped into memory.
+ */
+void readBinaryProperties (const SGPath &file, SGPropertyNode * start_node);
+
+
+/**
+ * Set the directory for binary snapshots of XML property files.
+ *
+ * While set, readProperties() for a file loads a cached snapshot instead
+ * of parsing the XML, as long as neither the file nor any file it includes
+ * has changed. An empty path (the default) disables the cache.
+ */
+void setPropertiesCacheDir (const SGPath &dir);
+
+SGPath getPropertiesCacheDir ();
+
+/**
+ * Enable or disable the cache of parsed include files.
+ *
+ * Files referenced by include= are parsed once per process and the result
+ * is copied to every including node, until the modification time or size
+ * of the file, or of a file it includes, changes. Enabled by default.
+ */
+void setPropertiesIncludeCacheEnabled (bool enabled);
+
+/**
+ * Drop all parsed include files.
+ */
+void clearPropertiesIncludeCache ();
+
+struct SGPropertiesCacheStats
+{
+  unsigned hits = 0;            ///< files loaded from the snapshot cache
+  unsigned misses = 0;          ///< files added to the snapshot cache
+  unsigned includeHits = 0;     ///< includes copied from a parsed file
+  unsigned includeMisses = 0;   ///< includes parsed
+};
+
+/**
+ * Statistics of the snapshot and include caches.
+ */
+SGPropertiesCacheStats getPropertiesCacheStats ();
+
+
 /**
  * Copy properties from one node to another.
  */
@@ -12,12 +12,18 @@
 #include <iostream>
 #include <map>
 #include <exception>
+#include <sstream>
+#include <thread>
 
 #include "props.hxx"
 #include "props_io.hxx"
+#include "vectorPropTemplates.hxx"
 
 #include <simgear/misc/test_macros.hxx>
 #include <simgear/misc/sg_path.hxx>
+#include <simgear/misc/sg_dir.hxx>
+#include <simgear/structure/exception.hxx>
+#include <simgear/io/iostreams/sgstream.hxx>
 #include <simgear/misc/test_macros.hxx>
 
 using std::cout;
@@ -970,6 +976,332 @@ void testDeleterListener()
     }
 }
 
+std::string writePropertiesString(const SGPropertyNode* node)
+{
+    std::ostringstream os;
+    writeProperties(os, node, true);
+    return os.str();
+}
+
+void testBinaryProperties()
+{
+    SGPropertyNode_ptr tree = new SGPropertyNode;
+    tree->setBoolValue("values/bool", true);
+    tree->setIntValue("values/int", -42);
+    tree->setLongValue("values/long", -1234567890L);
+    tree->setFloatValue("values/float", 0.25f);
+    tree->setDoubleValue("values/double", 1.0 / 3.0);
+    tree->setStringValue("values/string", "some text");
+    tree->setStringValue("values/string[3]", "");
+    tree->getNode("values/unspecified", true)->setUnspecifiedValue("17");
+    tree->getNode("values/vec3d", true)->setValue(SGVec3d(1, 2, 3));
+    tree->getNode("values/vec4d", true)->setValue(SGVec4d(1, 2, 3, 4));
+    tree->getNode("links/double", true)->alias("/values/double", false);
+    tree->getNode("values/int")->setAttribute(SGPropertyNode::ARCHIVE, true);
+    tree->getNode("values/bool")->setAttribute(SGPropertyNode::WRITE, false);
+    tree->getNode("values", true)->setLocation(SGSourceLocation("values.xml", 12));
+    tree->setUnspecifiedValue("values/_attr_/extra", "yes");
+
+    std::ostringstream os;
+    writeBinaryProperties(os, tree);
+    const std::string data = os.str();
+
+    SGPropertyNode_ptr copy = new SGPropertyNode;
+    readBinaryProperties(data.data(), data.size(), copy);
+    SG_CHECK_EQUAL(writePropertiesString(tree), writePropertiesString(copy));
+
+    SG_CHECK_EQUAL(copy->getNode("values/long")->getType(), simgear::props::LONG);
+    SG_CHECK_EQUAL(copy->getLongValue("values/long"), -1234567890L);
+    SG_CHECK_EQUAL(copy->getDoubleValue("values/double"), 1.0 / 3.0);
+    SG_CHECK_EQUAL(copy->getNode("values/unspecified")->getType(), simgear::props::UNSPECIFIED);
+    SG_CHECK_EQUAL(copy->getNode("values/vec4d")->getValue<SGVec4d>(), SGVec4d(1, 2, 3, 4));
+    SG_VERIFY(copy->getNode("links/double")->isAlias());
+    SG_VERIFY(copy->getNode("links/double")->getAliasTarget() == copy->getNode("values/double"));
+    SG_VERIFY(copy->getNode("values/int")->getAttribute(SGPropertyNode::ARCHIVE));
+    SG_VERIFY(!copy->getNode("values/bool")->getAttribute(SGPropertyNode::WRITE));
+    SG_CHECK_EQUAL(copy->getNode("values")->getLocation().getLine(), 12);
+    SG_CHECK_EQUAL(std::string(copy->getNode("values")->getLocation().getPath()), "values.xml");
+
+    // write-protected nodes are kept
+    readBinaryProperties(data.data(), data.size(), copy);
+    copy->setBoolValue("values/bool", false);
+    SG_VERIFY(copy->getBoolValue("values/bool"));
+
+    // truncated data
+    bool thrown = false;
+    try {
+        SGPropertyNode_ptr bad = new SGPropertyNode;
+        readBinaryProperties(data.data(), data.size() - 3, bad);
+    } catch (sg_io_exception&) {
+        thrown = true;
+    }
+    SG_VERIFY(thrown);
+
+    // through a mapped file
+    simgear::Dir temp = simgear::Dir::tempDir("props_binary");
+    temp.setRemoveOnDestroy();
+    const SGPath file = temp.file("tree.sgpb");
+    writeBinaryProperties(file, tree);
+    SGPropertyNode_ptr fromFile = new SGPropertyNode;
+    readBinaryProperties(file, fromFile);
+    SG_CHECK_EQUAL(writePropertiesString(tree), writePropertiesString(fromFile));
+}
+
+static void writeTextFile(const SGPath& path, const std::string& text)
+{
+    sg_ofstream os(path);
+    os << text;
+}
+
+// Checks that two trees read from the same file got the same access modes
+// and source locations
+static void checkAttributesAndLocations(const SGPropertyNode* expected,
+                                        const SGPropertyNode* actual)
+{
+    SG_CHECK_EQUAL(actual->getAttributes(), expected->getAttributes());
+    SG_CHECK_EQUAL(std::string(actual->getLocation().getPath()),
+                   std::string(expected->getLocation().getPath()));
+    SG_CHECK_EQUAL(actual->getLocation().getLine(), expected->getLocation().getLine());
+    SG_CHECK_EQUAL(actual->nChildren(), expected->nChildren());
+    for (int i = 0; i < expected->nChildren(); ++i)
+        checkAttributesAndLocations(expected->getChild(i), actual->getChild(i));
+}
+
+void testPropertiesCache()
+{
+    simgear::Dir temp = simgear::Dir::tempDir("props_cache");
+    temp.setRemoveOnDestroy();
+    const SGPath a = temp.file("a.xml");
+    writeTextFile(a, "<?xml version=\"1.0\"?>\n"
+                     "<PropertyList>\n"
+                     "  <x type=\"double\">1.5</x>\n"
+                     "  <sub include=\"b.xml\">\n"
+                     "    <w>text</w>\n"
+                     "  </sub>\n"
+                     "  <link alias=\"/x\"/>\n"
+                     "  <item>1</item>\n"
+                     "  <item>2</item>\n"
+                     "</PropertyList>\n");
+    writeTextFile(temp.file("b.xml"), "<?xml version=\"1.0\"?>\n"
+                                      "<PropertyList>\n"
+                                      "  <v type=\"int\">1</v>\n"
+                                      "</PropertyList>\n");
+
+    SGPropertyNode_ptr parsed = new SGPropertyNode;
+    readProperties(a, parsed);
+    const std::string expected = writePropertiesString(parsed);
+    SG_CHECK_EQUAL(parsed->getAttributes(), SGPropertyNode::READ | SGPropertyNode::WRITE);
+    SG_CHECK_EQUAL(std::string(parsed->getLocation().getPath()), a.utf8Str());
+    SG_CHECK_EQUAL(parsed->getLocation().getLine(), 2);
+
+    setPropertiesCacheDir(temp.file("cache"));
+    const SGPropertiesCacheStats start = getPropertiesCacheStats();
+
+    SGPropertyNode_ptr first = new SGPropertyNode;
+    readProperties(a, first);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().misses, start.misses + 1);
+    SG_CHECK_EQUAL(writePropertiesString(first), expected);
+    checkAttributesAndLocations(parsed, first);
+
+    SGPropertyNode_ptr second = new SGPropertyNode;
+    readProperties(a, second);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().hits, start.hits + 1);
+    SG_CHECK_EQUAL(writePropertiesString(second), expected);
+    checkAttributesAndLocations(parsed, second);
+    SG_VERIFY(second->getNode("link")->getAliasTarget() == second->getNode("x"));
+    SG_CHECK_EQUAL(second->getIntValue("sub/v"), 1);
+    SG_CHECK_EQUAL(second->getNode("sub")->getLocation().getLine(), 4);
+
+    // same size and likely the same modification time as before
+    writeTextFile(temp.file("b.xml"), "<?xml version=\"1.0\"?>\n"
+                                      "<PropertyList>\n"
+                                      "  <v type=\"int\">2</v>\n"
+                                      "</PropertyList>\n");
+    SGPropertyNode_ptr third = new SGPropertyNode;
+    readProperties(a, third);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().misses, start.misses + 2);
+    SG_CHECK_EQUAL(third->getIntValue("sub/v"), 2);
+
+    // the start node takes the mode and location of <PropertyList>,
+    // whether the file is parsed or read from the cache
+    writeTextFile(temp.file("b.xml"), "<?xml version=\"1.0\"?>\n"
+                                      "<PropertyList>\n"
+                                      "  <v type=\"int\">42</v>\n"
+                                      "</PropertyList>\n");
+    const int attributes = SGPropertyNode::READ | SGPropertyNode::ARCHIVE |
+                           SGPropertyNode::USERARCHIVE | SGPropertyNode::PRESERVE;
+    setPropertiesCacheDir(SGPath());
+    SGPropertyNode_ptr uncached = new SGPropertyNode;
+    uncached->setAttributes(attributes);
+    readProperties(a, uncached);
+    setPropertiesCacheDir(temp.file("cache"));
+    for (int i = 0; i < 2; ++i) {
+        SGPropertyNode_ptr protectedNode = new SGPropertyNode;
+        protectedNode->setAttributes(attributes);
+        readProperties(a, protectedNode);
+        checkAttributesAndLocations(uncached, protectedNode);
+        SG_CHECK_EQUAL(protectedNode->getIntValue("sub/v"), 42);
+    }
+    SG_CHECK_EQUAL(getPropertiesCacheStats().misses, start.misses + 3);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().hits, start.hits + 2);
+
+    setPropertiesCacheDir(SGPath());
+}
+
+void testIncludeCache()
+{
+    simgear::Dir temp = simgear::Dir::tempDir("props_include");
+    temp.setRemoveOnDestroy();
+    const SGPath a = temp.file("a.xml");
+    writeTextFile(a, "<?xml version=\"1.0\"?>\n"
+                     "<PropertyList>\n"
+                     "  <first include=\"base.xml\"/>\n"
+                     "  <second include=\"base.xml\">\n"
+                     "    <v type=\"int\">3</v>\n"
+                     "  </second>\n"
+                     "</PropertyList>\n");
+    writeTextFile(temp.file("base.xml"), "<?xml version=\"1.0\"?>\n"
+                                         "<PropertyList>\n"
+                                         "  <v type=\"int\">1</v>\n"
+                                         "  <link alias=\"../v\"/>\n"
+                                         "</PropertyList>\n");
+
+    setPropertiesIncludeCacheEnabled(false);
+    SGPropertyNode_ptr parsed = new SGPropertyNode;
+    readProperties(a, parsed);
+    setPropertiesIncludeCacheEnabled(true);
+
+    const SGPropertiesCacheStats start = getPropertiesCacheStats();
+    SGPropertyNode_ptr tree = new SGPropertyNode;
+    readProperties(a, tree);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().includeMisses, start.includeMisses + 1);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().includeHits, start.includeHits + 1);
+    SG_CHECK_EQUAL(writePropertiesString(tree), writePropertiesString(parsed));
+    checkAttributesAndLocations(parsed, tree);
+    SG_CHECK_EQUAL(tree->getIntValue("second/v"), 3);
+    SG_VERIFY(tree->getNode("second/link")->getAliasTarget() == tree->getNode("second/v"));
+
+    // a different size invalidates the parsed file
+    writeTextFile(temp.file("base.xml"), "<?xml version=\"1.0\"?>\n"
+                                         "<PropertyList>\n"
+                                         "  <v type=\"int\">12</v>\n"
+                                         "</PropertyList>\n");
+    SGPropertyNode_ptr changed = new SGPropertyNode;
+    readProperties(a, changed);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().includeMisses, start.includeMisses + 2);
+    SG_CHECK_EQUAL(changed->getIntValue("first/v"), 12);
+
+    // a top level include applies to the start node, which takes the mode
+    // and location of the including <PropertyList>, as without the cache
+    const SGPath c = temp.file("c.xml");
+    writeTextFile(c, "<?xml version=\"1.0\"?>\n"
+                     "<PropertyList include=\"base.xml\">\n"
+                     "  <extra type=\"int\">5</extra>\n"
+                     "</PropertyList>\n");
+    const int attributes = SGPropertyNode::READ | SGPropertyNode::ARCHIVE |
+                           SGPropertyNode::USERARCHIVE | SGPropertyNode::PRESERVE;
+    setPropertiesIncludeCacheEnabled(false);
+    SGPropertyNode_ptr uncached = new SGPropertyNode;
+    uncached->setAttributes(attributes);
+    readProperties(c, uncached);
+    SG_CHECK_EQUAL(uncached->getAttributes(),
+                   SGPropertyNode::READ | SGPropertyNode::WRITE);
+    SG_CHECK_EQUAL(std::string(uncached->getLocation().getPath()), c.utf8Str());
+    SG_CHECK_EQUAL(uncached->getLocation().getLine(), 2);
+    setPropertiesIncludeCacheEnabled(true);
+
+    for (int i = 0; i < 2; ++i) {
+        SGPropertyNode_ptr target = new SGPropertyNode;
+        target->setAttributes(attributes);
+        readProperties(c, target);
+        checkAttributesAndLocations(uncached, target);
+        SG_CHECK_EQUAL(target->getIntValue("v"), 12);
+        SG_CHECK_EQUAL(target->getIntValue("extra"), 5);
+    }
+    SG_CHECK_EQUAL(getPropertiesCacheStats().includeMisses, start.includeMisses + 3);
+    SG_CHECK_EQUAL(getPropertiesCacheStats().includeHits, start.includeHits + 3);
+
+    clearPropertiesIncludeCache();
+}
+
+void testInternedNames()
+{
+    SGPropertyNode_ptr root = new SGPropertyNode;
+    SGPropertyNode* a = root->getNode("engines/engine[0]/rpm", true);
+    SGPropertyNode* b = root->getNode("engines/engine[1]/rpm", true);
+    SGPropertyNode* c = root->getNode("gear/gear/rpm", true);
+
+    // nodes of the same name share a single copy
+    SG_VERIFY(&a->getNameString() == &b->getNameString());
+    SG_VERIFY(&a->getNameString() == &c->getNameString());
+    SG_CHECK_EQUAL(a->getNameString(), "rpm");
+
+    // also when renamed by addChild()
+    SGPropertyNode_ptr moved = new SGPropertyNode;
+    root->getNode("gear/gear")->addChild(moved, "rpm", 0, true);
+    SG_VERIFY(&moved->getNameString() == &a->getNameString());
+    SG_CHECK_EQUAL(moved->getIndex(), 1);
+    SG_VERIFY(root->getNode("gear/gear/rpm[1]") == moved);
+
+    SG_VERIFY(root->getNode("engines/engine[1]/rpm") == b);
+    SG_VERIFY(root->getNode("engines/engine/never-used-name-8734") == nullptr);
+    SG_VERIFY(root->getNode("engines")->getChild("engine", 2) == nullptr);
+    SG_VERIFY(root->getChild("never-used-name-8735") == nullptr);
+
+    const SGPropertyNode::NameStats stats = SGPropertyNode::getNameStats(*root);
+    SG_CHECK_EQUAL(stats.nodes, 10);
+    SG_CHECK_EQUAL(stats.distinctNames, 5); // including the root's empty name
+    SG_VERIFY(stats.bytesSaved() > 0);
+
+    bool thrown = false;
+    try {
+        root->addChild(new SGPropertyNode, "1bad");
+    } catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    SG_VERIFY(thrown);
+}
+
+void testNodePool()
+{
+    const size_t live = SGPropertyNode::getPoolStats().liveNodes;
+    {
+        SGPropertyNode_ptr root = new SGPropertyNode;
+        for (int i = 0; i < 1000; ++i) {
+            root->getNode("a/b", i, true)->setIntValue(i);
+        }
+        SG_CHECK_EQUAL(SGPropertyNode::getPoolStats().liveNodes, live + 1002);
+        SG_CHECK_EQUAL(root->getNode("a/b[999]")->getIntValue(), 999);
+    }
+
+    const SGPropertyNode::PoolStats stats = SGPropertyNode::getPoolStats();
+    SG_CHECK_EQUAL(stats.liveNodes, live);
+    SG_CHECK_EQUAL(stats.nodeSize, sizeof(SGPropertyNode));
+    SG_VERIFY(stats.poolBytes >= 1002 * sizeof(SGPropertyNode));
+
+    // nodes built on other threads, some deleted there and some here
+    SGPropertyNode_ptr kept[4];
+    std::thread builders[4];
+    for (int t = 0; t < 4; ++t) {
+        builders[t] = std::thread([&kept, t] {
+            SGPropertyNode_ptr scratch = new SGPropertyNode;
+            kept[t] = new SGPropertyNode;
+            for (int i = 0; i < 500; ++i) {
+                scratch->getNode("x", i, true);
+                kept[t]->getNode("y", i, true);
+            }
+        });
+    }
+    for (auto& b : builders) {
+        b.join();
+    }
+    SG_CHECK_EQUAL(SGPropertyNode::getPoolStats().liveNodes, live + 4 * 501);
+    for (auto& k : kept) {
+        k.clear();
+    }
+    SG_CHECK_EQUAL(SGPropertyNode::getPoolStats().liveNodes, live);
+}
+
 int main (int ac, char ** av)
 {
   test_value();
@@ -994,6 +1326,11 @@ int main (int ac, char ** av)
     tiedPropertiesListeners();
     testDeleterListener();
     testAliasedListeners();
+    testBinaryProperties();
+    testPropertiesCache();
+    testIncludeCache();
+    testInternedNames();
+    testNodePool();
 
     return 0;
 }
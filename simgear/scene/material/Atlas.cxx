@@ -191,6 +191,8 @@ void Atlas::addMaterial(int landclass, bool isWater, bool isSea, SGMaterial* mat
 }    
 
 void Atlas::addUniforms(osg::StateSet* stateset) {
+    // Terrain tiles may be generated concurrently, sharing the atlas.
+    std::lock_guard<std::mutex> lock(_uniformsMutex);
     stateset->addUniform(_dimensions);
     stateset->addUniform(_ambient);
     stateset->addUniform(_diffuse);
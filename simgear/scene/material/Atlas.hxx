@@ -29,6 +29,7 @@
 #include <osg/Texture1D>
 
 #include <memory>
+#include <mutex>
 #include <string>   // Standard C++ string library
 #include <map>      // STL associative "array"
 #include <vector>   // STL "array"
@@ -85,6 +86,7 @@ private:
     osg::ref_ptr<osg::Uniform> _materialParams1;
     osg::ref_ptr<osg::Uniform> _materialParams2;
     osg::ref_ptr<osg::Uniform> _materialParams3;
+    std::mutex _uniformsMutex; // protects the parents of the uniforms above
 
     unsigned int _imageIndex; // Index into the image
     unsigned int _materialLookupIndex; // Index into the material lookup
@@ -21,12 +21,25 @@
 #include "mipmap.hxx"
 #include "EffectBuilder.hxx"
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 #include <iomanip>
+#include <type_traits>
+
+#if defined(ENABLE_SIMD) && defined(__SSE2__)
+# include <emmintrin.h>
+# define SG_MIPMAP_SSE2 1
+#elif defined(ENABLE_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+# include <arm_neon.h>
+# define SG_MIPMAP_NEON 1
+#endif
 
 #include <osg/Image>
 #include <osg/Vec4>
 
+#include <simgear/threads/SGThreadPool.hxx>
+
 namespace simgear { namespace effect {
 
 EffectNameValue<MipMapFunction> mipmapFunctionsInit[] =
@@ -261,7 +274,380 @@ void dumpMipmap( std::string n, int s, int t, int r, int c, unsigned char *d, co
     }
 }
 
-osg::Image* computeMipmap( osg::Image* image, MipMapTuple attrs )
+
+// Fast paths for the common texture formats (RGBA, RGB and LUMINANCE with
+// unsigned byte or float components).  They perform exactly the same floating
+// point operations, in the same order, as the generic getColor() /
+// computeColor() / setColor() path above, so the result is bit-identical, but
+// without the per-texel format switches and osg::Vec4 round trips.
+namespace {
+
+template <typename T> struct TexelScale;
+
+template <> struct TexelScale<unsigned char>
+{
+    static float read() { return 1.0f/255.0f; }
+    static float write() { return 255.0f; }
+};
+
+template <> struct TexelScale<float>
+{
+    static float read() { return 1.0f; }
+    static float write() { return 1.0f; }
+};
+
+// One level reduction: the source texels sampled for a destination texel are
+// the same for the whole level, so their byte offsets are computed once.
+struct MipmapLevel
+{
+    const unsigned char* src;
+    unsigned char* dest;
+    int ns, nt;
+    unsigned int srcRow, srcSlice, destRow, destSlice;
+    unsigned int srcTexel, destTexel;
+    unsigned int offsets[8];
+    int nbSamples;
+    MipMapFunction functions[4];
+};
+
+// Below this many destination texels a level is reduced on the calling thread,
+// above it on the shared thread pool in chunks of about ParallelTexelGrain.
+const int ParallelTexelThreshold = 128 * 128;
+const int ParallelTexelGrain = 64 * 64;
+
+inline float reduceSamples( MipMapFunction f, const float* v, int n )
+{
+    float r;
+    switch ( f )
+    {
+    case AVERAGE:
+        r = 0;
+        for ( int i = 0; i < n; ++i ) r += v[i];
+        return r / float(n);
+    case SUM:
+        r = 0;
+        for ( int i = 0; i < n; ++i ) r += v[i];
+        return r;
+    case PRODUCT:
+        r = 1;
+        for ( int i = 0; i < n; ++i ) r *= v[i];
+        return r;
+    case MIN:
+        r = std::numeric_limits<float>::max();
+        for ( int i = 0; i < n; ++i ) r = std::min( r, v[i] );
+        return r;
+    case MAX:
+        r = std::numeric_limits<float>::min();
+        for ( int i = 0; i < n; ++i ) r = std::max( r, v[i] );
+        return r;
+    default: break;
+    }
+    return 0;
+}
+
+template <typename T, int N>
+void reduceRowsScalar( const MipmapLevel& l, int rowBegin, int rowEnd )
+{
+    const float readScale = TexelScale<T>::read();
+    const float writeScale = TexelScale<T>::write();
+    for ( int row = rowBegin; row < rowEnd; ++row )
+    {
+        int k = row / l.nt, j = row % l.nt;
+        const unsigned char* src = l.src + 2*k*l.srcSlice + 2*j*l.srcRow;
+        unsigned char* dest = l.dest + k*l.destSlice + j*l.destRow;
+        for ( int i = 0; i < l.ns; ++i, src += 2*l.srcTexel, dest += l.destTexel )
+        {
+            float v[N][8];
+            for ( int n = 0; n < l.nbSamples; ++n )
+            {
+                const T* p = reinterpret_cast<const T*>( src + l.offsets[n] );
+                for ( int c = 0; c < N; ++c )
+                    v[c][n] = float(p[c])*readScale;
+            }
+            T* out = reinterpret_cast<T*>( dest );
+            for ( int c = 0; c < N; ++c )
+                out[c] = reduceSamples( l.functions[c], v[c], l.nbSamples )*writeScale;
+        }
+    }
+}
+
+#if defined(SG_MIPMAP_SSE2)
+
+inline __m128 loadTexel( const unsigned char* p, std::integral_constant<int, 4> )
+{
+    int32_t bits;
+    memcpy( &bits, p, 4 );
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi8( _mm_cvtsi32_si128( bits ), zero );
+    return _mm_cvtepi32_ps( _mm_unpacklo_epi16( v, zero ) );
+}
+
+inline __m128 loadTexel( const unsigned char* p, std::integral_constant<int, 3> )
+{
+    return _mm_cvtepi32_ps( _mm_setr_epi32( p[0], p[1], p[2], 0 ) );
+}
+
+inline __m128 loadTexel( const float* p, std::integral_constant<int, 4> )
+{
+    return _mm_loadu_ps( p );
+}
+
+inline __m128 loadTexel( const float* p, std::integral_constant<int, 3> )
+{
+    return _mm_setr_ps( p[0], p[1], p[2], 0.0f );
+}
+
+// Float to unsigned char conversion truncates to a 32 bit integer and keeps
+// the low byte, exactly like the scalar conversion in _writeColor().
+inline void storeTexel( unsigned char* p, __m128 v, int n )
+{
+    __m128i i = _mm_and_si128( _mm_cvttps_epi32( v ), _mm_set1_epi32( 0xff ) );
+    i = _mm_packus_epi16( _mm_packs_epi32( i, i ), i );
+    int32_t bits = _mm_cvtsi128_si32( i );
+    memcpy( p, &bits, n );
+}
+
+inline void storeTexel( float* p, __m128 v, int n )
+{
+    float f[4];
+    _mm_storeu_ps( f, v );
+    memcpy( p, f, n * sizeof(float) );
+}
+
+template <typename T, int N>
+void reduceRowsSIMD( const MipmapLevel& l, int rowBegin, int rowEnd )
+{
+    const __m128 readScale = _mm_set1_ps( TexelScale<T>::read() );
+    const __m128 writeScale = _mm_set1_ps( TexelScale<T>::write() );
+    const __m128 count = _mm_set1_ps( float(l.nbSamples) );
+    const __m128 initMin = _mm_set1_ps( std::numeric_limits<float>::max() );
+    const __m128 initMax = _mm_set1_ps( std::numeric_limits<float>::min() );
+    __m128 mask[MAX + 1];
+    for ( int f = 0; f <= MAX; ++f )
+    {
+        mask[f] = _mm_castsi128_ps( _mm_setr_epi32( l.functions[0] == f ? -1 : 0, l.functions[1] == f ? -1 : 0,
+                                                    l.functions[2] == f ? -1 : 0, l.functions[3] == f ? -1 : 0 ) );
+    }
+    for ( int row = rowBegin; row < rowEnd; ++row )
+    {
+        int k = row / l.nt, j = row % l.nt;
+        const unsigned char* src = l.src + 2*k*l.srcSlice + 2*j*l.srcRow;
+        unsigned char* dest = l.dest + k*l.destSlice + j*l.destRow;
+        for ( int i = 0; i < l.ns; ++i, src += 2*l.srcTexel, dest += l.destTexel )
+        {
+            __m128 sum = _mm_setzero_ps(), prod = _mm_set1_ps( 1.0f ), mn = initMin, mx = initMax;
+            for ( int n = 0; n < l.nbSamples; ++n )
+            {
+                __m128 v = _mm_mul_ps( loadTexel( reinterpret_cast<const T*>( src + l.offsets[n] ),
+                                                  std::integral_constant<int, N>() ), readScale );
+                sum = _mm_add_ps( sum, v );
+                prod = _mm_mul_ps( prod, v );
+                mn = _mm_min_ps( v, mn );
+                mx = _mm_max_ps( v, mx );
+            }
+            __m128 r = _mm_and_ps( mask[AVERAGE], _mm_div_ps( sum, count ) );
+            r = _mm_or_ps( r, _mm_and_ps( mask[SUM], sum ) );
+            r = _mm_or_ps( r, _mm_and_ps( mask[PRODUCT], prod ) );
+            r = _mm_or_ps( r, _mm_and_ps( mask[MIN], mn ) );
+            r = _mm_or_ps( r, _mm_and_ps( mask[MAX], mx ) );
+            storeTexel( reinterpret_cast<T*>( dest ), _mm_mul_ps( r, writeScale ), N );
+        }
+    }
+}
+
+#elif defined(SG_MIPMAP_NEON)
+
+inline float32x4_t loadTexel( const unsigned char* p, std::integral_constant<int, 4> )
+{
+    uint32_t bits;
+    memcpy( &bits, p, 4 );
+    uint16x8_t v = vmovl_u8( vreinterpret_u8_u32( vdup_n_u32( bits ) ) );
+    return vcvtq_f32_u32( vmovl_u16( vget_low_u16( v ) ) );
+}
+
+inline float32x4_t loadTexel( const unsigned char* p, std::integral_constant<int, 3> )
+{
+    const uint32_t v[4] = { p[0], p[1], p[2], 0 };
+    return vcvtq_f32_u32( vld1q_u32( v ) );
+}
+
+inline float32x4_t loadTexel( const float* p, std::integral_constant<int, 4> )
+{
+    return vld1q_f32( p );
+}
+
+inline float32x4_t loadTexel( const float* p, std::integral_constant<int, 3> )
+{
+    const float v[4] = { p[0], p[1], p[2], 0.0f };
+    return vld1q_f32( v );
+}
+
+// Saturating conversion to 32 bit and keeping the low byte, exactly like the
+// scalar conversion in _writeColor() on AArch64.
+inline void storeTexel( unsigned char* p, float32x4_t v, int n )
+{
+    uint8x8_t b = vmovn_u16( vcombine_u16( vmovn_u32( vcvtq_u32_f32( v ) ), vdup_n_u16( 0 ) ) );
+    uint8_t out[8];
+    vst1_u8( out, b );
+    memcpy( p, out, n );
+}
+
+inline void storeTexel( float* p, float32x4_t v, int n )
+{
+    float f[4];
+    vst1q_f32( f, v );
+    memcpy( p, f, n * sizeof(float) );
+}
+
+template <typename T, int N>
+void reduceRowsSIMD( const MipmapLevel& l, int rowBegin, int rowEnd )
+{
+    const float32x4_t readScale = vdupq_n_f32( TexelScale<T>::read() );
+    const float32x4_t writeScale = vdupq_n_f32( TexelScale<T>::write() );
+    const float32x4_t count = vdupq_n_f32( float(l.nbSamples) );
+    const float32x4_t initMin = vdupq_n_f32( std::numeric_limits<float>::max() );
+    const float32x4_t initMax = vdupq_n_f32( std::numeric_limits<float>::min() );
+    uint32x4_t mask[MAX + 1];
+    for ( int f = 0; f <= MAX; ++f )
+    {
+        const uint32_t m[4] = { l.functions[0] == f ? ~0u : 0u, l.functions[1] == f ? ~0u : 0u,
+                                l.functions[2] == f ? ~0u : 0u, l.functions[3] == f ? ~0u : 0u };
+        mask[f] = vld1q_u32( m );
+    }
+    for ( int row = rowBegin; row < rowEnd; ++row )
+    {
+        int k = row / l.nt, j = row % l.nt;
+        const unsigned char* src = l.src + 2*k*l.srcSlice + 2*j*l.srcRow;
+        unsigned char* dest = l.dest + k*l.destSlice + j*l.destRow;
+        for ( int i = 0; i < l.ns; ++i, src += 2*l.srcTexel, dest += l.destTexel )
+        {
+            float32x4_t sum = vdupq_n_f32( 0.0f ), prod = vdupq_n_f32( 1.0f ), mn = initMin, mx = initMax;
+            for ( int n = 0; n < l.nbSamples; ++n )
+            {
+                float32x4_t v = vmulq_f32( loadTexel( reinterpret_cast<const T*>( src + l.offsets[n] ),
+                                                      std::integral_constant<int, N>() ), readScale );
+                sum = vaddq_f32( sum, v );
+                prod = vmulq_f32( prod, v );
+                mn = vbslq_f32( vcltq_f32( v, mn ), v, mn );
+                mx = vbslq_f32( vcgtq_f32( v, mx ), v, mx );
+            }
+            uint32x4_t r = vandq_u32( mask[AVERAGE], vreinterpretq_u32_f32( vdivq_f32( sum, count ) ) );
+            r = vorrq_u32( r, vandq_u32( mask[SUM], vreinterpretq_u32_f32( sum ) ) );
+            r = vorrq_u32( r, vandq_u32( mask[PRODUCT], vreinterpretq_u32_f32( prod ) ) );
+            r = vorrq_u32( r, vandq_u32( mask[MIN], vreinterpretq_u32_f32( mn ) ) );
+            r = vorrq_u32( r, vandq_u32( mask[MAX], vreinterpretq_u32_f32( mx ) ) );
+            storeTexel( reinterpret_cast<T*>( dest ), vmulq_f32( vreinterpretq_f32_u32( r ), writeScale ), N );
+        }
+    }
+}
+
+#endif
+
+template <typename T, int N>
+void reduceRows( const MipmapLevel& l, int rowBegin, int rowEnd )
+{
+#if defined(SG_MIPMAP_SSE2) || defined(SG_MIPMAP_NEON)
+    if constexpr ( N >= 3 )
+        reduceRowsSIMD<T, N>( l, rowBegin, rowEnd );
+    else
+#endif
+        reduceRowsScalar<T, N>( l, rowBegin, rowEnd );
+}
+
+template <typename T, int N>
+void reduceLevel( const MipmapLevel& l, int rows )
+{
+    if ( rows < 2 || l.ns * rows < ParallelTexelThreshold )
+    {
+        reduceRows<T, N>( l, 0, rows );
+        return;
+    }
+
+    // Rows of one level are independent, levels are not.
+    int grain = std::max( 1, ParallelTexelGrain / l.ns );
+    SGThreadPool::shared().parallelFor( 0, rows, grain, [&l]( int begin, int end ) {
+        reduceRows<T, N>( l, begin, end );
+    } );
+}
+
+template <typename T, int N>
+void buildLevels( const osg::Image* image, MipMapTuple attrs, unsigned char* data,
+                  const osg::Image::MipmapDataType& mipmapOffsets )
+{
+    MipmapLevel l;
+    l.functions[0] = std::get<0>(attrs);
+    l.functions[1] = std::get<1>(attrs);
+    l.functions[2] = std::get<2>(attrs);
+    l.functions[3] = std::get<3>(attrs);
+    l.srcTexel = l.destTexel = N * sizeof(T);
+
+    int s = image->s();
+    int t = image->t();
+    int r = image->r();
+    GLenum pixelFormat = image->getPixelFormat();
+    GLenum dataType = image->getDataType();
+    int packing = image->getPacking();
+    for ( osg::Image::MipmapDataType::size_type m = 0; m < mipmapOffsets.size(); ++m )
+    {
+        l.src = data + ( m > 0 ? mipmapOffsets[m-1] : 0 );
+        l.dest = data + mipmapOffsets[m];
+        l.ns = std::max( s >> 1, 1 );
+        l.nt = std::max( t >> 1, 1 );
+        int nr = std::max( r >> 1, 1 );
+        l.srcRow = osg::Image::computeRowWidthInBytes( s, pixelFormat, dataType, packing );
+        l.srcSlice = t * l.srcRow;
+        l.destRow = osg::Image::computeRowWidthInBytes( l.ns, pixelFormat, dataType, packing );
+        l.destSlice = l.nt * l.destRow;
+
+        // Same sample order as the colors[2][2][2] accumulation in computeAverage() & co.
+        l.nbSamples = 0;
+        for ( int dx = 0; dx < 2; ++dx ) for ( int dy = 0; dy < 2; ++dy ) for ( int dz = 0; dz < 2; ++dz )
+        {
+            if ( ( dx == 0 || s > 1 ) && ( dy == 0 || t > 1 ) && ( dz == 0 || r > 1 ) )
+                l.offsets[l.nbSamples++] = dx * l.srcTexel + dy * l.srcRow + dz * l.srcSlice;
+        }
+
+        reduceLevel<T, N>( l, l.nt * nr );
+
+        s = l.ns;
+        t = l.nt;
+        r = nr;
+    }
+}
+
+template <typename T>
+bool buildLevels( const osg::Image* image, MipMapTuple attrs, unsigned char* data,
+                  const osg::Image::MipmapDataType& mipmapOffsets )
+{
+    switch ( image->getPixelFormat() )
+    {
+    case GL_LUMINANCE: buildLevels<T, 1>( image, attrs, data, mipmapOffsets ); return true;
+    case GL_RGB:       buildLevels<T, 3>( image, attrs, data, mipmapOffsets ); return true;
+    case GL_RGBA:      buildLevels<T, 4>( image, attrs, data, mipmapOffsets ); return true;
+    default: break;
+    }
+    return false;
+}
+
+// Returns false if the image format has no fast path.
+bool buildLevelsFast( const osg::Image* image, MipMapTuple attrs, unsigned char* data,
+                      const osg::Image::MipmapDataType& mipmapOffsets )
+{
+    int r = image->r();
+    if ( r & (r - 1) )
+        return false;
+    switch ( image->getDataType() )
+    {
+    case GL_UNSIGNED_BYTE: return buildLevels<unsigned char>( image, attrs, data, mipmapOffsets );
+    case GL_FLOAT:         return buildLevels<float>( image, attrs, data, mipmapOffsets );
+    default: break;
+    }
+    return false;
+}
+
+} // anonymous namespace
+
+osg::Image* computeMipmap( osg::Image* image, MipMapTuple attrs, bool useFastPath )
 {
     bool computeMipmap = false;
     unsigned int nbComponents = osg::Image::computeNumComponents( image->getPixelFormat() );
@@ -307,7 +693,8 @@ osg::Image* computeMipmap( osg::Image* image, MipMapTuple attrs )
         s = image->s();
         t = image->t();
         r = image->r();
-        for ( int m = 0; m < nb-1; ++m )
+        bool built = useFastPath && buildLevelsFast( image, attrs, data, mipmapOffsets );
+        for ( int m = 0; !built && m < nb-1; ++m )
         {
             unsigned char *src = data;
             if ( m > 0 )
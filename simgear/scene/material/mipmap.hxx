@@ -48,7 +48,13 @@ typedef std::tuple<MipMapFunction, MipMapFunction, MipMapFunction, MipMapFunctio
 
 MipMapTuple makeMipMapTuple(Effect* effect, const SGPropertyNode* props,
                       const SGReaderWriterOptions* options);
-osg::Image* computeMipmap( osg::Image* image, MipMapTuple attrs );
+/**
+ * Build the mipmap levels of @a image with the given per channel functions.
+ * RGBA, RGB and LUMINANCE images with unsigned byte or float components use
+ * SIMD, multithreaded kernels unless @a useFastPath is false; their output is
+ * bit-identical to the generic per-texel path used for all other formats.
+ */
+osg::Image* computeMipmap( osg::Image* image, MipMapTuple attrs, bool useFastPath = true );
 } }
 
 #endif
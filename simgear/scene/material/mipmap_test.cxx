@@ -0,0 +1,85 @@
+#include <simgear_config.h>
+#include <simgear/compiler.h>
+#include <simgear/misc/test_macros.hxx>
+
+#include "mipmap.hxx"
+
+#include <cstring>
+#include <random>
+
+#include <osg/Image>
+
+using namespace simgear::effect;
+
+static osg::ref_ptr<osg::Image> makeImage(int s, int t, int r, GLenum pixelFormat,
+                                          GLenum dataType, int packing)
+{
+    osg::ref_ptr<osg::Image> image = new osg::Image;
+    image->allocateImage(s, t, r, pixelFormat, dataType, packing);
+
+    std::mt19937 rng(s * 131 + t * 17 + r + pixelFormat + dataType + packing);
+    unsigned char* data = image->data();
+    unsigned int size = image->getTotalSizeInBytes();
+    if (dataType == GL_FLOAT) {
+        std::uniform_real_distribution<float> dist(0.0f, 2.0f);
+        float* f = reinterpret_cast<float*>(data);
+        for (unsigned int i = 0; i < size / sizeof(float); ++i)
+            f[i] = dist(rng);
+    } else {
+        for (unsigned int i = 0; i < size; ++i)
+            data[i] = rng() & 0xff;
+    }
+    return image;
+}
+
+// The fast kernels must reproduce the generic per-texel path bit for bit.
+static void checkFastPath(int s, int t, int r, GLenum pixelFormat, GLenum dataType,
+                          int packing, MipMapTuple attrs)
+{
+    osg::ref_ptr<osg::Image> image = makeImage(s, t, r, pixelFormat, dataType, packing);
+    osg::ref_ptr<osg::Image> generic = computeMipmap(image.get(), attrs, false);
+    osg::ref_ptr<osg::Image> fast = computeMipmap(image.get(), attrs, true);
+
+    SG_VERIFY(generic.get() != image.get());
+    SG_CHECK_EQUAL(generic->getNumMipmapLevels(), fast->getNumMipmapLevels());
+    unsigned int size = generic->getTotalSizeInBytesIncludingMipmaps();
+    SG_CHECK_EQUAL(size, fast->getTotalSizeInBytesIncludingMipmaps());
+    if (memcmp(generic->data(), fast->data(), size) != 0) {
+        std::cerr << "mipmap mismatch: " << s << "x" << t << "x" << r
+                  << " format " << pixelFormat << " type " << dataType
+                  << " packing " << packing << std::endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const GLenum formats[] = { GL_RGBA, GL_RGB, GL_LUMINANCE };
+    const GLenum types[] = { GL_UNSIGNED_BYTE, GL_FLOAT };
+    const MipMapTuple functions[] = {
+        MipMapTuple(AVERAGE, AVERAGE, AVERAGE, AVERAGE),
+        MipMapTuple(SUM, PRODUCT, MIN, MAX),
+        MipMapTuple(MAX, MIN, SUM, AVERAGE),
+        MipMapTuple(PRODUCT, SUM, AVERAGE, MIN)
+    };
+    const int sizes[][3] = {
+        { 256, 128, 1 }, { 1, 64, 1 }, { 64, 1, 1 }, { 8, 8, 4 }, { 16, 4, 2 },
+        // large enough to be split across threads
+        { 1024, 1024, 1 }
+    };
+
+    for (GLenum format : formats)
+        for (GLenum type : types)
+            for (const MipMapTuple& attrs : functions)
+                for (const auto& size : sizes) {
+                    checkFastPath(size[0], size[1], size[2], format, type, 1, attrs);
+                    checkFastPath(size[0], size[1], size[2], format, type, 4, attrs);
+                }
+
+    // formats without a fast path still take the generic path
+    checkFastPath(64, 64, 1, GL_RGBA, GL_UNSIGNED_SHORT, 1,
+                  MipMapTuple(AVERAGE, MAX, MIN, SUM));
+
+    std::cout << "all tests passed successfully!" << std::endl;
+    return 0;
+}
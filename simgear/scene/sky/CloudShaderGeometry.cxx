@@ -20,14 +20,19 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
 
 #include <osgDB/Registry>
 #include <osgDB/Input>
 #include <osgDB/ParameterOutput>
+#include <osgUtil/CullVisitor>
 
 #include "CloudShaderGeometry.hxx"
 
 #include <simgear/props/props.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 using namespace osg;
 using namespace osgDB;
@@ -35,97 +40,172 @@ using namespace simgear;
 
 namespace
 {
-struct SpriteComp
+std::atomic<unsigned int> sortCount(0);
+std::atomic<unsigned int> spriteCount(0);
+std::atomic<std::uint64_t> sortNanos(0);
+
+// Stable two pass radix sort of the sprite indices by their 16 bit keys,
+// 8 bits per pass.
+void radixSort(const std::vector<unsigned short>& keys,
+               std::vector<unsigned int>& order,
+               std::vector<unsigned int>& scratch)
 {
-    bool operator() (const CloudShaderGeometry::SortData::SortItem& lhs,
-                     const CloudShaderGeometry::SortData::SortItem& rhs) const
-    {
-        return lhs.depth > rhs.depth;
+    const unsigned int n = keys.size();
+    unsigned int count[2][256] = {};
+
+    for (unsigned int i = 0; i < n; ++i) {
+        ++count[0][keys[i] & 0xff];
+        ++count[1][keys[i] >> 8];
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        unsigned int sum = 0;
+        for (int b = 0; b < 256; ++b) {
+            unsigned int c = count[pass][b];
+            count[pass][b] = sum;
+            sum += c;
+        }
+    }
+
+    scratch.resize(n);
+    order.resize(n);
+    for (unsigned int i = 0; i < n; ++i)
+        scratch[count[0][keys[i] & 0xff]++] = i;
+    for (unsigned int i = 0; i < n; ++i) {
+        unsigned int idx = scratch[i];
+        order[count[1][keys[idx] >> 8]++] = idx;
     }
-};
+}
 }
 namespace simgear
 {
+bool CloudShaderGeometry::SortCallback::cull(NodeVisitor* nv, Drawable* drawable,
+                                             RenderInfo* renderInfo) const
+{
+    osgUtil::CullVisitor* cv = dynamic_cast<osgUtil::CullVisitor*>(nv);
+    CloudShaderGeometry* geom = static_cast<CloudShaderGeometry*>(drawable);
+    if (cv && renderInfo && cv->getModelViewMatrix()) {
+        // With several views per context the order of the last one is drawn,
+        // as before.
+        SortData& sortData = geom->getSortData(renderInfo->getContextID());
+        geom->sort(sortData, *cv->getModelViewMatrix());
+    }
+    return false;
+}
+
+CloudShaderGeometry::SortData&
+CloudShaderGeometry::getSortData(unsigned int contextID) const
+{
+    std::lock_guard<std::mutex> lock(_sortDataMutex);
+    osg::ref_ptr<SortData>& sortData = _sortData[contextID];
+    if (!sortData.valid())
+        sortData = new SortData;
+    return *sortData;
+}
+
+void CloudShaderGeometry::sort(SortData& sortData, const Matrix& modelView) const
+{
+    if (!_geometry.valid())
+        return;
+
+    const Geometry* g = _geometry->asGeometry();
+    const Vec4Array* c = g ? dynamic_cast<const Vec4Array*>(g->getColorArray()) : 0;
+    if (!c)
+        return;
+
+    std::lock_guard<std::mutex> lock(sortData.sortMutex);
+    SGTimeStamp start = SGTimeStamp::now();
+
+    // The position of the sprite is stored in the colour array, with the
+    // exception of the w() coordinate which is the z-scaling parameter.
+    // Sort by the distance along the view direction, quantised to 16 bits
+    // over the depth range of the cloud, farthest first.
+    const unsigned int numSprites = c->size() / 4;
+    std::vector<unsigned int>& order = sortData.back;
+    std::vector<float>& depths = sortData.depths;
+    depths.resize(numSprites);
+
+    float minDepth = FLT_MAX, maxDepth = -FLT_MAX;
+    for (unsigned int i = 0; i < numSprites; ++i) {
+        const Vec4f& p = (*c)[4 * i];
+        float d = -(p.x() * modelView(0, 2) + p.y() * modelView(1, 2)
+                    + p.z() * modelView(2, 2) + modelView(3, 2));
+        depths[i] = d;
+        minDepth = std::min(minDepth, d);
+        maxDepth = std::max(maxDepth, d);
+    }
+
+    float scale = maxDepth > minDepth ? 65535.0f / (maxDepth - minDepth) : 0.0f;
+    sortData.keys.resize(numSprites);
+    for (unsigned int i = 0; i < numSprites; ++i)
+        sortData.keys[i] = static_cast<unsigned short>((maxDepth - depths[i]) * scale);
+
+    radixSort(sortData.keys, order, sortData.scratch);
+
+    {
+        std::lock_guard<std::mutex> swapLock(sortData.swapMutex);
+        sortData.front.swap(order);
+        ++sortData.generation;
+    }
+
+    sortCount++;
+    spriteCount += numSprites;
+    sortNanos += static_cast<std::uint64_t>((SGTimeStamp::now() - start).toNSecs());
+}
+
+CloudShaderGeometry::SortStats CloudShaderGeometry::getSortStats()
+{
+    SortStats stats;
+    stats.sorts = sortCount.exchange(0);
+    stats.sprites = spriteCount.exchange(0);
+    stats.time = sortNanos.exchange(0) * 1e-6;
+    return stats;
+}
+
 void CloudShaderGeometry::drawImplementation(RenderInfo& renderInfo) const
 {
-    if (_cloudsprites.empty()) return;
+    if (_cloudsprites.empty() || !_geometry.valid()) return;
     
     osg::State& state = *renderInfo.getState();
-    
-    int frameNumber = state.getFrameStamp()->getFrameNumber();
-    unsigned int contextID = state.getContextID();    
-    SortData& sortData = _sortData[contextID];
-    Geometry* g = _geometry->asGeometry();
-    
-    // If the cloud is already sorted, then it is likely to still be sorted.
-    // Therefore we can avoid re-sorting it for a period. If it is still
-    // sorted after that period, then we can wait for a longer period before
-    // checking again. In this way, only clouds that are changing regularly
-    // are sorted.        
-    osg::Vec3Array* v = dynamic_cast<osg::Vec3Array*>(g->getVertexArray());
-    if ((v->size() > 4) && 
-        (frameNumber - sortData.skip_limit >= sortData.frameSorted)) {
-        Matrix mvp = state.getModelViewMatrix() * state.getProjectionMatrix();
-        
-        osg::Vec4Array* c = dynamic_cast<osg::Vec4Array*>(g->getColorArray());
-        osg::Vec2Array* t = dynamic_cast<osg::Vec2Array*>(g->getTexCoordArray(0));
-        Vec3f av[4];
-        Vec4f ac[4];
-        Vec2f at[4];        
-        
-        // Perform a single pass bubble sort of the array, 
-        // keeping track of whether we've had to make any changes
-        bool sorted = true;                      
-        for (unsigned int i = 4; i < v->size(); i = i + 4) {
-            // The position of the sprite is stored in the colour
-            // array, with the exception of the w() coordinate
-            // which is the z-scaling parameter.
-            Vec4f a = (*c)[i-4];
-            Vec4f aPos = Vec4f(a.x(), a.y(), a.z(), 1.0f) * mvp;
-            Vec4f b = (*c)[i];
-            Vec4f bPos = Vec4f(b.x(), b.y(), b.z(), 1.0f) * mvp;
-            
-            if ((aPos.z()/aPos.w()) < (bPos.z()/bPos.w() - 0.0001)) {
-                // a is non-trivially closer than b, so should be rendered
-                // later. Swap them around
-                for (int j = 0; j < 4; j++) {
-                    av[j] = (*v)[i+j-4];
-                    ac[j] = (*c)[i+j-4];
-                    at[j] = (*t)[i+j-4];
-                    
-                    (*v)[i+j -4] = (*v)[i+j];
-                    (*c)[i+j -4] = (*c)[i+j];
-                    (*t)[i+j -4] = (*t)[i+j];
-                    
-                    (*v)[i+j] = av[j];
-                    (*c)[i+j] = ac[j];
-                    (*t)[i+j] = at[j];
-                }
-                
-                // Indicate that the arrays were not sorted
-                // so we should check them next iteration
-                sorted = false;
-            }
-        }
-        
-        if (sorted) {
-            // This cloud is sorted, so no need to re-sort.
-            
-            sortData.skip_limit = sortData.skip_limit * 2;
-            if (sortData.skip_limit > 30) {
-                // Jitter the skip frames to avoid synchronized sorts
-                // which will cause periodic frame-rate drops
-                sortData.skip_limit += sg_random() * 10;
-            }
-            if (sortData.skip_limit > 500) {
-                // Maximum of every 500 frames (10-20 seconds)
-                sortData.skip_limit = 500 + sg_random() * 10;
+    SortData& sortData = getSortData(state.getContextID());
+
+    // Draw a copy of the geometry sharing all arrays, with the sprites
+    // indexed in sorted order.
+    bool rebuilt = false;
+    if (sortData.source != _geometry.get()) {
+        const Geometry* g = _geometry->asGeometry();
+        if (!g || !g->getVertexArray()) return;
+
+        const unsigned int numVertices = g->getVertexArray()->getNumElements();
+        sortData.indices = new DrawElementsUInt(PrimitiveSet::QUADS, numVertices);
+        sortData.indices->setDataVariance(Object::DYNAMIC);
+        for (unsigned int i = 0; i < numVertices; ++i)
+            (*sortData.indices)[i] = i;
+
+        sortData.geometry = new Geometry(*g, CopyOp::SHALLOW_COPY);
+        sortData.geometry->removePrimitiveSet(0, sortData.geometry->getNumPrimitiveSets());
+        sortData.geometry->addPrimitiveSet(sortData.indices);
+        sortData.geometry->setUseDisplayList(false);
+        sortData.geometry->setUseVertexBufferObjects(true);
+        sortData.source = _geometry.get();
+        rebuilt = true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(sortData.swapMutex);
+        DrawElementsUInt& indices = *sortData.indices;
+        if ((rebuilt || sortData.drawnGeneration != sortData.generation) &&
+            sortData.front.size() * 4 == indices.size()) {
+            for (unsigned int i = 0; i < sortData.front.size(); ++i) {
+                unsigned int v = sortData.front[i] * 4;
+                indices[4 * i] = v;
+                indices[4 * i + 1] = v + 1;
+                indices[4 * i + 2] = v + 2;
+                indices[4 * i + 3] = v + 3;
             }
-        } else {
-            sortData.skip_limit = 1;
+            indices.dirty();
+            sortData.drawnGeneration = sortData.generation;
         }
-        
-        sortData.frameSorted = frameNumber;
     }
 
     const GLExtensions* extensions = GLExtensions::Get(state.getContextID(), true);
@@ -138,7 +218,20 @@ void CloudShaderGeometry::drawImplementation(RenderInfo& renderInfo) const
                        
     extensions->glVertexAttrib3fv(USR_ATTR_1, ua1 );
     extensions->glVertexAttrib3fv(USR_ATTR_2, ua2 );
-    _geometry->draw(renderInfo);    
+    sortData.geometry->draw(renderInfo);
+}
+
+void CloudShaderGeometry::releaseGLObjects(State* state) const
+{
+    Drawable::releaseGLObjects(state);
+    if (_geometry.valid())
+        _geometry->releaseGLObjects(state);
+
+    std::lock_guard<std::mutex> lock(_sortDataMutex);
+    for (unsigned int i = 0; i < _sortData.size(); ++i) {
+        if (_sortData[i].valid() && _sortData[i]->geometry.valid())
+            _sortData[i]->geometry->releaseGLObjects(state);
+    }
 }
 
 void CloudShaderGeometry::addSprite(const SGVec3f& p, int tx, int ty,
@@ -22,12 +22,15 @@
 #ifndef CLOUD_SHADER_GEOMETRY_HXX
 #define CLOUD_SHADER_GEOMETRY_HXX 1
 
+#include <mutex>
 #include <vector>
 
 #include <osg/BoundingBox>
 #include <osg/CopyOp>
 #include <osg/Drawable>
 #include <osg/Geometry>
+#include <osg/Matrix>
+#include <osg/PrimitiveSet>
 #include <osg/RenderInfo>
 #include <osg/Vec3>
 #include <osg/Vec4>
@@ -51,6 +54,7 @@ class CloudShaderGeometry : public osg::Drawable
         CloudShaderGeometry()
         { 
             setUseDisplayList(false); 
+            setCullCallback(new SortCallback);
         }
 
         CloudShaderGeometry(int vx, int vy, float width, float height, float ts, float ms, float bs, float shade, float ch, float zsc, float af) :
@@ -59,6 +63,7 @@ class CloudShaderGeometry : public osg::Drawable
             alpha_factor(af)
         { 
             setUseDisplayList(false); 
+            setCullCallback(new SortCallback);
             float x = width/2.0f;
             float z = height/2.0f;
             _bbox.expandBy(-x, -x, -z);
@@ -121,30 +126,62 @@ class CloudShaderGeometry : public osg::Drawable
         // Bounding box extents.
         osg::BoundingBox _bbox;
         
-    struct SortData
-    {
-        struct SortItem
+        /** Statistics of the depth sorting of all cloud sprites. */
+        struct SortStats
+        {
+            unsigned int sorts = 0;     ///< Number of sorted clouds
+            unsigned int sprites = 0;   ///< Number of sorted sprites
+            double time = 0.0;          ///< Total time spent sorting [ms]
+        };
+
+        /**
+         * Statistics accumulated since the previous call, so calling this
+         * once per frame gives the sorting cost per frame.
+         */
+        static SortStats getSortStats();
+
+        /**
+         * Sorts the sprites back to front for the current view during the
+         * cull traversal.
+         */
+        struct SortCallback : public osg::Drawable::CullCallback
         {
-            SortItem(size_t idx_, float depth_) : idx(idx_), depth(depth_) {}
-            SortItem() : idx(0), depth(0.0f) {}
-            size_t idx;
-            float depth;
+            virtual bool cull(osg::NodeVisitor* nv, osg::Drawable* drawable,
+                              osg::RenderInfo* renderInfo) const;
         };
-        SortData() : frameSorted(0), skip_limit(1), spriteIdx(0) {}
-        int frameSorted;
-        int skip_limit;
-        // This will be sorted by Z distance
-        typedef std::vector<SortItem> SortItemList;
-        SortItemList* spriteIdx;
+
+        virtual void releaseGLObjects(osg::State* state = 0) const;
+
+    // Sprite order for one graphics context. The cull traversal sorts into
+    // the back buffer and swaps it with the front buffer, from which the
+    // draw traversal takes the index array of its copy of the geometry.
+    struct SortData : public osg::Referenced
+    {
+        // Cull side
+        std::mutex sortMutex;
+        std::vector<float> depths;
+        std::vector<unsigned short> keys;
+        std::vector<unsigned int> scratch;
+        std::vector<unsigned int> back;
+
+        std::mutex swapMutex;
+        std::vector<unsigned int> front;
+        unsigned int generation = 0;
+
+        // Draw side, shares the arrays of _geometry
+        osg::ref_ptr<osg::Geometry> geometry;
+        osg::ref_ptr<osg::DrawElementsUInt> indices;
+        const osg::Drawable* source = nullptr;
+        unsigned int drawnGeneration = 0;
     };
 protected:
-    mutable osg::buffered_object<SortData> _sortData;
+    SortData& getSortData(unsigned int contextID) const;
+    void sort(SortData& sortData, const osg::Matrix& modelView) const;
+
+    mutable std::mutex _sortDataMutex;
+    mutable osg::buffered_object<osg::ref_ptr<SortData> > _sortData;
     
-    virtual ~CloudShaderGeometry()
-    {
-        for (unsigned int i = 0; i < _sortData.size(); ++i)
-            delete _sortData[i].spriteIdx;
-    }
+    virtual ~CloudShaderGeometry() {}
 };
 
 }
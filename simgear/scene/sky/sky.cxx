@@ -28,6 +28,7 @@
 #include "sky.hxx"
 #include "cloudfield.hxx"
 #include "newcloud.hxx"
+#include "CloudShaderGeometry.hxx"
 
 #include <simgear/scene/util/RenderConstants.hxx>
 #include <simgear/scene/util/OsgMath.hxx>
@@ -111,6 +112,9 @@ void SGSky::build( double h_radius_m,
     _ephTransform->addChild( oursun->build(tex_path, sun_size, property_tree_node ) );
    
     pre_root->addChild( pre_transform.get() );
+
+    if (property_tree_node)
+        _cloud_sort_stats = property_tree_node->getNode("cloud-sort-stats", true);
 }
 
 
@@ -200,6 +204,16 @@ bool SGSky::reposition( const SGSkyState &st, const SGEphemeris& eph, double dt
     }
     }
 
+    // sorting happens during the cull traversal, so these are the numbers
+    // of the previous frame
+    if (_cloud_sort_stats) {
+        const simgear::CloudShaderGeometry::SortStats stats =
+            simgear::CloudShaderGeometry::getSortStats();
+        _cloud_sort_stats->setIntValue("sorts", stats.sorts);
+        _cloud_sort_stats->setIntValue("sprites", stats.sprites);
+        _cloud_sort_stats->setDoubleValue("time-ms", stats.time);
+    }
+
     return true;
 }
 
@@ -257,6 +257,9 @@ private:
     // RNG seed
     mt seed;
 
+    // depth sorting statistics of the 3D clouds, per frame
+    SGPropertyNode_ptr _cloud_sort_stats;
+
 public:
 
     /** Constructor */
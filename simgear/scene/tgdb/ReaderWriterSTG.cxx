@@ -23,14 +23,14 @@
 #  include <simgear_config.h>
 #endif
 #include <algorithm>
+#include <atomic>
+#include <set>
 #include "ReaderWriterSTG.hxx"
 
 #include <osg/LOD>
 #include <osg/MatrixTransform>
 #include <osg/PagedLOD>
 #include <osg/ProxyNode>
-#include <osgUtil/LineSegmentIntersector>
-#include <osgUtil/IntersectionVisitor>
 
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
@@ -57,8 +57,11 @@
 #include <simgear/scene/tgdb/TreeBin.hxx>
 #include <simgear/scene/tgdb/VPBTechnique.hxx>
 #include <simgear/scene/tgdb/LightBin.hxx>
+#include <simgear/scene/tgdb/TerrainElevationQuery.hxx>
 
 #include <simgear/scene/util/SGSceneFeatures.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #include "SGOceanTile.hxx"
 
@@ -115,6 +118,26 @@ using TokenCallbackMap = std::map<std::string,ReaderWriterSTG::STGObjectCallback
 static TokenCallbackMap globalStgObjectCallbacks = {};
 static OpenThreads::Mutex globalStgObjectCallbackLock;
 
+static std::atomic<bool> parallelModelLoading{true};
+
+/**
+ * Call @a load(i) for every i in [0, count), spread over the shared thread
+ * pool if parallel model loading is enabled.
+ */
+template <class LoadFunc>
+static void loadConcurrently(size_t count, const LoadFunc& load)
+{
+    if (count > 1 && parallelModelLoading) {
+        simgear::SGThreadPool::shared().parallelFor(0, static_cast<int>(count), 1, [&](int begin, int end) {
+            for (int i = begin; i < end; ++i)
+                load(i);
+        });
+    } else {
+        for (size_t i = 0; i < count; ++i)
+            load(i);
+    }
+}
+
 struct ReaderWriterSTG::_ModelBin {
     struct _Object {
         SGPath _errorLocation;
@@ -133,6 +156,9 @@ struct ReaderWriterSTG::_ModelBin {
         double _hdg, _pitch, _roll;
         double _range, _radius;
         osg::ref_ptr<SGReaderWriterOptions> _options;
+        // Result of loading a shared model ahead of the scene assembly
+        bool _preloaded = false;
+        osg::ref_ptr<osg::Node> _preloadedNode;
     };
     struct _Sign {
         _Sign() : _agl(false), _lon(0), _lat(0), _elev(0), _hdg(0), _size(-1) { }
@@ -191,6 +217,20 @@ struct ReaderWriterSTG::_ModelBin {
       SGBucket _bucket;
     };
 
+    // Time spent on the stages of loading a tile, in milliseconds
+    struct _LoadTimes {
+        double _parse = 0;
+        double _terrain = 0;
+        double _models = 0;
+        double _placement = 0;
+
+        void log(const SGBucket& bucket) const
+        {
+            SG_LOG(SG_TERRAIN, SG_DEBUG, "Tile " << bucket.gen_index_str() << " load times: parse " << _parse
+                   << "ms, terrain " << _terrain << "ms, models " << _models << "ms, placement " << _placement << "ms");
+        }
+    };
+
     class DelayLoadReadFileCallback : public OptionsReadFileCallback {
 
     private:
@@ -216,8 +256,12 @@ struct ReaderWriterSTG::_ModelBin {
                 proxy->setCenterMode(osg::ProxyNode::UNION_OF_BOUNDING_SPHERE_AND_USER_DEFINED);
                 node = proxy;
             } else {
-                ErrorReportContext ec("terrain-stg", o._errorLocation.utf8Str());
-                node = osgDB::readRefNodeFile(o._name, o._options.get());
+                if (o._preloaded) {
+                    node = o._preloadedNode;
+                } else {
+                    ErrorReportContext ec("terrain-stg", o._errorLocation.utf8Str());
+                    node = osgDB::readRefNodeFile(o._name, o._options.get());
+                }
                 if (!node.valid()) {
                     SG_LOG(SG_TERRAIN, SG_ALERT, o._errorLocation << ": Failed to load "
                            << o._token << " '" << o._name << "'");
@@ -261,8 +305,18 @@ struct ReaderWriterSTG::_ModelBin {
         {
             ErrorReportContext ec("terrain-bucket", _bucket.gen_index_str());
 
+            // Work on a copy, the preloaded models must not stay referenced
+            // by the callback once the objects have been expired.
+            std::list<_ObjectStatic> objectStaticList = _objectStaticList;
+
+            _LoadTimes times = _times;
+            SGTimeStamp start = SGTimeStamp::now();
+            preloadModels(objectStaticList);
+            times._models = (SGTimeStamp::now() - start).toMSecs();
+            start = SGTimeStamp::now();
+
             STGObjectsQuadtree quadtree((GetModelLODCoord()), (AddModelLOD()));
-            quadtree.buildQuadTree(_objectStaticList.begin(), _objectStaticList.end());
+            quadtree.buildQuadTree(objectStaticList.begin(), objectStaticList.end());
             osg::ref_ptr<osg::Group> group = quadtree.getRoot();
             string group_name = string("STG-group-A ").append(_bucket.gen_index_str());
             group->setName(group_name);
@@ -394,9 +448,35 @@ struct ReaderWriterSTG::_ModelBin {
                 }
             }
 
+            times._placement += (SGTimeStamp::now() - start).toMSecs();
+            times.log(_bucket);
+
             return group.release();
         }
 
+        // Load the first instance of each distinct shared model up front and
+        // concurrently. Further instances are read while assembling the scene
+        // graph, and come from the model cache just as they would when loading
+        // one model after the other.
+        void preloadModels(std::list<_ObjectStatic>& objectStaticList)
+        {
+            std::vector<_ObjectStatic*> models;
+            std::set<std::string> names;
+            for (auto& o : objectStaticList) {
+                if (!o._proxy && names.insert(o._name).second)
+                    models.push_back(&o);
+            }
+
+            const std::string bucketIndex = _bucket.gen_index_str();
+            loadConcurrently(models.size(), [&](size_t i) {
+                _ObjectStatic& o = *models[i];
+                ErrorReportContext ec("terrain-bucket", bucketIndex);
+                ec.add("terrain-stg", o._errorLocation.utf8Str());
+                o._preloadedNode = osgDB::readRefNodeFile(o._name, o._options.get());
+                o._preloaded = true;
+            });
+        }
+
         mt _seed;
         std::list<_ObjectStatic> _objectStaticList;
         std::list<_Sign> _signList;
@@ -408,6 +488,7 @@ struct ReaderWriterSTG::_ModelBin {
         /// The original options to use for this bunch of models
         osg::ref_ptr<SGReaderWriterOptions> _options;
         SGBucket _bucket;
+        _LoadTimes _times;
     };
 
     _ModelBin() :
@@ -468,21 +549,34 @@ struct ReaderWriterSTG::_ModelBin {
         return staticOptions.release();
     }
 
-    double elevation(osg::Group& group, const SGGeod& geod)
+    // Resolve the elevation of all AGL objects and signs against the
+    // terrain in one batch, sharing one bounding volume hierarchy.
+    void resolveAGLElevations(osg::Group& terrainGroup)
     {
-        SGVec3d start = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, 10000));
-        SGVec3d end = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, -1000));
+        std::vector<double*> elevations;
+        std::vector<SGGeod> positions;
 
-        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector;
-        intersector = new osgUtil::LineSegmentIntersector(toOsg(start), toOsg(end));
-        osgUtil::IntersectionVisitor visitor(intersector.get());
-        group.accept(visitor);
+        for (auto& object : _objectStaticList) {
+            if (!object._agl)
+                continue;
+            elevations.push_back(&object._elev);
+            positions.push_back(SGGeod::fromDeg(object._lon, object._lat));
+        }
+
+        for (auto& sign : _signList) {
+            if (!sign._agl)
+                continue;
+            elevations.push_back(&sign._elev);
+            positions.push_back(SGGeod::fromDeg(sign._lon, sign._lat));
+        }
 
-        if (!intersector->containsIntersections())
-            return 0;
+        if (positions.empty())
+            return;
 
-        SGVec3d cart = toSG(intersector->getFirstIntersection().getWorldIntersectPoint());
-        return SGGeod::fromCart(cart).getElevationM();
+        TerrainElevationQuery query(terrainGroup);
+        std::vector<double> terrainElevations = query.elevations(positions);
+        for (size_t i = 0; i < elevations.size(); ++i)
+            *elevations[i] += terrainElevations[i];
     }
 
     void checkInsideBucket(const SGPath& absoluteFileName, float lon, float lat) {
@@ -503,6 +597,7 @@ struct ReaderWriterSTG::_ModelBin {
             return false;
         }
 
+        SGTimeStamp start = SGTimeStamp::now();
         sg_gzifstream stream(absoluteFileName);
         if (!stream.is_open()) {
             return false;
@@ -759,9 +854,27 @@ struct ReaderWriterSTG::_ModelBin {
             }
         }
 
+        _times._parse += (SGTimeStamp::now() - start).toMSecs();
         return true;
     }
 
+    // Load the terrain objects concurrently, results are in STG order
+    std::vector<osg::ref_ptr<osg::Node>> loadObjects(const SGBucket& bucket)
+    {
+        std::vector<const _Object*> objects;
+        for (const auto& stgObject : _objectList)
+            objects.push_back(&stgObject);
+
+        std::vector<osg::ref_ptr<osg::Node>> nodes(objects.size());
+        const std::string bucketIndex = bucket.gen_index_str();
+        loadConcurrently(objects.size(), [&](size_t i) {
+            simgear::ErrorReportContext ec("terrain-bucket", bucketIndex);
+            ec.add("terrain-stg", objects[i]->_errorLocation.utf8Str());
+            nodes[i] = osgDB::readRefNodeFile(objects[i]->_name, objects[i]->_options.get());
+        });
+        return nodes;
+    }
+
     osg::Node* load(const SGBucket& bucket, const osgDB::Options* opt)
     {
         osg::ref_ptr<SGReaderWriterOptions> options;
@@ -774,6 +887,7 @@ struct ReaderWriterSTG::_ModelBin {
         terrainGroup->setName(terrain_name);
 
         simgear::ErrorReportContext ec{"terrain-bucket", bucket.gen_index_str()};
+        SGTimeStamp start = SGTimeStamp::now();
 
         bool vpb_active = SGSceneFeatures::instance()->getVPBActive();
         if (vpb_active) {
@@ -819,9 +933,10 @@ struct ReaderWriterSTG::_ModelBin {
             }
 
             // OBJECTs include airports
-            for (auto stgObject : _objectList) {
-                osg::ref_ptr<osg::Node> node;
-                node = osgDB::readRefNodeFile(stgObject._name, stgObject._options.get());
+            std::vector<osg::ref_ptr<osg::Node>> nodes = loadObjects(bucket);
+            size_t index = 0;
+            for (const auto& stgObject : _objectList) {
+                osg::ref_ptr<osg::Node> node = nodes[index++];
 
                 if (!node.valid()) {
                     SG_LOG(SG_TERRAIN, SG_ALERT, stgObject._errorLocation << ": Failed to load "
@@ -836,10 +951,10 @@ struct ReaderWriterSTG::_ModelBin {
                 terrainGroup->addChild(node.get());
             }
         } else if (_foundBase) {
-            for (auto stgObject : _objectList) {
-                osg::ref_ptr<osg::Node> node;
-                simgear::ErrorReportContext ec("terrain-stg", stgObject._errorLocation.utf8Str());
-                node = osgDB::readRefNodeFile(stgObject._name, stgObject._options.get());
+            std::vector<osg::ref_ptr<osg::Node>> nodes = loadObjects(bucket);
+            size_t index = 0;
+            for (const auto& stgObject : _objectList) {
+                osg::ref_ptr<osg::Node> node = nodes[index++];
 
                 if (!node.valid()) {
                     SG_LOG(SG_TERRAIN, SG_ALERT, stgObject._errorLocation << ": Failed to load "
@@ -861,17 +976,10 @@ struct ReaderWriterSTG::_ModelBin {
             }
         }
 
-        for (std::list<_ObjectStatic>::iterator i = _objectStaticList.begin(); i != _objectStaticList.end(); ++i) {
-            if (!i->_agl)
-                continue;
-            i->_elev += elevation(*terrainGroup, SGGeod::fromDeg(i->_lon, i->_lat));
-        }
-
-        for (std::list<_Sign>::iterator i = _signList.begin(); i != _signList.end(); ++i) {
-            if (!i->_agl)
-                continue;
-            i->_elev += elevation(*terrainGroup, SGGeod::fromDeg(i->_lon, i->_lat));
-        }
+        _times._terrain = (SGTimeStamp::now() - start).toMSecs();
+        start = SGTimeStamp::now();
+        resolveAGLElevations(*terrainGroup);
+        _times._placement = (SGTimeStamp::now() - start).toMSecs();
 
         if (_objectStaticList.empty() && 
             _signList.empty() && 
@@ -884,6 +992,7 @@ struct ReaderWriterSTG::_ModelBin {
             _lightListList.empty())
         {
             // The simple case, just return the terrain group
+            _times.log(bucket);
             return terrainGroup.release();
         }
         
@@ -906,6 +1015,7 @@ struct ReaderWriterSTG::_ModelBin {
         readFileCallback->_signList = _signList;
         readFileCallback->_options = options;
         readFileCallback->_bucket = bucket;
+        readFileCallback->_times = _times;
 
         osg::ref_ptr<osgDB::Options> callbackOptions = new osgDB::Options;
         callbackOptions->setReadFileCallback(readFileCallback.get());
@@ -932,6 +1042,7 @@ struct ReaderWriterSTG::_ModelBin {
     double _object_range_rough;
     double _object_range_detailed;
     bool _foundBase;
+    _LoadTimes _times;
     std::list<_Object> _objectList;
     std::list<_ObjectStatic> _objectStaticList;
     std::list<_Sign> _signList;
@@ -1032,4 +1143,14 @@ void ReaderWriterSTG::removeSTGObjectHandler(const std::string &token, STGObject
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(globalStgObjectCallbackLock);
     globalStgObjectCallbacks.erase(token);
 }
+
+void ReaderWriterSTG::setParallelModelLoading(bool enabled)
+{
+    parallelModelLoading = enabled;
+}
+
+bool ReaderWriterSTG::getParallelModelLoading()
+{
+    return parallelModelLoading;
+}
 }
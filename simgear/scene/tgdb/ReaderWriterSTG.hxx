@@ -48,6 +48,14 @@ public:
     //add/remove a callback that is invoked for unknown STG token
     static void setSTGObjectHandler(const std::string &token, STGObjectCallback callback);
     static void removeSTGObjectHandler(const std::string &token, STGObjectCallback callback);
+
+    /**
+     * Load the terrain objects and distinct shared models of a tile
+     * concurrently on the shared thread pool (enabled by default). The
+     * scene graph is assembled in STG order either way.
+     */
+    static void setParallelModelLoading(bool enabled);
+    static bool getParallelModelLoading();
 private:
     struct _ModelBin;
 };
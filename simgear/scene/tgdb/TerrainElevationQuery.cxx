@@ -0,0 +1,179 @@
+// TerrainElevationQuery.cxx - batched vertical ray queries against terrain
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include "TerrainElevationQuery.hxx"
+
+#include <osg/Camera>
+#include <osg/Geode>
+#include <osg/Transform>
+
+#include <simgear/bvh/BVHGroup.hxx>
+#include <simgear/bvh/BVHLineSegmentVisitor.hxx>
+#include <simgear/bvh/BVHStaticGeometryBuilder.hxx>
+#include <simgear/bvh/BVHTransform.hxx>
+#include <simgear/math/SGGeometry.hxx>
+#include <simgear/scene/model/PrimitiveCollector.hxx>
+#include <simgear/scene/util/OsgMath.hxx>
+#include <simgear/scene/util/SGSceneUserData.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
+
+namespace simgear {
+
+// Collects the geometry below a node into one hierarchy. Triangles are
+// stored relative to the center of the scene to keep the single precision
+// vertices of the static geometry accurate.
+class TerrainElevationQuery::BuildVisitor : public osg::NodeVisitor {
+public:
+    struct Collector : public PrimitiveCollector {
+        Collector(BuildVisitor& visitor) :
+            _visitor(visitor)
+        { }
+        virtual void addPoint(const osg::Vec3d&)
+        { }
+        virtual void addLine(const osg::Vec3d&, const osg::Vec3d&)
+        { }
+        virtual void addTriangle(const osg::Vec3d& v1, const osg::Vec3d& v2, const osg::Vec3d& v3)
+        { _visitor.addTriangle(v1, v2, v3); }
+    private:
+        BuildVisitor& _visitor;
+    };
+
+    BuildVisitor(const osg::Vec3d& center) :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN),
+        _center(center),
+        _builder(new BVHStaticGeometryBuilder),
+        _group(new BVHGroup)
+    { }
+
+    void addTriangle(const osg::Vec3d& v1, const osg::Vec3d& v2, const osg::Vec3d& v3)
+    {
+        _builder->addTriangle(toVec3f(toSG(_localToWorld.preMult(v1) - _center)),
+                              toVec3f(toSG(_localToWorld.preMult(v2) - _center)),
+                              toVec3f(toSG(_localToWorld.preMult(v3) - _center)));
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (!reuseTree(node))
+            traverse(node);
+    }
+
+    virtual void apply(osg::Geode& geode)
+    {
+        if (reuseTree(geode))
+            return;
+
+        Collector collector(*this);
+        for (unsigned i = 0; i < geode.getNumDrawables(); ++i)
+            geode.getDrawable(i)->accept(collector);
+    }
+
+    virtual void apply(osg::Transform& transform)
+    {
+        if (transform.getReferenceFrame() != osg::Transform::RELATIVE_RF)
+            return;
+
+        osg::Matrix localToWorld = _localToWorld;
+        if (transform.computeLocalToWorldMatrix(_localToWorld, this)) {
+            if (!reuseTree(transform))
+                traverse(transform);
+        }
+        _localToWorld = localToWorld;
+    }
+
+    virtual void apply(osg::Camera& camera)
+    {
+        if (camera.getRenderOrder() != osg::Camera::NESTED_RENDER)
+            return;
+        apply(static_cast<osg::Transform&>(camera));
+    }
+
+    SGSharedPtr<BVHNode> getNode()
+    {
+        // Everything is relative to the center
+        SGSharedPtr<BVHNode> geometry = _builder->buildTree();
+        if (geometry.valid())
+            _group->addChild(geometry);
+        if (!_group->getNumChildren())
+            return SGSharedPtr<BVHNode>();
+
+        SGSharedPtr<BVHTransform> transform = new BVHTransform;
+        transform->setToWorldTransform(SGMatrixd(osg::Matrix::translate(_center).ptr()));
+        transform->addChild(_group);
+        return transform;
+    }
+
+private:
+    // Trees attached to a node hold the geometry below it in the node's
+    // child coordinate frame.
+    bool reuseTree(osg::Node& node)
+    {
+        SGSceneUserData* userData = SGSceneUserData::getSceneUserData(&node);
+        if (!userData || !userData->getBVHNode())
+            return false;
+
+        osg::Matrix toCenter = _localToWorld * osg::Matrix::translate(-_center);
+        SGSharedPtr<BVHTransform> transform = new BVHTransform;
+        transform->setToWorldTransform(SGMatrixd(toCenter.ptr()));
+        transform->addChild(userData->getBVHNode());
+        _group->addChild(transform);
+        return true;
+    }
+
+    osg::Vec3d _center;
+    osg::Matrix _localToWorld;
+    SGSharedPtr<BVHStaticGeometryBuilder> _builder;
+    SGSharedPtr<BVHGroup> _group;
+};
+
+TerrainElevationQuery::TerrainElevationQuery(osg::Node& terrain)
+{
+    BuildVisitor visitor(terrain.getBound().center());
+    terrain.accept(visitor);
+    _bvh = visitor.getNode();
+}
+
+TerrainElevationQuery::~TerrainElevationQuery()
+{
+}
+
+double TerrainElevationQuery::elevation(const SGGeod& geod) const
+{
+    if (!_bvh.valid())
+        return 0;
+
+    SGVec3d start = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, 10000));
+    SGVec3d end = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, -1000));
+
+    BVHLineSegmentVisitor visitor(SGLineSegmentd(start, end), 0);
+    _bvh->accept(visitor);
+    if (visitor.empty())
+        return 0;
+
+    return SGGeod::fromCart(visitor.getPoint()).getElevationM();
+}
+
+std::vector<double>
+TerrainElevationQuery::elevations(const std::vector<SGGeod>& geods,
+                                  bool parallel) const
+{
+    std::vector<double> result(geods.size(), 0.0);
+    auto query = [&](int begin, int end) {
+        for (int i = begin; i < end; ++i)
+            result[i] = elevation(geods[i]);
+    };
+
+    const int count = static_cast<int>(geods.size());
+    if (parallel && count > 16)
+        SGThreadPool::shared().parallelFor(0, count, 16, query);
+    else
+        query(0, count);
+
+    return result;
+}
+
+} // namespace simgear
@@ -0,0 +1,59 @@
+// TerrainElevationQuery.hxx - batched vertical ray queries against terrain
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#pragma once
+
+#include <vector>
+
+#include <simgear/bvh/BVHNode.hxx>
+#include <simgear/math/SGMath.hxx>
+#include <simgear/structure/SGSharedPtr.hxx>
+
+namespace osg {
+class Node;
+}
+
+namespace simgear {
+
+/**
+ * Answers terrain elevation queries for a scene graph (typically the
+ * terrain group of a tile) using a bounding volume hierarchy.
+ *
+ * The hierarchy is set up once on construction: trees already attached to
+ * the nodes (see BoundingVolumeBuildVisitor) are reused, a tree is built
+ * for the remaining geometry. Queries are read only and may run in
+ * parallel.
+ */
+class TerrainElevationQuery
+{
+public:
+    explicit TerrainElevationQuery(osg::Node& terrain);
+    ~TerrainElevationQuery();
+
+    /**
+     * Elevation of the first terrain surface hit by a vertical ray from
+     * 10000m above to 1000m below the given position, or 0 if nothing is
+     * hit.
+     */
+    double elevation(const SGGeod& geod) const;
+
+    /**
+     * Elevation for each of the positions, as given by elevation().
+     *
+     * @param parallel  Spread the queries over the shared thread pool.
+     */
+    std::vector<double> elevations(const std::vector<SGGeod>& geods,
+                                   bool parallel = true) const;
+
+    /**
+     * Whether there is any geometry to query at all.
+     */
+    bool empty() const { return !_bvh.valid(); }
+
+private:
+    class BuildVisitor;
+
+    SGSharedPtr<BVHNode> _bvh;
+};
+
+} // namespace simgear
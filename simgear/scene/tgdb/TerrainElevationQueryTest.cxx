@@ -0,0 +1,165 @@
+// TerrainElevationQueryTest.cxx - compare BVH elevations with osgUtil
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#  include <simgear_config.h>
+#endif
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+
+#include <simgear/math/SGMath.hxx>
+#include <simgear/scene/model/BoundingVolumeBuildVisitor.hxx>
+#include <simgear/scene/util/OsgMath.hxx>
+
+#include "TerrainElevationQuery.hxx"
+
+using namespace simgear;
+
+namespace {
+
+const SGGeod tileCenter = SGGeod::fromDegM(11.2, 47.5, 600);
+
+// Height field of n x n cells in a horizontal frame at the tile center,
+// the same way terrain tiles are placed.
+osg::Node* createTerrain(int n, double cellSize, double baseHeight)
+{
+    osg::Vec3Array* vertices = new osg::Vec3Array;
+    for (int j = 0; j <= n; ++j) {
+        for (int i = 0; i <= n; ++i) {
+            double x = (i - 0.5 * n) * cellSize;
+            double y = (j - 0.5 * n) * cellSize;
+            double h = baseHeight + 40 * sin(x * 0.003) * cos(y * 0.002) + 0.01 * x;
+            // local frame is north, east, down
+            vertices->push_back(osg::Vec3(x, y, -h));
+        }
+    }
+
+    osg::DrawElementsUInt* triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    for (int j = 0; j < n; ++j) {
+        for (int i = 0; i < n; ++i) {
+            unsigned v = j * (n + 1) + i;
+            triangles->push_back(v);
+            triangles->push_back(v + 1);
+            triangles->push_back(v + n + 1);
+            triangles->push_back(v + 1);
+            triangles->push_back(v + n + 2);
+            triangles->push_back(v + n + 1);
+        }
+    }
+
+    osg::Geometry* geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices);
+    geometry->addPrimitiveSet(triangles);
+
+    osg::Geode* geode = new osg::Geode;
+    geode->addDrawable(geometry);
+
+    osg::Matrixd transform = osg::Matrixd::rotate(toOsg(SGQuatd::fromLonLat(tileCenter)));
+    transform.postMultTranslate(toOsg(SGVec3d::fromGeod(tileCenter)));
+
+    osg::MatrixTransform* node = new osg::MatrixTransform(transform);
+    node->addChild(geode);
+    return node;
+}
+
+// The current implementation in ReaderWriterSTG
+double intersectorElevation(osg::Node& node, const SGGeod& geod)
+{
+    SGVec3d start = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, 10000));
+    SGVec3d end = SGVec3d::fromGeod(SGGeod::fromGeodM(geod, -1000));
+
+    osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector;
+    intersector = new osgUtil::LineSegmentIntersector(toOsg(start), toOsg(end));
+    osgUtil::IntersectionVisitor visitor(intersector.get());
+    node.accept(visitor);
+
+    if (!intersector->containsIntersections())
+        return 0;
+
+    SGVec3d cart = toSG(intersector->getFirstIntersection().getWorldIntersectPoint());
+    return SGGeod::fromCart(cart).getElevationM();
+}
+
+int compare(osg::Node& terrain, const char* name)
+{
+    const double tolerance = 0.05;
+
+    // Also some positions outside of the terrain
+    std::vector<SGGeod> positions;
+    for (int j = -30; j <= 30; ++j)
+        for (int i = -30; i <= 30; ++i)
+            positions.push_back(SGGeod::fromDeg(tileCenter.getLongitudeDeg() + i * 0.0006,
+                                                tileCenter.getLatitudeDeg() + j * 0.0005));
+
+    TerrainElevationQuery query(terrain);
+    if (query.empty()) {
+        std::cerr << name << ": no geometry found" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> elevations = query.elevations(positions);
+    std::vector<double> serial = query.elevations(positions, false);
+
+    int failures = 0, hits = 0;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        double expected = intersectorElevation(terrain, positions[i]);
+        if (expected != 0)
+            ++hits;
+
+        if (std::fabs(elevations[i] - expected) > tolerance ||
+            elevations[i] != serial[i]) {
+            if (failures++ < 10)
+                std::cerr << name << ": elevation at " << positions[i]
+                          << " is " << elevations[i] << " (serial "
+                          << serial[i] << "), expected " << expected << std::endl;
+        }
+    }
+
+    // Make sure the test actually covers both hits and misses
+    if (hits == 0 || hits == static_cast<int>(positions.size())) {
+        std::cerr << name << ": unexpected number of hits " << hits << std::endl;
+        return 1;
+    }
+
+    return failures;
+}
+
+} // namespace
+
+int main()
+{
+    int failures = 0;
+
+    // Plain geometry, the hierarchy is built by the query
+    osg::ref_ptr<osg::Group> terrain = new osg::Group;
+    terrain->addChild(createTerrain(40, 50, 600));
+    failures += compare(*terrain, "built");
+
+    // Terrain with attached bounding volume trees as loaded from BTG files,
+    // plus a second layer without
+    osg::ref_ptr<osg::Node> tile = createTerrain(40, 50, 600);
+    BoundingVolumeBuildVisitor bvBuilder(false);
+    tile->accept(bvBuilder);
+
+    osg::ref_ptr<osg::Group> mixed = new osg::Group;
+    mixed->addChild(tile);
+    mixed->addChild(createTerrain(8, 50, 750));
+    failures += compare(*mixed, "reused");
+
+    if (failures) {
+        std::cerr << failures << " elevation mismatches" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "all tests passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -110,7 +110,7 @@ void VegetationHandler::setLocation(const SGGeod loc, double r_E_lat,
 }
 
 bool VegetationHandler::handleNewMaterial(SGMaterial *mat) {
-    if (mat->get_wood_coverage() <= 0)
+    if (!usesMaterial(mat))
         return false;
 
     wood_coverage = 2000.0 / mat->get_wood_coverage();
@@ -149,6 +149,10 @@ bool VegetationHandler::handleNewMaterial(SGMaterial *mat) {
     return true;
 }
 
+bool VegetationHandler::usesMaterial(const SGMaterial *mat) const {
+    return mat->get_wood_coverage() > 0;
+}
+
 bool VegetationHandler::handleIteration(
     SGMaterial* mat, osg::Image* objectMaskImage,
     const double lon, const double lat,
@@ -263,7 +267,7 @@ void RandomLightsHandler::setLocation(const SGGeod loc, double r_E_lat,
 }
 
 bool RandomLightsHandler::handleNewMaterial(SGMaterial *mat) {
-    if (mat->get_light_coverage() <= 0)
+    if (!usesMaterial(mat))
         return false;
 
     if (bin == NULL) {
@@ -275,6 +279,10 @@ bool RandomLightsHandler::handleNewMaterial(SGMaterial *mat) {
     return true;
 }
 
+bool RandomLightsHandler::usesMaterial(const SGMaterial *mat) const {
+    return mat->get_light_coverage() > 0;
+}
+
 bool RandomLightsHandler::handleIteration(
     SGMaterial* mat, osg::Image* objectMaskImage,
     const double lon, const double lat,
@@ -73,6 +73,10 @@ class VPBMaterialHandler {
     // irrelevant to the handler
     virtual bool handleNewMaterial(SGMaterial *mat) = 0;
 
+    // Whether handleNewMaterial() returns true for the material, without
+    // changing the handler's state
+    virtual bool usesMaterial(const SGMaterial *mat) const = 0;
+
     // Function that is called for each point in the scanline reading process
     // Return false if the material is irrelevant to the handler
     // Return true if the point should be used to place an object, updating
@@ -115,6 +119,7 @@ class VegetationHandler : public VPBMaterialHandler {
                     osg::ref_ptr<TerrainTile> terrainTile);
     void setLocation(const SGGeod loc, double r_E_lat, double r_E_lon);
     bool handleNewMaterial(SGMaterial *mat);
+    bool usesMaterial(const SGMaterial *mat) const;
     bool handleIteration(SGMaterial* mat, osg::Image* objectMaskImage,
                          const double lon, const double lat, osg::Vec2d p,
                          const double D, const osg::Vec2d ll_O,
@@ -148,6 +153,7 @@ class RandomLightsHandler : public VPBMaterialHandler {
                     osg::ref_ptr<TerrainTile> terrainTile);
     void setLocation(const SGGeod loc, double r_E_lat, double r_E_lon);
     bool handleNewMaterial(SGMaterial *mat);
+    bool usesMaterial(const SGMaterial *mat) const;
     bool handleIteration(SGMaterial* mat, osg::Image* objectMaskImage,
                          const double lon, const double lat, osg::Vec2d p,
                          const double D, const osg::Vec2d ll_O,
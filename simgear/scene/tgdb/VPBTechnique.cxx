@@ -16,6 +16,7 @@
 // along with this program; if not, write to the Free Software
 // Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 
+#include <chrono>
 #include <cmath>
 #include <tuple>
 
@@ -49,6 +50,8 @@
 #include <simgear/scene/util/SGNodeMasks.hxx>
 #include <simgear/scene/util/SGReaderWriterOptions.hxx>
 #include <simgear/scene/util/SGSceneFeatures.hxx>
+#include <simgear/threads/SGStageGraph.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
 
 #include "VPBTechnique.hxx"
 #include "VPBMaterialHandler.hxx"
@@ -192,34 +195,90 @@ void VPBTechnique::init(int dirtyMask, bool assumeMultiThreaded)
         SG_LOG(SG_TERRAIN, SG_ALERT, "Unable to create materials lib for  " << loc);
     }
 
+    bool reuseStateSet = false;
     if ((dirtyMask & TerrainTile::IMAGERY_DIRTY)==0)
     {
-        generateGeometry(*buffer, masterLocator, centerModel, matcache);
+        reuseStateSet = _currentBufferData.valid() && _currentBufferData->_landGeode.valid() &&
+            _currentBufferData->_landGeode->getStateSet();
+    }
 
-        osg::ref_ptr<BufferData> read_buffer = _currentBufferData;
+    // Look the tile up in the tile cache, or record the generated data for it.
+    std::shared_ptr<DiskCache> tileCache;
+    std::string tileCacheKey;
+    if (!reuseStateSet && matcache && masterLocator)
+    {
+        tileCache = VPBTileCache::get(_options->getPropertyNode().get());
+    }
 
-        osg::StateSet* stateset = read_buffer->_landGeode->getStateSet();
-        if (stateset)
-        {
-            buffer->_landGeode->setStateSet(stateset);
-        }
-        else
+    if (tileCache)
+    {
+        tileCacheKey = computeTileCacheKey(masterLocator, centerModel);
+        buffer->_tileData = new VPBTileData;
+        std::string data;
+        if (tileCache->read(tileCacheKey, data))
         {
-            applyColorLayers(*buffer, masterLocator, matcache);
-            applyLineFeatures(*buffer, masterLocator, matcache);
-            applyAreaFeatures(*buffer, masterLocator, matcache);
-            applyMaterials(*buffer, masterLocator, matcache);
+            buffer->_fromCache = buffer->_tileData->deserialize(data);
+            if (!buffer->_fromCache)
+            {
+                SG_LOG(SG_TERRAIN, SG_WARN, "Invalid tile cache entry for tile " << tileID.x << "," << tileID.y << " level " << tileID.level);
+                tileCache->remove(tileCacheKey);
+                buffer->_tileData = new VPBTileData;
+            }
         }
     }
-    else
-    {
+
+    // The geometry is needed by all other stages, and random objects are
+    // kept off the line features.  The remaining stages are independent and
+    // run concurrently on the shared thread pool.
+    SGStageGraph stages;
+    const int geometryStage = stages.add([&]() {
         generateGeometry(*buffer, masterLocator, centerModel, matcache);
-        
-        applyColorLayers(*buffer, masterLocator, matcache);
-        applyLineFeatures(*buffer, masterLocator, matcache);
-        applyAreaFeatures(*buffer, masterLocator, matcache);
-        applyMaterials(*buffer, masterLocator, matcache);
+        // compute the bounds now, rather than lazily from several threads
+        if (buffer->_transform.valid()) buffer->_transform->getBound();
+    });
+
+    int colorLayersStage = -1, lineFeaturesStage = -1, areaFeaturesStage = -1, materialsStage = -1;
+    if (!reuseStateSet)
+    {
+        colorLayersStage = stages.add([&]() { applyColorLayers(*buffer, masterLocator, matcache); }, {geometryStage});
+        lineFeaturesStage = stages.add([&]() { applyLineFeatures(*buffer, masterLocator, matcache); }, {geometryStage});
+        areaFeaturesStage = stages.add([&]() { applyAreaFeatures(*buffer, masterLocator, matcache); }, {geometryStage});
+        materialsStage = stages.add([&]() { applyMaterials(*buffer, masterLocator, matcache); }, {lineFeaturesStage});
+    }
+
+    stages.run(getParallelTileGeneration());
+
+    if (tileCache && !buffer->_fromCache && buffer->_tileData->complete)
+    {
+        tileCache->write(tileCacheKey, buffer->_tileData->serialize());
     }
+    buffer->_tileData = nullptr;
+
+    if (reuseStateSet)
+    {
+        buffer->_landGeode->setStateSet(_currentBufferData->_landGeode->getStateSet());
+    }
+
+    // Add the generated features in the same order as the stages were
+    // originally run in.
+    if (buffer->_transform.valid())
+    {
+        for (osg::Group* group : {buffer->_lineFeatureNodes.get(), buffer->_areaFeatureNodes.get(), static_cast<osg::Group*>(buffer->_materialNodes.get())})
+        {
+            for (unsigned int i = 0; i < group->getNumChildren(); ++i)
+            {
+                buffer->_transform->addChild(group->getChild(i));
+            }
+            group->removeChildren(0, group->getNumChildren());
+        }
+    }
+
+    StageTimes stageTimes;
+    stageTimes[GEOMETRY_STAGE] = stages.seconds(geometryStage);
+    stageTimes[COLOR_LAYERS_STAGE] = stages.seconds(colorLayersStage);
+    stageTimes[LINE_FEATURES_STAGE] = stages.seconds(lineFeaturesStage);
+    stageTimes[AREA_FEATURES_STAGE] = stages.seconds(areaFeaturesStage);
+    stageTimes[MATERIALS_STAGE] = stages.seconds(materialsStage);
 
     if (buffer->_transform.valid()) buffer->_transform->setThreadSafeRefUnref(true);
 
@@ -238,8 +297,12 @@ void VPBTechnique::init(int dirtyMask, bool assumeMultiThreaded)
     _terrainTile->setDirtyMask(0);
 
     std::chrono::duration<double> elapsed_seconds = std::chrono::system_clock::now() - start;
-    VPBTechnique::updateStats(tileID.level, elapsed_seconds.count());
-    SG_LOG(SG_TERRAIN, SG_DEBUG, "Init complete of tile " << tileID.x << "," << tileID.y << " level " << tileID.level << " " << elapsed_seconds.count() << " seconds.  Average " << VPBTechnique::getMeanLoadTime(tileID.level));
+    VPBTechnique::updateStats(tileID.level, elapsed_seconds.count(), stageTimes);
+    SG_LOG(SG_TERRAIN, SG_DEBUG, "Init complete of tile " << tileID.x << "," << tileID.y << " level " << tileID.level << " " << elapsed_seconds.count() << " seconds"
+           << (buffer->_fromCache ? " (cached)" : "") << ".  Average " << VPBTechnique::getMeanLoadTime(tileID.level)
+           << ".  Stages: geometry " << stageTimes[GEOMETRY_STAGE] << ", color layers " << stageTimes[COLOR_LAYERS_STAGE]
+           << ", line features " << stageTimes[LINE_FEATURES_STAGE] << ", area features " << stageTimes[AREA_FEATURES_STAGE]
+           << ", materials " << stageTimes[MATERIALS_STAGE]);
 }
 
 Locator* VPBTechnique::computeMasterLocator()
@@ -331,6 +394,97 @@ const SGGeod VPBTechnique::computeCenterGeod(BufferData& buffer, Locator* master
     return SGGeod::fromCart(toSG(world));
 }
 
+std::string VPBTechnique::computeTileCacheKey(Locator* masterLocator, const osg::Vec3d& centerModel)
+{
+    VPBTileKey key;
+    const TileID tileID = _terrainTile->getTileID();
+    key.add(tileID.level);
+    key.add(tileID.x);
+    key.add(tileID.y);
+    key.addFile(_fileName, _options.get());
+
+    // The boundaries of the mesh are shared with the neighbouring tiles
+    Terrain* terrain = _terrainTile->getTerrain();
+    key.add(terrain && terrain->getEqualizeBoundaries());
+    if (terrain && terrain->getEqualizeBoundaries()) {
+        const TileID neighbours[4] = {TileID(tileID.level, tileID.x-1, tileID.y), TileID(tileID.level, tileID.x+1, tileID.y),
+                                      TileID(tileID.level, tileID.x, tileID.y+1), TileID(tileID.level, tileID.x, tileID.y-1)};
+        for (const auto& id : neighbours) {
+            osg::ref_ptr<TerrainTile> tile = terrain->getTile(id);
+            VPBTechnique* technique = tile.valid() ? dynamic_cast<VPBTechnique*>(tile->getTerrainTechnique()) : nullptr;
+            key.add(tile.valid() && tile->getElevationLayer());
+            if (technique) key.addFile(technique->_fileName, _options.get());
+        }
+    }
+
+    key.add(SGSceneFeatures::instance()->getVPBVerticalScale());
+    key.add(SGSceneFeatures::instance()->getVPBSampleRatio());
+    key.add(SGSceneFeatures::instance()->getVPBConstraintGap());
+
+    const SGPropertyNode* propertyNode = _options->getPropertyNode().get();
+    if (propertyNode) {
+        key.addProperties(propertyNode->getNode("/sim/rendering/static-lod"));
+        key.addProperties(propertyNode->getNode("/sim/rendering/random-vegetation"));
+        key.addProperties(propertyNode->getNode("/sim/rendering/vegetation-density"));
+        key.addProperties(propertyNode->getNode("/sim/rendering/osm-buildings"));
+    }
+
+    // The line and area features of the bucket, which are loaded separately
+    const SGBucket bucket(SGGeod::fromCart(toSG(centerModel)));
+    {
+        const std::lock_guard<std::mutex> lock(VPBTechnique::_lineFeatureLists_mutex);
+        for (const auto& list : _lineFeatureLists) {
+            if (list.first != bucket) continue;
+            for (const auto& bin : list.second) {
+                key.add(bin->getMaterial());
+                for (const auto& line : bin->getLineFeatures()) {
+                    for (const auto& node : line._nodes) key.add(node);
+                    key.add(double(line._width));
+                    key.add(line._attributes);
+                    key.add(osg::Vec3d(line._a, line._b, line._c));
+                    key.add(double(line._d));
+                }
+            }
+        }
+    }
+    {
+        const std::lock_guard<std::mutex> lock(VPBTechnique::_areaFeatureLists_mutex);
+        for (const auto& list : _areaFeatureLists) {
+            if (list.first != bucket) continue;
+            for (const auto& bin : list.second) {
+                key.add(bin->getMaterial());
+                for (const auto& area : bin->getAreaFeatures()) {
+                    for (const auto& node : area._nodes) key.add(node);
+                    key.add(double(area._area));
+                    key.add(area._attributes);
+                    key.add(osg::Vec3d(area._a, area._b, area._c));
+                    key.add(double(area._d));
+                }
+            }
+        }
+    }
+
+    // Airports and other elevation constraints the tile may be displaced by
+    double radius = 0.0;
+    for (const auto& corner : {osg::Vec3d(0.0, 0.0, 0.0), osg::Vec3d(1.0, 0.0, 0.0), osg::Vec3d(0.0, 1.0, 0.0), osg::Vec3d(1.0, 1.0, 0.0)}) {
+        osg::Vec3d model;
+        masterLocator->convertLocalToModel(corner, model);
+        radius = std::max(radius, (model - centerModel).length());
+    }
+    const osg::BoundingSphere tileBound(centerModel, radius);
+    {
+        const std::lock_guard<std::mutex> lock(VPBTechnique::_elevationConstraintMutex);
+        for (unsigned int i = 0; i < _elevationConstraintGroup->getNumChildren(); ++i) {
+            const osg::BoundingSphere& bound = _elevationConstraintGroup->getChild(i)->getBound();
+            if (!bound.intersects(tileBound)) continue;
+            key.add(osg::Vec3d(bound.center()));
+            key.add(double(bound.radius()));
+        }
+    }
+
+    return key.result();
+}
+
 class VertexNormalGenerator
 {
     public:
@@ -850,43 +1004,14 @@ void VertexNormalGenerator::computeNormals()
     }
 }
 
-void VPBTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator, const osg::Vec3d& centerModel, osg::ref_ptr<SGMaterialCache> matcache)
+// Generate the terrain mesh and its skirts from the elevation data, and the
+// size of the tile.
+void VPBTechnique::generateMesh(BufferData& buffer, Locator* masterLocator, const osg::Vec3d& centerModel, osg::ref_ptr<Atlas> atlas)
 {
-    osg::ref_ptr<Atlas> atlas;
-
     Terrain* terrain = _terrainTile->getTerrain();
     osgTerrain::Layer* elevationLayer = _terrainTile->getElevationLayer();
     osgTerrain::Layer* colorLayer = _terrainTile->getColorLayer(0);
 
-    // Determine the correct Effect for this, based on a material lookup taking into account
-    // the lat/lon of the center.
-    SGPropertyNode_ptr landEffectProp = new SGPropertyNode();
-
-    if (matcache) {
-      atlas = matcache->getAtlas();
-      SGMaterial* landmat = matcache->find("ws30land");
-
-      if (landmat) {
-        makeChild(landEffectProp.ptr(), "inherits-from")->setStringValue(landmat->get_effect_name());
-      } else {
-        SG_LOG( SG_TERRAIN, SG_ALERT, "Unable to get effect for VPB - no matching material in library");
-        makeChild(landEffectProp.ptr(), "inherits-from")->setStringValue("Effects/model-default");
-      }
-    } else {
-        SG_LOG( SG_TERRAIN, SG_ALERT, "Unable to get effect for VPB - no material library available");
-        makeChild(landEffectProp.ptr(), "inherits-from")->setStringValue("Effects/model-default");
-    }
-
-    buffer._landGeode = new EffectGeode();
-    if (buffer._transform.valid()) buffer._transform->addChild(buffer._landGeode.get());
-
-    buffer._landGeometry = new osg::Geometry;
-    buffer._landGeode->addDrawable(buffer._landGeometry.get());
-  
-    osg::ref_ptr<Effect> landEffect = makeEffect(landEffectProp, true, _options);
-    buffer._landGeode->setEffect(landEffect.get());
-    buffer._landGeode->setNodeMask(SG_NODEMASK_TERRAIN_BIT);
-
     unsigned int numRows = 20;
     unsigned int numColumns = 20;
 
@@ -935,12 +1060,6 @@ void VPBTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator,
     // allocate and assign normals
     buffer._landGeometry->setNormalArray(VNG._normals.get(), osg::Array::BIND_PER_VERTEX);
 
-    // allocate and assign color
-    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array(1);
-    (*colors)[0].set(1.0f,1.0f,1.0f,1.0f);
-
-    buffer._landGeometry->setColorArray(colors.get(), osg::Array::BIND_OVERALL);
-
     // allocate and assign texture coordinates
     auto texcoords = new osg::Vec2Array;
     VNG.populateCenter(elevationLayer, colorLayer, atlas, texcoords);
@@ -959,53 +1078,6 @@ void VPBTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator,
         VNG.populateRightBoundary(right_tile.valid() ? right_tile->getElevationLayer() : 0, colorLayer, atlas);
         VNG.populateAboveBoundary(top_tile.valid() ? top_tile->getElevationLayer() : 0, colorLayer, atlas);
         VNG.populateBelowBoundary(bottom_tile.valid() ? bottom_tile->getElevationLayer() : 0, colorLayer, atlas);
-
-        _neighbours.clear();
-
-        bool updateNeighboursImmediately = false;
-
-        if (left_tile.valid())   addNeighbour(left_tile.get());
-        if (right_tile.valid())  addNeighbour(right_tile.get());
-        if (top_tile.valid())    addNeighbour(top_tile.get());
-        if (bottom_tile.valid()) addNeighbour(bottom_tile.get());
-
-        if (left_tile.valid())
-        {
-            if (left_tile->getTerrainTechnique()==0 || !(left_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
-            {
-                int dirtyMask = left_tile->getDirtyMask() | TerrainTile::LEFT_EDGE_DIRTY;
-                if (updateNeighboursImmediately) left_tile->init(dirtyMask, true);
-                else left_tile->setDirtyMask(dirtyMask);
-            }
-        }
-        if (right_tile.valid())
-        {
-            if (right_tile->getTerrainTechnique()==0 || !(right_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
-            {
-                int dirtyMask = right_tile->getDirtyMask() | TerrainTile::RIGHT_EDGE_DIRTY;
-                if (updateNeighboursImmediately) right_tile->init(dirtyMask, true);
-                else right_tile->setDirtyMask(dirtyMask);
-            }
-        }
-        if (top_tile.valid())
-        {
-            if (top_tile->getTerrainTechnique()==0 || !(top_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
-            {
-                int dirtyMask = top_tile->getDirtyMask() | TerrainTile::TOP_EDGE_DIRTY;
-                if (updateNeighboursImmediately) top_tile->init(dirtyMask, true);
-                else top_tile->setDirtyMask(dirtyMask);
-            }
-        }
-
-        if (bottom_tile.valid())
-        {
-            if (bottom_tile->getTerrainTechnique()==0 || !(bottom_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
-            {
-                int dirtyMask = bottom_tile->getDirtyMask() | TerrainTile::BOTTOM_EDGE_DIRTY;
-                if (updateNeighboursImmediately) bottom_tile->init(dirtyMask, true);
-                else bottom_tile->setDirtyMask(dirtyMask);
-            }
-        }
     }
 
     osg::ref_ptr<osg::Vec3Array> skirtVectors = new osg::Vec3Array((*VNG._normals));
@@ -1247,15 +1319,6 @@ void VPBTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator,
 
     landElements->resizeElements(landElements->getNumIndices());
 
-    buffer._landGeometry->setUseDisplayList(false);
-    buffer._landGeometry->setUseVertexBufferObjects(true);
-    buffer._landGeode->runGenerators(buffer._landGeometry);
-
-    // Tile-specific information for the shaders
-    osg::StateSet *landStateSet = buffer._landGeode->getOrCreateStateSet();
-    osg::ref_ptr<osg::Uniform> level = new osg::Uniform("tile_level", _terrainTile->getTileID().level);
-    landStateSet->addUniform(level);
-
     // Determine the x and y texture scaling.  Has to be performed after we've generated all the vertices.
     // Because the earth is round, each tile is not a rectangle.  Apart from edge cases like the poles, the
     // difference in axis length is < 1%, so we will just take the average.
@@ -1275,6 +1338,138 @@ void VPBTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator,
         buffer._width = 0.5 * (s.length() + u.length());
         buffer._height = 0.5 * (t.length() + v.length());
     }
+}
+
+void VPBTechnique::linkNeighbours(TerrainTile* left_tile, TerrainTile* right_tile, TerrainTile* top_tile, TerrainTile* bottom_tile)
+{
+    _neighbours.clear();
+
+    bool updateNeighboursImmediately = false;
+
+    if (left_tile)   addNeighbour(left_tile);
+    if (right_tile)  addNeighbour(right_tile);
+    if (top_tile)    addNeighbour(top_tile);
+    if (bottom_tile) addNeighbour(bottom_tile);
+
+    if (left_tile)
+    {
+        if (left_tile->getTerrainTechnique()==0 || !(left_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
+        {
+            int dirtyMask = left_tile->getDirtyMask() | TerrainTile::LEFT_EDGE_DIRTY;
+            if (updateNeighboursImmediately) left_tile->init(dirtyMask, true);
+            else left_tile->setDirtyMask(dirtyMask);
+        }
+    }
+    if (right_tile)
+    {
+        if (right_tile->getTerrainTechnique()==0 || !(right_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
+        {
+            int dirtyMask = right_tile->getDirtyMask() | TerrainTile::RIGHT_EDGE_DIRTY;
+            if (updateNeighboursImmediately) right_tile->init(dirtyMask, true);
+            else right_tile->setDirtyMask(dirtyMask);
+        }
+    }
+    if (top_tile)
+    {
+        if (top_tile->getTerrainTechnique()==0 || !(top_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
+        {
+            int dirtyMask = top_tile->getDirtyMask() | TerrainTile::TOP_EDGE_DIRTY;
+            if (updateNeighboursImmediately) top_tile->init(dirtyMask, true);
+            else top_tile->setDirtyMask(dirtyMask);
+        }
+    }
+
+    if (bottom_tile)
+    {
+        if (bottom_tile->getTerrainTechnique()==0 || !(bottom_tile->getTerrainTechnique()->containsNeighbour(_terrainTile)))
+        {
+            int dirtyMask = bottom_tile->getDirtyMask() | TerrainTile::BOTTOM_EDGE_DIRTY;
+            if (updateNeighboursImmediately) bottom_tile->init(dirtyMask, true);
+            else bottom_tile->setDirtyMask(dirtyMask);
+        }
+    }
+}
+
+void VPBTechnique::generateGeometry(BufferData& buffer, Locator* masterLocator, const osg::Vec3d& centerModel, osg::ref_ptr<SGMaterialCache> matcache)
+{
+    osg::ref_ptr<Atlas> atlas;
+
+    Terrain* terrain = _terrainTile->getTerrain();
+
+    // Determine the correct Effect for this, based on a material lookup taking into account
+    // the lat/lon of the center.
+    SGPropertyNode_ptr landEffectProp = new SGPropertyNode();
+
+    if (matcache) {
+      atlas = matcache->getAtlas();
+      SGMaterial* landmat = matcache->find("ws30land");
+
+      if (landmat) {
+        makeChild(landEffectProp.ptr(), "inherits-from")->setStringValue(landmat->get_effect_name());
+      } else {
+        SG_LOG( SG_TERRAIN, SG_ALERT, "Unable to get effect for VPB - no matching material in library");
+        makeChild(landEffectProp.ptr(), "inherits-from")->setStringValue("Effects/model-default");
+      }
+    } else {
+        SG_LOG( SG_TERRAIN, SG_ALERT, "Unable to get effect for VPB - no material library available");
+        makeChild(landEffectProp.ptr(), "inherits-from")->setStringValue("Effects/model-default");
+    }
+
+    buffer._landGeode = new EffectGeode();
+    if (buffer._transform.valid()) buffer._transform->addChild(buffer._landGeode.get());
+
+    buffer._landGeometry = new osg::Geometry;
+    buffer._landGeode->addDrawable(buffer._landGeometry.get());
+  
+    osg::ref_ptr<Effect> landEffect = makeEffect(landEffectProp, true, _options);
+    buffer._landGeode->setEffect(landEffect.get());
+    buffer._landGeode->setNodeMask(SG_NODEMASK_TERRAIN_BIT);
+
+    // allocate and assign color
+    osg::ref_ptr<osg::Vec4Array> colors = new osg::Vec4Array(1);
+    (*colors)[0].set(1.0f,1.0f,1.0f,1.0f);
+
+    buffer._landGeometry->setColorArray(colors.get(), osg::Array::BIND_OVERALL);
+
+    if (buffer._fromCache)
+    {
+        const VPBTileData::Geometry& mesh = buffer._tileData->mesh;
+        buffer._landGeometry->setVertexArray(mesh.vertices.get());
+        buffer._landGeometry->setNormalArray(mesh.normals.get(), osg::Array::BIND_PER_VERTEX);
+        buffer._landGeometry->setTexCoordArray(0, mesh.texcoords.get());
+        for (const auto& primitive : mesh.primitives) buffer._landGeometry->addPrimitiveSet(primitive.get());
+        buffer._width = buffer._tileData->width;
+        buffer._height = buffer._tileData->height;
+    }
+    else
+    {
+        generateMesh(buffer, masterLocator, centerModel, atlas);
+
+        if (buffer._tileData.valid())
+        {
+            if (!buffer._tileData->mesh.capture(*buffer._landGeometry)) buffer._tileData->complete = false;
+            buffer._tileData->width = buffer._width;
+            buffer._tileData->height = buffer._height;
+        }
+    }
+
+    if (terrain && terrain->getEqualizeBoundaries())
+    {
+        TileID tileID = _terrainTile->getTileID();
+        linkNeighbours(terrain->getTile(TileID(tileID.level, tileID.x-1, tileID.y)),
+                       terrain->getTile(TileID(tileID.level, tileID.x+1, tileID.y)),
+                       terrain->getTile(TileID(tileID.level, tileID.x, tileID.y+1)),
+                       terrain->getTile(TileID(tileID.level, tileID.x, tileID.y-1)));
+    }
+
+    buffer._landGeometry->setUseDisplayList(false);
+    buffer._landGeometry->setUseVertexBufferObjects(true);
+    buffer._landGeode->runGenerators(buffer._landGeometry);
+
+    // Tile-specific information for the shaders
+    osg::StateSet *landStateSet = buffer._landGeode->getOrCreateStateSet();
+    osg::ref_ptr<osg::Uniform> level = new osg::Uniform("tile_level", _terrainTile->getTileID().level);
+    landStateSet->addUniform(level);
 
     SG_LOG(SG_TERRAIN, SG_DEBUG, "Tile Level " << _terrainTile->getTileID().level << " width " << buffer._width << " height " << buffer._height);
 
@@ -1462,9 +1657,11 @@ void VPBTechnique::applyMaterials(BufferData& buffer, Locator* masterLocator, os
 
     // Filter out handlers that do not apply to the current tile
     std::vector<VPBMaterialHandler *> handlers;
-    for (const auto handler : all_handlers) {
-        if (handler->initialize(_options, _terrainTile)) {
-            handlers.push_back(handler);
+    std::vector<unsigned int> handler_ids; // index into all_handlers, for the tile cache
+    for (auto i = 0u; i < all_handlers.size(); ++i) {
+        if (all_handlers[i]->initialize(_options, _terrainTile)) {
+            handlers.push_back(all_handlers[i]);
+            handler_ids.push_back(i);
         }
     }
 
@@ -1473,8 +1670,6 @@ void VPBTechnique::applyMaterials(BufferData& buffer, Locator* masterLocator, os
         return;
     }
 
-    SGMaterial* mat = 0;
-
     const SGGeod loc = computeCenterGeod(buffer, masterLocator);
 
     osg::Vec3d up = buffer._transform->getMatrix().getTrans();
@@ -1536,183 +1731,223 @@ void VPBTechnique::applyMaterials(BufferData& buffer, Locator* masterLocator, os
             std::make_pair(handler->get_delta_lat(), handler->get_delta_lon()));
     }
 
-    // At the detailed tile level we are handling various materials, and
-    // as we walk across the tile in a scanline, the landclass doesn't
-    // change regularly from point to point.  Cache the required
-    // material information for the current landclass to reduce the
-    // number of lookups into the material cache.
-    int current_land_class = -1;
-    osg::Texture2D* object_mask = NULL;
-    osg::Image* object_mask_image = NULL;
-    float x_scale = 1000.0;
-    float y_scale = 1000.0;
-
-    for (unsigned int i = 0; i < triangle_count; i++)
-    {
-        const int i0 = drawElements->index(3 * i);
-        const int i1 = drawElements->index(3 * i + 1);
-        const int i2 = drawElements->index(3 * i + 2);
-
-        const osg::Vec3 v0 = vertexPtr[i0];
-        const osg::Vec3 v1 = vertexPtr[i1];
-        const osg::Vec3 v2 = vertexPtr[i2];
-
-        const osg::Vec3d v_0 = v0;
-        const osg::Vec3d v_x = v1 - v0;
-        const osg::Vec3d v_y = v2 - v0;
-
-        osg::Vec3 n = v_x ^ v_y;
-        n.normalize();
-
-        const osg::Vec3d v_0_g = R_vert * v0;
-        const osg::Vec3d v_1_g = R_vert * v1;
-        const osg::Vec3d v_2_g = R_vert * v2;
-
-        const osg::Vec2d ll_0 = osg::Vec2d(v_0_g.y() * one_over_C + lon, -v_0_g.x() * one_over_r_E + lat);
-        const osg::Vec2d ll_1 = osg::Vec2d(v_1_g.y() * one_over_C + lon, -v_1_g.x() * one_over_r_E + lat);
-        const osg::Vec2d ll_2 = osg::Vec2d(v_2_g.y() * one_over_C + lon, -v_2_g.x() * one_over_r_E + lat);
-
-        const osg::Vec2d ll_O = ll_0;
-        const osg::Vec2d ll_x = osg::Vec2d((v_1_g.y() - v_0_g.y()) * one_over_C, -(v_1_g.x() - v_0_g.x()) * one_over_r_E);
-        const osg::Vec2d ll_y = osg::Vec2d((v_2_g.y() - v_0_g.y()) * one_over_C, -(v_2_g.x() - v_0_g.x()) * one_over_r_E);
-
-        // Each handler may have a different delta/granularity in the scanline.
-        // To take advantage of the material caching, we first collect all the
-        // scan points from all the handlers for the current tile, and then scan
-        // them in spatial order, calling the appropriate handler for each
-        // point.
-        //
-        // We will insert <lon, lat, handler*> elements in a vector, and sort
-        // all elements in increasing lon followed by increase lat, mimicking a
-        // scanline reading approach for efficient landclass caching
-        std::vector<std::tuple<double, double, VPBMaterialHandler *>>
-            scan_points;
-
-        for(auto iter=0u; iter!=handlers.size(); iter++) {
-            const double delta_lat = deltas[iter].first;
-            const double delta_lon = deltas[iter].second;
-            const int off_x = ll_O.x() / delta_lon;
-            const int off_y = ll_O.y() / delta_lat;
-            const int min_lon = min(min(ll_0.x(), ll_1.x()), ll_2.x()) / delta_lon;
-            const int max_lon = max(max(ll_0.x(), ll_1.x()), ll_2.x()) / delta_lon;
-            const int min_lat = min(min(ll_0.y(), ll_1.y()), ll_2.y()) / delta_lat;
-            const int max_lat = max(max(ll_0.y(), ll_1.y()), ll_2.y()) / delta_lat;
-
-            for (int lat_int = min_lat - 1; lat_int <= max_lat + 1; lat_int++) {
-                const double lat = (lat_int - off_y) * delta_lat;
-                for (int lon_int = min_lon - 1; lon_int <= max_lon + 1;
-                     lon_int++) {
-                    const double lon = (lon_int - off_x) * delta_lon;
-                    scan_points.push_back(
-                        std::make_tuple(lon, lat, handlers[iter]));
+    if (buffer._fromCache) {
+        // Place the objects found when the tile was generated.  This skips
+        // the scan of the landclass texture and the constraint checks.
+        const auto& placements = buffer._tileData->placements;
+        for (auto h = 0u; h < handlers.size(); ++h) {
+            if (handler_ids[h] >= placements.size()) continue;
+
+            int current_land_class = -1;
+            bool active = false;
+            for (const auto& placement : placements[handler_ids[h]]) {
+                if (placement.landClass != current_land_class) {
+                    current_land_class = placement.landClass;
+                    SGMaterial* mat = matcache->find(current_land_class);
+                    active = mat && handlers[h]->handleNewMaterial(mat);
                 }
+                if (active) handlers[h]->placeObject(placement.position, up, placement.normal);
             }
         }
 
-        std::sort(scan_points.begin(), scan_points.end());
+        for (const auto handler : handlers) {
+            handler->finish(_options, buffer._materialNodes, loc);
+        }
+        return;
+    }
 
-        const osg::Vec2 t0 = texPtr[i0];
-        const osg::Vec2 t1 = texPtr[i1];
-        const osg::Vec2 t2 = texPtr[i2];
+    if (buffer._tileData.valid()) buffer._tileData->placements.resize(all_handlers.size());
+
+    // Make sure the bounds of the line features are computed before they
+    // are intersected from several threads.
+    if (buffer._lineFeatures) buffer._lineFeatures->getBound();
+
+    // Each handler scans the whole tile on its own, so the handlers can run
+    // concurrently.  To place the same objects as a single scan calling all
+    // handlers, every scan walks the scan points of all handlers in the
+    // same order and follows the landclass changes they cause, but only
+    // handles its own points.  As in a single scan, a change is passed to
+    // handleNewMaterial(), and the point causing it is skipped if its own
+    // handler doesn't use the material; usesMaterial() tells that for the
+    // points of other handlers.  The objects placed only depend on the
+    // position (pc_map_rand), so the result doesn't depend on which thread
+    // scans.
+    auto scanTile = [&](unsigned int h) {
+        VPBMaterialHandler* handler = handlers[h];
+
+        // The random number state is per thread.
+        pc_init(2718281);
+
+        // At the detailed tile level we are handling various materials, and
+        // as we walk across the tile in a scanline, the landclass doesn't
+        // change regularly from point to point.  Cache the required
+        // material information for the current landclass to reduce the
+        // number of lookups into the material cache.
+        SGMaterial* mat = 0;
+        int current_land_class = -1;
+        osg::Texture2D* object_mask = NULL;
+        osg::Image* object_mask_image = NULL;
+        float x_scale = 1000.0;
+        float y_scale = 1000.0;
+
+        std::vector<VPBTileData::Placement>* placements = buffer._tileData.valid() ?
+            &buffer._tileData->placements[handler_ids[h]] : nullptr;
+
+        // <lon, lat, handler> for the points of all handlers, sorted in
+        // increasing lon followed by increasing lat, mimicking a scanline
+        // reading approach for efficient landclass caching.
+        std::vector<std::tuple<double, double, VPBMaterialHandler*>> scan_points;
+
+        for (unsigned int i = 0; i < triangle_count; i++)
+        {
+            const int i0 = drawElements->index(3 * i);
+            const int i1 = drawElements->index(3 * i + 1);
+            const int i2 = drawElements->index(3 * i + 2);
+
+            const osg::Vec3 v0 = vertexPtr[i0];
+            const osg::Vec3 v1 = vertexPtr[i1];
+            const osg::Vec3 v2 = vertexPtr[i2];
+
+            const osg::Vec3d v_0 = v0;
+            const osg::Vec3d v_x = v1 - v0;
+            const osg::Vec3d v_y = v2 - v0;
+
+            osg::Vec3 n = v_x ^ v_y;
+            n.normalize();
+
+            const osg::Vec3d v_0_g = R_vert * v0;
+            const osg::Vec3d v_1_g = R_vert * v1;
+            const osg::Vec3d v_2_g = R_vert * v2;
+
+            const osg::Vec2d ll_0 = osg::Vec2d(v_0_g.y() * one_over_C + lon, -v_0_g.x() * one_over_r_E + lat);
+            const osg::Vec2d ll_1 = osg::Vec2d(v_1_g.y() * one_over_C + lon, -v_1_g.x() * one_over_r_E + lat);
+            const osg::Vec2d ll_2 = osg::Vec2d(v_2_g.y() * one_over_C + lon, -v_2_g.x() * one_over_r_E + lat);
+
+            const osg::Vec2d ll_O = ll_0;
+            const osg::Vec2d ll_x = osg::Vec2d((v_1_g.y() - v_0_g.y()) * one_over_C, -(v_1_g.x() - v_0_g.x()) * one_over_r_E);
+            const osg::Vec2d ll_y = osg::Vec2d((v_2_g.y() - v_0_g.y()) * one_over_C, -(v_2_g.x() - v_0_g.x()) * one_over_r_E);
+
+            scan_points.clear();
+            for (auto iter = 0u; iter != handlers.size(); iter++) {
+                const double delta_lat = deltas[iter].first;
+                const double delta_lon = deltas[iter].second;
+                const int off_x = ll_O.x() / delta_lon;
+                const int off_y = ll_O.y() / delta_lat;
+                const int min_lon = min(min(ll_0.x(), ll_1.x()), ll_2.x()) / delta_lon;
+                const int max_lon = max(max(ll_0.x(), ll_1.x()), ll_2.x()) / delta_lon;
+                const int min_lat = min(min(ll_0.y(), ll_1.y()), ll_2.y()) / delta_lat;
+                const int max_lat = max(max(ll_0.y(), ll_1.y()), ll_2.y()) / delta_lat;
+
+                for (int lat_int = min_lat - 1; lat_int <= max_lat + 1; lat_int++) {
+                    const double lat = (lat_int - off_y) * delta_lat;
+                    for (int lon_int = min_lon - 1; lon_int <= max_lon + 1;
+                         lon_int++) {
+                        const double lon = (lon_int - off_x) * delta_lon;
+                        scan_points.push_back(
+                            std::make_tuple(lon, lat, handlers[iter]));
+                    }
+                }
+            }
 
-        const osg::Vec2d t_0 = t0;
-        const osg::Vec2d t_x = t1 - t0;
-        const osg::Vec2d t_y = t2 - t0;
+            std::sort(scan_points.begin(), scan_points.end());
 
-        const double D = det2(ll_x, ll_y);
+            const osg::Vec2 t0 = texPtr[i0];
+            const osg::Vec2 t1 = texPtr[i1];
+            const osg::Vec2 t2 = texPtr[i2];
 
-        for(auto const &point : scan_points) {
-            const double lon = get<0>(point);
-            const double lat = get<1>(point);
-            VPBMaterialHandler *handler = get<2>(point);
+            const osg::Vec2d t_0 = t0;
+            const osg::Vec2d t_x = t1 - t0;
+            const osg::Vec2d t_y = t2 - t0;
 
-            osg::Vec2d p(lon, lat);
-            double x = det2(ll_x, p) / D;
-            double y = det2(p, ll_y) / D;
+            const double D = det2(ll_x, ll_y);
 
-            if ((x < 0.0) || (y < 0.0) || (x + y > 1.0)) continue;
+            for(auto const &point : scan_points) {
+                const double lon = std::get<0>(point);
+                const double lat = std::get<1>(point);
+                const bool own_point = (std::get<2>(point) == handler);
 
-            if (!image) {
-                SG_LOG(SG_TERRAIN, SG_ALERT, "Image disappeared under my feet.");
-                continue;
-            }
+                osg::Vec2d p(lon, lat);
+                double x = det2(ll_x, p) / D;
+                double y = det2(p, ll_y) / D;
 
-            osg::Vec2 t = osg::Vec2(t_0 + t_x * x + t_y * y);
-            unsigned int tx = (unsigned int) (image->s() * t.x()) % image->s();
-            unsigned int ty = (unsigned int) (image->t() * t.y()) % image->t();
-            const osg::Vec4 tc = image->getColor(tx, ty);
-            const int land_class = int(std::round(tc.x() * 255.0));
-
-            if (land_class != current_land_class) {
-                // Use temporal locality to reduce material lookup by caching
-                // some elements for future lookups against the same landclass.
-                mat = matcache->find(land_class);
-                if (!mat) continue;
-
-                current_land_class = land_class;
-
-                // We need to notify all handlers of material change, but
-                // only consider the current handler being processed for
-                // skipping the loop
-                bool current_handler_result = true;
-                for (const auto temp_handler : handlers) {
-                    bool result = temp_handler->handleNewMaterial(mat);
-
-                    if (temp_handler == handler) {
-                        current_handler_result = result;
-                    }
-                }
+                if ((x < 0.0) || (y < 0.0) || (x + y > 1.0)) continue;
 
-                if (!current_handler_result) {
-                    continue;
-                }
+                osg::Vec2 t = osg::Vec2(t_0 + t_x * x + t_y * y);
+                unsigned int tx = (unsigned int) (image->s() * t.x()) % image->s();
+                unsigned int ty = (unsigned int) (image->t() * t.y()) % image->t();
+                const osg::Vec4 tc = image->getColor(tx, ty);
+                const int land_class = int(std::round(tc.x() * 255.0));
+
+                if (land_class != current_land_class) {
+                    // Use temporal locality to reduce material lookup by caching
+                    // some elements for future lookups against the same landclass.
+                    mat = matcache->find(land_class);
+                    if (!mat) continue;
+
+                    current_land_class = land_class;
 
-                object_mask = mat->get_one_object_mask(0);
-                object_mask_image = NULL;
-                if (object_mask != NULL) {
-                    object_mask_image = object_mask->getImage();
-                    if (!object_mask_image || ! object_mask_image->valid()) {
-                        object_mask_image = NULL;
+                    const bool result = handler->handleNewMaterial(mat);
+                    if (own_point ? !result : !std::get<2>(point)->usesMaterial(mat)) {
                         continue;
                     }
 
-                    // Texture coordinates run [0..1][0..1] across the entire tile whereas
-                    // the texure itself has defined dimensions in m.
-                    // We therefore need to use the tile width and height to determine the correct
-                    // texture coordinate transformation.
-                    x_scale = buffer._width / 1000.0;
-                    y_scale = buffer._height / 1000.0;
+                    object_mask = mat->get_one_object_mask(0);
+                    object_mask_image = NULL;
+                    if (object_mask != NULL) {
+                        object_mask_image = object_mask->getImage();
+                        if (!object_mask_image || ! object_mask_image->valid()) {
+                            object_mask_image = NULL;
+                            continue;
+                        }
+
+                        // Texture coordinates run [0..1][0..1] across the entire tile whereas
+                        // the texure itself has defined dimensions in m.
+                        // We therefore need to use the tile width and height to determine the correct
+                        // texture coordinate transformation.
+                        x_scale = buffer._width / 1000.0;
+                        y_scale = buffer._height / 1000.0;
 
-                    if (mat->get_xsize() > 0.0) { x_scale = buffer._width / mat->get_xsize(); }
-                    if (mat->get_ysize() > 0.0) { y_scale = buffer._height / mat->get_ysize(); }
+                        if (mat->get_xsize() > 0.0) { x_scale = buffer._width / mat->get_xsize(); }
+                        if (mat->get_ysize() > 0.0) { y_scale = buffer._height / mat->get_ysize(); }
+                    }
                 }
-            }
 
-            if (!mat) continue;
+                if (!mat || !own_point) continue;
 
-            osg::Vec2f pointInTriangle;
+                osg::Vec2f pointInTriangle;
 
-            if (handler->handleIteration(mat, object_mask_image,
-                                         lon, lat, p,
-                                         D, ll_O, ll_x, ll_y, t_0, t_x, t_y, x_scale, y_scale, pointInTriangle)) {
-                // Check against constraints to stop lights on roads
-                const osg::Vec3 vp = v_x * pointInTriangle.x() + v_y * pointInTriangle.y() + v_0;
-                const osg::Vec3 upperPoint = vp + up * 100;
-                const osg::Vec3 lowerPoint = vp - up * 100;
-                if (checkAgainstRandomObjectsConstraints(buffer, lowerPoint, upperPoint))
-                    continue;
+                if (handler->handleIteration(mat, object_mask_image,
+                                             lon, lat, p,
+                                             D, ll_O, ll_x, ll_y, t_0, t_x, t_y, x_scale, y_scale, pointInTriangle)) {
+                    // Check against constraints to stop lights on roads
+                    const osg::Vec3 vp = v_x * pointInTriangle.x() + v_y * pointInTriangle.y() + v_0;
+                    const osg::Vec3 upperPoint = vp + up * 100;
+                    const osg::Vec3 lowerPoint = vp - up * 100;
+                    if (checkAgainstRandomObjectsConstraints(buffer, lowerPoint, upperPoint))
+                        continue;
 
-                const osg::Matrixd localToGeocentricTransform = buffer._transform->getMatrix();
-                if (checkAgainstElevationConstraints(lowerPoint * localToGeocentricTransform, upperPoint * localToGeocentricTransform))
-                    continue;
+                    const osg::Matrixd localToGeocentricTransform = buffer._transform->getMatrix();
+                    if (checkAgainstElevationConstraints(lowerPoint * localToGeocentricTransform, upperPoint * localToGeocentricTransform))
+                        continue;
 
-                handler->placeObject(vp, up, n);
+                    handler->placeObject(vp, up, n);
+                    if (placements) placements->push_back({current_land_class, vp, n});
+                }
             }
         }
+    };
+
+    if ((handlers.size() > 1) && getParallelTileGeneration()) {
+        SGThreadPool::shared().parallelFor(0, static_cast<int>(handlers.size()), 1, [&](int begin, int end) {
+            for (int h = begin; h < end; ++h) scanTile(h);
+        });
+    } else {
+        for (auto h = 0u; h < handlers.size(); ++h) scanTile(h);
     }
 
+    // Add the results in handler order, whichever handler finished first.
     for (const auto handler : handlers) {
-        handler->finish(_options, buffer._transform, loc);
+        handler->finish(_options, buffer._materialNodes, loc);
     }
 }
 
@@ -1754,107 +1989,126 @@ void VPBTechnique::applyLineFeatures(BufferData& buffer, Locator* masterLocator,
     const osg::Vec3d world = buffer._transform->getMatrix().getTrans();
     const SGGeod loc = SGGeod::fromCart(toSG(world));
     const SGBucket bucket = SGBucket(loc);
-    string material_name = "";
-    for (auto roads = _lineFeatureLists.begin(); roads != _lineFeatureLists.end(); ++roads) {
-        auto r = *roads;
-        if (r.first != bucket) continue;
-        LineFeatureBinList roadBins = r.second;
-
-        for (LineFeatureBinList::iterator rb = roadBins.begin(); rb != roadBins.end(); ++rb)
-        {
-            if (material_name != (*rb)->getMaterial()) {
-                // Cache the material to reduce lookups.
-                mat = matcache->find((*rb)->getMaterial());
-                material_name = (*rb)->getMaterial();
-            }
-
-            if (!mat) {
-                SG_LOG(SG_TERRAIN, SG_ALERT, "Unable to find material " << (*rb)->getMaterial() << " at " << loc << " " << bucket);
-                continue;
-            }    
-
-            const unsigned int ysize = mat->get_ysize();
-            const bool   light_edge_offset = mat->get_light_edge_offset();
-            const double light_edge_spacing = mat->get_light_edge_spacing_m();
-            const double light_edge_height = mat->get_light_edge_height_m();
-            const double x0 = mat->get_line_feature_tex_x0();
-            const double x1 = mat->get_line_feature_tex_x1();
-            const double elevation_offset_m = mat->get_line_feature_offset_m();
 
-            //  Generate a geometry for this set of roads.
-            osg::Vec3Array* v = new osg::Vec3Array;
-            osg::Vec2Array* t = new osg::Vec2Array;
-            osg::Vec3Array* n = new osg::Vec3Array;
-            osg::Vec4Array* c = new osg::Vec4Array;
-            osg::Vec3Array* lights = new osg::Vec3Array;
+    // Build the geode and lights of one set of line features
+    auto addLineFeature = [&](SGMaterial* mat, osg::Vec3Array* v, osg::Vec2Array* t, osg::Vec3Array* n, osg::Vec3Array* lights) {
+        osg::ref_ptr<osg::Vec4Array> c = new osg::Vec4Array;
+        c->push_back(osg::Vec4d(1.0,1.0,1.0,1.0));
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(v);
+        geometry->setTexCoordArray(0, t, osg::Array::BIND_PER_VERTEX);
+        geometry->setTexCoordArray(1, t, osg::Array::BIND_PER_VERTEX);
+        geometry->setNormalArray(n, osg::Array::BIND_PER_VERTEX);
+        geometry->setColorArray(c, osg::Array::BIND_OVERALL);
+        geometry->setUseDisplayList( false );
+        geometry->setUseVertexBufferObjects( true );
+        geometry->addPrimitiveSet( new osg::DrawArrays( GL_TRIANGLES, 0, v->size()) );
+
+        EffectGeode* geode = new EffectGeode;
+        geode->addDrawable(geometry);
+
+        geode->setMaterial(mat);
+        geode->setEffect(mat->get_one_effect(0));
+        geode->runGenerators(geometry);
+        geode->setNodeMask(SG_NODEMASK_TERRAIN_BIT);
+
+        osg::StateSet* stateset = geode->getOrCreateStateSet();
+        stateset->addUniform(new osg::Uniform(VPBTechnique::Z_UP_TRANSFORM, osg::Matrixf(osg::Matrix::inverse(makeZUpFrameRelative(loc)))));
+        stateset->addUniform(new osg::Uniform(VPBTechnique::MODEL_OFFSET, (osg::Vec3f) buffer._transform->getMatrix().getTrans()));
 
-            auto lineFeatures = (*rb)->getLineFeatures();
+        atlas->addUniforms(stateset);
 
-            for (auto r = lineFeatures.begin(); r != lineFeatures.end(); ++r) {
-                if (r->_width > minWidth) generateLineFeature(buffer, masterLocator, *r, world, v, t, n, lights, x0, x1, ysize, light_edge_spacing, light_edge_height, light_edge_offset, elevation_offset_m);
-            }
+        buffer._lineFeatures->addChild(geode);
+
+        if (lights->size() > 0) {
+            const double size = mat->get_light_edge_size_cm();
+            const double intensity = mat->get_light_edge_intensity_cd();
+            const SGVec4f color = mat->get_light_edge_colour();
+            const double horiz = mat->get_light_edge_angle_horizontal_deg();
+            const double vertical = mat->get_light_edge_angle_vertical_deg();
+            // Assume street lights point down.
+            osg::Vec3d up = world;
+            up.normalize();
+            const SGVec3f direction = toSG(- (osg::Vec3f) up);
+
+            std::for_each(lights->begin(), lights->end(), 
+                [&, size, intensity, color, direction, horiz, vertical] (osg::Vec3f p) { lightbin.insert(toSG(p), size, intensity, 1, color, direction, horiz, vertical); } );
+        }
+    };
 
-            if (v->size() == 0) {
-                v->unref();
-                t->unref();
-                n->unref();
-                c->unref();
-                lights->unref();
+    if (buffer._fromCache) {
+        for (const auto& feature : buffer._tileData->lineFeatures) {
+            mat = matcache->find(feature.material);
+            if (!mat) {
+                SG_LOG(SG_TERRAIN, SG_ALERT, "Unable to find material " << feature.material << " at " << loc << " " << bucket);
                 continue;
             }
+            addLineFeature(mat, feature.geometry.vertices.get(), feature.geometry.texcoords.get(), feature.geometry.normals.get(), feature.lights.get());
+        }
+    } else {
+        string material_name = "";
+        for (auto roads = _lineFeatureLists.begin(); roads != _lineFeatureLists.end(); ++roads) {
+            auto r = *roads;
+            if (r.first != bucket) continue;
+            LineFeatureBinList roadBins = r.second;
 
-            c->push_back(osg::Vec4d(1.0,1.0,1.0,1.0));
-
-            osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
-            geometry->setVertexArray(v);
-            geometry->setTexCoordArray(0, t, osg::Array::BIND_PER_VERTEX);
-            geometry->setTexCoordArray(1, t, osg::Array::BIND_PER_VERTEX);
-            geometry->setNormalArray(n, osg::Array::BIND_PER_VERTEX);
-            geometry->setColorArray(c, osg::Array::BIND_OVERALL);
-            geometry->setUseDisplayList( false );
-            geometry->setUseVertexBufferObjects( true );
-            geometry->addPrimitiveSet( new osg::DrawArrays( GL_TRIANGLES, 0, v->size()) );
-
-            EffectGeode* geode = new EffectGeode;
-            geode->addDrawable(geometry);
+            for (LineFeatureBinList::iterator rb = roadBins.begin(); rb != roadBins.end(); ++rb)
+            {
+                if (material_name != (*rb)->getMaterial()) {
+                    // Cache the material to reduce lookups.
+                    mat = matcache->find((*rb)->getMaterial());
+                    material_name = (*rb)->getMaterial();
+                }
 
-            geode->setMaterial(mat);
-            geode->setEffect(mat->get_one_effect(0));
-            geode->runGenerators(geometry);
-            geode->setNodeMask(SG_NODEMASK_TERRAIN_BIT);
+                if (!mat) {
+                    SG_LOG(SG_TERRAIN, SG_ALERT, "Unable to find material " << (*rb)->getMaterial() << " at " << loc << " " << bucket);
+                    continue;
+                }    
+
+                const unsigned int ysize = mat->get_ysize();
+                const bool   light_edge_offset = mat->get_light_edge_offset();
+                const double light_edge_spacing = mat->get_light_edge_spacing_m();
+                const double light_edge_height = mat->get_light_edge_height_m();
+                const double x0 = mat->get_line_feature_tex_x0();
+                const double x1 = mat->get_line_feature_tex_x1();
+                const double elevation_offset_m = mat->get_line_feature_offset_m();
+
+                //  Generate a geometry for this set of roads.
+                osg::ref_ptr<osg::Vec3Array> v = new osg::Vec3Array;
+                osg::ref_ptr<osg::Vec2Array> t = new osg::Vec2Array;
+                osg::ref_ptr<osg::Vec3Array> n = new osg::Vec3Array;
+                osg::ref_ptr<osg::Vec3Array> lights = new osg::Vec3Array;
+
+                auto lineFeatures = (*rb)->getLineFeatures();
+
+                for (auto r = lineFeatures.begin(); r != lineFeatures.end(); ++r) {
+                    if (r->_width > minWidth) generateLineFeature(buffer, masterLocator, *r, world, v.get(), t.get(), n.get(), lights.get(), x0, x1, ysize, light_edge_spacing, light_edge_height, light_edge_offset, elevation_offset_m);
+                }
 
-            osg::StateSet* stateset = geode->getOrCreateStateSet();
-            stateset->addUniform(new osg::Uniform(VPBTechnique::Z_UP_TRANSFORM, osg::Matrixf(osg::Matrix::inverse(makeZUpFrameRelative(loc)))));
-            stateset->addUniform(new osg::Uniform(VPBTechnique::MODEL_OFFSET, (osg::Vec3f) buffer._transform->getMatrix().getTrans()));
+                if (v->size() == 0) continue;
 
-            atlas->addUniforms(stateset);
+                if (buffer._tileData.valid()) {
+                    VPBTileData::Feature feature;
+                    feature.material = material_name;
+                    feature.geometry.vertices = v;
+                    feature.geometry.texcoords = t;
+                    feature.geometry.normals = n;
+                    feature.lights = lights;
+                    buffer._tileData->lineFeatures.push_back(feature);
+                }
 
-            buffer._lineFeatures->addChild(geode);
-
-            if (lights->size() > 0) {
-                const double size = mat->get_light_edge_size_cm();
-                const double intensity = mat->get_light_edge_intensity_cd();
-                const SGVec4f color = mat->get_light_edge_colour();
-                const double horiz = mat->get_light_edge_angle_horizontal_deg();
-                const double vertical = mat->get_light_edge_angle_vertical_deg();
-                // Assume street lights point down.
-                osg::Vec3d up = world;
-                up.normalize();
-                const SGVec3f direction = toSG(- (osg::Vec3f) up);
-
-                std::for_each(lights->begin(), lights->end(), 
-                    [&, size, intensity, color, direction, horiz, vertical] (osg::Vec3f p) { lightbin.insert(toSG(p), size, intensity, 1, color, direction, horiz, vertical); } );
+                addLineFeature(mat, v, t, n, lights);
             }
-            lights->unref();
         }
     }
 
     if (buffer._lineFeatures->getNumChildren() > 0) {
         // We have some line features, so add them
-        buffer._transform->addChild(buffer._lineFeatures.get());
+        buffer._lineFeatureNodes->addChild(buffer._lineFeatures.get());
     }
 
-    if (lightbin.getNumLights() > 0) buffer._transform->addChild(createLights(lightbin, osg::Matrix::identity(), _options));
+    if (lightbin.getNumLights() > 0) buffer._lineFeatureNodes->addChild(createLights(lightbin, osg::Matrix::identity(), _options));
 }
 
 void VPBTechnique::generateLineFeature(BufferData& buffer, Locator* masterLocator, LineFeatureBin::LineFeature road, osg::Vec3d modelCenter, osg::Vec3Array* v, osg::Vec2Array* t, osg::Vec3Array* n, osg::Vec3Array* lights, double x0, double x1, unsigned int ysize, double light_edge_spacing, double light_edge_height, bool light_edge_offset, double elevation_offset_m)
@@ -2011,10 +2265,56 @@ void VPBTechnique::applyAreaFeatures(BufferData& buffer, Locator* masterLocator,
 
     SGMaterial* mat = 0;
 
-    // Get all appropriate areas.  We assume that the VPB terrain tile is smaller than a Bucket size.
     const osg::Vec3d world = buffer._transform->getMatrix().getTrans();
     const SGGeod loc = SGGeod::fromCart(toSG(world));
     const SGBucket bucket = SGBucket(loc);
+
+    // Create the geometry of one set of areas, with the vertex arrays
+    // empty if they are to be generated
+    auto createGeometry = [](osg::Vec3Array* v, osg::Vec2Array* t, osg::Vec3Array* n) {
+        osg::Vec4Array* c = new osg::Vec4Array(1);
+
+        osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+        geometry->setVertexArray(v);
+        geometry->setTexCoordArray(0, t, osg::Array::BIND_PER_VERTEX);
+        geometry->setTexCoordArray(1, t, osg::Array::BIND_PER_VERTEX);
+        geometry->setNormalArray(n, osg::Array::BIND_PER_VERTEX);
+        geometry->setColorArray(c, osg::Array::BIND_OVERALL);
+        geometry->setUseDisplayList( false );
+        geometry->setUseVertexBufferObjects( true );
+        c->push_back(osg::Vec4(1.0,1.0,1.0,1.0));
+        return geometry;
+    };
+
+    auto addAreaFeature = [&](SGMaterial* mat, osg::Geometry* geometry) {
+        geometry->dirtyBound();
+
+        EffectGeode* geode = new EffectGeode;
+        geode->addDrawable(geometry);
+
+        geode->setMaterial(mat);
+        geode->setEffect(mat->get_one_effect(0));
+        geode->setNodeMask(SG_NODEMASK_TERRAIN_BIT);
+        buffer._areaFeatureNodes->addChild(geode);
+    };
+
+    if (buffer._fromCache) {
+        for (const auto& feature : buffer._tileData->areaFeatures) {
+            mat = matcache->find(feature.material);
+            if (!mat) {
+                SG_LOG(SG_TERRAIN, SG_ALERT, "Unable to find material " << feature.material << " at " << loc << " " << bucket);
+                continue;
+            }
+
+            const VPBTileData::Geometry& cached = feature.geometry;
+            osg::ref_ptr<osg::Geometry> geometry = createGeometry(cached.vertices.get(), cached.texcoords.get(), cached.normals.get());
+            for (const auto& primitive : cached.primitives) geometry->addPrimitiveSet(primitive.get());
+            addAreaFeature(mat, geometry.get());
+        }
+        return;
+    }
+
+    // Get all appropriate areas.  We assume that the VPB terrain tile is smaller than a Bucket size.
     for (auto areas = _areaFeatureLists.begin(); areas != _areaFeatureLists.end(); ++areas) {
         if (areas->first != bucket) continue;
 
@@ -2036,16 +2336,7 @@ void VPBTechnique::applyAreaFeatures(BufferData& buffer, Locator* masterLocator,
             osg::Vec3Array* v = new osg::Vec3Array;
             osg::Vec2Array* t = new osg::Vec2Array;
             osg::Vec3Array* n = new osg::Vec3Array;
-            osg::Vec4Array* c = new osg::Vec4Array(1);
-
-            osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
-            geometry->setVertexArray(v);
-            geometry->setTexCoordArray(0, t, osg::Array::BIND_PER_VERTEX);
-            geometry->setTexCoordArray(1, t, osg::Array::BIND_PER_VERTEX);
-            geometry->setNormalArray(n, osg::Array::BIND_PER_VERTEX);
-            geometry->setColorArray(c, osg::Array::BIND_OVERALL);
-            geometry->setUseDisplayList( false );
-            geometry->setUseVertexBufferObjects( true );
+            osg::ref_ptr<osg::Geometry> geometry = createGeometry(v, t, n);
 
             auto areaFeatures = (*rb)->getAreaFeatures();
 
@@ -2054,17 +2345,15 @@ void VPBTechnique::applyAreaFeatures(BufferData& buffer, Locator* masterLocator,
             }
 
             if (v->size() == 0) continue;
-            c->push_back(osg::Vec4(1.0,1.0,1.0,1.0));
-
-            geometry->dirtyBound();
 
-            EffectGeode* geode = new EffectGeode;
-            geode->addDrawable(geometry);
+            if (buffer._tileData.valid()) {
+                VPBTileData::Feature feature;
+                feature.material = (*rb)->getMaterial();
+                if (feature.geometry.capture(*geometry)) buffer._tileData->areaFeatures.push_back(feature);
+                else buffer._tileData->complete = false;
+            }
 
-            geode->setMaterial(mat);
-            geode->setEffect(mat->get_one_effect(0));
-            geode->setNodeMask(SG_NODEMASK_TERRAIN_BIT);
-            buffer._transform->addChild(geode);
+            addAreaFeature(mat, geometry.get());
         }
     }
 }
@@ -2618,19 +2907,36 @@ void VPBTechnique::unloadFeatures(SGBucket bucket)
     }
 }
 
-void VPBTechnique::updateStats(int tileLevel, float loadTime) {
+void VPBTechnique::updateStats(int tileLevel, float loadTime, const StageTimes& stageTimes) {
     const std::lock_guard<std::mutex> lock(VPBTechnique::_stats_mutex); // Lock the _stats_mutex for this scope
-    if (_loadStats.find(tileLevel) == _loadStats.end()) {
-        _loadStats[tileLevel] = LoadStat(1, loadTime);
-    } else {
-        _loadStats[tileLevel].first++;
-        _loadStats[tileLevel].second +=loadTime;
+    LoadStat& stat = _loadStats[tileLevel];
+    stat.count++;
+    stat.loadTime += loadTime;
+    for (int i = 0; i < NUM_LOAD_STAGES; ++i) {
+        stat.stageTimes[i] += stageTimes[i];
     }
 }
 
 float VPBTechnique::getMeanLoadTime(int tileLevel) {
     const std::lock_guard<std::mutex> lock(VPBTechnique::_stats_mutex); // Lock the _stats_mutex for this scope
-    if (_loadStats.find(tileLevel) == _loadStats.end()) return 0.0;
+    auto it = _loadStats.find(tileLevel);
+    if (it == _loadStats.end()) return 0.0;
 
-    return _loadStats[tileLevel].second / _loadStats[tileLevel].first;
-}
\ No newline at end of file
+    return it->second.loadTime / it->second.count;
+}
+
+float VPBTechnique::getMeanStageTime(int tileLevel, LoadStage stage) {
+    const std::lock_guard<std::mutex> lock(VPBTechnique::_stats_mutex); // Lock the _stats_mutex for this scope
+    auto it = _loadStats.find(tileLevel);
+    if (it == _loadStats.end()) return 0.0;
+
+    return it->second.stageTimes[stage] / it->second.count;
+}
+
+void VPBTechnique::setParallelTileGeneration(bool enabled) {
+    _parallelTileGeneration = enabled;
+}
+
+bool VPBTechnique::getParallelTileGeneration() {
+    return _parallelTileGeneration;
+}
@@ -19,6 +19,8 @@
 #ifndef VPBTECHNIQUE
 #define VPBTECHNIQUE 1
 
+#include <array>
+#include <atomic>
 #include <mutex>
 
 #include <osg/MatrixTransform>
@@ -35,6 +37,7 @@
 #include <simgear/scene/tgdb/LightBin.hxx>
 #include <simgear/scene/tgdb/LineFeatureBin.hxx>
 #include <simgear/scene/tgdb/CoastlineBin.hxx>
+#include <simgear/scene/tgdb/VPBTileCache.hxx>
 
 using namespace osgTerrain;
 
@@ -107,6 +110,13 @@ class VPBTechnique : public TerrainTechnique
         static void addCoastlineList(SGBucket bucket, CoastlineBinList areaList);
         static void unloadFeatures(SGBucket bucket);
 
+        // Run the independent stages of generating a tile (color layers,
+        // line and area features, random vegetation and lights)
+        // concurrently on the shared thread pool. Enabled by default; the
+        // result is the same either way.
+        static void setParallelTileGeneration(bool enabled);
+        static bool getParallelTileGeneration();
+
     protected:
 
         virtual ~VPBTechnique();
@@ -114,15 +124,26 @@ class VPBTechnique : public TerrainTechnique
         class BufferData : public osg::Referenced
         {
         public:
-            BufferData() : _transform(0), _landGeode(0), _landGeometry(0), _lineFeatures(0), _width(0.0), _height(0.0)            
+            BufferData() : _transform(0), _landGeode(0), _landGeometry(0), _lineFeatures(0),
+                _lineFeatureNodes(new osg::Group), _areaFeatureNodes(new osg::Group), _materialNodes(new osg::MatrixTransform),
+                _width(0.0), _height(0.0), _fromCache(false)
             {}
 
             osg::ref_ptr<osg::MatrixTransform>  _transform;
             osg::ref_ptr<EffectGeode>           _landGeode;
             osg::ref_ptr<osg::Geometry>         _landGeometry;
             osg::ref_ptr<osg::Group>            _lineFeatures;
+            // Nodes generated by the concurrent stages, moved to _transform in
+            // a fixed order once all stages are complete.
+            osg::ref_ptr<osg::Group>            _lineFeatureNodes;
+            osg::ref_ptr<osg::Group>            _areaFeatureNodes;
+            osg::ref_ptr<osg::MatrixTransform>  _materialNodes;
             float                               _width;
             float                               _height;
+            // Data for the tile cache, recorded while generating or read
+            // from the cache if _fromCache is set.
+            osg::ref_ptr<VPBTileData>           _tileData;
+            bool                                _fromCache;
 
         protected:
             ~BufferData() {}
@@ -133,6 +154,11 @@ class VPBTechnique : public TerrainTechnique
         const virtual SGGeod computeCenterGeod(BufferData& buffer, Locator* masterLocator);
 
         virtual void generateGeometry(BufferData& buffer, Locator* masterLocator, const osg::Vec3d& centerModel, osg::ref_ptr<SGMaterialCache> matcache);
+        void generateMesh(BufferData& buffer, Locator* masterLocator, const osg::Vec3d& centerModel, osg::ref_ptr<Atlas> atlas);
+        void linkNeighbours(TerrainTile* left, TerrainTile* right, TerrainTile* top, TerrainTile* bottom);
+
+        // Everything the cached data of this tile depends on
+        std::string computeTileCacheKey(Locator* masterLocator, const osg::Vec3d& centerModel);
 
         virtual void applyColorLayers(BufferData& buffer, Locator* masterLocator, osg::ref_ptr<SGMaterialCache> matcache);
 
@@ -177,8 +203,19 @@ class VPBTechnique : public TerrainTechnique
 
         virtual osg::Vec3d getMeshIntersection(BufferData& buffer, Locator* masterLocator, osg::Vec3d pt, osg::Vec3d up);
 
-        static void updateStats(int tileLevel, float loadTime);
+        enum LoadStage {
+            GEOMETRY_STAGE,
+            COLOR_LAYERS_STAGE,
+            LINE_FEATURES_STAGE,
+            AREA_FEATURES_STAGE,
+            MATERIALS_STAGE,
+            NUM_LOAD_STAGES
+        };
+        typedef std::array<float, NUM_LOAD_STAGES> StageTimes;
+
+        static void updateStats(int tileLevel, float loadTime, const StageTimes& stageTimes);
         static float getMeanLoadTime(int tileLevel);
+        static float getMeanStageTime(int tileLevel, LoadStage stage);
 
         // Check a given vertex against any constraints  E.g. to ensure we
         // don't get objects like trees sprouting from roads or runways.
@@ -216,8 +253,13 @@ class VPBTechnique : public TerrainTechnique
         inline static std::mutex _coastFeatureLists_mutex;  // protects the _areaFeatureLists;
 
         inline static std::mutex _stats_mutex; // Protects the loading statistics
-        typedef std::pair<unsigned int, float> LoadStat;
+        struct LoadStat {
+            unsigned int count = 0;
+            float loadTime = 0.0;
+            StageTimes stageTimes = {};  // Summed over all tiles, like loadTime
+        };
         inline static std::map<int, LoadStat> _loadStats;
+        inline static std::atomic<bool> _parallelTileGeneration{true};
 
         inline static osg::ref_ptr<osg::Image> _defaultCoastlineTexture;
         inline static std::mutex _defaultCoastlineTexture_mutex;
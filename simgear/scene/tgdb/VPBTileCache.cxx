@@ -0,0 +1,383 @@
+// VPBTileCache.cxx - on-disk cache of generated VPB tile data
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include "VPBTileCache.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include <osgDB/FileUtils>
+
+#include <simgear/debug/logstream.hxx>
+#include <simgear/misc/sg_path.hxx>
+#include <simgear/misc/strutils.hxx>
+#include <simgear/props/props.hxx>
+
+namespace simgear {
+
+namespace {
+
+// Bump whenever the generated data or its encoding changes.
+const uint32_t FormatVersion = 1;
+const char Magic[4] = {'V', 'P', 'B', 'T'};
+
+enum PrimitiveType : uint32_t {
+    DRAW_ARRAYS,
+    DRAW_ELEMENTS_USHORT,
+    DRAW_ELEMENTS_UINT
+};
+
+// The data is only read back on the same machine, so values are stored in
+// native byte order.
+class Writer
+{
+public:
+    void put(uint32_t v) { append(&v, sizeof(v)); }
+    void put(int32_t v) { append(&v, sizeof(v)); }
+    void put(float v) { append(&v, sizeof(v)); }
+
+    void put(const std::string& s)
+    {
+        put(static_cast<uint32_t>(s.size()));
+        append(s.data(), s.size());
+    }
+
+    template <class ArrayType>
+    void putArray(const ArrayType* array)
+    {
+        const uint32_t count = array ? array->size() : 0;
+        put(count);
+        if (count > 0) append(&array->front(), count * sizeof(typename ArrayType::ElementDataType));
+    }
+
+    void put(const VPBTileData::Geometry& geometry)
+    {
+        putArray(geometry.vertices.get());
+        putArray(geometry.normals.get());
+        putArray(geometry.texcoords.get());
+        put(static_cast<uint32_t>(geometry.primitives.size()));
+        for (const auto& primitive : geometry.primitives) {
+            put(static_cast<uint32_t>(primitive->getMode()));
+            if (auto arrays = dynamic_cast<const osg::DrawArrays*>(primitive.get())) {
+                put(uint32_t(DRAW_ARRAYS));
+                put(int32_t(arrays->getFirst()));
+                put(int32_t(arrays->getCount()));
+            } else if (auto elements = dynamic_cast<const osg::DrawElementsUShort*>(primitive.get())) {
+                put(uint32_t(DRAW_ELEMENTS_USHORT));
+                put(static_cast<uint32_t>(elements->size()));
+                if (!elements->empty()) append(&elements->front(), elements->size() * sizeof(GLushort));
+            } else if (auto elements = dynamic_cast<const osg::DrawElementsUInt*>(primitive.get())) {
+                put(uint32_t(DRAW_ELEMENTS_UINT));
+                put(static_cast<uint32_t>(elements->size()));
+                if (!elements->empty()) append(&elements->front(), elements->size() * sizeof(GLuint));
+            }
+        }
+    }
+
+    std::string data;
+
+private:
+    void append(const void* p, size_t size)
+    {
+        data.append(static_cast<const char*>(p), size);
+    }
+};
+
+class Reader
+{
+public:
+    explicit Reader(const std::string& data) : _data(data) {}
+
+    // All reads fail once the data ran out.
+    bool ok() const { return _ok; }
+
+    template <class T>
+    T get()
+    {
+        T v{};
+        extract(&v, sizeof(v));
+        return v;
+    }
+
+    std::string getString()
+    {
+        const uint32_t size = get<uint32_t>();
+        if (!check(size)) return std::string();
+        std::string s = _data.substr(_pos, size);
+        _pos += size;
+        return s;
+    }
+
+    template <class ArrayType>
+    osg::ref_ptr<ArrayType> getArray()
+    {
+        const uint32_t count = get<uint32_t>();
+        osg::ref_ptr<ArrayType> array = new ArrayType;
+        if (check(size_t(count) * sizeof(typename ArrayType::ElementDataType))) {
+            array->resize(count);
+            if (count > 0) extract(&array->front(), count * sizeof(typename ArrayType::ElementDataType));
+        }
+        return array;
+    }
+
+    void get(VPBTileData::Geometry& geometry)
+    {
+        geometry.vertices = getArray<osg::Vec3Array>();
+        geometry.normals = getArray<osg::Vec3Array>();
+        geometry.texcoords = getArray<osg::Vec2Array>();
+        const uint32_t count = get<uint32_t>();
+        for (uint32_t i = 0; (i < count) && _ok; ++i) {
+            const GLenum mode = get<uint32_t>();
+            const uint32_t type = get<uint32_t>();
+            if (type == DRAW_ARRAYS) {
+                const int32_t first = get<int32_t>();
+                const int32_t size = get<int32_t>();
+                geometry.primitives.push_back(new osg::DrawArrays(mode, first, size));
+            } else if (type == DRAW_ELEMENTS_USHORT) {
+                osg::ref_ptr<osg::DrawElementsUShort> elements = new osg::DrawElementsUShort(mode);
+                getElements(*elements);
+                geometry.primitives.push_back(elements);
+            } else if (type == DRAW_ELEMENTS_UINT) {
+                osg::ref_ptr<osg::DrawElementsUInt> elements = new osg::DrawElementsUInt(mode);
+                getElements(*elements);
+                geometry.primitives.push_back(elements);
+            } else {
+                _ok = false;
+            }
+        }
+    }
+
+private:
+    template <class ElementsType>
+    void getElements(ElementsType& elements)
+    {
+        const uint32_t count = get<uint32_t>();
+        if (check(size_t(count) * sizeof(typename ElementsType::value_type))) {
+            elements.resize(count);
+            if (count > 0) extract(&elements.front(), count * sizeof(typename ElementsType::value_type));
+        }
+    }
+
+    bool check(size_t size)
+    {
+        _ok = _ok && (size <= _data.size() - _pos);
+        return _ok;
+    }
+
+    void extract(void* p, size_t size)
+    {
+        if (!check(size)) return;
+        memcpy(p, _data.data() + _pos, size);
+        _pos += size;
+    }
+
+    const std::string& _data;
+    size_t _pos = 0;
+    bool _ok = true;
+};
+
+std::mutex cacheMutex;
+std::shared_ptr<DiskCache> sharedCache;
+
+} // anonymous namespace
+
+bool VPBTileData::Geometry::capture(const osg::Geometry& geometry)
+{
+    vertices = dynamic_cast<osg::Vec3Array*>(const_cast<osg::Array*>(geometry.getVertexArray()));
+    normals = dynamic_cast<osg::Vec3Array*>(const_cast<osg::Array*>(geometry.getNormalArray()));
+    texcoords = dynamic_cast<osg::Vec2Array*>(const_cast<osg::Array*>(geometry.getTexCoordArray(0)));
+    if (!vertices || !normals || !texcoords) {
+        return false;
+    }
+
+    primitives.clear();
+    for (unsigned int i = 0; i < geometry.getNumPrimitiveSets(); ++i) {
+        osg::PrimitiveSet* primitive = const_cast<osg::PrimitiveSet*>(geometry.getPrimitiveSet(i));
+        if (!dynamic_cast<osg::DrawArrays*>(primitive) &&
+            !dynamic_cast<osg::DrawElementsUShort*>(primitive) &&
+            !dynamic_cast<osg::DrawElementsUInt*>(primitive)) {
+            return false;
+        }
+        primitives.push_back(primitive);
+    }
+    return true;
+}
+
+std::string VPBTileData::serialize() const
+{
+    Writer w;
+    w.data.append(Magic, sizeof(Magic));
+    w.put(FormatVersion);
+
+    w.put(mesh);
+    w.put(width);
+    w.put(height);
+
+    w.put(static_cast<uint32_t>(lineFeatures.size()));
+    for (const auto& feature : lineFeatures) {
+        w.put(feature.material);
+        w.put(feature.geometry);
+        w.putArray(feature.lights.get());
+    }
+
+    w.put(static_cast<uint32_t>(areaFeatures.size()));
+    for (const auto& feature : areaFeatures) {
+        w.put(feature.material);
+        w.put(feature.geometry);
+    }
+
+    w.put(static_cast<uint32_t>(placements.size()));
+    for (const auto& handlerPlacements : placements) {
+        w.put(static_cast<uint32_t>(handlerPlacements.size()));
+        for (const auto& p : handlerPlacements) {
+            w.put(int32_t(p.landClass));
+            for (int i = 0; i < 3; ++i) w.put(p.position[i]);
+            for (int i = 0; i < 3; ++i) w.put(p.normal[i]);
+        }
+    }
+
+    return w.data;
+}
+
+bool VPBTileData::deserialize(const std::string& data)
+{
+    if ((data.size() < sizeof(Magic)) || (memcmp(data.data(), Magic, sizeof(Magic)) != 0)) {
+        return false;
+    }
+
+    Reader r(data);
+    r.get<uint32_t>(); // magic
+    if (r.get<uint32_t>() != FormatVersion) {
+        return false;
+    }
+
+    r.get(mesh);
+    width = r.get<float>();
+    height = r.get<float>();
+
+    // the counts are not trusted for allocations, in case of a corrupt file
+    const uint32_t numLineFeatures = r.get<uint32_t>();
+    for (uint32_t i = 0; (i < numLineFeatures) && r.ok(); ++i) {
+        Feature feature;
+        feature.material = r.getString();
+        r.get(feature.geometry);
+        feature.lights = r.getArray<osg::Vec3Array>();
+        lineFeatures.push_back(feature);
+    }
+
+    const uint32_t numAreaFeatures = r.get<uint32_t>();
+    for (uint32_t i = 0; (i < numAreaFeatures) && r.ok(); ++i) {
+        Feature feature;
+        feature.material = r.getString();
+        r.get(feature.geometry);
+        areaFeatures.push_back(feature);
+    }
+
+    const uint32_t numHandlers = r.get<uint32_t>();
+    for (uint32_t h = 0; (h < numHandlers) && r.ok(); ++h) {
+        placements.emplace_back();
+        const uint32_t count = r.get<uint32_t>();
+        for (uint32_t i = 0; (i < count) && r.ok(); ++i) {
+            Placement p;
+            p.landClass = r.get<int32_t>();
+            for (int j = 0; j < 3; ++j) p.position[j] = r.get<float>();
+            for (int j = 0; j < 3; ++j) p.normal[j] = r.get<float>();
+            placements.back().push_back(p);
+        }
+    }
+
+    return r.ok();
+}
+
+VPBTileKey::VPBTileKey()
+{
+    sha1_init(&_hash);
+    add(static_cast<int>(FormatVersion));
+}
+
+void VPBTileKey::add(const std::string& s)
+{
+    // include the length, so consecutive strings can't run together
+    add(static_cast<int>(s.size()));
+    sha1_write(&_hash, s.data(), s.size());
+}
+
+void VPBTileKey::add(int i)
+{
+    sha1_write(&_hash, reinterpret_cast<const char*>(&i), sizeof(i));
+}
+
+void VPBTileKey::add(double d)
+{
+    sha1_write(&_hash, reinterpret_cast<const char*>(&d), sizeof(d));
+}
+
+void VPBTileKey::add(const osg::Vec3d& v)
+{
+    sha1_write(&_hash, reinterpret_cast<const char*>(v.ptr()), 3 * sizeof(double));
+}
+
+void VPBTileKey::addFile(const std::string& fileName, const osgDB::Options* options)
+{
+    add(fileName);
+    const SGPath path = SGPath::fromUtf8(osgDB::findDataFile(fileName, options));
+    add(static_cast<double>(path.exists() ? path.sizeInBytes() : 0));
+    add(static_cast<double>(path.exists() ? path.modTime() : 0));
+}
+
+void VPBTileKey::addProperties(const SGPropertyNode* node)
+{
+    if (!node) {
+        add(std::string());
+        return;
+    }
+
+    add(node->getPath());
+    if (node->hasValue()) {
+        add(node->getStringValue());
+    }
+
+    add(node->nChildren());
+    for (int i = 0; i < node->nChildren(); ++i) {
+        addProperties(node->getChild(i));
+    }
+}
+
+std::string VPBTileKey::result()
+{
+    return strutils::encodeHex(sha1_result(&_hash), HASH_LENGTH);
+}
+
+std::shared_ptr<DiskCache> VPBTileCache::get(const SGPropertyNode* propertyNode)
+{
+    if (!propertyNode || !propertyNode->getBoolValue("/sim/rendering/vpb-cache/enabled", false)) {
+        return {};
+    }
+
+    const SGPath path = SGPath::fromUtf8(propertyNode->getStringValue("/sim/rendering/vpb-cache/path"));
+    const size_t maxSize = size_t(std::max(propertyNode->getIntValue("/sim/rendering/vpb-cache/max-size-mb", 1024), 0)) * 1024 * 1024;
+    if (path.isNull()) {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!sharedCache || (sharedCache->path() != path)) {
+        SG_LOG(SG_TERRAIN, SG_INFO, "VPB tile cache in " << path << ", " << (maxSize >> 20) << " MB");
+        sharedCache = std::make_shared<DiskCache>(path, maxSize);
+    } else if (sharedCache->maxSize() != maxSize) {
+        sharedCache->setMaxSize(maxSize);
+    }
+    return sharedCache;
+}
+
+DiskCache::Stats VPBTileCache::getStats()
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return sharedCache ? sharedCache->stats() : DiskCache::Stats();
+}
+
+} // namespace simgear
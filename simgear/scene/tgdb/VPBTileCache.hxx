@@ -0,0 +1,121 @@
+// VPBTileCache.hxx - on-disk cache of generated VPB tile data
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#ifndef VPBTILECACHE
+#define VPBTILECACHE 1
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <osg/Array>
+#include <osg/Geometry>
+#include <osg/Referenced>
+
+#include <simgear/misc/DiskCache.hxx>
+#include <simgear/misc/sg_hash.hxx>
+
+class SGPropertyNode;
+
+namespace osgDB {
+class Options;
+}
+
+namespace simgear {
+
+/**
+ * The parts of a generated VPB tile which are expensive to compute: the
+ * terrain mesh with its skirts, the line and area feature geometry, and
+ * the positions of random vegetation and lights. Effects, materials and
+ * state sets are not kept; they are set up again from the material names
+ * and landclasses, so the cached data stays valid when effects change.
+ */
+class VPBTileData : public osg::Referenced
+{
+public:
+    struct Geometry
+    {
+        osg::ref_ptr<osg::Vec3Array> vertices;
+        osg::ref_ptr<osg::Vec3Array> normals;
+        osg::ref_ptr<osg::Vec2Array> texcoords;
+        osg::Geometry::PrimitiveSetList primitives;
+
+        // Take the arrays and primitives of geometry. Returns false for
+        // array or primitive types which can't be stored.
+        bool capture(const osg::Geometry& geometry);
+    };
+
+    struct Feature
+    {
+        std::string material;
+        Geometry geometry;
+        osg::ref_ptr<osg::Vec3Array> lights; // line features only
+    };
+
+    // An object placed by a VPBMaterialHandler, and the landclass it was
+    // placed on
+    struct Placement
+    {
+        int landClass;
+        osg::Vec3f position;
+        osg::Vec3f normal;
+    };
+
+    Geometry mesh;
+    float width = 0.0f;
+    float height = 0.0f;
+    std::vector<Feature> lineFeatures;
+    std::vector<Feature> areaFeatures;
+    std::vector<std::vector<Placement>> placements; // per material handler
+
+    // Cleared if any of the data could not be captured
+    std::atomic<bool> complete{true};
+
+    std::string serialize() const;
+    bool deserialize(const std::string& data);
+};
+
+/**
+ * Builds the cache key of a tile from everything its data depends on.
+ */
+class VPBTileKey
+{
+public:
+    VPBTileKey();
+
+    void add(const std::string& s);
+    void add(int i);
+    void add(double d);
+    void add(const osg::Vec3d& v);
+
+    // the name, size and modification time of a data file
+    void addFile(const std::string& fileName, const osgDB::Options* options);
+
+    // the values of a property subtree
+    void addProperties(const SGPropertyNode* node);
+
+    std::string result();
+
+private:
+    sha1nfo _hash;
+};
+
+class VPBTileCache
+{
+public:
+    /**
+     * The tile cache as configured by /sim/rendering/vpb-cache: enabled,
+     * path and max-size-mb (default 1024). Returns nullptr if the cache is
+     * disabled or no path is set. The size limit can be changed at any
+     * time; the least recently used tiles are removed to meet it.
+     */
+    static std::shared_ptr<DiskCache> get(const SGPropertyNode* propertyNode);
+
+    /// statistics of the current cache directory
+    static DiskCache::Stats getStats();
+};
+
+} // namespace simgear
+
+#endif
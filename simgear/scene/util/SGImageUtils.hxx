@@ -347,6 +347,18 @@ namespace simgear
         */
         static osg::Image* readStream(std::istream& stream, const osgDB::Options* options);
 
+        /**
+        * Enables or disables the fast paths of resizeImage, bicubicUpsample,
+        * convert, featherAlphaRegions, convertToPremultipliedAlpha and
+        * createSharpenedImage (enabled by default). For 8 bit and float
+        * LUMINANCE, RGB and RGBA images these access pixels without going
+        * through the PixelReader/PixelWriter function pointers, and large
+        * images are split across the shared thread pool. The results are
+        * identical to the generic path, which is kept as the reference.
+        */
+        static void setFastPathsEnabled(bool enabled);
+        static bool getFastPathsEnabled();
+
         /**
         * Reads color data out of an image, regardles of its internal pixel format.
         */
@@ -0,0 +1,163 @@
+// image_utils_bench - compare generic and fast ImageUtils pixel paths
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+
+#include <osg/Image>
+#include <osg/ref_ptr>
+
+#include <simgear/scene/util/SGImageUtils.hxx>
+
+using namespace simgear;
+
+namespace {
+
+osg::Image* makeImage(int s, int t, GLenum pixelFormat, GLenum dataType)
+{
+    osg::Image* image = new osg::Image;
+    image->allocateImage(s, t, 1, pixelFormat, dataType);
+
+    std::mt19937 rng(s + pixelFormat + dataType);
+    const unsigned n = image->getTotalSizeInBytes();
+    unsigned char* data = image->data();
+    if (dataType == GL_FLOAT) {
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        float* f = reinterpret_cast<float*>(data);
+        // leave some texels transparent so featherAlphaRegions has work
+        for (unsigned i = 0; i < n / sizeof(float); ++i)
+            f[i] = (rng() % 4 == 0) ? 0.0f : dist(rng);
+    } else {
+        for (unsigned i = 0; i < n; ++i)
+            data[i] = ((i % 4 == 3) && (rng() % 3 == 0)) ? 0 : rng();
+    }
+    return image;
+}
+
+bool sameImage(const osg::Image* a, const osg::Image* b)
+{
+    return a && b &&
+           a->getTotalSizeInBytes() == b->getTotalSizeInBytes() &&
+           !memcmp(a->data(), b->data(), a->getTotalSizeInBytes());
+}
+
+template <class F>
+double timeIt(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char* formatName(GLenum pixelFormat, GLenum dataType)
+{
+    if (pixelFormat == GL_RGBA) return dataType == GL_FLOAT ? "RGBA/float" : "RGBA/ubyte";
+    if (pixelFormat == GL_RGB) return dataType == GL_FLOAT ? "RGB/float" : "RGB/ubyte";
+    return dataType == GL_FLOAT ? "L/float" : "L/ubyte";
+}
+
+enum Operation {
+    OpResize = 0,
+    OpConvert,
+    OpPremultiply,
+    OpFeather,
+    OpBicubic,
+    OpSharpen,
+    NumOperations
+};
+
+const char* operationNames[NumOperations] = {
+    "resize", "convert", "premultiply", "feather", "bicubic", "sharpen"};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    const int size = (argc > 1) ? atoi(argv[1]) : 4096;
+    const double megapixels = double(size) * size / 1e6;
+    int mismatches = 0;
+
+    std::cout << "ImageUtils benchmark on " << size << "x" << size << " images" << std::endl;
+
+    const GLenum pixelFormats[] = {GL_RGBA, GL_RGB, GL_LUMINANCE};
+    const GLenum dataTypes[] = {GL_UNSIGNED_BYTE, GL_FLOAT};
+
+    for (GLenum pixelFormat : pixelFormats) {
+        for (GLenum dataType : dataTypes) {
+            osg::ref_ptr<osg::Image> input = makeImage(size, size, pixelFormat, dataType);
+            osg::ref_ptr<osg::Image> bicubicSource = makeImage(size + 1, size + 1, pixelFormat, dataType);
+
+            osg::ref_ptr<osg::Image> results[2][NumOperations];
+            double seconds[2][NumOperations] = {};
+
+            for (int fast = 0; fast < 2; ++fast) {
+                ImageUtils::setFastPathsEnabled(fast != 0);
+                osg::ref_ptr<osg::Image>* out = results[fast];
+                double* t = seconds[fast];
+
+                t[OpResize] = timeIt([&] {
+                    ImageUtils::resizeImage(input, size / 2 + 3, size / 2 + 1, out[OpResize]);
+                });
+
+                const GLenum convertType = (dataType == GL_FLOAT) ? GL_UNSIGNED_BYTE : GL_FLOAT;
+                t[OpConvert] = timeIt([&] {
+                    out[OpConvert] = ImageUtils::convert(input, GL_RGBA, convertType);
+                });
+
+                out[OpPremultiply] = new osg::Image(*input, osg::CopyOp::DEEP_COPY_ALL);
+                t[OpPremultiply] = timeIt([&] {
+                    ImageUtils::convertToPremultipliedAlpha(out[OpPremultiply]);
+                });
+
+                out[OpFeather] = new osg::Image(*input, osg::CopyOp::DEEP_COPY_ALL);
+                t[OpFeather] = timeIt([&] {
+                    ImageUtils::featherAlphaRegions(out[OpFeather]);
+                });
+
+                out[OpBicubic] = new osg::Image;
+                out[OpBicubic]->allocateImage(size + 1, size + 1, 1, pixelFormat, dataType);
+                t[OpBicubic] = timeIt([&] {
+                    ImageUtils::bicubicUpsample(bicubicSource, out[OpBicubic], 1, 2);
+                });
+
+                // createSharpenedImage only handles 4-channel images
+                if (pixelFormat == GL_RGBA && dataType == GL_UNSIGNED_BYTE) {
+                    t[OpSharpen] = timeIt([&] {
+                        out[OpSharpen] = ImageUtils::createSharpenedImage(input);
+                    });
+                }
+            }
+
+            for (int op = 0; op < NumOperations; ++op) {
+                if (!results[0][op].valid())
+                    continue;
+
+                const bool same = sameImage(results[0][op], results[1][op]);
+                if (!same)
+                    ++mismatches;
+
+                std::cout << std::left << std::setw(12) << formatName(pixelFormat, dataType)
+                          << std::setw(13) << operationNames[op] << std::right << std::fixed
+                          << std::setprecision(1)
+                          << " generic " << std::setw(8) << megapixels / seconds[0][op] << " MP/s"
+                          << "  fast " << std::setw(8) << megapixels / seconds[1][op] << " MP/s"
+                          << (same ? "" : "  MISMATCH") << std::endl;
+            }
+        }
+    }
+
+    ImageUtils::setFastPathsEnabled(true);
+
+    if (mismatches) {
+        std::cerr << mismatches << " operations produced different results" << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -14,9 +14,18 @@
 #include <simgear/compiler.h>
 #include "SGBinding.hxx"
 
+#include <atomic>
+
 #include <simgear/props/props_io.hxx>
 #include <simgear/structure/exception.hxx>
 
+namespace {
+
+std::atomic<uint64_t> statFired{0};
+std::atomic<uint64_t> statCommandLookups{0};
+
+} // anonymous namespace
+
 SGBinding::SGBinding()
     : _arg(new SGPropertyNode)
 {
@@ -38,6 +47,9 @@ SGBinding::clear()
     _arg.clear();
     _root.clear();
     _setting.clear();
+    _offset.clear();
+    _command = nullptr;
+    _commandGeneration = 0;
 }
 
 void SGBinding::read(const SGPropertyNode* node, SGPropertyNode* root)
@@ -54,6 +66,9 @@ void SGBinding::read(const SGPropertyNode* node, SGPropertyNode* root)
     _arg = const_cast<SGPropertyNode*>(node);
     _root = const_cast<SGPropertyNode*>(root);
     _setting.clear();
+    _offset.clear();
+    _command = nullptr;
+    _commandGeneration = 0;
 }
 
 void
@@ -64,10 +79,26 @@ SGBinding::fire() const
   }
 }
 
+SGCommandMgr::Command*
+SGBinding::command() const
+{
+    // Axis bindings fire at the input polling rate: avoid looking up the
+    // command by name every time.
+    const unsigned generation = SGCommandMgr::getGeneration();
+    if (generation != _commandGeneration) {
+        _command = SGCommandMgr::instance()->getCommand(_command_name);
+        _commandGeneration = generation;
+        statCommandLookups.fetch_add(1, std::memory_order_relaxed);
+    }
+    return _command;
+}
+
 void
 SGBinding::innerFire () const
 {
-    auto cmd = SGCommandMgr::instance()->getCommand(_command_name);
+    statFired.fetch_add(1, std::memory_order_relaxed);
+
+    auto cmd = command();
     if (!cmd) {
         SG_LOG(SG_INPUT, SG_WARN, "No command found for binding:" << _command_name);
         return;
@@ -99,7 +130,10 @@ void
 SGBinding::fire (double offset, double max) const
 {
   if (test()) {
-    _arg->setDoubleValue("offset", offset/max);
+    if (!_offset) { // save the offset node for efficiency
+        _offset = _arg->getChild("offset", 0, true);
+    }
+    _offset->setDoubleValue(offset/max);
     innerFire();
   }
 }
@@ -118,6 +152,14 @@ SGBinding::fire (double setting) const
   }
 }
 
+SGBinding::Stats SGBinding::getStats()
+{
+    Stats stats;
+    stats.fired = statFired.load(std::memory_order_relaxed);
+    stats.commandLookups = statCommandLookups.load(std::memory_order_relaxed);
+    return stats;
+}
+
 void fireBindingList(const SGBindingList& aBindings, SGPropertyNode* params)
 {
     for (auto b : aBindings) {
@@ -13,6 +13,7 @@
 
 #include <simgear/compiler.h>
 
+#include <cstdint>
 #include <string>
 #include <map>
 #include <vector>
@@ -123,16 +124,34 @@ public:
    * The children of params will be merged with the fixed arguments.
    */
   void fire (SGPropertyNode* params) const;
+
+  /**
+   * Counters over all bindings, for profiling input handling.
+   */
+  struct Stats
+  {
+    uint64_t fired = 0;          ///< bindings fired (passing their condition)
+    uint64_t commandLookups = 0; ///< lookups of the command by name
+  };
+
+  static Stats getStats();
   
 private:
   void innerFire() const;
+  SGCommandMgr::Command* command() const;
                                 // just to be safe.
   SGBinding (const SGBinding &binding);
 
   std::string _command_name;
   mutable SGPropertyNode_ptr _arg;
   mutable SGPropertyNode_ptr _setting;
+  mutable SGPropertyNode_ptr _offset;
   mutable SGPropertyNode_ptr _root;
+
+  // The command is looked up again when commands were added or removed
+  // since, see SGCommandMgr::getGeneration().
+  mutable SGCommandMgr::Command* _command = nullptr;
+  mutable unsigned _commandGeneration = 0;
 };
 
 typedef SGSharedPtr<SGBinding> SGBinding_ptr;
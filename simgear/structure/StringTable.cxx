@@ -1,14 +1,65 @@
+#include <simgear_config.h>
+
 #include "StringTable.hxx"
 
+#include <mutex>
 
 namespace simgear
 {
-using namespace std;
 
-const string* StringTable::insert(const string& str)
+StringTable::Shard& StringTable::shard(std::string_view str) const
+{
+    // the low bits pick the bucket within the shard's map
+    const size_t hash = std::hash<std::string_view>()(str);
+    return _shards[(hash >> 24) % ShardCount];
+}
+
+const std::string* StringTable::insert(std::string_view str)
+{
+    Shard& s = shard(str);
+    {
+        std::shared_lock<std::shared_mutex> lock(s.mutex);
+        auto it = s.strings.find(str);
+        if (it != s.strings.end()) {
+            return it->second.get();
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.strings.find(str);
+    if (it == s.strings.end()) {
+        auto copy = std::make_unique<std::string>(str);
+        const std::string_view key(*copy);
+        it = s.strings.emplace(key, std::move(copy)).first;
+    }
+    return it->second.get();
+}
+
+const std::string* StringTable::find(std::string_view str) const
+{
+    const Shard& s = shard(str);
+    std::shared_lock<std::shared_mutex> lock(s.mutex);
+    auto it = s.strings.find(str);
+    return (it == s.strings.end()) ? nullptr : it->second.get();
+}
+
+StringTable::Stats StringTable::getStats() const
 {
-    std::lock_guard<std::mutex> lock(_mutex);
-    StringContainer::iterator it = _strings.insert(str).first;
-    return &*it;
+    const size_t localCapacity = std::string().capacity();
+    Stats stats;
+    for (const Shard& s : _shards) {
+        std::shared_lock<std::shared_mutex> lock(s.mutex);
+        stats.strings += s.strings.size();
+        stats.bytes += s.strings.bucket_count() * sizeof(void*);
+        for (const auto& entry : s.strings) {
+            // map node, string object and any heap buffer
+            stats.bytes += sizeof(StringMap::value_type) + sizeof(void*) + sizeof(std::string);
+            if (entry.second->capacity() > localCapacity) {
+                stats.bytes += entry.second->capacity() + 1;
+            }
+        }
+    }
+    return stats;
 }
+
 }
@@ -1,28 +1,57 @@
 #ifndef SIMGEAR_STRINGTABLE_HXX
 #define SIMGEAR_STRINGTABLE_HXX 1
 
+#include <memory>
+#include <shared_mutex>
 #include <string>
-#include <mutex>
-
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/identity.hpp>
+#include <string_view>
+#include <unordered_map>
 
 namespace simgear
 {
-typedef boost::multi_index_container<
-    std::string,
-    boost::multi_index::indexed_by<
-        boost::multi_index::hashed_unique<
-            boost::multi_index::identity<std::string> > > >
-StringContainer;
 
+/**
+ * A set of strings, each stored once, so that equal strings inserted into
+ * the same table share one address and can be compared by pointer. The
+ * strings stay valid for the lifetime of the table.
+ *
+ * The table is split into shards by hash, each with its own lock, so that
+ * threads looking up strings (the common case, once a string is known) only
+ * take a shared lock and rarely contend with threads inserting new ones.
+ */
 class StringTable
 {
-    const std::string* insert(const std::string& str);
+public:
+    const std::string* insert(std::string_view str);
+
+    /**
+     * Return the stored copy of str, or nullptr if it was never inserted.
+     */
+    const std::string* find(std::string_view str) const;
+
+    struct Stats
+    {
+        size_t strings = 0;
+        size_t bytes = 0; ///< approximate memory held by the strings
+    };
+
+    Stats getStats() const;
+
 private:
-    std::mutex _mutex;
-    StringContainer _strings;
+    typedef std::unordered_map<std::string_view, std::unique_ptr<std::string>> StringMap;
+
+    struct Shard
+    {
+        mutable std::shared_mutex mutex;
+        StringMap strings; ///< keys point into the values
+    };
+
+    static const unsigned ShardCount = 32;
+
+    Shard& shard(std::string_view str) const;
+
+    mutable Shard _shards[ShardCount];
 };
+
 }
 #endif
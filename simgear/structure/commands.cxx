@@ -6,6 +6,7 @@
 
 #include <simgear_config.h>
 
+#include <atomic>
 #include <memory>
 #include <cassert>
 #include <mutex>
@@ -45,6 +46,7 @@ public:
 ////////////////////////////////////////////////////////////////////////
 
 static SGCommandMgr* static_instance = nullptr;
+static std::atomic<unsigned> static_generation{1};
 
 SGCommandMgr::SGCommandMgr () :
   d(new Private)
@@ -52,12 +54,14 @@ SGCommandMgr::SGCommandMgr () :
     d->_mainThreadId = SGThread::current();
     assert(static_instance == nullptr);
     static_instance = this;
+    ++static_generation;
 }
 
 SGCommandMgr::~SGCommandMgr ()
 {
     assert(static_instance == this);
     static_instance = nullptr;
+    ++static_generation;
 }
 
 SGCommandMgr*
@@ -79,6 +83,7 @@ SGCommandMgr::addCommandObject (const std::string &name, Command* command)
     throw sg_exception("duplicate command name:" + name);
 
   d->_commands[name] = command;
+  ++static_generation;
 }
 
 SGCommandMgr::Command*
@@ -169,9 +174,15 @@ bool SGCommandMgr::removeCommand(const std::string& name)
 
     delete it->second;
     d->_commands.erase(it);
+    ++static_generation;
     return true;
 }
 
+unsigned SGCommandMgr::getGeneration()
+{
+    return static_generation.load(std::memory_order_relaxed);
+}
+
 void SGCommandMgr::queuedExecute(const std::string &name, const SGPropertyNode* arg)
 {
   Invocation invoke = {name, new SGPropertyNode};
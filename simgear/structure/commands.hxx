@@ -182,6 +182,13 @@ public:
    */
   bool removeCommand(const std::string& name);
 
+  /**
+   * Get a counter which changes whenever a command is added or removed, or
+   * the manager itself is replaced. Callers which keep the result of
+   * getCommand() compare it to tell when the pointer may be stale.
+   */
+  static unsigned getGeneration();
+
 private:
     class Private;
     std::unique_ptr<Private> d;
@@ -1,20 +1,33 @@
+#include <simgear_config.h>
+
 #include <simgear/structure/intern.hxx>
 
-#include <simgear/structure/StringTable.hxx>
-#include <simgear/structure/Singleton.hxx>
+namespace simgear
+{
 
 namespace
 {
-class GlobalStringTable : public StringTable,
-                          public Singleton<GlobalStringTable>
+StringTable& globalStringTable()
 {
-};
+    // never destroyed: interned strings may be referenced by static objects
+    static StringTable* table = new StringTable;
+    return *table;
+}
 }
 
-namespace simgear
+const std::string* intern(std::string_view str)
 {
-const std::string* intern(const std::string& str)
+    return globalStringTable().insert(str);
+}
+
+const std::string* findInterned(std::string_view str)
 {
-    return GlobalStringTable::instance()->insert(str);
+    return globalStringTable().find(str);
 }
+
+StringTable::Stats getInternStats()
+{
+    return globalStringTable().getStats();
+}
+
 }
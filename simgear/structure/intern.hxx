@@ -2,6 +2,9 @@
 #define SIMGEAR_INTERN_HXX 1
 
 #include <string>
+#include <string_view>
+
+#include <simgear/structure/StringTable.hxx>
 
 #include <typeinfo>
 #ifndef _MSC_VER
@@ -30,8 +33,20 @@ std::string getTypeName(void)
 }
 
 /**
- * Return a pointer to a single string object for a given string.
+ * Return a pointer to a single string object for a given string. Equal
+ * strings give the same pointer, which stays valid until exit.
+ */
+const std::string* intern(std::string_view str);
+
+/**
+ * Return the interned string equal to str, or nullptr if str was never
+ * interned. Unlike intern(), this never adds to the table.
+ */
+const std::string* findInterned(std::string_view str);
+
+/**
+ * Number of interned strings, and the memory they take.
  */
-const std::string* intern(const std::string& str);
+StringTable::Stats getInternStats();
 }
 #endif
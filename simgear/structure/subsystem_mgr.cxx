@@ -22,6 +22,11 @@
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <unordered_map>
 
 #include <simgear/debug/logstream.hxx>
 #include <simgear/timing/timestamp.hxx>
@@ -35,6 +40,7 @@
 #include <simgear/debug/Reporting.hxx>
 #include <simgear/math/SGMath.hxx>
 #include <simgear/props/props.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
 
 const int SG_MAX_SUBSYSTEM_EXCEPTIONS = 4;
 const char SUBSYSTEM_NAME_SEPARATOR = '.';
@@ -174,6 +180,19 @@ SGSubsystemGroup* SGSubsystem::get_group() const
     return _group;
 }
 
+void SGSubsystem::setUpdateDependencies(const UpdateDependencies& dependencies)
+{
+    _updateDependencies.reset(new UpdateDependencies(dependencies));
+    if (_group) {
+        _group->invalidateSchedule();
+    }
+}
+
+auto SGSubsystem::getUpdateDependencies() const -> const UpdateDependencies*
+{
+    return _updateDependencies.get();
+}
+
 SGSubsystemMgr* SGSubsystem::get_manager() const
 {
     if (auto group = get_group(); group)
@@ -244,6 +263,80 @@ public:
     void mergeTimerStats(SGSubsystem::TimerStats &stats);
 };
 
+// whether path is tree or below it
+static bool propertySubtreeContains(const std::string& tree, const std::string& path)
+{
+    std::string prefix = tree;
+    if (!prefix.empty() && (prefix.back() == '/')) {
+        prefix.pop_back();
+    }
+    return simgear::strutils::starts_with(path, prefix) &&
+        ((path.size() == prefix.size()) || (path[prefix.size()] == '/'));
+}
+
+/**
+ * Which members have to be updated before which, for concurrent updates.
+ */
+class SGSubsystemGroup::Schedule
+{
+public:
+    explicit Schedule(const MemberVec& members);
+
+    std::vector<std::vector<int>> successors;
+    std::vector<int> numPredecessors;
+
+private:
+    static bool independent(const Member& a, const Member& b);
+    static bool overlap(const string_list& a, const string_list& b);
+};
+
+SGSubsystemGroup::Schedule::Schedule(const MemberVec& members) :
+    successors(members.size()),
+    numPredecessors(members.size(), 0)
+{
+    // Members which may not run concurrently keep their order.
+    for (auto j = 0u; j < members.size(); ++j) {
+        for (auto i = 0u; i < j; ++i) {
+            if (!independent(*members[i], *members[j])) {
+                successors[i].push_back(j);
+                ++numPredecessors[j];
+            }
+        }
+    }
+}
+
+bool SGSubsystemGroup::Schedule::independent(const Member& a, const Member& b)
+{
+    auto da = a.subsystem->getUpdateDependencies();
+    auto db = b.subsystem->getUpdateDependencies();
+    if (!da || !db) {
+        return false;
+    }
+
+    const auto dependsOn = [](const SGSubsystem::UpdateDependencies* d, const std::string& name) {
+        return std::find(d->dependsOn.begin(), d->dependsOn.end(), name) != d->dependsOn.end();
+    };
+    if (dependsOn(da, b.name) || dependsOn(db, a.name)) {
+        return false;
+    }
+
+    return !overlap(da->writes, db->writes) && !overlap(da->writes, db->reads) &&
+        !overlap(db->writes, da->reads);
+}
+
+// whether any of the subtrees in a contains or is contained in one in b
+bool SGSubsystemGroup::Schedule::overlap(const string_list& a, const string_list& b)
+{
+    for (const auto& pa : a) {
+        for (const auto& pb : b) {
+            if (propertySubtreeContains(pa, pb) || propertySubtreeContains(pb, pa)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 
 
 SGSubsystemGroup::SGSubsystemGroup() :
@@ -258,6 +351,25 @@ SGSubsystemGroup::~SGSubsystemGroup ()
     clearSubsystems();
 }
 
+void
+SGSubsystemGroup::set_concurrent_update(bool concurrent)
+{
+    _concurrentUpdate = concurrent;
+}
+
+void
+SGSubsystemGroup::set_update_validation(SGPropertyNode* root)
+{
+    _validationRoot = root;
+    _validationErrors = 0;
+}
+
+void
+SGSubsystemGroup::invalidateSchedule()
+{
+    _schedule.reset();
+}
+
 void
 SGSubsystemGroup::init ()
 {
@@ -426,7 +538,11 @@ SGSubsystemGroup::update (double delta_time_sec)
     }
 
     const bool recordTime = (reportTimingCb != nullptr);
-    if (recordTime) {
+    if (_validationRoot && !recordTime) {
+        updateMembersValidating(loopCount, delta_time_sec);
+    } else if (_concurrentUpdate && (_members.size() > 1) && !recordTime) {
+        updateMembersConcurrently(loopCount, delta_time_sec);
+    } else if (recordTime) {
         // recording timing adds some overhead at present, this is
         // an easy way to ensure in the case where recording is not actually
         // enabled, we don't pay that cost.
@@ -448,6 +564,129 @@ void SGSubsystemGroup::updateMembers(int loopCount, double delta_time_sec)
     } // of multiple update loop
 }
 
+void SGSubsystemGroup::updateMembersConcurrently(int loopCount, double delta_time_sec)
+{
+    if (!_schedule) {
+        _schedule.reset(new Schedule(_members));
+    }
+
+    // Each lane takes the next member whose predecessors are done, until
+    // all members are.
+    auto& pool = simgear::SGThreadPool::shared();
+    const int numMembers = static_cast<int>(_members.size());
+    const int numLanes = std::min(numMembers, static_cast<int>(pool.size()) + 1);
+
+    while (loopCount-- > 0) {
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::vector<int> waitingFor = _schedule->numPredecessors;
+        std::deque<int> ready;
+        int remaining = numMembers;
+        std::exception_ptr error;
+
+        for (int i = 0; i < numMembers; ++i) {
+            if (waitingFor[i] == 0) {
+                ready.push_back(i);
+            }
+        }
+
+        pool.parallelFor(0, numLanes, 1, [&](int, int) {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;) {
+                condition.wait(lock, [&] { return !ready.empty() || (remaining == 0); });
+                if (remaining == 0) {
+                    return;
+                }
+
+                const int i = ready.front();
+                ready.pop_front();
+                lock.unlock();
+                try {
+                    _members[i]->update(delta_time_sec); // indirect call
+                } catch (...) {
+                    // let the other members finish before re-throwing
+                    lock.lock();
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    lock.unlock();
+                }
+                lock.lock();
+
+                --remaining;
+                for (int s : _schedule->successors[i]) {
+                    if (--waitingFor[s] == 0) {
+                        ready.push_back(s);
+                    }
+                }
+                condition.notify_all();
+            }
+        });
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    } // of multiple update loop
+}
+
+namespace {
+
+using PropertyValues = std::unordered_map<std::string, std::string>;
+
+// The values below node, by path. Tied values are left out, since they
+// change without being written through the tree.
+void collectPropertyValues(const SGPropertyNode* node, const std::string& path, PropertyValues& values)
+{
+    for (int i = 0; i < node->nChildren(); ++i) {
+        const SGPropertyNode* child = node->getChild(i);
+        const std::string childPath = path + "/" + child->getDisplayName(true);
+        if (child->hasValue() && !child->isTied() && (child->getType() != simgear::props::ALIAS)) {
+            values[childPath] = child->getStringValue();
+        }
+        collectPropertyValues(child, childPath, values);
+    }
+}
+
+} // of anonymous namespace
+
+void SGSubsystemGroup::updateMembersValidating(int loopCount, double delta_time_sec)
+{
+    const std::string rootPath = _validationRoot->getPath();
+    PropertyValues before;
+    collectPropertyValues(_validationRoot, rootPath, before);
+
+    while (loopCount-- > 0) {
+        for (auto member : _members) {
+            member->update(delta_time_sec); // indirect call
+
+            PropertyValues after;
+            collectPropertyValues(_validationRoot, rootPath, after);
+
+            auto dependencies = member->subsystem->getUpdateDependencies();
+            if (dependencies) {
+                for (const auto& value : after) {
+                    auto it = before.find(value.first);
+                    if ((it != before.end()) && (it->second == value.second)) {
+                        continue;
+                    }
+
+                    const bool declared = std::any_of(dependencies->writes.begin(), dependencies->writes.end(),
+                        [&value](const std::string& tree) {
+                            return propertySubtreeContains(tree, value.first);
+                        });
+                    if (!declared) {
+                        ++_validationErrors;
+                        SG_LOG(SG_GENERAL, SG_ALERT, "Subsystem " << member->name << " wrote "
+                               << value.first << " without declaring it");
+                    }
+                }
+            }
+
+            before.swap(after);
+        }
+    } // of multiple update loop
+}
+
 void SGSubsystemGroup::updateMembersWithTiming(int loopCount, double delta_time_sec)
 {
     SGTimeStamp timeStamp;
@@ -653,6 +892,7 @@ SGSubsystemGroup::set_subsystem (const string &name, SGSubsystem * subsystem,
     member->subsystem = subsystem;
     member->min_step_sec = min_step_sec;
     subsystem->set_group(this);
+    invalidateSchedule();
     notifyDidChange(subsystem, State::ADD);
 
     if (_state != State::INVALID && (_state <= State::POSTINIT)) {
@@ -739,6 +979,7 @@ SGSubsystemGroup::remove_subsystem(const string &name)
         notifyWillChange(sub, State::REMOVE);
         delete *it;
         _members.erase(it);
+        invalidateSchedule();
         notifyDidChange(sub, State::REMOVE);
         return true;
     }
@@ -788,6 +1029,7 @@ void SGSubsystemGroup::clearSubsystems()
     }
 
     _members.clear();
+    invalidateSchedule();
 }
 
 void
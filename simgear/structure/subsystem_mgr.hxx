@@ -27,6 +27,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <vector>
 #include <functional>
 
@@ -350,6 +351,30 @@ public:
      */
     SGPropertyNode_ptr getConfigNode() const;
 
+    /**
+     * What update() of this subsystem touches, so that a group with
+     * concurrent updates enabled can update it at the same time as other
+     * members. Property paths are absolute and include the subtree below
+     * them. State shared other than through the properties listed must be
+     * declared with dependsOn.
+     */
+    struct UpdateDependencies
+    {
+        string_list reads;      ///< property subtrees read by update()
+        string_list writes;     ///< property subtrees written by update()
+        string_list dependsOn;  ///< names of members of the same group which
+                                ///< must not be updated at the same time
+    };
+
+    /**
+     * Declare the dependencies of update(). Subsystems which don't declare
+     * them are never updated concurrently with other members of their group.
+     */
+    void setUpdateDependencies(const UpdateDependencies& dependencies);
+
+    /// the declared dependencies, or nullptr if there are none
+    const UpdateDependencies* getUpdateDependencies() const;
+
 protected:
     friend class SGSubsystemMgr;
     friend class SGSubsystemGroup;
@@ -381,6 +406,7 @@ private:
     std::string _subsystemId;
 
     SGSubsystemGroup* _group = nullptr;
+    std::unique_ptr<UpdateDependencies> _updateDependencies;
 protected:
     TimerStats _timerStats, _lastTimerStats;
     double _executionTime;
@@ -435,6 +461,30 @@ public:
      */
     void set_fixed_update_time(double fixed_dt);
 
+    /**
+     * Update members which declared independent UpdateDependencies at the
+     * same time, on the shared thread pool. Members which depend on each
+     * other are still updated in the order they were added, and members
+     * without declared dependencies on their own. Off by default.
+     *
+     * While timing is being reported, or validation is enabled, members
+     * are always updated one at a time.
+     */
+    void set_concurrent_update(bool concurrent);
+    bool get_concurrent_update() const { return _concurrentUpdate; }
+
+    /**
+     * Check the declared dependencies of the members: compare the property
+     * tree below root before and after each member with declared
+     * dependencies is updated, and report values which changed outside its
+     * declared writes. This walks the whole tree for every member, so is
+     * only meant for testing. Pass nullptr to disable.
+     */
+    void set_update_validation(SGPropertyNode* root);
+
+    /// number of undeclared writes found by validation
+    unsigned get_update_validation_errors() const { return _validationErrors; }
+
     /**
      * retrive list of member subsystem names
      */
@@ -460,6 +510,11 @@ private:
 
     void updateMembers(int loopCount, double dt);
     void updateMembersWithTiming(int loopCount, double dt);
+    void updateMembersConcurrently(int loopCount, double dt);
+    void updateMembersValidating(int loopCount, double dt);
+
+    friend class SGSubsystem;
+    void invalidateSchedule();
 
     friend class SGSubsystemMgr;
 
@@ -483,6 +538,13 @@ private:
     /// back-pointer to the manager, for the root groups. (sub-groups
     /// will have this as null, and chain via their parent)
     SGSubsystemMgr* _manager = nullptr;
+
+    bool _concurrentUpdate = false;
+    class Schedule;
+    std::unique_ptr<Schedule> _schedule; ///< built on demand from the members
+
+    SGPropertyNode_ptr _validationRoot;
+    unsigned _validationErrors = 0;
 };
 
 typedef SGSharedPtr<SGSubsystemGroup> SGSubsystemGroupRef;
@@ -2,6 +2,9 @@
 
 #include <cstdio>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #include <simgear/compiler.h>
 #include <simgear/constants.h>
@@ -536,6 +539,128 @@ void testAddRemoveAfterInit()
 
 ///////////////////////////////////////////////////////////////////////////////
 
+// increments a property, and records when it was updated
+class CounterSub : public SGSubsystem
+{
+public:
+    CounterSub(SGPropertyNode* node, std::atomic<int>& sequence) :
+        _node(node),
+        _sequence(sequence)
+    {
+    }
+
+    void update(double dt) override
+    {
+        if (meetWith) {
+            // wait a while for the other subsystem to be updated at the same time
+            ++(*meetWith);
+            for (int i = 0; (i < 1000) && (*meetWith < 2); ++i) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            met = (*meetWith >= 2);
+        }
+
+        _node->setIntValue(_node->getIntValue() + 1);
+        if (extraNode) {
+            extraNode->setIntValue(extraNode->getIntValue() + 1);
+        }
+        updatedAt = _sequence++;
+    }
+
+    int updatedAt = -1;
+    std::atomic<int>* meetWith = nullptr;
+    bool met = false;
+    SGPropertyNode_ptr extraNode;
+
+private:
+    SGPropertyNode_ptr _node;
+    std::atomic<int>& _sequence;
+};
+
+void testConcurrentUpdate()
+{
+    SGPropertyNode_ptr props(new SGPropertyNode);
+    std::atomic<int> sequence{0};
+    std::atomic<int> meeting{0};
+    SGSharedPtr<SGSubsystemGroup> group = new SGSubsystemGroup;
+
+    auto a = new CounterSub(props->getNode("a/value", true), sequence);
+    a->setUpdateDependencies({{}, {"/a"}, {}});
+    a->meetWith = &meeting;
+    auto b = new CounterSub(props->getNode("b/value", true), sequence);
+    b->setUpdateDependencies({{}, {"/b/"}, {}});
+    b->meetWith = &meeting;
+    auto c = new CounterSub(props->getNode("c", true), sequence);
+    c->setUpdateDependencies({{"/a/value"}, {"/c"}, {}});
+    auto d = new CounterSub(props->getNode("d", true), sequence);
+    d->setUpdateDependencies({{}, {"/d"}, {"b"}});
+    auto e = new CounterSub(props->getNode("e", true), sequence);
+
+    group->set_subsystem("a", a);
+    group->set_subsystem("b", b);
+    group->set_subsystem("c", c);
+    group->set_subsystem("d", d);
+    group->set_subsystem("e", e);
+    group->set_concurrent_update(true);
+
+    group->update(0.1);
+
+    for (auto name : {"a/value", "b/value", "c", "d", "e"}) {
+        SG_CHECK_EQUAL(props->getIntValue(name), 1);
+    }
+
+    // the independent a and b were updated at the same time
+    SG_VERIFY(a->met);
+    SG_VERIFY(b->met);
+
+    // c reads what a writes, d depends on b, and e declares nothing
+    SG_VERIFY(c->updatedAt > a->updatedAt);
+    SG_VERIFY(d->updatedAt > b->updatedAt);
+    SG_CHECK_EQUAL(e->updatedAt, 4);
+
+    // and serially again
+    a->meetWith = b->meetWith = nullptr;
+    group->set_concurrent_update(false);
+    sequence = 0;
+    group->update(0.1);
+    SG_CHECK_EQUAL(props->getIntValue("e"), 2);
+    SG_CHECK_EQUAL(a->updatedAt, 0);
+    SG_CHECK_EQUAL(e->updatedAt, 4);
+}
+
+void testUpdateValidation()
+{
+    SGPropertyNode_ptr props(new SGPropertyNode);
+    std::atomic<int> sequence{0};
+    SGSharedPtr<SGSubsystemGroup> group = new SGSubsystemGroup;
+
+    auto a = new CounterSub(props->getNode("a/value", true), sequence);
+    a->setUpdateDependencies({{}, {"/a"}, {}});
+    auto b = new CounterSub(props->getNode("b", true), sequence);
+    b->setUpdateDependencies({{}, {"/b"}, {}});
+    b->extraNode = props->getNode("a/other", true);
+    auto c = new CounterSub(props->getNode("c", true), sequence);
+    c->extraNode = props->getNode("a/value", true);
+
+    group->set_subsystem("a", a);
+    group->set_subsystem("b", b);
+    group->set_subsystem("c", c);
+    group->set_concurrent_update(true);
+    group->set_update_validation(props);
+
+    group->update(0.1);
+    group->update(0.1);
+
+    // b writes below /a; c declares nothing, so isn't checked
+    SG_CHECK_EQUAL(group->get_update_validation_errors(), 2);
+    SG_CHECK_EQUAL(props->getIntValue("a/value"), 4);
+
+    group->set_update_validation(nullptr);
+    SG_CHECK_EQUAL(group->get_update_validation_errors(), 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 
 int main(int argc, char* argv[])
 {
@@ -547,6 +672,8 @@ int main(int argc, char* argv[])
     testPropertyRoot();
     testAddRemoveAfterInit();
     testEmptyGroup();
+    testConcurrentUpdate();
+    testUpdateValidation();
     
     cout << __FILE__ << ": All tests passed" << endl;
     return EXIT_SUCCESS;
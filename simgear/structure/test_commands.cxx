@@ -6,6 +6,7 @@
 #include <simgear/compiler.h>
 #include <simgear/constants.h>
 #include <simgear/structure/commands.hxx>
+#include <simgear/structure/SGBinding.hxx>
 #include <simgear/misc/test_macros.hxx>
 #include <simgear/props/props.hxx>
 
@@ -117,11 +118,73 @@ void testQueuedExec()
 
 ///////////////////////////////////////////////////////////////////////////////
 
+bool commandSettingFunc(const SGPropertyNode* args, SGPropertyNode* root)
+{
+    root->setDoubleValue("setting", args->getDoubleValue("setting"));
+    root->setDoubleValue("offset", args->getDoubleValue("offset"));
+    return true;
+}
+
+bool commandCountFunc(const SGPropertyNode* args, SGPropertyNode* root)
+{
+    root->setIntValue("count", root->getIntValue("count") + 1);
+    return true;
+}
+
+void testBindingCommandCache()
+{
+    delete SGCommandMgr::instance();
+
+    test_rootNode.reset(new SGPropertyNode);
+    SGCommandMgr::instance()->setImplicitRoot(test_rootNode.get());
+    SGCommandMgr::instance()->addCommand("cmd-setting", commandSettingFunc);
+
+    SGPropertyNode_ptr config(new SGPropertyNode);
+    config->setStringValue("command", "cmd-setting");
+    SGBinding_ptr binding(new SGBinding(config, test_rootNode));
+
+    const auto before = SGBinding::getStats();
+    binding->fire(0.25);
+    binding->fire(0.5);
+    binding->fire(2.0, 4.0);
+    SG_CHECK_EQUAL(test_rootNode->getDoubleValue("setting"), 0.5);
+    SG_CHECK_EQUAL(test_rootNode->getDoubleValue("offset"), 0.5);
+    SG_CHECK_EQUAL(config->getDoubleValue("setting"), 0.5);
+
+    // the command is looked up once, not on every fire
+    auto stats = SGBinding::getStats();
+    SG_CHECK_EQUAL(stats.fired - before.fired, 3);
+    SG_CHECK_EQUAL(stats.commandLookups - before.commandLookups, 1);
+
+    // replacing the command invalidates the cached one
+    SGCommandMgr::instance()->removeCommand("cmd-setting");
+    binding->fire();
+    SG_CHECK_EQUAL(test_rootNode->getIntValue("count"), 0);
+
+    SGCommandMgr::instance()->addCommand("cmd-setting", commandCountFunc);
+    binding->fire();
+    binding->fire();
+    SG_CHECK_EQUAL(test_rootNode->getIntValue("count"), 2);
+
+    stats = SGBinding::getStats();
+    SG_CHECK_EQUAL(stats.fired - before.fired, 6);
+    SG_CHECK_EQUAL(stats.commandLookups - before.commandLookups, 3);
+
+    // as does replacing the command manager
+    delete SGCommandMgr::instance();
+    SGCommandMgr::instance()->setImplicitRoot(test_rootNode.get());
+    binding->fire();
+    SG_CHECK_EQUAL(test_rootNode->getIntValue("count"), 2);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 
 int main(int argc, char* argv[])
 {
     testBasicCommands();
     testQueuedExec();
+    testBindingCommandCache();
     
     cout << __FILE__ << ": All tests passed" << endl;
     return EXIT_SUCCESS;
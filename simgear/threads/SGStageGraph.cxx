@@ -0,0 +1,93 @@
+// SGStageGraph.cxx - dependency graph of tasks run on a thread pool
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include "SGStageGraph.hxx"
+
+#include <chrono>
+
+#include "SGThreadPool.hxx"
+
+namespace simgear {
+
+int SGStageGraph::add(std::function<void()> fn, std::initializer_list<int> deps)
+{
+    const int id = static_cast<int>(_stages.size());
+    _stages.emplace_back();
+    _stages.back().fn = std::move(fn);
+    for (int dep : deps) {
+        _stages[dep].dependents.push_back(id);
+        ++_stages.back().pending;
+    }
+    return id;
+}
+
+void SGStageGraph::run(bool parallel, SGThreadPool* pool)
+{
+    if (!parallel || (_stages.size() < 2)) {
+        for (auto& stage : _stages) {
+            runStage(stage);
+        }
+    } else {
+        for (unsigned int i = 0; i < _stages.size(); ++i) {
+            if (_stages[i].pending == 0) _ready.push_back(i);
+        }
+
+        // One lane per stage at most; lanes without work return at once.
+        const int lanes = static_cast<int>(_stages.size());
+        (pool ? *pool : SGThreadPool::shared()).parallelFor(0, lanes, 1, [this](int begin, int end) {
+            for (int i = begin; i < end; ++i) lane();
+        });
+    }
+
+    if (_error) std::rethrow_exception(_error);
+}
+
+float SGStageGraph::seconds(int id) const
+{
+    return (id < 0) ? 0.0f : _stages[id].seconds;
+}
+
+void SGStageGraph::runStage(Stage& stage)
+{
+    const auto start = std::chrono::steady_clock::now();
+    try {
+        stage.fn();
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error) _error = std::current_exception();
+    }
+    const std::chrono::duration<float> elapsed = std::chrono::steady_clock::now() - start;
+    stage.seconds = elapsed.count();
+}
+
+// Run ready stages until every stage has been started.  A lane only
+// waits while another stage is running, which may make more ready.
+void SGStageGraph::lane()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (;;) {
+        _cond.wait(lock, [this]() {
+            return !_ready.empty() || (_started == _stages.size()) || (_running == 0);
+        });
+        if (_ready.empty()) return;
+
+        Stage& stage = _stages[_ready.front()];
+        _ready.pop_front();
+        ++_started;
+        ++_running;
+
+        lock.unlock();
+        runStage(stage);
+        lock.lock();
+
+        --_running;
+        for (int dependent : stage.dependents) {
+            if (--_stages[dependent].pending == 0) _ready.push_back(dependent);
+        }
+        _cond.notify_all();
+    }
+}
+
+} // namespace simgear
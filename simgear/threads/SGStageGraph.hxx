@@ -0,0 +1,65 @@
+// SGStageGraph.hxx - dependency graph of tasks run on a thread pool
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+namespace simgear {
+
+class SGThreadPool;
+
+/**
+ * A small dependency graph of stages, for work such as generating a
+ * terrain tile. Each stage is started as soon as the stages it depends on
+ * are complete, so independent stages run concurrently.
+ *
+ * A graph is run once. The first exception thrown by a stage is rethrown
+ * by run() after all stages have been run.
+ */
+class SGStageGraph
+{
+public:
+    /**
+     * Add a stage, returning its id. Stages may only depend on stages
+     * added before them.
+     */
+    int add(std::function<void()> fn, std::initializer_list<int> deps = {});
+
+    /**
+     * Run all stages. Without @a parallel, stages run on the calling
+     * thread in the order they were added; otherwise on @a pool, which
+     * defaults to SGThreadPool::shared().
+     */
+    void run(bool parallel, SGThreadPool* pool = nullptr);
+
+    /// Time taken by a stage in seconds, 0 for stages not in the graph.
+    float seconds(int id) const;
+
+private:
+    struct Stage {
+        std::function<void()> fn;
+        std::vector<int> dependents;
+        int pending = 0;
+        float seconds = 0.0f;
+    };
+
+    void runStage(Stage& stage);
+    void lane();
+
+    std::vector<Stage> _stages;
+    std::deque<int> _ready;
+    size_t _started = 0;
+    int _running = 0;
+    std::exception_ptr _error;
+    std::mutex _mutex;
+    std::condition_variable _cond;
+};
+
+} // namespace simgear
@@ -0,0 +1,122 @@
+#include <simgear_config.h>
+
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/threads/SGStageGraph.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
+
+using namespace simgear;
+
+void testDependencies()
+{
+    SGThreadPool pool(4);
+    for (int run = 0; run < 50; ++run) {
+        // a diamond with a tail: b and c only need a, d needs both
+        std::atomic<int> clock{0};
+        int start[5], end[5];
+        auto stage = [&](int i) {
+            return [&, i]() {
+                start[i] = ++clock;
+                end[i] = ++clock;
+            };
+        };
+
+        SGStageGraph graph;
+        const int a = graph.add(stage(0));
+        const int b = graph.add(stage(1), {a});
+        const int c = graph.add(stage(2), {a});
+        const int d = graph.add(stage(3), {b, c});
+        graph.add(stage(4), {d});
+        graph.run(true, &pool);
+
+        SG_VERIFY(start[1] > end[0]);
+        SG_VERIFY(start[2] > end[0]);
+        SG_VERIFY(start[3] > end[1]);
+        SG_VERIFY(start[3] > end[2]);
+        SG_VERIFY(start[4] > end[3]);
+    }
+}
+
+// Stages writing only their own outputs give the same result however they
+// are scheduled.
+std::vector<std::string> runPipeline(bool parallel, SGThreadPool& pool)
+{
+    std::vector<std::string> out(6);
+    SGStageGraph graph;
+    const int geometry = graph.add([&]() { out[0] = "geometry"; });
+    const int color = graph.add([&]() { out[1] = out[0] + "+color"; }, {geometry});
+    const int lines = graph.add([&]() { out[2] = out[0] + "+lines"; }, {geometry});
+    const int areas = graph.add([&]() { out[3] = out[0] + "+areas"; }, {geometry});
+    const int materials = graph.add([&]() { out[4] = out[2] + "+materials"; }, {lines});
+    graph.add([&]() { out[5] = out[1] + out[3] + out[4]; }, {color, areas, materials});
+    graph.run(parallel, &pool);
+    return out;
+}
+
+void testDeterminism()
+{
+    SGThreadPool pool(3);
+    const std::vector<std::string> expected = runPipeline(false, pool);
+    SG_CHECK_EQUAL(expected[5], "geometry+colorgeometry+areasgeometry+lines+materials");
+    for (int run = 0; run < 100; ++run) {
+        const std::vector<std::string> out = runPipeline(true, pool);
+        for (unsigned int i = 0; i < out.size(); ++i) {
+            SG_CHECK_EQUAL(out[i], expected[i]);
+        }
+    }
+}
+
+void testSerialOrder()
+{
+    SGThreadPool pool(2);
+    std::vector<int> order;
+    SGStageGraph graph;
+    const int a = graph.add([&]() { order.push_back(0); });
+    graph.add([&]() { order.push_back(1); });
+    graph.add([&]() { order.push_back(2); }, {a});
+    graph.run(false, &pool);
+    SG_CHECK_EQUAL(order.size(), 3u);
+    for (int i = 0; i < 3; ++i) {
+        SG_CHECK_EQUAL(order[i], i);
+    }
+}
+
+void testException()
+{
+    SGThreadPool pool(2);
+    for (bool parallel : {false, true}) {
+        std::atomic<int> ran{0};
+        SGStageGraph graph;
+        const int a = graph.add([&]() { ++ran; throw std::runtime_error("stage failed"); });
+        graph.add([&]() { ++ran; }, {a});
+        graph.add([&]() { ++ran; });
+
+        bool thrown = false;
+        try {
+            graph.run(parallel, &pool);
+        } catch (std::runtime_error& e) {
+            thrown = true;
+            SG_CHECK_EQUAL(std::string(e.what()), "stage failed");
+        }
+        SG_VERIFY(thrown);
+        // the other stages still ran
+        SG_CHECK_EQUAL(ran.load(), 3);
+        SG_CHECK_EQUAL(graph.seconds(-1), 0.0f);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    testDependencies();
+    testDeterminism();
+    testSerialOrder();
+    testException();
+
+    std::cout << "all tests passed successfully!" << std::endl;
+    return 0;
+}
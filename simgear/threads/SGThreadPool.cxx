@@ -0,0 +1,128 @@
+// SGThreadPool.cxx - fixed size pool of worker threads
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#include <simgear_config.h>
+
+#include "SGThreadPool.hxx"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace simgear {
+
+SGThreadPool::SGThreadPool(unsigned numThreads)
+{
+    if (numThreads == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        numThreads = hw > 1 ? hw - 1 : 1;
+    }
+
+    _threads.reserve(numThreads);
+    for (unsigned i = 0; i < numThreads; ++i) {
+        _threads.emplace_back(&SGThreadPool::run, this);
+    }
+}
+
+SGThreadPool::~SGThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _condition.notify_all();
+    for (auto& t : _threads) {
+        t.join();
+    }
+}
+
+SGThreadPool& SGThreadPool::shared()
+{
+    static SGThreadPool pool;
+    return pool;
+}
+
+std::future<void> SGThreadPool::submit(std::function<void()> task)
+{
+    std::packaged_task<void()> packaged(std::move(task));
+    std::future<void> result = packaged.get_future();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(packaged));
+    }
+    _condition.notify_one();
+    return result;
+}
+
+void SGThreadPool::run()
+{
+    for (;;) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _condition.wait(lock, [this] { return _stop || !_tasks.empty(); });
+            if (_tasks.empty()) {
+                return; // stopped and drained
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void SGThreadPool::parallelFor(int begin, int end, int grain,
+                               const std::function<void(int, int)>& fn)
+{
+    if (end <= begin) {
+        return;
+    }
+
+    grain = std::max(grain, 1);
+    const int numChunks = (end - begin + grain - 1) / grain;
+    if (numChunks == 1 || _threads.empty()) {
+        fn(begin, end);
+        return;
+    }
+
+    // Chunks are claimed through a shared counter. The caller only ever waits
+    // for chunks which a worker is actually processing, so a helper task that
+    // never gets scheduled (e.g. because all workers are busy, or because we
+    // are running inside a worker) cannot cause a deadlock.
+    struct State {
+        std::atomic<int> next{0};
+        int done = 0;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+
+    auto work = [state, begin, end, grain, numChunks, &fn]() {
+        int count = 0;
+        for (int c; (c = state->next.fetch_add(1)) < numChunks; ++count) {
+            int b = begin + c * grain;
+            fn(b, std::min(b + grain, end));
+        }
+        if (count > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->done += count;
+            if (state->done == numChunks) {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    // A helper may only start after we returned, when all chunks are
+    // claimed; it then exits without touching fn.
+    const int numHelpers = std::min<int>(numChunks - 1, size());
+    for (int i = 0; i < numHelpers; ++i) {
+        submit(work);
+    }
+
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state, numChunks] { return state->done == numChunks; });
+}
+
+} // namespace simgear
@@ -0,0 +1,66 @@
+// SGThreadPool.hxx - fixed size pool of worker threads
+// SPDX-License-Identifier: LGPL-2.0-or-later
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace simgear {
+
+/**
+ * A fixed number of worker threads executing queued tasks.
+ *
+ * Intended for splitting CPU bound work (image processing, geometry
+ * generation, loading) into chunks. parallelFor() lets the calling thread
+ * take part in the work, so it is safe to call from within a pool task.
+ */
+class SGThreadPool
+{
+public:
+    /**
+     * @param numThreads Number of worker threads; 0 means one less than
+     *                   the number of hardware threads (at least one).
+     */
+    explicit SGThreadPool(unsigned numThreads = 0);
+    ~SGThreadPool();
+
+    SGThreadPool(const SGThreadPool&) = delete;
+    SGThreadPool& operator=(const SGThreadPool&) = delete;
+
+    /**
+     * Process wide pool shared by the SimGear subsystems.
+     */
+    static SGThreadPool& shared();
+
+    unsigned size() const { return static_cast<unsigned>(_threads.size()); }
+
+    /**
+     * Queue a task for execution on one of the workers.
+     */
+    std::future<void> submit(std::function<void()> task);
+
+    /**
+     * Call @a fn(begin, end) for consecutive chunks of at most @a grain
+     * elements of the range [begin, end), spreading the chunks over the
+     * workers and the calling thread. Returns once all chunks are done.
+     */
+    void parallelFor(int begin, int end, int grain,
+                     const std::function<void(int, int)>& fn);
+
+private:
+    void run();
+
+    std::vector<std::thread> _threads;
+    std::deque<std::packaged_task<void()>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stop = false;
+};
+
+} // namespace simgear
@@ -0,0 +1,72 @@
+#include <simgear_config.h>
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+#include <simgear/misc/test_macros.hxx>
+#include <simgear/threads/SGThreadPool.hxx>
+
+using namespace simgear;
+
+void testSubmit()
+{
+    SGThreadPool pool(3);
+    SG_CHECK_EQUAL(pool.size(), 3u);
+
+    std::atomic<int> counter{0};
+    std::vector<std::future<void>> results;
+    for (int i = 0; i < 100; ++i) {
+        results.push_back(pool.submit([&counter] { ++counter; }));
+    }
+    for (auto& r : results) {
+        r.get();
+    }
+    SG_CHECK_EQUAL(counter.load(), 100);
+}
+
+void testParallelFor()
+{
+    SGThreadPool pool(4);
+    std::vector<int> values(10007, 0);
+    pool.parallelFor(0, static_cast<int>(values.size()), 64, [&values](int b, int e) {
+        for (int i = b; i < e; ++i) {
+            values[i] += i;
+        }
+    });
+    for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+        SG_CHECK_EQUAL(values[i], i);
+    }
+
+    // empty and single chunk ranges
+    int calls = 0;
+    pool.parallelFor(5, 5, 1, [&calls](int, int) { ++calls; });
+    SG_CHECK_EQUAL(calls, 0);
+    pool.parallelFor(0, 10, 100, [&calls](int b, int e) {
+        SG_CHECK_EQUAL(b, 0);
+        SG_CHECK_EQUAL(e, 10);
+        ++calls;
+    });
+    SG_CHECK_EQUAL(calls, 1);
+}
+
+void testNestedParallelFor()
+{
+    // every worker blocks in a nested parallelFor: must not deadlock
+    SGThreadPool pool(2);
+    std::atomic<int> sum{0};
+    pool.parallelFor(0, 8, 1, [&pool, &sum](int, int) {
+        pool.parallelFor(0, 100, 10, [&sum](int b, int e) { sum += e - b; });
+    });
+    SG_CHECK_EQUAL(sum.load(), 800);
+}
+
+int main(int argc, char* argv[])
+{
+    testSubmit();
+    testParallelFor();
+    testNestedParallelFor();
+
+    std::cout << "all tests passed successfully!" << std::endl;
+    return 0;
+}
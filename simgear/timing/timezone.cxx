@@ -32,6 +32,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <cstdlib>
+#include <mutex>
 
 #include <simgear/io/iostreams/sgstream.hxx>
 #include <simgear/structure/exception.hxx>
@@ -148,6 +149,10 @@ public:
             delete z;
         }
             
+        if (cache) {
+            ZDFreeCache(cache);
+        }
+
         if (cd) {
             ZDCloseDatabase(cd);
         }
@@ -155,6 +160,11 @@ public:
     
     SGMMapFile file;
     ZoneDetect *cd = nullptr;
+
+    // Lookups are typically made for nearby positions in a row (AI traffic,
+    // airports of a region), the cache reuses decoded polygons and results.
+    std::mutex cacheMutex;
+    ZoneDetectCache *cache = nullptr;
     const char* buffer = nullptr;
     size_t size = 0;
 
@@ -178,6 +188,7 @@ SGTimeZoneContainer::SGTimeZoneContainer(const SGPath& path) :
         if (!d->cd) {
           throw sg_io_exception("timezone database read error");
         }
+        d->cache = ZDCreateCache(d->cd, 8 * 1024 * 1024);
     }
   else // zone.tab is in filename
   {
@@ -252,7 +263,11 @@ SGTimeZone* SGTimeZoneContainer::getNearest(const SGGeod& ref) const
     float safezone = 0;
     float lat = ref.getLatitudeDeg();
     float lon = ref.getLongitudeDeg();
-    ZoneDetectResult *results = ZDLookup(d->cd, lat, lon, &safezone);
+    ZoneDetectResult *results = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(d->cacheMutex);
+      results = ZDLookupCached(d->cd, d->cache, lat, lon, &safezone);
+    }
     if (results && results[0].data)
     {
       for(unsigned i=0; i<results[0].numFields; ++i)
@@ -275,6 +290,7 @@ SGTimeZone* SGTimeZoneContainer::getNearest(const SGGeod& ref) const
         match = new SGTimeZone(ref, CountryAlpha2, (char*)desc.c_str());
       }
     }
+    ZDFreeResults(results);
   }
 
   return match;
@@ -85,6 +85,49 @@ struct ZoneDetectOpaque {
     uint32_t bboxOffset;
     uint32_t metadataOffset;
     uint32_t dataOffset;
+
+    /* Spatial index, see ZDBuildIndex() */
+    uint32_t numPolygons;
+    struct ZDPolygonBox *boxes;
+    uint32_t *gridStart;
+    uint32_t *gridItems;
+};
+
+struct ZDPolygonBox {
+    int32_t minLat, minLon, maxLat, maxLon;
+    uint32_t metadataIndex;
+    uint32_t polygonIndex;
+};
+
+struct ZDCachedPolygon {
+    uint32_t polygonId;
+    int32_t *points;
+    size_t length;
+
+    struct ZDCachedPolygon *lruPrev;
+    struct ZDCachedPolygon *lruNext;
+};
+
+struct ZoneDetectCacheOpaque {
+    const ZoneDetect *library;
+
+    /* Decoded polygons by id, least recently used last */
+    struct ZDCachedPolygon **polygons;
+    uint8_t *uncacheable;
+    struct ZDCachedPolygon *lruFirst;
+    struct ZDCachedPolygon *lruLast;
+    size_t size;
+    size_t maxSize;
+
+    /* Result of the last lookup, valid within lastSafeRadius */
+    uint8_t lastValid;
+    int32_t lastLat, lastLon;
+    uint64_t lastDistanceSqr;
+    double lastSafeRadius;
+    size_t lastNumResults;
+    ZoneDetectResult *lastResults;
+
+    ZoneDetectCacheStats stats;
 };
 
 static void (*zdErrorHandler)(int, int);
@@ -328,6 +371,184 @@ static int ZDParseHeader(ZoneDetect *library)
     return 0;
 }
 
+/*
+ * The bounding box table is decoded once and indexed by a coarse grid, each
+ * cell listing the polygons whose bounding box overlaps it in table order.
+ */
+#define ZD_GRID_LAT 64
+#define ZD_GRID_LON 128
+#define ZD_GRID_MAX_ITEMS 4194304
+
+static unsigned int ZDGridCell(const ZoneDetect *library, int32_t value, unsigned int cells)
+{
+    const int64_t offset = (int64_t)value + ((int64_t)1 << (library->precision - 1));
+    if(offset < 0) {
+        return 0;
+    }
+
+    const int64_t cell = (offset * cells) >> library->precision;
+    return (cell >= (int64_t)cells) ? cells - 1 : (unsigned int)cell;
+}
+
+static void ZDFreeIndex(ZoneDetect *library)
+{
+    free(library->boxes);
+    free(library->gridStart);
+    free(library->gridItems);
+    library->numPolygons = 0;
+    library->boxes = NULL;
+    library->gridStart = NULL;
+    library->gridItems = NULL;
+}
+
+static int ZDBuildIndex(ZoneDetect *library)
+{
+    if(library->precision < 8 || library->precision > 30) {
+        return -1;
+    }
+
+    size_t capacity = 1024;
+    library->boxes = malloc(capacity * sizeof *library->boxes);
+    if(!library->boxes) {
+        return -1;
+    }
+
+    uint32_t bboxIndex = library->bboxOffset;
+    uint32_t metadataIndex = 0, polygonIndex = 0;
+
+    while(bboxIndex < library->metadataOffset) {
+        int32_t minLat, minLon, maxLat, maxLon, metadataIndexDelta;
+        uint64_t polygonIndexDelta;
+        if(!ZDDecodeVariableLengthSigned(library, &bboxIndex, &minLat)) break;
+        if(!ZDDecodeVariableLengthSigned(library, &bboxIndex, &minLon)) break;
+        if(!ZDDecodeVariableLengthSigned(library, &bboxIndex, &maxLat)) break;
+        if(!ZDDecodeVariableLengthSigned(library, &bboxIndex, &maxLon)) break;
+        if(!ZDDecodeVariableLengthSigned(library, &bboxIndex, &metadataIndexDelta)) break;
+        if(!ZDDecodeVariableLengthUnsigned(library, &bboxIndex, &polygonIndexDelta)) break;
+
+        metadataIndex += (uint32_t)metadataIndexDelta;
+        polygonIndex += (uint32_t)polygonIndexDelta;
+
+        if(library->numPolygons == capacity) {
+            capacity *= 2;
+            struct ZDPolygonBox *const boxes = realloc(library->boxes, capacity * sizeof *boxes);
+            if(!boxes) {
+                goto fail;
+            }
+            library->boxes = boxes;
+        }
+
+        struct ZDPolygonBox *const box = &library->boxes[library->numPolygons++];
+        box->minLat = minLat;
+        box->minLon = minLon;
+        box->maxLat = maxLat;
+        box->maxLon = maxLon;
+        box->metadataIndex = metadataIndex;
+        box->polygonIndex = polygonIndex;
+    }
+
+    library->gridStart = calloc(ZD_GRID_LAT * ZD_GRID_LON + 1, sizeof *library->gridStart);
+    if(!library->gridStart) {
+        goto fail;
+    }
+
+    /* Count the polygons per cell, then fill the cells in table order */
+    size_t numItems = 0;
+    uint32_t i;
+    for(i = 0; i < library->numPolygons; i++) {
+        const struct ZDPolygonBox *const box = &library->boxes[i];
+        const unsigned int lat0 = ZDGridCell(library, box->minLat, ZD_GRID_LAT);
+        const unsigned int lat1 = ZDGridCell(library, box->maxLat, ZD_GRID_LAT);
+        const unsigned int lon0 = ZDGridCell(library, box->minLon, ZD_GRID_LON);
+        const unsigned int lon1 = ZDGridCell(library, box->maxLon, ZD_GRID_LON);
+        unsigned int lat, lon;
+        for(lat = lat0; lat <= lat1; lat++) {
+            for(lon = lon0; lon <= lon1; lon++) {
+                library->gridStart[lat * ZD_GRID_LON + lon + 1]++;
+                numItems++;
+            }
+        }
+        if(numItems > ZD_GRID_MAX_ITEMS) {
+            goto fail;
+        }
+    }
+
+    for(i = 0; i < ZD_GRID_LAT * ZD_GRID_LON; i++) {
+        library->gridStart[i + 1] += library->gridStart[i];
+    }
+
+    library->gridItems = malloc((numItems ? numItems : 1) * sizeof *library->gridItems);
+    uint32_t *const cursor = malloc(ZD_GRID_LAT * ZD_GRID_LON * sizeof *cursor);
+    if(!library->gridItems || !cursor) {
+        free(cursor);
+        goto fail;
+    }
+    memcpy(cursor, library->gridStart, ZD_GRID_LAT * ZD_GRID_LON * sizeof *cursor);
+
+    for(i = 0; i < library->numPolygons; i++) {
+        const struct ZDPolygonBox *const box = &library->boxes[i];
+        const unsigned int lat0 = ZDGridCell(library, box->minLat, ZD_GRID_LAT);
+        const unsigned int lat1 = ZDGridCell(library, box->maxLat, ZD_GRID_LAT);
+        const unsigned int lon0 = ZDGridCell(library, box->minLon, ZD_GRID_LON);
+        const unsigned int lon1 = ZDGridCell(library, box->maxLon, ZD_GRID_LON);
+        unsigned int lat, lon;
+        for(lat = lat0; lat <= lat1; lat++) {
+            for(lon = lon0; lon <= lon1; lon++) {
+                library->gridItems[cursor[lat * ZD_GRID_LON + lon]++] = i;
+            }
+        }
+    }
+
+    free(cursor);
+    return 0;
+
+fail:
+    ZDFreeIndex(library);
+    return -1;
+}
+
+/* Squared distance as used for the safezone, lon has half scale */
+static uint64_t ZDDistanceSqr(int64_t diffLat, int64_t diffLon)
+{
+    return (uint64_t)(diffLat * diffLat) + (uint64_t)(diffLon * diffLon) * 4;
+}
+
+static uint64_t ZDBoxDistanceSqr(const struct ZDPolygonBox *box, int32_t lat, int32_t lon)
+{
+    int64_t diffLat = 0, diffLon = 0;
+    if(lat < box->minLat) {
+        diffLat = (int64_t)box->minLat - lat;
+    } else if(lat > box->maxLat) {
+        diffLat = (int64_t)lat - box->maxLat;
+    }
+    if(lon < box->minLon) {
+        diffLon = (int64_t)box->minLon - lon;
+    } else if(lon > box->maxLon) {
+        diffLon = (int64_t)lon - box->maxLon;
+    }
+    return ZDDistanceSqr(diffLat, diffLon);
+}
+
+/* Squared distance to the nearest edge of the grid cell containing the point */
+static uint64_t ZDCellClearanceSqr(const ZoneDetect *library, unsigned int cellLat, unsigned int cellLon, int32_t lat, int32_t lon)
+{
+    const int64_t half = (int64_t)1 << (library->precision - 1);
+    const int64_t sizeLat = ((int64_t)1 << library->precision) / ZD_GRID_LAT;
+    const int64_t sizeLon = ((int64_t)1 << library->precision) / ZD_GRID_LON;
+    const int64_t minLat = cellLat * sizeLat - half, maxLat = minLat + sizeLat - 1;
+    const int64_t minLon = cellLon * sizeLon - half, maxLon = minLon + sizeLon - 1;
+
+    if(lat < minLat || lat > maxLat || lon < minLon || lon > maxLon) {
+        return 0;
+    }
+
+    const int64_t diffLat = (lat - minLat < maxLat - lat) ? lat - minLat : maxLat - lat;
+    const int64_t diffLon = (lon - minLon < maxLon - lon) ? lon - minLon : maxLon - lon;
+    const uint64_t distanceLat = ZDDistanceSqr(diffLat, 0);
+    const uint64_t distanceLon = ZDDistanceSqr(0, diffLon);
+    return (distanceLat < distanceLon) ? distanceLat : distanceLon;
+}
+
 static int ZDPointInBox(int32_t xl, int32_t x, int32_t xr, int32_t yl, int32_t y, int32_t yr)
 {
     if((xl <= x && x <= xr) || (xr <= x && x <= xl)) {
@@ -635,22 +856,32 @@ fail:
     return NULL;
 }
 
-static ZDLookupResult ZDPointInPolygon(const ZoneDetect *library, uint32_t polygonIndex, int32_t latFixedPoint, int32_t lonFixedPoint, uint64_t *distanceSqrMin)
+static ZDLookupResult ZDPointInPolygon(const ZoneDetect *library, uint32_t polygonIndex, const int32_t *points, size_t length, int32_t latFixedPoint, int32_t lonFixedPoint, uint64_t *distanceSqrMin)
 {
     int32_t pointLat, pointLon, prevLat = 0, prevLon = 0;
     int prevQuadrant = 0, winding = 0;
 
     uint8_t first = 1;
+    size_t pointIndex = 0;
 
     struct Reader reader;
     ZDReaderInit(&reader, library, polygonIndex);
 
     while(1) {
-        int result = ZDReaderGetPoint(&reader, &pointLat, &pointLon);
-        if(result < 0) {
-            return ZD_LOOKUP_PARSE_ERROR;
-        } else if(result == 0) {
-            break;
+        /* Use the decoded points if given, read them from the database otherwise */
+        if(points) {
+            if(pointIndex >= length) {
+                break;
+            }
+            pointLat = points[pointIndex++];
+            pointLon = points[pointIndex++];
+        } else {
+            int result = ZDReaderGetPoint(&reader, &pointLat, &pointLon);
+            if(result < 0) {
+                return ZD_LOOKUP_PARSE_ERROR;
+            } else if(result == 0) {
+                break;
+            }
         }
 
         /* Check if point is ON the border */
@@ -797,6 +1028,7 @@ void ZDCloseDatabase(ZoneDetect *library)
         if(library->notice) {
             free(library->notice);
         }
+        ZDFreeIndex(library);
 
         if(library->closeType == 0) {
 #if defined(_MSC_VER) || defined(__MINGW32__)
@@ -838,6 +1070,9 @@ ZoneDetect *ZDOpenDatabaseFromMemory(void* buffer, size_t length)
             zdError(ZD_E_PARSE_HEADER, 0);
             goto fail;
         }
+
+        /* Without the index lookups fall back to a linear scan */
+        ZDBuildIndex(library);
     }
 
     return library;
@@ -905,6 +1140,9 @@ ZoneDetect *ZDOpenDatabase(const char *path)
             zdError(ZD_E_PARSE_HEADER, 0);
             goto fail;
         }
+
+        /* Without the index lookups fall back to a linear scan */
+        ZDBuildIndex(library);
     }
 
     return library;
@@ -914,23 +1152,225 @@ fail:
     return NULL;
 }
 
-ZoneDetectResult *ZDLookup(const ZoneDetect *library, float lat, float lon, float *safezone)
+/*
+ * Cache of decoded polygons, see ZDCreateCache()
+ */
+
+static void ZDCacheUnlink(ZoneDetectCache *cache, struct ZDCachedPolygon *entry)
 {
-    const int32_t latFixedPoint = ZDFloatToFixedPoint(lat, 90, library->precision);
-    const int32_t lonFixedPoint = ZDFloatToFixedPoint(lon, 180, library->precision);
-    size_t numResults = 0;
-    uint64_t distanceSqrMin = (uint64_t)-1;
+    if(entry->lruPrev) entry->lruPrev->lruNext = entry->lruNext;
+    else cache->lruFirst = entry->lruNext;
+    if(entry->lruNext) entry->lruNext->lruPrev = entry->lruPrev;
+    else cache->lruLast = entry->lruPrev;
+    entry->lruPrev = entry->lruNext = NULL;
+}
 
-    /* Iterate over all polygons */
-    uint32_t bboxIndex = library->bboxOffset;
-    uint32_t metadataIndex = 0;
-    uint32_t polygonIndex = 0;
+static void ZDCachePushFront(ZoneDetectCache *cache, struct ZDCachedPolygon *entry)
+{
+    entry->lruPrev = NULL;
+    entry->lruNext = cache->lruFirst;
+    if(cache->lruFirst) cache->lruFirst->lruPrev = entry;
+    else cache->lruLast = entry;
+    cache->lruFirst = entry;
+}
+
+static void ZDCacheRemove(ZoneDetectCache *cache, struct ZDCachedPolygon *entry)
+{
+    ZDCacheUnlink(cache, entry);
+    cache->polygons[entry->polygonId] = NULL;
+    cache->size -= entry->length * sizeof(int32_t);
+    free(entry->points);
+    free(entry);
+}
+
+static const int32_t *ZDCacheGetPolygon(ZoneDetectCache *cache, uint32_t polygonId, uint32_t polygonIndex, size_t *length)
+{
+    const ZoneDetect *const library = cache->library;
+    if(polygonId >= library->numPolygons || cache->uncacheable[polygonId]) {
+        return NULL;
+    }
+
+    struct ZDCachedPolygon *entry = cache->polygons[polygonId];
+    if(entry) {
+        cache->stats.polygonHits++;
+        ZDCacheUnlink(cache, entry);
+        ZDCachePushFront(cache, entry);
+        *length = entry->length;
+        return entry->points;
+    }
+
+    cache->stats.polygonMisses++;
+
+    size_t listLength = 0;
+    int32_t *const points = ZDPolygonToListInternal(library, polygonIndex, &listLength);
+    if(!points || listLength * sizeof(int32_t) > cache->maxSize) {
+        free(points);
+        cache->uncacheable[polygonId] = 1;
+        return NULL;
+    }
+
+    entry = malloc(sizeof *entry);
+    if(!entry) {
+        free(points);
+        return NULL;
+    }
+
+    while(cache->lruLast && cache->size + listLength * sizeof(int32_t) > cache->maxSize) {
+        ZDCacheRemove(cache, cache->lruLast);
+    }
+
+    entry->polygonId = polygonId;
+    entry->points = points;
+    entry->length = listLength;
+    ZDCachePushFront(cache, entry);
+    cache->polygons[polygonId] = entry;
+    cache->size += listLength * sizeof(int32_t);
+
+    *length = listLength;
+    return points;
+}
+
+ZoneDetectCache *ZDCreateCache(const ZoneDetect *library, size_t maxBytes)
+{
+    if(!library || !library->gridStart) {
+        return NULL;
+    }
+
+    ZoneDetectCache *const cache = malloc(sizeof *cache);
+    if(!cache) {
+        return NULL;
+    }
+
+    memset(cache, 0, sizeof(*cache));
+    cache->library = library;
+    cache->maxSize = maxBytes;
+    cache->polygons = calloc(library->numPolygons ? library->numPolygons : 1, sizeof *cache->polygons);
+    cache->uncacheable = calloc(library->numPolygons ? library->numPolygons : 1, sizeof *cache->uncacheable);
+    if(!cache->polygons || !cache->uncacheable) {
+        ZDFreeCache(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+void ZDFreeCache(ZoneDetectCache *cache)
+{
+    if(cache) {
+        while(cache->lruFirst) {
+            ZDCacheRemove(cache, cache->lruFirst);
+        }
+        free(cache->polygons);
+        free(cache->uncacheable);
+        free(cache->lastResults);
+        free(cache);
+    }
+}
+
+void ZDGetCacheStats(const ZoneDetectCache *cache, ZoneDetectCacheStats *stats)
+{
+    if(cache && stats) {
+        *stats = cache->stats;
+    }
+}
+
+/*
+ * Lookup
+ */
+
+static int ZDAddResult(const ZoneDetect *library, ZoneDetectResult **results, size_t *numResults, uint32_t polygonId, uint32_t metadataIndex, ZDLookupResult lookupResult)
+{
+    ZoneDetectResult *const newResults = realloc(*results, sizeof *newResults * (*numResults + 2));
+    if(!newResults) {
+        return 0;
+    }
+
+    *results = newResults;
+    newResults[*numResults].polygonId = polygonId;
+    newResults[*numResults].metaId = metadataIndex;
+    newResults[*numResults].numFields = library->numFields;
+    newResults[*numResults].fieldNames = library->fieldNames;
+    newResults[*numResults].lookupResult = lookupResult;
+    newResults[*numResults].data = NULL;
+    (*numResults)++;
+    return 1;
+}
+
+/* Returns 0 if the lookup should stop */
+static int ZDTestPolygon(const ZoneDetect *library, ZoneDetectCache *cache, uint32_t polygonId, uint32_t metadataIndex, uint32_t polygonIndex, int32_t latFixedPoint, int32_t lonFixedPoint, uint64_t *distanceSqrMin, ZoneDetectResult **results, size_t *numResults)
+{
+    const int32_t *points = NULL;
+    size_t length = 0;
+    if(cache) {
+        points = ZDCacheGetPolygon(cache, polygonId, library->dataOffset + polygonIndex, &length);
+    }
+
+    const ZDLookupResult lookupResult = ZDPointInPolygon(library, library->dataOffset + polygonIndex, points, length, latFixedPoint, lonFixedPoint, distanceSqrMin);
+    if(lookupResult == ZD_LOOKUP_PARSE_ERROR) {
+        return 0;
+    } else if(lookupResult != ZD_LOOKUP_NOT_IN_ZONE) {
+        return ZDAddResult(library, results, numResults, polygonId, metadataIndex, lookupResult);
+    }
+
+    return 1;
+}
+
+/*
+ * Tests all polygons whose bounding box contains the point, using the grid
+ * index if there is one and useIndex is set. If clearanceSqr is given it
+ * receives the squared distance within which no other bounding box can be
+ * entered, which needs the index.
+ */
+static ZoneDetectResult *ZDCollectResults(const ZoneDetect *library, ZoneDetectCache *cache, int32_t latFixedPoint, int32_t lonFixedPoint, uint64_t *distanceSqrMin, uint64_t *clearanceSqr, size_t *numResultsPtr, int useIndex)
+{
+    size_t numResults = 0;
 
     ZoneDetectResult *results = malloc(sizeof *results);
     if(!results) {
         return NULL;
     }
 
+    if(clearanceSqr) {
+        *clearanceSqr = 0;
+    }
+
+    if(library->gridStart && useIndex) {
+        const unsigned int cellLat = ZDGridCell(library, latFixedPoint, ZD_GRID_LAT);
+        const unsigned int cellLon = ZDGridCell(library, lonFixedPoint, ZD_GRID_LON);
+        const unsigned int cell = cellLat * ZD_GRID_LON + cellLon;
+
+        if(clearanceSqr) {
+            *clearanceSqr = ZDCellClearanceSqr(library, cellLat, cellLon, latFixedPoint, lonFixedPoint);
+        }
+
+        uint32_t i;
+        for(i = library->gridStart[cell]; i < library->gridStart[cell + 1]; i++) {
+            const uint32_t polygonId = library->gridItems[i];
+            const struct ZDPolygonBox *const box = &library->boxes[polygonId];
+
+            if(latFixedPoint >= box->minLat &&
+                    latFixedPoint <= box->maxLat &&
+                    lonFixedPoint >= box->minLon &&
+                    lonFixedPoint <= box->maxLon) {
+                if(!ZDTestPolygon(library, cache, polygonId, box->metadataIndex, box->polygonIndex, latFixedPoint, lonFixedPoint, distanceSqrMin, &results, &numResults)) {
+                    break;
+                }
+            } else if(clearanceSqr) {
+                const uint64_t distanceSqr = ZDBoxDistanceSqr(box, latFixedPoint, lonFixedPoint);
+                if(distanceSqr < *clearanceSqr) {
+                    *clearanceSqr = distanceSqr;
+                }
+            }
+        }
+
+        *numResultsPtr = numResults;
+        return results;
+    }
+
+    /* Iterate over all polygons */
+    uint32_t bboxIndex = library->bboxOffset;
+    uint32_t metadataIndex = 0;
+    uint32_t polygonIndex = 0;
     uint32_t polygonId = 0;
 
     while(bboxIndex < library->metadataOffset) {
@@ -950,25 +1390,8 @@ ZoneDetectResult *ZDLookup(const ZoneDetect *library, float lat, float lon, floa
             if(latFixedPoint <= maxLat &&
                     lonFixedPoint >= minLon &&
                     lonFixedPoint <= maxLon) {
-
-                const ZDLookupResult lookupResult = ZDPointInPolygon(library, library->dataOffset + polygonIndex, latFixedPoint, lonFixedPoint, (safezone) ? &distanceSqrMin : NULL);
-                if(lookupResult == ZD_LOOKUP_PARSE_ERROR) {
+                if(!ZDTestPolygon(library, cache, polygonId, metadataIndex, polygonIndex, latFixedPoint, lonFixedPoint, distanceSqrMin, &results, &numResults)) {
                     break;
-                } else if(lookupResult != ZD_LOOKUP_NOT_IN_ZONE) {
-                    ZoneDetectResult *const newResults = realloc(results, sizeof *newResults * (numResults + 2));
-
-                    if(newResults) {
-                        results = newResults;
-                        results[numResults].polygonId = polygonId;
-                        results[numResults].metaId = metadataIndex;
-                        results[numResults].numFields = library->numFields;
-                        results[numResults].fieldNames = library->fieldNames;
-                        results[numResults].lookupResult = lookupResult;
-
-                        numResults++;
-                    } else {
-                        break;
-                    }
                 }
             }
         } else {
@@ -979,7 +1402,12 @@ ZoneDetectResult *ZDLookup(const ZoneDetect *library, float lat, float lon, floa
         polygonId++;
     }
 
-    /* Clean up results */
+    *numResultsPtr = numResults;
+    return results;
+}
+
+static size_t ZDMergeResults(ZoneDetectResult *results, size_t numResults)
+{
     size_t i;
     for(i = 0; i < numResults; i++) {
         int insideSum = 0;
@@ -1021,8 +1449,13 @@ ZoneDetectResult *ZDLookup(const ZoneDetect *library, float lat, float lon, floa
         }
     }
     numResults = newNumResults;
+    return numResults;
+}
 
-    /* Lookup metadata */
+/* Parses the metadata of the results and terminates the list, frees the results on failure */
+static ZoneDetectResult *ZDLookupMetadata(const ZoneDetect *library, ZoneDetectResult *results, size_t numResults)
+{
+    size_t i;
     for(i = 0; i < numResults; i++) {
         uint32_t tmpIndex = library->metadataOffset + results[i].metaId;
         results[i].data = malloc(library->numFields * sizeof *results[i].data);
@@ -1080,8 +1513,133 @@ ZoneDetectResult *ZDLookup(const ZoneDetect *library, float lat, float lon, floa
     results[numResults].fieldNames = NULL;
     results[numResults].data = NULL;
 
-    if(safezone) {
-        *safezone = sqrtf((float)distanceSqrMin) * 90 / (float)(1 << (library->precision - 1));
+    return results;
+}
+
+static float ZDSafezone(const ZoneDetect *library, double distance)
+{
+    return (float)distance * 90 / (float)(1 << (library->precision - 1));
+}
+
+static ZoneDetectResult *ZDLookupInternal(const ZoneDetect *library, float lat, float lon, float *safezone, int useIndex)
+{
+    const int32_t latFixedPoint = ZDFloatToFixedPoint(lat, 90, library->precision);
+    const int32_t lonFixedPoint = ZDFloatToFixedPoint(lon, 180, library->precision);
+    size_t numResults = 0;
+    uint64_t distanceSqrMin = (uint64_t)-1;
+
+    ZoneDetectResult *results = ZDCollectResults(library, NULL, latFixedPoint, lonFixedPoint, (safezone) ? &distanceSqrMin : NULL, NULL, &numResults, useIndex);
+    if(!results) {
+        return NULL;
+    }
+
+    numResults = ZDMergeResults(results, numResults);
+    results = ZDLookupMetadata(library, results, numResults);
+
+    if(results && safezone) {
+        *safezone = ZDSafezone(library, sqrt((double)distanceSqrMin));
+    }
+
+    return results;
+}
+
+ZoneDetectResult *ZDLookup(const ZoneDetect *library, float lat, float lon, float *safezone)
+{
+    return ZDLookupInternal(library, lat, lon, safezone, 1);
+}
+
+ZoneDetectResult *ZDLookupLinear(const ZoneDetect *library, float lat, float lon, float *safezone)
+{
+    return ZDLookupInternal(library, lat, lon, safezone, 0);
+}
+
+/*
+ * Margin in fixed point units for the rounding of the border distances, which
+ * are computed in single precision.
+ */
+#define ZD_SAFEZONE_MARGIN 4.0
+
+ZoneDetectResult *ZDLookupCached(const ZoneDetect *library, ZoneDetectCache *cache, float lat, float lon, float *safezone)
+{
+    if(!cache || cache->library != library) {
+        return ZDLookup(library, lat, lon, safezone);
+    }
+
+    const int32_t latFixedPoint = ZDFloatToFixedPoint(lat, 90, library->precision);
+    const int32_t lonFixedPoint = ZDFloatToFixedPoint(lon, 180, library->precision);
+    size_t numResults = 0;
+    ZoneDetectResult *results;
+
+    cache->stats.lookups++;
+
+    /*
+     * Within the safe radius of the last lookup no polygon border is crossed
+     * and no other bounding box is entered, so the result is the same.
+     */
+    if(cache->lastValid) {
+        const double diffLat = (double)latFixedPoint - cache->lastLat;
+        const double diffLon = 2.0 * ((double)lonFixedPoint - cache->lastLon);
+        const double moved = sqrt(diffLat * diffLat + diffLon * diffLon);
+
+        if(moved < cache->lastSafeRadius) {
+            numResults = cache->lastNumResults;
+            results = malloc(sizeof *results * (numResults + 1));
+            if(!results) {
+                return NULL;
+            }
+
+            if(numResults) {
+                memcpy(results, cache->lastResults, sizeof *results * numResults);
+            }
+            cache->stats.lastResultHits++;
+
+            results = ZDLookupMetadata(library, results, numResults);
+            if(results && safezone) {
+                *safezone = ZDSafezone(library, sqrt((double)cache->lastDistanceSqr) - moved);
+            }
+            return results;
+        }
+    }
+
+    uint64_t distanceSqrMin = (uint64_t)-1;
+    uint64_t clearanceSqr = 0;
+
+    cache->lastValid = 0;
+    results = ZDCollectResults(library, cache, latFixedPoint, lonFixedPoint, &distanceSqrMin, &clearanceSqr, &numResults, 1);
+    if(!results) {
+        return NULL;
+    }
+
+    numResults = ZDMergeResults(results, numResults);
+
+    /*
+     * Remember the result for the next lookup. The border distance is taken
+     * to the nearest point of the segment without the half scale of lon, so
+     * it may be up to twice the actual distance.
+     */
+    const double borderDistance = 0.5 * sqrt((double)distanceSqrMin);
+    const double clearance = sqrt((double)clearanceSqr);
+    const double safeRadius = ((borderDistance < clearance) ? borderDistance : clearance) - ZD_SAFEZONE_MARGIN;
+    if(safeRadius > 0) {
+        ZoneDetectResult *const lastResults = realloc(cache->lastResults, sizeof *lastResults * (numResults + 1));
+        if(lastResults) {
+            cache->lastResults = lastResults;
+            if(numResults) {
+                memcpy(lastResults, results, sizeof *lastResults * numResults);
+            }
+            cache->lastNumResults = numResults;
+            cache->lastLat = latFixedPoint;
+            cache->lastLon = lonFixedPoint;
+            cache->lastDistanceSqr = distanceSqrMin;
+            cache->lastSafeRadius = safeRadius;
+            cache->lastValid = 1;
+        }
+    }
+
+    results = ZDLookupMetadata(library, results, numResults);
+
+    if(results && safezone) {
+        *safezone = ZDSafezone(library, sqrt((double)distanceSqrMin));
     }
 
     return results;
@@ -63,6 +63,16 @@ typedef struct {
 struct ZoneDetectOpaque;
 typedef struct ZoneDetectOpaque ZoneDetect;
 
+struct ZoneDetectCacheOpaque;
+typedef struct ZoneDetectCacheOpaque ZoneDetectCache;
+
+typedef struct {
+    uint64_t lookups;
+    uint64_t lastResultHits;
+    uint64_t polygonHits;
+    uint64_t polygonMisses;
+} ZoneDetectCacheStats;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -74,6 +84,22 @@ ZD_EXPORT void        ZDCloseDatabase(ZoneDetect *library);
 ZD_EXPORT ZoneDetectResult *ZDLookup(const ZoneDetect *library, float lat, float lon, float *safezone);
 ZD_EXPORT void              ZDFreeResults(ZoneDetectResult *results);
 
+/*
+ * Same as ZDLookup() without the spatial index, scanning the bounding box
+ * table. Slower, for checking the index.
+ */
+ZD_EXPORT ZoneDetectResult *ZDLookupLinear(const ZoneDetect *library, float lat, float lon, float *safezone);
+
+/*
+ * Optional cache for repeated lookups, keeping up to maxBytes of decoded
+ * polygons and reusing the last result while the point stays within its
+ * safezone. A cache must not be used by several threads at once.
+ */
+ZD_EXPORT ZoneDetectCache  *ZDCreateCache(const ZoneDetect *library, size_t maxBytes);
+ZD_EXPORT void              ZDFreeCache(ZoneDetectCache *cache);
+ZD_EXPORT ZoneDetectResult *ZDLookupCached(const ZoneDetect *library, ZoneDetectCache *cache, float lat, float lon, float *safezone);
+ZD_EXPORT void              ZDGetCacheStats(const ZoneDetectCache *cache, ZoneDetectCacheStats *stats);
+
 ZD_EXPORT const char *ZDGetNotice(const ZoneDetect *library);
 ZD_EXPORT uint8_t     ZDGetTableType(const ZoneDetect *library);
 ZD_EXPORT const char *ZDLookupResultToString(ZDLookupResult result);
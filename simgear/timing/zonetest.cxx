@@ -29,8 +29,11 @@
 #include <string>
 #include <cstdio>
 #include <cstdlib>
+#include <random>
+#include <vector>
 
 #include <simgear/misc/sg_path.hxx>
+#include <simgear/timing/timestamp.hxx>
 
 #define ZD_EXPORT
 #include "zonedetect.h"
@@ -40,6 +43,112 @@ static void onError(int errZD, int errNative)
     fprintf(stderr, "ZD error: %s (0x%08X)\n", ZDGetErrorString(errZD), (unsigned)errNative);
 }
 
+// Polygon and metadata ids of a lookup result, to compare lookups
+static std::string resultKey(ZoneDetectResult *results)
+{
+    std::string key;
+    if (!results) {
+        return "null";
+    }
+    for (unsigned i = 0; results[i].lookupResult != ZD_LOOKUP_END; ++i) {
+        key += std::to_string(results[i].polygonId) + ":" +
+               std::to_string(results[i].metaId) + ":" +
+               std::to_string(results[i].lookupResult) + " ";
+    }
+    return key;
+}
+
+// Time a million lookups at random positions and along random tracks, with
+// the grid index and a lookup cache, checking both against a linear scan of
+// a tenth of the points.
+static int benchmark(ZoneDetect *cd)
+{
+    const size_t linearStride = 10;
+    const size_t count = 1000000;
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<float> lat(-90.0f, 90.0f);
+    std::uniform_real_distribution<float> lon(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> step(-0.01f, 0.01f);
+
+    std::vector<std::pair<float, float>> random, tracks;
+    random.reserve(count);
+    tracks.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        random.emplace_back(lat(gen), lon(gen));
+
+        // Restart the track every 1000 points
+        if (i % 1000 == 0) {
+            tracks.emplace_back(lat(gen) * 0.9f, lon(gen) * 0.9f);
+        } else {
+            const auto& p = tracks.back();
+            tracks.emplace_back(p.first + step(gen), p.second + step(gen));
+        }
+    }
+
+    int failures = 0;
+    for (const auto* points : {&random, &tracks}) {
+        const char* name = (points == &random) ? "random" : "tracks";
+        std::vector<std::string> expected;
+        expected.reserve(count);
+
+        SGTimeStamp start = SGTimeStamp::now();
+        for (const auto& p : *points) {
+            ZoneDetectResult *results = ZDLookup(cd, p.first, p.second, nullptr);
+            expected.push_back(resultKey(results));
+            ZDFreeResults(results);
+        }
+        const double plain = (SGTimeStamp::now() - start).toSecs();
+
+        start = SGTimeStamp::now();
+        size_t linearLookups = 0, indexMismatches = 0;
+        for (size_t i = 0; i < points->size(); i += linearStride) {
+            const auto& p = (*points)[i];
+            ZoneDetectResult *results = ZDLookupLinear(cd, p.first, p.second, nullptr);
+            if (resultKey(results) != expected[i]) {
+                ++indexMismatches;
+            }
+            ZDFreeResults(results);
+            ++linearLookups;
+        }
+        const double linear = (SGTimeStamp::now() - start).toSecs();
+
+        ZoneDetectCache *cache = ZDCreateCache(cd, 8 * 1024 * 1024);
+        start = SGTimeStamp::now();
+        size_t mismatches = 0;
+        for (size_t i = 0; i < points->size(); ++i) {
+            const auto& p = (*points)[i];
+            float safezone = 0;
+            ZoneDetectResult *results = ZDLookupCached(cd, cache, p.first, p.second, &safezone);
+            if (resultKey(results) != expected[i]) {
+                ++mismatches;
+            }
+            ZDFreeResults(results);
+        }
+        const double cached = (SGTimeStamp::now() - start).toSecs();
+
+        ZoneDetectCacheStats stats = {};
+        ZDGetCacheStats(cache, &stats);
+        ZDFreeCache(cache);
+
+        printf("%s: %zu lookups, linear %.3fs (%zu lookups, %.3fs scaled), grid %.3fs, "
+               "cached %.3fs (%llu last result hits, %llu/%llu polygon cache hits/misses)\n",
+               name, points->size(), linear, linearLookups, linear * linearStride, plain, cached,
+               (unsigned long long)stats.lastResultHits,
+               (unsigned long long)stats.polygonHits,
+               (unsigned long long)stats.polygonMisses);
+        if (indexMismatches) {
+            printf("%s: %zu indexed lookups differ from the linear scan\n", name, indexMismatches);
+            failures++;
+        }
+        if (mismatches) {
+            printf("%s: %zu cached lookups differ\n", name, mismatches);
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
 int main(int argc, char *argv[])
 {
     if(argc != 2) {
@@ -93,7 +202,9 @@ int main(int argc, char *argv[])
             }
         }
     }
+    printf("\nBenchmarking lookups...\n");
+    const int failures = benchmark(cd);
     ZDCloseDatabase(cd);
 
-    return 0;
+    return failures ? 3 : 0;
 }